@@ -8,6 +8,7 @@
 
 #include <cicada/apply_cube_prune.hpp>
 #include <cicada/apply_cube_prune_diverse.hpp>
+#include <cicada/apply_cube_prune_parallel.hpp>
 #include <cicada/apply_cube_prune_rejection.hpp>
 #include <cicada/apply_cube_grow.hpp>
 #include <cicada/apply_cube_grow_coarse.hpp>
@@ -9,6 +9,7 @@
 #include <numeric>
 
 #include <cicada/apply_state_less.hpp>
+#include <cicada/apply_edge_delta.hpp>
 #include <cicada/hypergraph.hpp>
 #include <cicada/model.hpp>
 
@@ -75,10 +76,14 @@ namespace cicada
     
     typedef utils::small_vector<int, std::allocator<int> > index_set_type;
     
+    typedef ApplyEdgeDelta edge_delta_type;
+    typedef edge_delta_type::range_type feature_range_type;
+    
+    // we do not keep an edge for each candidate, but the difference of features from in_edge, 
+    // and materialize the edge only when appended to the output forest
     struct Candidate
     {
       const edge_type* in_edge;
-      edge_type        out_edge;
 
       state_type state;
       
@@ -86,11 +91,15 @@ namespace cicada
       
       score_type score;
       
+      feature_range_type features;
+      
+      id_type node;
+      
       Candidate(const index_set_type& __j)
-	: in_edge(0), j(__j) {}
+	: in_edge(0), j(__j), node(hypergraph_type::invalid) {}
 
       Candidate(const edge_type& __edge, const index_set_type& __j)
-	: in_edge(&__edge), out_edge(__edge), j(__j) {}
+	: in_edge(&__edge), j(__j), node(hypergraph_type::invalid) {}
     };
 
     typedef Candidate candidate_type;
@@ -196,6 +205,7 @@ namespace cicada
 	//cube_prune(graph_in);
 	
 	candidates.clear();
+	edge_delta.clear();
 	
 	node_states.clear();
 	node_states.reserve(graph_in.nodes.size() * cube_size_max);
@@ -336,7 +346,7 @@ namespace cicada
 	  }
 	  
 	  // assign true head
-	  candidate.out_edge.head = graph_out.goal;
+	  candidate.node = graph_out.goal;
 	} else {
 	  // we will merge states, but do not merge score/estimates, since we
 	  // are enumerating jth best derivations... is this correct?
@@ -355,11 +365,18 @@ namespace cicada
 	  }
 	  
 	  // assign true head
-	  candidate.out_edge.head = result.first->second;
+	  candidate.node = result.first->second;
 	}
 	
-	edge_type& edge = graph_out.add_edge(candidate.out_edge);
-	graph_out.connect_edge(edge.id, candidate.out_edge.head);
+	// materialize edge...
+	edge_type& edge = graph_out.add_edge(*candidate.in_edge);
+	
+	for (size_t i = 0; i != candidate.j.size(); ++ i)
+	  edge.tails[i] = states[candidate.in_edge->tails[i]].D[candidate.j[i]]->node;
+	
+	edge_delta.materialize(edge.features, candidate.features);
+	
+	graph_out.connect_edge(edge.id, candidate.node);
 	
 	if (prune_bin)
 	  edge.attributes[attr_prune_bin] = attribute_set_type::int_type(item->in_edge->head);
@@ -394,18 +411,22 @@ namespace cicada
       candidate_type& candidate = candidates.back();
       
 #if 1
+      edge_type& edge_apply = edge_delta.prepare(edge);
+      
       candidate.score = semiring::traits<score_type>::one();
       for (size_t i = 0; i != j.size(); ++ i) {
 	const candidate_type& antecedent = *states[edge.tails[i]].D[j[i]];
 	
 	// assign real-node-id
-	candidate.out_edge.tails[i] = antecedent.out_edge.head;
-	candidate.score *= scores[antecedent.out_edge.head];
+	edge_apply.tails[i] = antecedent.node;
+	candidate.score *= scores[antecedent.node];
       }
       
-      candidate.state = model.apply(node_states, candidate.out_edge, candidate.out_edge.features, is_goal);
+      candidate.state = model.apply(node_states, edge_apply, edge_apply.features, is_goal);
       
-      candidate.score *= function(candidate.out_edge.features);
+      candidate.score *= function(edge_apply.features);
+      
+      candidate.features = edge_delta.commit(edge);
 #endif
       
 #if 0
@@ -480,6 +501,7 @@ namespace cicada
     
   private:
     candidate_set_type  candidates;
+    edge_delta_type     edge_delta;
     
     state_set_type      node_states;
     score_set_type      scores;
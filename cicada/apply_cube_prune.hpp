@@ -9,6 +9,7 @@
 #include <numeric>
 
 #include <cicada/apply_state_less.hpp>
+#include <cicada/apply_edge_delta.hpp>
 #include <cicada/hypergraph.hpp>
 #include <cicada/model.hpp>
 
@@ -17,6 +18,7 @@
 #include <utils/compact_map.hpp>
 #include <utils/small_vector.hpp>
 #include <utils/chunk_vector.hpp>
+#include <utils/arena_allocator.hpp>
 #include <utils/hashmurmur3.hpp>
 
 #include <utils/b_heap.hpp>
@@ -71,12 +73,16 @@ namespace cicada
     
     typedef Function function_type;
     
-    typedef utils::small_vector<int, std::allocator<int> > index_set_type;
+    typedef utils::small_vector<int, utils::arena_allocator<int> > index_set_type;
     
+    typedef ApplyEdgeDelta edge_delta_type;
+    typedef edge_delta_type::range_type feature_range_type;
+    
+    // we do not keep an edge for each candidate, but the difference of features from in_edge, 
+    // and materialize the edge only when appended to the output forest
     struct Candidate
     {
       const edge_type* in_edge;
-      edge_type        out_edge;
       
       state_type state;
       
@@ -84,15 +90,20 @@ namespace cicada
       
       score_type score;
       
+      feature_range_type features;
+      
+      id_type node;
+      
       Candidate(const index_set_type& __j)
-	: in_edge(0), j(__j) {}
+	: in_edge(0), j(__j), node(hypergraph_type::invalid) {}
 
       Candidate(const edge_type& __edge, const index_set_type& __j)
-	: in_edge(&__edge), out_edge(__edge), j(__j) {}
+	: in_edge(&__edge), j(__j), node(hypergraph_type::invalid) {}
     };
 
     typedef Candidate candidate_type;
-    typedef utils::chunk_vector<candidate_type, 4096 / sizeof(candidate_type), std::allocator<candidate_type> > candidate_set_type;
+    // candidates are temporaries of a single application: allocated from the arena of the current thread, if installed.
+    typedef utils::chunk_vector<candidate_type, 4096 / sizeof(candidate_type), utils::arena_allocator<candidate_type> > candidate_set_type;
         
     struct node_score_type
     {
@@ -191,6 +202,7 @@ namespace cicada
 	__applier(graph_in, graph_out);
       } else {
 	candidates.clear();
+	edge_delta.clear();
 	
 	D.clear();
 	D.reserve(graph_in.nodes.size());
@@ -219,6 +231,7 @@ namespace cicada
       
       // clear candidates!
       candidates.clear();
+      edge_delta.clear();
       
       const node_type& node = graph_in.nodes[v];
       const bool is_goal(v == graph_in.goal);
@@ -263,7 +276,7 @@ namespace cicada
       
       typename state_node_map_type::const_iterator biter_end = buf.end();
       for (typename state_node_map_type::const_iterator biter = buf.begin(); biter != biter_end; ++ biter)
-	D[v].push_back(node_score_type(biter->second->out_edge.head, biter->second->score));
+	D[v].push_back(node_score_type(biter->second->node, biter->second->score));
       
       std::sort(D[v].begin(), D[v].end(), compare_estimate_type());
 
@@ -278,7 +291,13 @@ namespace cicada
 		     state_node_map_type& buf,
 		     hypergraph_type& graph)
     {
-      edge_type& edge_new = graph.add_edge(item.out_edge);
+      // materialize edge...
+      edge_type& edge_new = graph.add_edge(*item.in_edge);
+      
+      for (size_t i = 0; i != item.j.size(); ++ i)
+	edge_new.tails[i] = D[item.in_edge->tails[i]][item.j[i]].node;
+      
+      edge_delta.materialize(edge_new.features, item.features);
 
       // prune-bin attribute
       if (prune_bin)
@@ -312,7 +331,7 @@ namespace cicada
 	if (result.second) {
 	  //std::cerr << "added node!" << std::endl;
 	  
-	  result.first->second->out_edge.head = graph.add_node().id;
+	  result.first->second->node = graph.add_node().id;
 	  node_states.push_back(item.state);
 	} else
 	  model.deallocate(item.state);
@@ -321,7 +340,7 @@ namespace cicada
 	
 	candidate_type& item_graph = *(result.first->second);
 	
-	node_type& node = graph.nodes[item_graph.out_edge.head];
+	node_type& node = graph.nodes[item_graph.node];
 	
 	graph.connect_edge(edge_new.id, node.id);
 	
@@ -514,20 +533,22 @@ namespace cicada
       
       candidate_type& candidate = candidates.back();
       
-      candidate.out_edge.tails = edge_type::node_set_type(j.size());
+      edge_type& edge_apply = edge_delta.prepare(edge);
       
       candidate.score = semiring::traits<score_type>::one();
       for (size_t i = 0; i != j.size(); ++ i) {
 	const node_score_type& antecedent = D[edge.tails[i]][j[i]];
 	
-	candidate.out_edge.tails[i] = antecedent.node;
+	edge_apply.tails[i] = antecedent.node;
 	candidate.score *= antecedent.score;
       }
       
       // perform actual model application...
       
-      candidate.state = model.apply(node_states, candidate.out_edge, candidate.out_edge.features, is_goal);
-      candidate.score *= function(candidate.out_edge.features);
+      candidate.state = model.apply(node_states, edge_apply, edge_apply.features, is_goal);
+      candidate.score *= function(edge_apply.features);
+      
+      candidate.features = edge_delta.commit(edge);
 
       //std::cerr << "make candidate done" << std::endl;
       
@@ -536,6 +557,7 @@ namespace cicada
     
   private:
     candidate_set_type  candidates;
+    edge_delta_type     edge_delta;
     node_score_set_type D;
     state_set_type      node_states;
 
@@ -0,0 +1,542 @@
+// -*- mode: c++ -*-
+//
+//  Copyright(C) 2010-2013 Taro Watanabe <taro.watanabe@nict.go.jp>
+//
+
+#ifndef __CICADA__APPLY_CUBE_PRUNE_PARALLEL__HPP__
+#define __CICADA__APPLY_CUBE_PRUNE_PARALLEL__HPP__ 1
+
+#include <numeric>
+#include <vector>
+
+#include <cicada/apply_state_less.hpp>
+#include <cicada/apply_edge_delta.hpp>
+#include <cicada/hypergraph.hpp>
+#include <cicada/model.hpp>
+
+#include <cicada/semiring/traits.hpp>
+
+#include <utils/compact_map.hpp>
+#include <utils/small_vector.hpp>
+#include <utils/chunk_vector.hpp>
+#include <utils/atomicop.hpp>
+#include <utils/bithack.hpp>
+
+#include <utils/std_heap.hpp>
+
+#include <boost/thread.hpp>
+
+namespace cicada
+{
+
+  // parallel cube-pruning within a single hypergraph.
+  //
+  // Nodes are partitioned into topological levels, i.e. the longest path from the leaves, so that all the
+  // nodes in the same level depend only on the nodes in the lower levels and can be processed independently.
+  // Each level is processed by a pool of workers, each of which owns its own (cloned) model, hence its own
+  // state-allocator. The per-node results are merged into graph_out in the node-id order of each level, so that
+  // the output does not depend on the number of threads nor on the scheduling.
+  //
+  // We employ the same pruning as ApplyCubePrune (Faster Cube Pruning, Algorithm 2).
+
+  template <typename Semiring, typename Function>
+  struct ApplyCubePruneParallel
+  {
+    typedef size_t    size_type;
+    typedef ptrdiff_t difference_type;
+
+    typedef HyperGraph hypergraph_type;
+
+    typedef hypergraph_type::id_type   id_type;
+    typedef hypergraph_type::node_type node_type;
+    typedef hypergraph_type::edge_type edge_type;
+
+    typedef hypergraph_type::feature_set_type feature_set_type;
+    typedef hypergraph_type::attribute_set_type attribute_set_type;
+
+    typedef feature_set_type::feature_type     feature_type;
+    typedef attribute_set_type::attribute_type attribute_type;
+
+    typedef Model model_type;
+    typedef std::vector<model_type, std::allocator<model_type> > model_set_type;
+
+    typedef model_type::state_type     state_type;
+    typedef model_type::state_set_type state_set_type;
+
+    typedef Semiring semiring_type;
+    typedef Semiring score_type;
+
+    typedef Function function_type;
+
+    typedef utils::small_vector<int, std::allocator<int> > index_set_type;
+
+    typedef ApplyEdgeDelta edge_delta_type;
+    typedef edge_delta_type::range_type feature_range_type;
+
+    struct Candidate
+    {
+      const edge_type* in_edge;
+
+      state_type state;
+
+      index_set_type j;
+
+      score_type score;
+
+      feature_range_type features;
+
+      Candidate(const edge_type& __edge, const index_set_type& __j)
+	: in_edge(&__edge), j(__j) {}
+    };
+
+    typedef Candidate candidate_type;
+    typedef utils::chunk_vector<candidate_type, 4096 / sizeof(candidate_type), std::allocator<candidate_type> > candidate_set_type;
+
+    struct node_score_type
+    {
+      id_type node;
+      score_type score;
+
+      node_score_type() : node(), score() {}
+
+      node_score_type(const id_type __node, const score_type& __score)
+	: node(__node), score(__score) {}
+    };
+
+    typedef std::vector<node_score_type, std::allocator<node_score_type> > node_score_list_type;
+    typedef std::vector<node_score_list_type, std::allocator<node_score_list_type> > node_score_set_type;
+
+    struct compare_heap_type
+    {
+      // we use less, so that when popped from heap, we will grab "greater" in back...
+      bool operator()(const candidate_type* x, const candidate_type* y) const
+      {
+	return (x->score < y->score) || (!(y->score < x->score) && (cardinality(x->j) > cardinality(y->j)));
+      }
+
+      size_t cardinality(const index_set_type& x) const
+      {
+	return std::accumulate(x.begin(), x.end(), 0);
+      }
+    };
+
+    struct compare_estimate_type
+    {
+      // we will use greater, so that simple sort will yield estimated score order...
+      bool operator()(const node_score_type& x, const node_score_type& y) const
+      {
+	return (x.score > y.score) || (!(y.score > x.score) && (x.node < y.node));
+      }
+    };
+
+    typedef std::vector<const candidate_type*, std::allocator<const candidate_type*> > candidate_heap_base_type;
+    typedef utils::std_heap<const candidate_type*,  candidate_heap_base_type, compare_heap_type> candidate_heap_type;
+
+    typedef utils::compact_map<state_type, id_type,
+			       model_type::state_unassigned, model_type::state_unassigned,
+			       model_type::state_hash, model_type::state_equal,
+			       std::allocator<std::pair<const state_type, id_type> > > state_node_map_type;
+
+    typedef std::vector<id_type, std::allocator<id_type> > node_set_type;
+    typedef std::vector<node_set_type, std::allocator<node_set_type> > level_set_type;
+
+    typedef std::vector<edge_type, std::allocator<edge_type> > edge_set_type;
+    typedef std::vector<score_type, std::allocator<score_type> > score_set_type;
+
+    // the result of cube-pruning for a node in graph_in.
+    // edge's head is an index into states/scores, a node local to this result,
+    // which will be re-indexed when merged into graph_out
+    struct Result
+    {
+      edge_set_type  edges;
+      state_set_type states;
+      score_set_type scores;
+
+      void clear()
+      {
+	edges.clear();
+	states.clear();
+	scores.clear();
+      }
+    };
+    typedef Result result_type;
+    typedef std::vector<result_type, std::allocator<result_type> > result_set_type;
+
+    struct Worker
+    {
+      Worker(ApplyCubePruneParallel& __applier, const model_type& __model)
+	: applier(__applier), model(__model) {}
+
+      // process nodes of the current level until exhausted
+      void run()
+      {
+	const node_set_type& level = *applier.level;
+
+	for (;;) {
+	  const size_type pos = utils::atomicop::fetch_and_add(applier.level_pos, size_type(1));
+
+	  if (pos >= level.size()) break;
+
+	  kbest(level[pos], applier.results[pos]);
+	}
+      }
+
+      // thread entry
+      void operator()()
+      {
+	for (;;) {
+	  applier.barrier_start->wait();
+
+	  if (applier.finished) break;
+
+	  run();
+
+	  applier.barrier_finish->wait();
+	}
+      }
+
+      void kbest(const id_type v, result_type& result)
+      {
+	const hypergraph_type& graph_in = *applier.graph_in;
+
+	candidates.clear();
+	edge_delta.clear();
+	cand.clear();
+	result.clear();
+
+	const node_type& node = graph_in.nodes[v];
+	const bool is_goal(v == graph_in.goal);
+
+	cand.reserve(node.edges.size() * applier.cube_size_max);
+
+	node_type::edge_set_type::const_iterator eiter_end = node.edges.end();
+	for (node_type::edge_set_type::const_iterator eiter = node.edges.begin(); eiter != eiter_end; ++ eiter) {
+	  const edge_type& edge = graph_in.edges[*eiter];
+	  const index_set_type j(edge.tails.size(), 0);
+
+	  cand.push(make_candidate(edge, j, is_goal));
+	}
+
+	state_node_map_type buf(cand.size(), model_type::state_hash(model.state_size()), model_type::state_equal(model.state_size()));
+
+	for (size_type num_pop = 0; ! cand.empty() && num_pop != applier.cube_size_max; ++ num_pop) {
+	  const candidate_type* item = cand.top();
+	  cand.pop();
+
+	  push_succ(*item, is_goal);
+	  append_item(*item, is_goal, buf, result);
+	}
+
+	typename candidate_heap_type::const_iterator hiter_end = cand.end();
+	for (typename candidate_heap_type::const_iterator hiter = cand.begin(); hiter != hiter_end; ++ hiter)
+	  model.deallocate((*hiter)->state);
+      }
+
+      void append_item(const candidate_type& item,
+		       const bool is_goal,
+		       state_node_map_type& buf,
+		       result_type& result)
+      {
+	const node_score_set_type& D = applier.D;
+
+	// materialize edge...
+	result.edges.push_back(*item.in_edge);
+
+	edge_type& edge_new = result.edges.back();
+
+	for (size_t i = 0; i != item.j.size(); ++ i)
+	  edge_new.tails[i] = D[item.in_edge->tails[i]][item.j[i]].node;
+
+	edge_delta.materialize(edge_new.features, item.features);
+
+	if (applier.prune_bin)
+	  edge_new.attributes[applier.attr_prune_bin] = attribute_set_type::int_type(item.in_edge->head);
+
+	if (is_goal) {
+	  if (result.states.empty()) {
+	    result.states.push_back(item.state);
+	    result.scores.push_back(item.score);
+	  } else
+	    model.deallocate(item.state);
+
+	  edge_new.head = 0;
+	} else {
+	  typedef std::pair<typename state_node_map_type::iterator, bool> insert_type;
+
+	  const insert_type res = buf.insert(std::make_pair(item.state, id_type(result.states.size())));
+
+	  if (res.second) {
+	    result.states.push_back(item.state);
+	    result.scores.push_back(item.score);
+	  } else {
+	    model.deallocate(item.state);
+
+	    // check if we found better derivation..
+	    if (item.score > result.scores[res.first->second])
+	      result.scores[res.first->second] = item.score;
+	  }
+
+	  edge_new.head = res.first->second;
+	}
+      }
+
+      void push_succ(const candidate_type& candidate, const bool is_goal)
+      {
+	//
+	// Faster Cube Pruning: Algorithm 2
+	//
+	const node_score_set_type& D = applier.D;
+
+	index_set_type j = candidate.j;
+	for (size_t i = 0; i != candidate.j.size(); ++ i) {
+	  ++ j[i];
+
+	  if (j[i] < static_cast<int>(D[candidate.in_edge->tails[i]].size()))
+	    cand.push(make_candidate(*candidate.in_edge, j, is_goal));
+
+	  if (candidate.j[i] != 0) break;
+
+	  -- j[i];
+	}
+      }
+
+      const candidate_type* make_candidate(const edge_type& edge, const index_set_type& j, const bool is_goal)
+      {
+	const node_score_set_type& D = applier.D;
+
+	candidates.push_back(candidate_type(edge, j));
+
+	candidate_type& candidate = candidates.back();
+
+	edge_type& edge_apply = edge_delta.prepare(edge);
+
+	candidate.score = semiring::traits<score_type>::one();
+	for (size_t i = 0; i != j.size(); ++ i) {
+	  const node_score_type& antecedent = D[edge.tails[i]][j[i]];
+
+	  edge_apply.tails[i] = antecedent.node;
+	  candidate.score *= antecedent.score;
+	}
+
+	candidate.state = model.apply(applier.node_states, edge_apply, edge_apply.features, is_goal);
+	candidate.score *= applier.function(edge_apply.features);
+
+	candidate.features = edge_delta.commit(edge);
+
+	return &candidate;
+      }
+
+      ApplyCubePruneParallel& applier;
+      const model_type& model;
+
+      candidate_set_type  candidates;
+      candidate_heap_type cand;
+      edge_delta_type     edge_delta;
+    };
+
+    typedef Worker worker_type;
+    typedef std::vector<worker_type, std::allocator<worker_type> > worker_set_type;
+
+    ApplyCubePruneParallel(const model_set_type& _models,
+			   const function_type& _function,
+			   const int _cube_size_max,
+			   const bool _prune_bin=false)
+      : models(_models),
+	function(_function),
+	cube_size_max(_cube_size_max),
+	prune_bin(_prune_bin),
+	attr_prune_bin(_prune_bin ? "prune-bin" : "")
+    {
+      if (models.empty())
+	throw std::runtime_error("no models for parallel cube-pruning");
+    }
+
+    void operator()(const hypergraph_type& __graph_in,
+		    hypergraph_type&       graph_out)
+    {
+      for (size_type i = 0; i != models.size(); ++ i)
+	const_cast<model_type&>(models[i]).initialize();
+
+      if (models.front().is_stateless()) {
+	ApplyStateLess __applier(models.front(), prune_bin);
+	__applier(__graph_in, graph_out);
+	return;
+      }
+
+      graph_in = &__graph_in;
+
+      D.clear();
+      D.reserve(graph_in->nodes.size());
+      D.resize(graph_in->nodes.size());
+
+      node_states.clear();
+      node_states.reserve(graph_in->nodes.size() * cube_size_max);
+
+      graph_out.clear();
+
+      compute_levels(*graph_in);
+
+      worker_set_type workers;
+      workers.reserve(models.size());
+      for (size_type i = 0; i != models.size(); ++ i)
+	workers.push_back(worker_type(*this, models[i]));
+
+      // the caller serves as the first worker
+      boost::barrier __barrier_start(models.size());
+      boost::barrier __barrier_finish(models.size());
+
+      barrier_start  = &__barrier_start;
+      barrier_finish = &__barrier_finish;
+      finished = false;
+
+      boost::thread_group pool;
+      for (size_type i = 1; i < workers.size(); ++ i)
+	pool.add_thread(new boost::thread(boost::ref(workers[i])));
+
+      level_set_type::const_iterator liter_end = levels.end();
+      for (level_set_type::const_iterator liter = levels.begin(); liter != liter_end; ++ liter) {
+	level = &(*liter);
+	level_pos = 0;
+
+	results.resize(utils::bithack::max(results.size(), level->size()));
+
+	// a single node does not worth synchronization...
+	if (level->size() == 1)
+	  workers.front().run();
+	else {
+	  barrier_start->wait();
+	  workers.front().run();
+	  barrier_finish->wait();
+	}
+
+	merge(*level, graph_out);
+      }
+
+      finished = true;
+      barrier_start->wait();
+      pool.join_all();
+
+      results.clear();
+      levels.clear();
+
+      // topologically sort...
+      graph_out.topologically_sort();
+
+      // re-initialize again...
+      for (size_type i = 0; i != models.size(); ++ i)
+	const_cast<model_type&>(models[i]).initialize();
+    }
+
+  private:
+    // level of node = 1 + maximum level of antecedent nodes.
+    // We assume that graph_in is topologically sorted, i.e. tails are always less than head.
+    void compute_levels(const hypergraph_type& graph)
+    {
+      typedef std::vector<int, std::allocator<int> > depth_set_type;
+
+      depth_set_type depths(graph.nodes.size(), 0);
+
+      levels.clear();
+
+      for (id_type node_id = 0; node_id != graph.nodes.size(); ++ node_id) {
+	const node_type& node = graph.nodes[node_id];
+
+	int depth = 0;
+	node_type::edge_set_type::const_iterator eiter_end = node.edges.end();
+	for (node_type::edge_set_type::const_iterator eiter = node.edges.begin(); eiter != eiter_end; ++ eiter) {
+	  const edge_type& edge = graph.edges[*eiter];
+
+	  edge_type::node_set_type::const_iterator titer_end = edge.tails.end();
+	  for (edge_type::node_set_type::const_iterator titer = edge.tails.begin(); titer != titer_end; ++ titer)
+	    depth = utils::bithack::max(depth, depths[*titer] + 1);
+	}
+
+	depths[node_id] = depth;
+
+	if (depth >= static_cast<int>(levels.size()))
+	  levels.resize(depth + 1);
+	levels[depth].push_back(node_id);
+      }
+    }
+
+    // merge the results in the order of node-id, so that the output is deterministic
+    void merge(const node_set_type& nodes, hypergraph_type& graph_out)
+    {
+      for (size_type pos = 0; pos != nodes.size(); ++ pos) {
+	const id_type v = nodes[pos];
+	result_type& result = results[pos];
+
+	const id_type base = graph_out.nodes.size();
+
+	for (size_type i = 0; i != result.states.size(); ++ i) {
+	  graph_out.add_node();
+	  node_states.push_back(result.states[i]);
+	}
+
+	if (v == graph_in->goal) {
+	  if (! result.states.empty())
+	    graph_out.goal = base;
+	} else {
+	  D[v].reserve(result.scores.size());
+	  for (size_type i = 0; i != result.scores.size(); ++ i)
+	    D[v].push_back(node_score_type(base + i, result.scores[i]));
+
+	  std::sort(D[v].begin(), D[v].end(), compare_estimate_type());
+	}
+
+	typename edge_set_type::const_iterator eiter_end = result.edges.end();
+	for (typename edge_set_type::const_iterator eiter = result.edges.begin(); eiter != eiter_end; ++ eiter) {
+	  edge_type& edge_new = graph_out.add_edge(*eiter);
+
+	  graph_out.connect_edge(edge_new.id, base + eiter->head);
+	}
+
+	result.clear();
+      }
+    }
+
+  private:
+    const hypergraph_type* graph_in;
+
+    node_score_set_type D;
+    state_set_type      node_states;
+
+    level_set_type     levels;
+    const node_set_type* level;
+    volatile size_type level_pos;
+
+    result_set_type results;
+
+    boost::barrier* barrier_start;
+    boost::barrier* barrier_finish;
+    volatile bool finished;
+
+    const model_set_type& models;
+    const function_type& function;
+    size_type  cube_size_max;
+    bool prune_bin;
+
+    attribute_type attr_prune_bin;
+  };
+
+  template <typename Function>
+  inline
+  void apply_cube_prune(const std::vector<Model, std::allocator<Model> >& models, const HyperGraph& source, HyperGraph& target, const Function& func, const int cube_size, const bool prune_bin=false)
+  {
+    ApplyCubePruneParallel<typename Function::value_type, Function>(models, func, cube_size, prune_bin)(source, target);
+  }
+
+  template <typename Function>
+  inline
+  void apply_cube_prune(const std::vector<Model, std::allocator<Model> >& models, HyperGraph& source, const Function& func, const int cube_size, const bool prune_bin=false)
+  {
+    HyperGraph target;
+
+    ApplyCubePruneParallel<typename Function::value_type, Function>(models, func, cube_size, prune_bin)(source, target);
+
+    source.swap(target);
+  }
+
+};
+
+#endif
@@ -0,0 +1,130 @@
+// -*- mode: c++ -*-
+//
+//  Copyright(C) 2010-2013 Taro Watanabe <taro.watanabe@nict.go.jp>
+//
+
+#ifndef __CICADA__APPLY_EDGE_DELTA__HPP__
+#define __CICADA__APPLY_EDGE_DELTA__HPP__ 1
+
+#include <stdint.h>
+
+#include <vector>
+#include <utility>
+
+#include <cicada/hypergraph.hpp>
+
+namespace cicada
+{
+  // Feature application for cube-pruning-like algorithms creates lots of candidates, most of which are
+  // discarded without being added to the output forest. Instead of copying an edge (features, attributes, rule etc.)
+  // for each candidate, we score candidates on a single scratch edge, and keep only the difference of the
+  // features from the input edge in an arena. The real edge is materialized only when the candidate is appended
+  // to the output forest.
+  //
+  // An erased feature is represented by a zero value, since zero-valued features are equivalent to the absent features.
+
+  struct ApplyEdgeDelta
+  {
+    typedef HyperGraph hypergraph_type;
+
+    typedef hypergraph_type::id_type          id_type;
+    typedef hypergraph_type::edge_type        edge_type;
+    typedef hypergraph_type::feature_set_type feature_set_type;
+
+    typedef feature_set_type::feature_type feature_type;
+    typedef feature_set_type::mapped_type  mapped_type;
+
+    typedef std::pair<feature_type, mapped_type> value_type;
+    typedef std::vector<value_type, std::allocator<value_type> > delta_set_type;
+
+    // a range in the arena
+    struct range_type
+    {
+      uint32_t first;
+      uint32_t last;
+
+      range_type() : first(0), last(0) {}
+      range_type(const uint32_t& __first, const uint32_t& __last) : first(__first), last(__last) {}
+    };
+
+    ApplyEdgeDelta() : source(0) {}
+    ApplyEdgeDelta(const ApplyEdgeDelta& x) : deltas(), edge(), source(0) {}
+    ApplyEdgeDelta& operator=(const ApplyEdgeDelta& x)
+    {
+      clear();
+      return *this;
+    }
+
+    // prepare the scratch edge from the in-edge. The tails should be re-assigned by the caller.
+    edge_type& prepare(const edge_type& in_edge)
+    {
+      if (source != &in_edge) {
+	edge.head       = in_edge.head;
+	edge.tails      = in_edge.tails;
+	edge.attributes = in_edge.attributes;
+	edge.rule       = in_edge.rule;
+	edge.id         = in_edge.id;
+
+	source = &in_edge;
+      }
+
+      // assignment will reuse the storage, once large enough
+      edge.features = in_edge.features;
+
+      return edge;
+    }
+
+    // record the features in the scratch edge as the difference from the in-edge
+    range_type commit(const edge_type& in_edge)
+    {
+      const uint32_t first = deltas.size();
+      
+      size_t inserted = 0;
+      feature_set_type::const_iterator fiter_end = edge.features.end();
+      for (feature_set_type::const_iterator fiter = edge.features.begin(); fiter != fiter_end; ++ fiter) {
+	feature_set_type::const_iterator iter = in_edge.features.find(fiter->first);
+	
+	if (iter == in_edge.features.end()) {
+	  deltas.push_back(value_type(fiter->first, fiter->second));
+	  ++ inserted;
+	} else if (iter->second != fiter->second)
+	  deltas.push_back(value_type(fiter->first, fiter->second));
+      }
+      
+      // some features are erased
+      if (edge.features.size() - inserted != in_edge.features.size()) {
+	feature_set_type::const_iterator fiter_end = in_edge.features.end();
+	for (feature_set_type::const_iterator fiter = in_edge.features.begin(); fiter != fiter_end; ++ fiter)
+	  if (edge.features.find(fiter->first) == edge.features.end())
+	    deltas.push_back(value_type(fiter->first, mapped_type()));
+      }
+
+      return range_type(first, deltas.size());
+    }
+
+    // apply the difference to the features copied from the in-edge
+    void materialize(feature_set_type& features, const range_type& range) const
+    {
+      delta_set_type::const_iterator diter_end = deltas.begin() + range.last;
+      for (delta_set_type::const_iterator diter = deltas.begin() + range.first; diter != diter_end; ++ diter) {
+	if (diter->second == mapped_type())
+	  features.erase(diter->first);
+	else
+	  features[diter->first] = diter->second;
+      }
+    }
+
+    void clear()
+    {
+      deltas.clear();
+      source = 0;
+    }
+
+  private:
+    delta_set_type   deltas;
+    edge_type        edge;
+    const edge_type* source;
+  };
+};
+
+#endif
@@ -4,6 +4,7 @@
 
 #include <utils/config.hpp>
 #include <utils/thread_specific_ptr.hpp>
+#include <utils/intern_cache.hpp>
 
 #include "attribute.hpp"
 
@@ -44,4 +45,9 @@ namespace cicada
     return *attribute_maps;
 #endif
   }
+
+  Attribute::id_type Attribute::__allocate(const piece_type& x)
+  {
+    return utils::intern_cache<Attribute, attribute_type, id_type>::intern(x, __index(), __attributes(), __mutex);
+  }
 };
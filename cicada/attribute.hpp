@@ -171,22 +171,8 @@ namespace cicada
       return __id;
     }
     
-    static id_type __allocate(const piece_type& x)
-    {
-      ticket_type::scoped_writer_lock lock(__mutex);
-      
-      attribute_index_type& index = __index();
-      
-      std::pair<attribute_index_type::iterator, bool> result = index.insert(x);
-      
-      if (result.second) {
-	attribute_set_type& attributes = __attributes();
-	attributes.push_back(x);
-	const_cast<piece_type&>(*result.first) = attributes.back();	
-      }
-      
-      return result.first - index.begin();
-    }
+    // lookup is lock-free for the attributes cached by each thread, and we take the writer lock only when inserting
+    static id_type __allocate(const piece_type& x);
     
   private:
     id_type __id;
@@ -209,18 +209,27 @@ namespace cicada
 
   // feature-vector dot weight-vector
 
+  // for small feature-vectors, we directly scan the inline storage: erased elements are zero-valued
+  // with out-of-range feature id, and do not contribute to the dot product.
+  
   template <typename Tp1, typename Alloc1, typename Tp2, typename Alloc2>
   inline
   Tp1 dot_product(const FeatureVector<Tp1, Alloc1>& x, const WeightVector<Tp2, Alloc2>& y)
   {
-    return dot_product(x.begin(), x.end(), y, Tp1());
+    if (x.small())
+      return dot_product(x.small_begin(), x.small_end(), y, Tp1());
+    else
+      return dot_product(x.begin(), x.end(), y, Tp1());
   }
   
   template <typename Tp1, typename Alloc1, typename Tp2, typename Alloc2>
   inline
   Tp1 dot_product(const WeightVector<Tp1, Alloc1>& x, const FeatureVector<Tp2, Alloc2>& y)
   {
-    return dot_product(x, y.begin(), y.end(), Tp1());
+    if (y.small())
+      return dot_product(x, y.small_begin(), y.small_end(), Tp1());
+    else
+      return dot_product(x, y.begin(), y.end(), Tp1());
   }
   
   template <typename Iterator, typename Tp2, typename Alloc2, typename Tp>
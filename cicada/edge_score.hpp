@@ -0,0 +1,75 @@
+// -*- mode: c++ -*-
+//
+//  Copyright(C) 2013 Taro Watanabe <taro.watanabe@nict.go.jp>
+//
+
+#ifndef __CICADA__EDGE_SCORE__HPP__
+#define __CICADA__EDGE_SCORE__HPP__ 1
+
+#include <vector>
+
+#include <cicada/hypergraph.hpp>
+#include <cicada/hypergraph_compact.hpp>
+
+//
+// batched edge scoring: compute the score of every edge once, and keep them in a contiguous array indexed by edge-id.
+// Algorithms which visit edges more than once, i.e. inside-outside, pruning and k-best, should use the cached scores
+// by EdgeScore, instead of re-computing function(edge) at each visit.
+//
+
+namespace cicada
+{
+
+  // scores[edge.id] = function(edge)
+  template <typename Function, typename ScoreSet>
+  inline
+  void edge_score(const HyperGraph& graph, const Function& function, ScoreSet& scores)
+  {
+    typedef HyperGraph hypergraph_type;
+
+    scores.resize(graph.edges.size());
+
+    hypergraph_type::edge_set_type::const_iterator eiter_end = graph.edges.end();
+    for (hypergraph_type::edge_set_type::const_iterator eiter = graph.edges.begin(); eiter != eiter_end; ++ eiter)
+      scores[eiter->id] = function(*eiter);
+  }
+
+  // a semiring function which returns the scores cached by edge_score.
+  // Since Inside/Outside etc. copy their functions, we keep a reference to the scores.
+  template <typename Function>
+  struct EdgeScore
+  {
+    typedef HyperGraph hypergraph_type;
+    typedef hypergraph_type::edge_type edge_type;
+
+    typedef Function function_type;
+    typedef typename function_type::value_type value_type;
+
+    typedef std::vector<value_type, std::allocator<value_type> > score_set_type;
+
+    EdgeScore(const score_set_type& __scores, const function_type& __function)
+      : scores(__scores), function(__function) {}
+
+    value_type operator()(const edge_type& edge) const
+    {
+      return scores[edge.id];
+    }
+
+    value_type operator()(const HyperGraphCompact::edge_type& edge) const
+    {
+      return scores[edge.id];
+    }
+
+    template <typename FeatureSet>
+    value_type operator()(const FeatureSet& x) const
+    {
+      return function(x);
+    }
+
+    const score_set_type& scores;
+    const function_type   function;
+  };
+
+};
+
+#endif
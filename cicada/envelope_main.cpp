@@ -0,0 +1,100 @@
+//
+//  Copyright(C) 2013 Taro Watanabe <taro.watanabe@nict.go.jp>
+//
+
+// a node with a single incoming edge over a multi-line envelope: the edge line is added to each line
+// of the antecedent envelope, which keeps its breakpoints.
+
+#include <iostream>
+#include <vector>
+#include <stdexcept>
+#include <limits>
+#include <iterator>
+
+#include <cmath>
+
+#include "hypergraph.hpp"
+#include "inside_outside.hpp"
+#include "weight_vector.hpp"
+
+#include "semiring/envelope.hpp"
+
+typedef cicada::HyperGraph           hypergraph_type;
+typedef cicada::WeightVector<double> weight_set_type;
+
+typedef cicada::semiring::Envelope          envelope_type;
+typedef envelope_type::line_type            line_type;
+typedef envelope_type::line_pool_type       line_pool_type;
+typedef cicada::semiring::EnvelopeFunction<weight_set_type> function_type;
+
+typedef std::vector<envelope_type, std::allocator<envelope_type> > envelope_set_type;
+
+void add_edge(hypergraph_type& graph, const hypergraph_type::id_type head, const int tail, const double m, const double y)
+{
+  std::vector<hypergraph_type::id_type> tails;
+  if (tail >= 0)
+    tails.push_back(tail);
+
+  hypergraph_type::edge_type& edge = graph.add_edge(tails.begin(), tails.end());
+  edge.features["direction"] = m;
+  edge.features["origin"]    = y;
+
+  graph.connect_edge(edge.id, head);
+}
+
+int main(int argc, char** argv)
+{
+  try {
+    // node 0: the upper envelope of y = -x, y = 1 and y = x, whose breakpoints are -inf, -1 and 1
+    // node 1: a single edge, y = 0.5x + 2, over node 0
+    hypergraph_type graph;
+
+    const hypergraph_type::id_type node0 = graph.add_node().id;
+    add_edge(graph, node0, -1, -1.0, 0.0);
+    add_edge(graph, node0, -1,  0.0, 1.0);
+    add_edge(graph, node0, -1,  1.0, 0.0);
+
+    const hypergraph_type::id_type node1 = graph.add_node().id;
+    add_edge(graph, node1, node0, 0.5, 2.0);
+
+    graph.goal = node1;
+
+    weight_set_type origin;
+    weight_set_type direction;
+    origin["origin"]       = 1.0;
+    direction["direction"] = 1.0;
+
+    line_pool_type pool;
+    envelope_set_type envelopes(graph.nodes.size());
+
+    cicada::inside(graph, envelopes, function_type(origin, direction, pool));
+
+    envelope_type& envelope = envelopes[graph.goal];
+    envelope.sort();
+
+    const double infinity = std::numeric_limits<double>::infinity();
+
+    const double xs[] = {- infinity, -1.0, 1.0};
+    const double ms[] = {-0.5, 0.5, 1.5};
+    const double ys[] = {2.0, 3.0, 2.0};
+
+    if (std::distance(envelope.begin(), envelope.end()) != 3)
+      throw std::runtime_error("invalid # of lines");
+
+    int i = 0;
+    for (envelope_type::const_iterator liter = envelope.begin(); liter != envelope.end(); ++ liter, ++ i) {
+      const line_type& line = *(*liter);
+
+      std::cout << "x: " << line.x << " m: " << line.m << " y: " << line.y << std::endl;
+
+      if (line.x != xs[i])
+	throw std::runtime_error("invalid breakpoint");
+      if (std::fabs(line.m - ms[i]) > 1e-12 || std::fabs(line.y - ys[i]) > 1e-12)
+	throw std::runtime_error("invalid line");
+    }
+  }
+  catch (std::exception& err) {
+    std::cerr << "error: " << err.what() << std::endl;
+    return -1;
+  }
+}
@@ -135,6 +135,28 @@ namespace cicada
 	length_reference  /= scale;
 	length_hypothesis /= scale;
       }
+
+      size_t statistics_size() const { return ngrams_hypothesis.size() + ngrams_matched.size() + 2; }
+
+      void statistics(double* stats) const
+      {
+	stats = std::copy(ngrams_hypothesis.begin(), ngrams_hypothesis.end(), stats);
+	stats = std::copy(ngrams_matched.begin(), ngrams_matched.end(), stats);
+	
+	stats[0] = length_reference;
+	stats[1] = length_hypothesis;
+      }
+
+      void assign_statistics(const double* stats)
+      {
+	std::copy(stats, stats + ngrams_hypothesis.size(), ngrams_hypothesis.begin());
+	stats += ngrams_hypothesis.size();
+	std::copy(stats, stats + ngrams_matched.size(), ngrams_matched.begin());
+	stats += ngrams_matched.size();
+	
+	length_reference  = stats[0];
+	length_hypothesis = stats[1];
+      }
       
       score_ptr_type zero() const
       {
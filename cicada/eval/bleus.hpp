@@ -96,6 +96,20 @@ namespace cicada
 	bleu /= scale;
 	norm /= scale;
       }
+
+      size_t statistics_size() const { return 2; }
+
+      void statistics(double* stats) const
+      {
+	stats[0] = bleu;
+	stats[1] = norm;
+      }
+
+      void assign_statistics(const double* stats)
+      {
+	bleu = stats[0];
+	norm = stats[1];
+      }
       
       score_ptr_type zero() const
       {
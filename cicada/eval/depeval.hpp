@@ -88,6 +88,20 @@ namespace cicada
 	matched   /= scale;
 	total     /= scale;
       }
+
+      size_t statistics_size() const { return 2; }
+
+      void statistics(double* stats) const
+      {
+	stats[0] = matched;
+	stats[1] = total;
+      }
+
+      void assign_statistics(const double* stats)
+      {
+	matched = stats[0];
+	total   = stats[1];
+      }
       
       score_ptr_type zero() const
       {
@@ -99,6 +99,24 @@ namespace cicada
 	norm_hyp  /= scale;
       }
 
+      size_t statistics_size() const { return 4; }
+
+      void statistics(double* stats) const
+      {
+	stats[0] = match_ref;
+	stats[1] = match_hyp;
+	stats[2] = norm_ref;
+	stats[3] = norm_hyp;
+      }
+
+      void assign_statistics(const double* stats)
+      {
+	match_ref = stats[0];
+	match_hyp = stats[1];
+	norm_ref  = stats[2];
+	norm_hyp  = stats[3];
+      }
+
       std::string description() const;
       std::string encode() const;
 
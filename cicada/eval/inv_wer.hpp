@@ -111,6 +111,26 @@ namespace cicada
 	references   /= scale;
       }
 
+      size_t statistics_size() const { return 5; }
+
+      void statistics(double* stats) const
+      {
+	stats[0] = insertion;
+	stats[1] = deletion;
+	stats[2] = substitution;
+	stats[3] = inversion;
+	stats[4] = references;
+      }
+
+      void assign_statistics(const double* stats)
+      {
+	insertion    = stats[0];
+	deletion     = stats[1];
+	substitution = stats[2];
+	inversion    = stats[3];
+	references   = stats[4];
+      }
+
       score_ptr_type zero() const
       {
 	return score_ptr_type(new InvWER());
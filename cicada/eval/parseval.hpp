@@ -95,6 +95,22 @@ namespace cicada
 	test      /= scale;
 	reference /= scale;
       }
+
+      size_t statistics_size() const { return 3; }
+
+      void statistics(double* stats) const
+      {
+	stats[0] = matched;
+	stats[1] = test;
+	stats[2] = reference;
+      }
+
+      void assign_statistics(const double* stats)
+      {
+	matched   = stats[0];
+	test      = stats[1];
+	reference = stats[2];
+      }
       
       score_ptr_type zero() const
       {
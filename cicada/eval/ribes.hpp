@@ -88,6 +88,20 @@ namespace cicada
 	distance /= scale;
 	norm     /= scale;
       }
+
+      size_t statistics_size() const { return 2; }
+
+      void statistics(double* stats) const
+      {
+	stats[0] = distance;
+	stats[1] = norm;
+      }
+
+      void assign_statistics(const double* stats)
+      {
+	distance = stats[0];
+	norm     = stats[1];
+      }
       
       score_ptr_type zero() const
       {
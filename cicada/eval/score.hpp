@@ -51,6 +51,12 @@ namespace cicada
       virtual void multiplies_equal(const double& scale) = 0;
       virtual void divides_equal(const double& scale) = 0;
 
+      // fixed-width sufficient statistics: scores from the same scorer are summed element-wise as plain doubles,
+      // and assign_statistics() restores a score from the summed statistics. Zero width when not supported.
+      virtual size_t statistics_size() const { return 0; }
+      virtual void statistics(double* stats) const {}
+      virtual void assign_statistics(const double* stats) {}
+
       virtual score_ptr_type zero() const = 0;
       virtual score_ptr_type clone() const = 0;
       
@@ -105,6 +105,24 @@ namespace cicada
 	references   /= scale;
       }
 
+      size_t statistics_size() const { return 4; }
+
+      void statistics(double* stats) const
+      {
+	stats[0] = insertion;
+	stats[1] = deletion;
+	stats[2] = substitution;
+	stats[3] = references;
+      }
+
+      void assign_statistics(const double* stats)
+      {
+	insertion    = stats[0];
+	deletion     = stats[1];
+	substitution = stats[2];
+	references   = stats[3];
+      }
+
       score_ptr_type zero() const
       {
 	return score_ptr_type(new WER());
@@ -4,6 +4,7 @@
 
 #include <utils/config.hpp>
 #include <utils/thread_specific_ptr.hpp>
+#include <utils/intern_cache.hpp>
 
 #include "feature.hpp"
 
@@ -44,4 +45,9 @@ namespace cicada
     return *feature_maps;
 #endif
   }
+
+  Feature::id_type Feature::__allocate(const piece_type& x)
+  {
+    return utils::intern_cache<Feature, feature_type, id_type>::intern(x, __index(), __features(), __mutex);
+  }
 };
@@ -87,6 +87,7 @@ namespace cicada
       typedef utils::hashmurmur3<size_t> hasher_type;
       
       typedef std::vector<char, std::allocator<char> > buffer_type;
+      typedef std::vector<symbol_type::id_type, std::allocator<symbol_type::id_type> > id_set_type;
       
       typedef boost::filesystem::path path_type;
 
@@ -266,6 +267,8 @@ namespace cicada
 	phrase_type::const_iterator titer_begin = target.begin();
         phrase_type::const_iterator titer_end   = target.end();
 	
+	terminals.clear();
+	
 	int non_terminal_pos = 0;
 	bool initial = true;
 	for (phrase_type::const_iterator titer = titer_begin; titer != titer_end; ++ titer) {
@@ -273,7 +276,9 @@ namespace cicada
 	    const int __non_terminal_index = titer->non_terminal_index();
             const int antecedent_index = utils::bithack::branch(__non_terminal_index <= 0, non_terminal_pos, __non_terminal_index - 1);
             ++ non_terminal_pos;
-
+	    
+	    terminals_score();
+	    
 	    if (initial)
 	      scorer.initial_non_terminal(states[antecedent_index]);
 	    else
@@ -281,24 +286,38 @@ namespace cicada
 	    
 	    initial = false;
 	  } else if (! skipper(*titer)) {
+	    const bool bos = (no_bos_eos && extract(*titer) == vocab_type::BOS);
 	    
-	    if (no_bos_eos && extract(*titer) == vocab_type::BOS && scorer.ngram_state_.empty(state))
+	    if (bos)
+	      terminals_score();
+	    
+	    if (bos && scorer.ngram_state_.empty(state))
 	      scorer.initial_bos(&(*buffer_bos.begin()));
 	    else {
 	      const word_type::id_type id = ngram->index.vocab()[extract(*titer)];
 	      
 	      result.oov_ += (id == id_oov);
-	      scorer.terminal(id);
+	      terminals.push_back(id);
 	    }
 	    
 	    initial = false;
 	  }
 	}
 	
+	terminals_score();
+	
 	result.score_ += scorer.complete();
       }
       
       
+      // score the terminals collected so far at once: their contexts are known from the words, thus,
+      // the look-ups of the words are interleaved by the scorer.
+      void terminals_score()
+      {
+	scorer.terminals(terminals.begin(), terminals.end());
+	terminals.clear();
+      }
+      
       void ngram_final_score(const state_ptr_type& state, result_type& result)
       {
 	if (no_bos_eos)
@@ -340,25 +359,35 @@ namespace cicada
 	
 	scorer.assign(&(*buffer_tmp.begin()));
 	
+	terminals.clear();
+	
 	phrase_type::const_iterator piter_end = phrase.end();
 	for (phrase_type::const_iterator piter = phrase.begin(); piter != piter_end; ++ piter) {
 	  if (piter->is_non_terminal()) {
+	    terminals_score();
+	    
 	    result.score_ += scorer.complete();
 	    
 	    scorer.assign(&(*buffer_tmp.begin()));
 	  } else if (! skipper(*piter)) {
+	    const bool bos = (no_bos_eos && extract(*piter) == vocab_type::BOS);
+	    
+	    if (bos)
+	      terminals_score();
 	    
-	    if (no_bos_eos && extract(*piter) == vocab_type::BOS && scorer.ngram_state_.empty(&(*buffer_tmp.begin())))
+	    if (bos && scorer.ngram_state_.empty(&(*buffer_tmp.begin())))
 	      scorer.initial_bos(&(*buffer_bos.begin()));
 	    else {
 	      const word_type::id_type id = ngram->index.vocab()[extract(*piter)];
 	      
 	      result.oov_ += (id == id_oov);
-	      scorer.terminal(id);
+	      terminals.push_back(id);
 	    }
 	  }
 	}
 	
+	terminals_score();
+	
 	result.score_ += scorer.complete();
       }
       
@@ -470,6 +499,9 @@ namespace cicada
       
       scorer_type scorer;
       
+      // terminals in a rule, between non-terminals
+      id_set_type terminals;
+      
       // bos state
       buffer_type buffer_bos;
       buffer_type buffer_tmp;
@@ -492,6 +524,8 @@ namespace cicada
       bool        skip_sgml_tag = false;
       bool        split_estimate = false;
       bool        no_bos_eos = false;
+      size_type   cache_size = 0;
+      int         debug = 0;
       
       path_type   coarse_path;
       bool        coarse_populate = false;
@@ -515,6 +549,10 @@ namespace cicada
 	  no_bos_eos = utils::lexical_cast<bool>(piter->second);
 	else if (utils::ipiece(piter->first) == "split-estimate")
 	  split_estimate = utils::lexical_cast<bool>(piter->second);	
+	else if (utils::ipiece(piter->first) == "cache")
+	  cache_size = utils::lexical_cast<size_type>(piter->second);
+	else if (utils::ipiece(piter->first) == "debug")
+	  debug = utils::lexical_cast<int>(piter->second);
 	else if (utils::ipiece(piter->first) == "coarse-file")
 	  coarse_path = piter->second;
 	else if (utils::ipiece(piter->first) == "coarse-populate")
@@ -545,6 +583,14 @@ namespace cicada
       ngram_impl->skip_sgml_tag  = skip_sgml_tag;
       ngram_impl->split_estimate = split_estimate;
       
+      // the ngram is shared, thus, the debug level is raised, but never lowered
+      if (debug)
+	ngram_impl->ngram->debug = utils::bithack::max(ngram_impl->ngram->debug, debug);
+      
+      // score cache in MB, shared by all the threads
+      if (cache_size)
+	ngram_impl->ngram->cache_allocate(cache_size * 1024 * 1024);
+      
       if (! cluster_path.empty()) {
 	if (! boost::filesystem::exists(cluster_path))
 	  throw std::runtime_error("no cluster file: " + cluster_path.string());
@@ -85,8 +85,8 @@ namespace cicada
       static const symbol_type::id_type id_star;
 
     public:
-      NGramNNImpl(const path_type& __path, const int __order, const bool populate)
-	: ngram(&ngram_type::create(__path)),
+      NGramNNImpl(const path_type& __path, const int __order, const bool populate, const bool normalize, const bool precompute)
+	: ngram(&ngram_type::create(__path, normalize, precompute)),
 	  order(__order), no_bos_eos(false), skip_sgml_tag(false), split_estimate(false)
       {
 	order = utils::bithack::min(order, ngram->order());
@@ -102,7 +102,7 @@ namespace cicada
       }
 
       NGramNNImpl(const NGramNNImpl& x)
-	: ngram(&ngram_type::create(x.ngram->path())),
+	: ngram(&ngram_type::create(x.ngram->path(), x.ngram->normalize(), x.ngram->precompute())),
 	  order(x.order),
 	  no_bos_eos(x.no_bos_eos),
 	  skip_sgml_tag(x.skip_sgml_tag),
@@ -120,7 +120,7 @@ namespace cicada
 
       NGramNNImpl& operator=(const NGramNNImpl& x)
       {
-	ngram = &ngram_type::create(x.ngram->path());
+	ngram = &ngram_type::create(x.ngram->path(), x.ngram->normalize(), x.ngram->precompute());
 	order = x.order;
 	
 	no_bos_eos     = x.no_bos_eos;
@@ -176,14 +176,10 @@ namespace cicada
 	  
 	  buffer_type& buffer = const_cast<buffer_type&>(buffer_score_impl);
 	  buffer.clear();
-	  buffer.insert(buffer.end(), first, iter);
+	  buffer.insert(buffer.end(), first, last);
 	  
-	  cache.score = 0.0;
-	  for (/**/; iter != last; ++ iter) {
-	    buffer.push_back(*iter);
-	    
-	    cache.score += ngram->operator()(std::max(buffer.begin(), buffer.end() - order), buffer.end());
-	  }
+	  // score all the words in a batch
+	  cache.score = ngram->operator()(buffer.begin(), buffer.begin() + (iter - first), buffer.end(), order);
 	}
 	
 	return cache.score;
@@ -210,14 +206,12 @@ namespace cicada
 	    ++ first;
 	  }
 	  
-	  double score = 0.0;
-	  for (/**/; first != last; ++ first) {
-	    buffer.push_back(*first);
-	    
-	    score += ngram->operator()(buffer.begin(), buffer.end());
-	  }
+	  const size_type prefix_size = buffer.size();
+	  
+	  buffer.insert(buffer.end(), first, last);
 	  
-	  cache[cache_pos] = score;
+	  // score all the words in a batch
+	  cache[cache_pos] = ngram->operator()(buffer.begin(), buffer.begin() + prefix_size, buffer.end());
 	}
 	
 	return cache_estimate[cache_pos];
@@ -610,6 +604,8 @@ namespace cicada
       bool        skip_sgml_tag = false;
       bool        split_estimate = false;
       bool        no_bos_eos = false;
+      bool        normalize = false;
+      bool        precompute = false;
       
       path_type   coarse_path;
       bool        coarse_populate;
@@ -630,6 +626,10 @@ namespace cicada
 	  no_bos_eos = utils::lexical_cast<bool>(piter->second);
 	else if (utils::ipiece(piter->first) == "split-estimate")
 	  split_estimate = utils::lexical_cast<bool>(piter->second);	
+	else if (utils::ipiece(piter->first) == "normalize")
+	  normalize = utils::lexical_cast<bool>(piter->second);
+	else if (utils::ipiece(piter->first) == "precompute")
+	  precompute = utils::lexical_cast<bool>(piter->second);
 	else if (utils::ipiece(piter->first) == "coarse-file")
 	  coarse_path = piter->second;
 	else if (utils::ipiece(piter->first) == "coarse-populate")
@@ -653,7 +653,7 @@ namespace cicada
       if (! coarse_path.empty() && ! boost::filesystem::exists(coarse_path))
 	throw std::runtime_error("no coarse ngram language model? " + coarse_path.string());
       
-      std::auto_ptr<impl_type> ngram_impl(new impl_type(path, order, populate));
+      std::auto_ptr<impl_type> ngram_impl(new impl_type(path, order, populate, normalize, precompute));
       
       ngram_impl->no_bos_eos     = no_bos_eos;
       ngram_impl->skip_sgml_tag  = skip_sgml_tag;
@@ -677,7 +677,7 @@ namespace cicada
 	  throw std::runtime_error("coarse order must be non-zero!");
 	
 	if (! coarse_path.empty()) {
-	  std::auto_ptr<impl_type> ngram_impl(new impl_type(coarse_path, coarse_order, coarse_populate));
+	  std::auto_ptr<impl_type> ngram_impl(new impl_type(coarse_path, coarse_order, coarse_populate, normalize, precompute));
 
 	  ngram_impl->no_bos_eos = no_bos_eos;
 	  ngram_impl->skip_sgml_tag = skip_sgml_tag;
@@ -185,6 +185,8 @@ ngram: ngram language model\n\
 \tno-bos-eos=[true|false] do not add bos/eos\n\
 \tsplit-estimate=[true|false] split estimated ngram score\n\
 \tskip-sgml-tag=[true|false] skip sgml tags\n\
+\tcache=<size in MB> ngram score cache shared by all the threads\n\
+\tdebug=<debug level> report the score cache statistics\n\
 \tcoarse-file=<file>   ngram for coarrse heuristic\n\
 \tcoarse-populate=[true|false] \"populate\" by pre-fetching\n\
 \tcoarse-cluster=<word class> word class for coarse heuristics\n\
@@ -197,6 +199,8 @@ ngram-nn: neural network ngram language model\n\
 \tno-bos-eos=[true|false] do not add bos/eos\n\
 \tskip-sgml-tag=[true|false] skip sgml tags\n\
 \tsplit-estimate=[true|false] split estimated ngram score\n\
+\tnormalize=[true|false] normalize by the partition function (default: self-normalized)\n\
+\tprecompute=[true|false] pre-compute the projections of words\n\
 \tcoarse-order=<order> ngram order for coarse heuristic\n\
 \tcoarse-file=<file>   ngram for coarrse heuristic\n\
 \tcoarse-populate=[true|false] \"populate\" by pre-fetching\n\
@@ -219,6 +223,8 @@ ngram-rnn: limited memory recurrent neural network ngram language model\n\
 \tno-bos-eos=[true|false] do not add bos/eos\n\
 \tskip-sgml-tag=[true|false] skip sgml tags\n\
 \tsplit-estimate=[true|false] split estimated ngram score\n\
+\tnormalize=[true|false] normalize by the partition function (default: self-normalized)\n\
+\tprecompute=[true|false] pre-compute the projections of words\n\
 \tcoarse-order=<order> ngram order for coarse heuristic\n\
 \tcoarse-file=<file>   ngram for coarrse heuristic\n\
 \tcoarse-populate=[true|false] \"populate\" by pre-fetching\n\
@@ -15,7 +15,7 @@
 
 #include <cicada/feature.hpp>
 
-#include <utils/compact_map.hpp>
+#include <utils/small_compact_map.hpp>
 #include <utils/hashmurmur3.hpp>
 
 namespace cicada
@@ -44,10 +44,10 @@ namespace cicada
   private:
 
     typedef typename Alloc::template rebind<value_type>::other alloc_type;
-    typedef typename utils::compact_map<key_type, data_type,
-					utils::unassigned<key_type>, utils::deleted<key_type>,
-					utils::hashmurmur3<size_t>, std::equal_to<key_type>,
-					alloc_type> vector_type;
+    typedef typename utils::small_compact_map<key_type, data_type,
+					      utils::unassigned<key_type>, utils::deleted<key_type>,
+					      utils::hashmurmur3<size_t>, std::equal_to<key_type>,
+					      alloc_type> vector_type;
     
     typedef FeatureVector<Tp, Alloc> self_type;
     
@@ -382,6 +382,12 @@ namespace cicada
 
     void reserve(size_type x) { __vector.rehash(x); }
     void rehash(size_type x) { __vector.rehash(x); }
+
+    // small vectors are kept in the inline storage, which can be scanned linearly without
+    // checking erased elements, since they are marked by zero values.
+    bool small() const { return ! __vector.spilled(); }
+    const value_type* small_begin() const { return __vector.small_begin(); }
+    const value_type* small_end() const { return __vector.small_end(); }
     
     void clear()
     {
@@ -416,7 +422,7 @@ namespace cicada
 
     void erase(iterator x)
     {
-      __vector.erase(x.diter);
+      __vector.erase(x);
     }
     
     template <typename Prefix>
@@ -556,7 +562,7 @@ namespace cicada
 	assign(x);
 	return *this;
       } else {
-	__vector.rehash(__vector.occupied_count() + x.size());
+	__vector.reserve(__vector.occupied_count() + x.size());
 	plus_equal(__vector, x.begin(), x.end());
 	return *this;
       }
@@ -573,7 +579,7 @@ namespace cicada
 	assign(x);
 	return *this;
       } else {
-	__vector.rehash(__vector.occupied_count() + x.size());
+	__vector.reserve(__vector.occupied_count() + x.size());
 	plus_equal(__vector, x.begin(), x.end());
 	return *this;
       }
@@ -584,7 +590,7 @@ namespace cicada
     {
       if (x.empty()) return *this;
       
-      __vector.rehash(__vector.occupied_count() + x.size());
+      __vector.reserve(__vector.occupied_count() + x.size());
       minus_equal(__vector, x.begin(), x.end());
       
       return *this;
@@ -597,7 +603,7 @@ namespace cicada
     {
       if (x.empty()) return *this;
       
-      __vector.rehash(__vector.occupied_count() + x.size());
+      __vector.reserve(__vector.occupied_count() + x.size());
       minus_equal(__vector, x.begin(), x.end());
       
       return *this;
@@ -7,6 +7,10 @@
 
 #include <iostream>
 #include <iterator>
+#include <vector>
+#include <string>
+
+#include <boost/thread.hpp>
 
 #include "feature_vector.hpp"
 #include "feature_vector_compact.hpp"
@@ -15,6 +19,7 @@
 
 #include "utils/lexical_cast.hpp"
 #include "utils/random_seed.hpp"
+#include "utils/resource.hpp"
 
 #include <cicada/msgpack/feature_vector.hpp>
 #include "msgpack_main_impl.hpp"
@@ -23,6 +28,51 @@ typedef cicada::FeatureVector<double> feature_set_type;
 typedef cicada::FeatureVectorLinear<double> feature_linear_type;
 typedef cicada::FeatureVectorCompact  feature_compact_type;
 
+// contention benchmark: threads intern the same strings, most of which are already interned
+typedef std::vector<std::string, std::allocator<std::string> > word_set_type;
+
+struct Intern
+{
+  Intern(const word_set_type& __words) : words(__words), checksum(0) {}
+  
+  void operator()()
+  {
+    for (int iter = 0; iter != 64; ++ iter)
+      for (word_set_type::const_iterator witer = words.begin(); witer != words.end(); ++ witer)
+	checksum += cicada::Feature(*witer).id();
+  }
+  
+  const word_set_type& words;
+  size_t checksum;
+};
+
+void contention(const word_set_type& words)
+{
+  typedef std::vector<Intern, std::allocator<Intern> > intern_set_type;
+  
+  for (int threads = 1; threads <= 32; threads *= 2) {
+    intern_set_type interns(threads, Intern(words));
+    
+    utils::resource start;
+    
+    boost::thread_group workers;
+    for (int i = 0; i != threads; ++ i)
+      workers.add_thread(new boost::thread(boost::ref(interns[i])));
+    workers.join_all();
+    
+    utils::resource end;
+    
+    bool consistent = true;
+    for (int i = 1; i != threads; ++ i)
+      consistent &= (interns[i].checksum == interns.front().checksum);
+    
+    std::cerr << "threads: " << threads
+	      << " features/second: " << (64.0 * words.size() * threads) / (end.user_time() - start.user_time())
+	      << " consistent? " << consistent
+	      << std::endl;
+  }
+}
+
 void check_compact(const feature_set_type& features, const feature_compact_type& feats)
 {
   std::cerr << "size: " << features.size() * sizeof(feature_set_type::value_type)
@@ -254,4 +304,19 @@ int main(int argc, char** argv)
     
     check_compact(features1);
   }
+  
+  word_set_type words;
+  for (int i = 0; i != 1024 * 4; ++ i) {
+    const std::string feat = "feature:" + utils::lexical_cast<std::string>(random());
+    
+    feature_set_type::feature_type feature(feat);
+    
+    words.push_back(feat);
+  }
+  
+  // a few new features are inserted while interning
+  for (int i = 0; i != 64; ++ i)
+    words.push_back("feature:" + utils::lexical_cast<std::string>(random()));
+  
+  contention(words);
 }
@@ -119,6 +119,13 @@ namespace cicada
       for (transducer_ptr_set_type::const_iterator iter = transducers.begin(); iter != iter_end; ++ iter)
 	const_cast<transducer_ptr_type&>(*iter)->assign(hypergraph, lattice);
     }
+    
+    void cache_statistics(size_type& hit, size_type& miss) const
+    {
+      transducer_ptr_set_type::const_iterator iter_end = transducers.end();
+      for (transducer_ptr_set_type::const_iterator iter = transducers.begin(); iter != iter_end; ++ iter)
+	(*iter)->cache_statistics(hit, miss);
+    }
 
   public:    
     static const char* lists() { return transducer_type::lists(); }
@@ -0,0 +1,183 @@
+//
+//  Copyright(C) 2013 Taro Watanabe <taro.watanabe@nict.go.jp>
+//
+
+// a plain text grammar compiled through cache=: the rules of the compiled GrammarStatic, their features and attributes,
+// are the same as those of GrammarMutable, including the reordered, the monolingual and the attributed rules.
+
+#include <iostream>
+#include <sstream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <set>
+#include <algorithm>
+#include <iterator>
+#include <stdexcept>
+
+#include <boost/filesystem.hpp>
+
+#include "transducer.hpp"
+#include "grammar_mutable.hpp"
+
+#include "utils/tempfile.hpp"
+
+typedef cicada::Transducer transducer_type;
+typedef cicada::Symbol     symbol_type;
+
+typedef transducer_type::rule_pair_set_type rule_pair_set_type;
+
+typedef std::vector<symbol_type, std::allocator<symbol_type> > sequence_type;
+typedef std::vector<std::string, std::allocator<std::string> > rule_string_set_type;
+typedef std::set<sequence_type, std::less<sequence_type>, std::allocator<sequence_type> > sequence_set_type;
+
+typedef boost::filesystem::path path_type;
+
+const char* rules[] = {
+  "[x] ||| a ||| A ||| 0.5 0.25",
+  "[x] ||| a ||| A2 ||| feature=0.75 ||| weight=-3",
+  "[x] ||| a [x,1] b ||| [x,1] B A ||| 1 2",
+  "[x] ||| [x,2] c [x,1] ||| [x,1] C [x,2] ||| 0.125 ||| tag=1 name=\"reordered rule\"",
+  "[x] ||| [x,1] c [x,2] ||| [x,1] c [x,2] ||| 0.375",
+  "[s] ||| [x,2] [y,1] ||| [y,1] [x,2] ||| 3 ||| prob=0.5",
+  "[s] ||| [y,2] d [x,1] e ||| [x,1] D E [y,2] ||| 4",
+  "[x] ||| d e ||| ||| 1",
+  "[x] ||| d e ||| ||| 2 ||| monolingual=1",
+  "[y] ||| f ||| F ||| 1 ||| span=\"f\"",
+};
+
+void collect(const rule_pair_set_type& rule_pairs, rule_string_set_type& collected)
+{
+  collected.clear();
+
+  rule_pair_set_type::const_iterator riter_end = rule_pairs.end();
+  for (rule_pair_set_type::const_iterator riter = rule_pairs.begin(); riter != riter_end; ++ riter) {
+    std::ostringstream os;
+    os.precision(20);
+
+    os << riter->source->lhs << " |||";
+    for (cicada::Rule::symbol_set_type::const_iterator siter = riter->source->rhs.begin(); siter != riter->source->rhs.end(); ++ siter)
+      os << ' ' << *siter;
+    os << " |||";
+    if (riter->target)
+      for (cicada::Rule::symbol_set_type::const_iterator titer = riter->target->rhs.begin(); titer != riter->target->rhs.end(); ++ titer)
+	os << ' ' << *titer;
+    os << " |||";
+
+    rule_string_set_type features;
+    transducer_type::feature_set_type::const_iterator fiter_end = riter->features.end();
+    for (transducer_type::feature_set_type::const_iterator fiter = riter->features.begin(); fiter != fiter_end; ++ fiter) {
+      std::ostringstream os_feature;
+      os_feature.precision(20);
+      os_feature << ' ' << fiter->first << '=' << fiter->second;
+      features.push_back(os_feature.str());
+    }
+    std::sort(features.begin(), features.end());
+    std::copy(features.begin(), features.end(), std::ostream_iterator<std::string>(os));
+    os << " |||";
+
+    rule_string_set_type attributes;
+    transducer_type::attribute_set_type::const_iterator aiter_end = riter->attributes.end();
+    for (transducer_type::attribute_set_type::const_iterator aiter = riter->attributes.begin(); aiter != aiter_end; ++ aiter) {
+      std::ostringstream os_attribute;
+      os_attribute.precision(20);
+      os_attribute << ' ' << aiter->first << '=' << aiter->second;
+      attributes.push_back(os_attribute.str());
+    }
+    std::sort(attributes.begin(), attributes.end());
+    std::copy(attributes.begin(), attributes.end(), std::ostream_iterator<std::string>(os));
+
+    collected.push_back(os.str());
+  }
+
+  std::sort(collected.begin(), collected.end());
+}
+
+transducer_type::id_type traverse(const transducer_type& grammar, const sequence_type& sequence)
+{
+  transducer_type::id_type node = grammar.root();
+
+  sequence_type::const_iterator siter_end = sequence.end();
+  for (sequence_type::const_iterator siter = sequence.begin(); siter != siter_end; ++ siter) {
+    node = grammar.next(node, *siter);
+
+    if (node == grammar.root())
+      throw std::runtime_error("no transition?");
+  }
+
+  return node;
+}
+
+int main(int argc, char** argv)
+{
+  try {
+    const path_type tmp_dir = utils::tempfile::directory_name(utils::tempfile::tmp_dir() / "cicada.grammar.cache.XXXXXX");
+    utils::tempfile::insert(tmp_dir);
+
+    const path_type path_grammar = tmp_dir / "grammar.txt";
+    const path_type path_cache   = tmp_dir / "cache";
+
+    const size_t size = sizeof(rules) / sizeof(const char*);
+
+    {
+      std::ofstream os(path_grammar.string().c_str());
+      for (size_t i = 0; i != size; ++ i)
+	os << rules[i] << '\n';
+    }
+
+    cicada::GrammarMutable grammar_mutable(path_grammar.string());
+
+    transducer_type::transducer_ptr_type grammar_static(transducer_type::create(path_grammar.string() + ":cache=" + path_cache.string()));
+
+    if (! boost::filesystem::exists(path_cache) || boost::filesystem::directory_iterator(path_cache) == boost::filesystem::directory_iterator())
+      throw std::runtime_error("no compiled grammar under the cache");
+
+    rule_string_set_type rules_mutable;
+    rule_string_set_type rules_static;
+
+    sequence_set_type sequences;
+    size_t num_rules = 0;
+
+    for (size_t i = 0; i != size; ++ i) {
+      // the source side of the rule, which is the key of the rule sets, by the "plain" non-terminals
+      std::istringstream is(std::string(rules[i]).substr(std::string(rules[i]).find("|||") + 3));
+
+      sequence_type sequence;
+      std::string word;
+      while (is >> word && word != "|||") {
+	const symbol_type symbol(word);
+
+	sequence.push_back(symbol.is_non_terminal() ? symbol.non_terminal() : symbol);
+      }
+
+      // rules sharing the same source are compared once
+      if (! sequences.insert(sequence).second) continue;
+
+      collect(grammar_mutable.rules(traverse(grammar_mutable, sequence)), rules_mutable);
+      collect(grammar_static->rules(traverse(*grammar_static, sequence)), rules_static);
+
+      if (rules_mutable.empty())
+	throw std::runtime_error(std::string("no rules: ") + rules[i]);
+
+      if (rules_mutable != rules_static) {
+	std::cerr << "mutable:" << std::endl;
+	std::copy(rules_mutable.begin(), rules_mutable.end(), std::ostream_iterator<std::string>(std::cerr, "\n"));
+	std::cerr << "static:" << std::endl;
+	std::copy(rules_static.begin(), rules_static.end(), std::ostream_iterator<std::string>(std::cerr, "\n"));
+
+	throw std::runtime_error(std::string("different rules: ") + rules[i]);
+      }
+
+      num_rules += rules_mutable.size();
+    }
+
+    std::cout << "rules: " << num_rules << std::endl;
+
+    boost::filesystem::remove_all(tmp_dir);
+    utils::tempfile::erase(tmp_dir);
+  }
+  catch (std::exception& err) {
+    std::cerr << "error: " << err.what() << std::endl;
+    return -1;
+  }
+}
@@ -8,6 +8,7 @@
 #include <memory>
 
 #include "grammar_mutable.hpp"
+#include "grammar_static.hpp"
 #include "parameter.hpp"
 #include "attribute_vector.hpp"
 
@@ -33,8 +34,10 @@
 #include "utils/config.hpp"
 #include "utils/thread_specific_ptr.hpp"
 #include "utils/json_string_parser.hpp"
+#include "utils/json_string_generator.hpp"
 #include "utils/resource.hpp"
 #include "utils/getline.hpp"
+#include "utils/tempfile.hpp"
 
 namespace std
 {
@@ -70,11 +73,15 @@ namespace cicada
     typedef Transducer::rule_ptr_type      rule_ptr_type;
     typedef Transducer::rule_pair_type     rule_pair_type;
     typedef Transducer::rule_pair_set_type rule_pair_set_type;
+    typedef Transducer::feature_set_type   feature_set_type;
+    typedef Transducer::attribute_set_type attribute_set_type;
     
     typedef utils::trie_compact<symbol_type, rule_pair_set_type, utils::unassigned<symbol_type>, boost::hash<symbol_type>, std::equal_to<symbol_type>,
 				std::allocator<std::pair<const symbol_type, rule_pair_set_type> > > trie_type;
     typedef trie_type::id_type id_type;
     
+    typedef boost::filesystem::path path_type;
+    
     typedef std::vector<feature_type, std::allocator<feature_type> >     feature_name_set_type;
     typedef std::vector<attribute_type, std::allocator<attribute_type> > attribute_name_set_type;
 
@@ -109,6 +116,8 @@ namespace cicada
     }
     
     void clear() { trie.clear(); }
+    
+    void write(const path_type& path) const;
 
   private:
     trie_type trie;
@@ -316,7 +325,9 @@ namespace cicada
       } else if (utils::ipiece(piter->first) == "attribute-prefix") {
 	attribute_prefix = piter->second;
 	continue;
-      } else if (utils::ipiece(piter->first) == "populate")
+      } else if (utils::ipiece(piter->first) == "populate"
+		 || utils::ipiece(piter->first) == "cache-shared"
+		 || utils::ipiece(piter->first) == "cache-size")
 	continue;
       
       {
@@ -467,11 +478,178 @@ namespace cicada
     }
   }
   
+  struct attribute_data_writer : public boost::static_visitor<void>
+  {
+    typedef std::ostream_iterator<char> iterator_type;
+    
+    // we need a "dot" for the double data, and enough digits to keep the value as is.
+    struct real_precision : boost::spirit::karma::real_policies<double>
+    {
+      static unsigned int precision(double) 
+      { 
+        return 20;
+      }
+    };
+    
+    attribute_data_writer(std::ostream& __os) : os(__os) {}
+    
+    void operator()(const AttributeVector::int_type& x) const
+    {
+      iterator_type iter(os);
+      
+      if (! boost::spirit::karma::generate(iter, data_int, x))
+	throw std::runtime_error("failed attribute data generation!");
+    }
+    
+    void operator()(const double& x) const
+    {
+      iterator_type iter(os);
+      
+      if (! boost::spirit::karma::generate(iter, data_double, x))
+	throw std::runtime_error("failed attribute data generation!");
+    }
+    
+    void operator()(const std::string& x) const
+    {
+      iterator_type iter(os);
+      
+      if (! boost::spirit::karma::generate(iter, data_string, x))
+	throw std::runtime_error("failed attribute data generation!");
+    }
+    
+    std::ostream& os;
+    
+    boost::spirit::karma::real_generator<double, real_precision>              data_double;
+    boost::spirit::karma::int_generator<AttributeVector::int_type, 10, false> data_int;
+    utils::json_string_generator<iterator_type, true>                         data_string;
+  };
+  
+  void GrammarMutableImpl::write(const path_type& path) const
+  {
+    // we dump rules in the key-value format, one group of rules for each trie node, and let GrammarStatic index them.
+    
+    const path_type tmp_dir = utils::tempfile::tmp_dir();
+    const path_type path_text = utils::tempfile::file_name(tmp_dir / "cicada.grammar.XXXXXX");
+    
+    utils::tempfile::insert(path_text);
+    
+    {
+      utils::compress_ostream os(path_text, 1024 * 1024);
+      os.precision(20);
+      
+      attribute_data_writer writer(os);
+      
+      typedef std::vector<int, std::allocator<int> > index_type;
+      typedef std::vector<rule_type, std::allocator<rule_type> > rule_set_type;
+      typedef std::vector<size_type, std::allocator<size_type> > group_set_type;
+      
+      index_type    index;
+      rule_set_type sources;
+      rule_set_type targets;
+      group_set_type groups;
+      
+      for (id_type id = 0; id != trie.size(); ++ id) {
+	const rule_pair_set_type& rules = trie[id];
+	
+	if (rules.empty()) continue;
+	
+	// GrammarStatic applies cicada::sort() when reading, which assumes the target non-terminals in order.
+	// Thus, we move the non-terminal indices from the target to the source.
+	sources.clear();
+	targets.clear();
+	
+	rule_pair_set_type::const_iterator riter_end = rules.end();
+	for (rule_pair_set_type::const_iterator riter = rules.begin(); riter != riter_end; ++ riter) {
+	  sources.push_back(*riter->source);
+	  targets.push_back(riter->target ? *riter->target : rule_type(riter->source->lhs, rule_type::symbol_set_type()));
+	  
+	  rule_type& source = sources.back();
+	  rule_type& target = targets.back();
+	  
+	  if (target.rhs.empty()) continue;
+	  
+	  index.clear();
+	  index.resize(target.rhs.size() + source.rhs.size() + 1, 0);
+	  
+	  int pos = 1;
+	  rule_type::symbol_set_type::iterator titer_end = target.rhs.end();
+	  for (rule_type::symbol_set_type::iterator titer = target.rhs.begin(); titer != titer_end; ++ titer)
+	    if (titer->is_non_terminal()) {
+	      index[titer->non_terminal_index()] = pos;
+	      *titer = titer->non_terminal(pos);
+	      ++ pos;
+	    }
+	  
+	  rule_type::symbol_set_type::iterator siter_end = source.rhs.end();
+	  for (rule_type::symbol_set_type::iterator siter = source.rhs.begin(); siter != siter_end; ++ siter)
+	    if (siter->is_non_terminal())
+	      *siter = siter->non_terminal(index[siter->non_terminal_index()]);
+	}
+	
+	// GrammarStatic groups consecutive rules by the source, thus, we output rules grouped by the source
+	groups.clear();
+	for (size_type i = 0; i != sources.size(); ++ i) {
+	  bool found = false;
+	  for (group_set_type::const_iterator giter = groups.begin(); giter != groups.end() && ! found; ++ giter)
+	    found = (sources[*giter].rhs == sources[i].rhs);
+	  
+	  if (! found)
+	    groups.push_back(i);
+	}
+	
+	for (group_set_type::const_iterator giter = groups.begin(); giter != groups.end(); ++ giter)
+	  for (size_type i = *giter; i != sources.size(); ++ i) {
+	    if (sources[i].rhs != sources[*giter].rhs) continue;
+	    
+	    const rule_pair_type& rule = rules[i];
+	    
+	    os << sources[i].lhs << " |||";
+	    
+	    rule_type::symbol_set_type::const_iterator siter_end = sources[i].rhs.end();
+	    for (rule_type::symbol_set_type::const_iterator siter = sources[i].rhs.begin(); siter != siter_end; ++ siter)
+	      os << ' ' << *siter;
+	    os << " |||";
+	    
+	    rule_type::symbol_set_type::const_iterator titer_end = targets[i].rhs.end();
+	    for (rule_type::symbol_set_type::const_iterator titer = targets[i].rhs.begin(); titer != titer_end; ++ titer)
+	      os << ' ' << *titer;
+	    os << " |||";
+	    
+	    feature_set_type::const_iterator fiter_end = rule.features.end();
+	    for (feature_set_type::const_iterator fiter = rule.features.begin(); fiter != fiter_end; ++ fiter)
+	      os << ' ' << fiter->first << '=' << fiter->second;
+	    os << " |||";
+	    
+	    attribute_set_type::const_iterator aiter_end = rule.attributes.end();
+	    for (attribute_set_type::const_iterator aiter = rule.attributes.begin(); aiter != aiter_end; ++ aiter) {
+	      os << ' ' << aiter->first << '=';
+	      boost::apply_visitor(writer, aiter->second);
+	    }
+	    os << '\n';
+	  }
+      }
+    }
+    
+    {
+      GrammarStatic grammar(path_text.string() + ":key-value=true,debug=" + utils::lexical_cast<std::string>(debug));
+      
+      grammar.write(path);
+    }
+    
+    boost::filesystem::remove(path_text);
+    utils::tempfile::erase(path_text);
+  }
+  
   void GrammarMutable::read(const std::string& parameter)
   {
     pimpl->read(parameter);
   }
 
+  void GrammarMutable::write(const path_type& path) const
+  {
+    pimpl->write(path);
+  }
+
   void GrammarMutable::clear()
   {
     pimpl->clear();
@@ -12,6 +12,8 @@
 
 #include <cicada/transducer.hpp>
 
+#include <boost/filesystem/path.hpp>
+
 namespace cicada
 {
   
@@ -22,6 +24,8 @@ namespace cicada
   private:
     typedef GrammarMutableImpl impl_type;
 
+    typedef boost::filesystem::path path_type;
+
   public:
     // mutable grammar, use to encode rule-table generated by nicttm, moses, joshua etc.
     // 
@@ -68,6 +72,9 @@ namespace cicada
     void clear();
     size_type size() const;
     
+    // compile into the indexed grammar of GrammarStatic, which can be memory-mapped by later runs.
+    void write(const path_type& path) const;
+    
     void insert(const std::string& pattern);
     void insert(const rule_pair_type& rule_pair);
     
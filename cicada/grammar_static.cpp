@@ -39,6 +39,7 @@
 #include "utils/getline.hpp"
 #include "utils/hashmurmur.hpp"
 #include "utils/hashmurmur3.hpp"
+#include "utils/striped_cache.hpp"
 
 #include <boost/lexical_cast.hpp>
 #include <boost/bind.hpp>
@@ -274,15 +275,25 @@ namespace cicada
     typedef std::vector<score_set_type, std::allocator<score_set_type> > score_db_type;
     
     // caching...
-    typedef utils::arc_list<size_type, rule_pair_set_type, 4,
+    typedef boost::shared_ptr<const rule_pair_set_type> rule_pair_set_ptr_type;
+    
+    typedef utils::arc_list<size_type, rule_pair_set_ptr_type, 4,
 			    std::equal_to<size_type>,
-			    std::allocator<std::pair<size_type, rule_pair_set_type> > > cache_rule_set_type;
+			    std::allocator<std::pair<size_type, rule_pair_set_ptr_type> > > cache_rule_set_type;
+    
+    // the rule sets shared among clones, i.e., decoder threads. A local miss is looked up in the shared one
+    // before decoding, and a decoded rule set is published to the others.
+    typedef utils::striped_cache<size_type, rule_pair_set_type> cache_shared_type;
+    typedef boost::shared_ptr<cache_shared_type>               cache_shared_ptr_type;
 
+    // ordered implies that the k-th non-terminal is indexed by k, thus, cicada::sort() is an identity for an ordered pair,
+    // and we can share the decoded phrase among rules.
     struct cache_phrase_type
     {
       rule_ptr_type rule;
       size_type     pos;
-      cache_phrase_type() : rule(), pos(size_type(-1)) {}
+      bool          ordered;
+      cache_phrase_type() : rule(), pos(size_type(-1)), ordered(false) {}
     };
     
     struct cache_node_type
@@ -295,7 +306,7 @@ namespace cicada
     };
 
     typedef utils::array_power2<cache_rule_set_type, 1024 * 2, std::allocator<cache_rule_set_type> > cache_rule_map_type;
-    typedef utils::array_power2<cache_phrase_type,   1024 * 2, std::allocator<cache_phrase_type> >   cache_phrase_set_type;
+    typedef utils::array_power2<cache_phrase_type,   1024 * 8, std::allocator<cache_phrase_type> >   cache_phrase_set_type;
     typedef utils::array_power2<cache_node_type,     1024 * 8, std::allocator<cache_node_type> >     cache_node_set_type;
     
     typedef std::vector<size_type, std::allocator<size_type> > cache_root_type;
@@ -322,7 +333,9 @@ namespace cicada
 
   public:
     GrammarStaticImpl(const std::string& parameter)
-      : max_span(0),
+      : cache_hit(0),
+	cache_miss(0),
+	max_span(0),
 	debug(0)
     {
       read(parameter);
@@ -341,6 +354,9 @@ namespace cicada
 	vocab(x.vocab),
 	feature_names(x.feature_names),
 	attribute_names(x.attribute_names),
+	cache_shared(x.cache_shared),
+	cache_hit(0),
+	cache_miss(0),
 	max_span(x.max_span),
 	debug(x.debug)
     { }
@@ -361,6 +377,7 @@ namespace cicada
       vocab           = x.vocab;
       feature_names   = x.feature_names;
       attribute_names = x.attribute_names;
+      cache_shared    = x.cache_shared;
       max_span        = x.max_span;
       debug           = x.debug;
       
@@ -389,6 +406,10 @@ namespace cicada
       cache_targets.clear();
       cache_nodes.clear();
       cache_root.clear();
+      
+      cache_shared.reset();
+      cache_hit  = 0;
+      cache_miss = 0;
 
       max_span = 0;
     }
@@ -448,11 +469,25 @@ namespace cicada
       cache_rule_set_type& cache = const_cast<cache_rule_set_type&>(cache_rule_sets[cache_pos]);
       
       std::pair<cache_rule_set_type::iterator, bool> result = cache.find(node);
-      if (! result.second) {
+      if (result.second) {
+	++ const_cast<size_type&>(cache_hit);
+	return *result.first->second;
+      }
+      
+      result.first->second.reset();
+      if (cache_shared)
+	result.first->second = cache_shared->find(node);
+      
+      if (result.first->second)
+	++ const_cast<size_type&>(cache_hit);
+      else {
 	typedef utils::piece code_set_type;
 	
-	rule_pair_set_type& options = result.first->second;
-	options.clear();
+	++ const_cast<size_type&>(cache_miss);
+	
+	boost::shared_ptr<rule_pair_set_type> options_ptr(new rule_pair_set_type());
+	
+	rule_pair_set_type& options = *options_ptr;
 	
 	rule_db_type::cursor cursor_end = rule_db.cend(node);
 	for (rule_db_type::cursor cursor = rule_db.cbegin(node); cursor != cursor_end; ++ cursor) {
@@ -495,10 +530,14 @@ namespace cicada
 	    
 	    const symbol_type lhs = vocab[id_lhs];
 	    
-	    const rule_ptr_type rule_source = read_phrase(lhs, pos_source, cache_sources, source_db);
-	    const rule_ptr_type rule_target = read_phrase(lhs, pos_target, cache_targets, target_db);
+	    const cache_phrase_type& phrase_source = read_phrase(lhs, pos_source, cache_sources, source_db);
+	    const cache_phrase_type& phrase_target = read_phrase(lhs, pos_target, cache_targets, target_db);
+	    
+	    const rule_ptr_type& rule_source = phrase_source.rule;
+	    const rule_ptr_type& rule_target = phrase_target.rule;
 	    
-	    if (rule_target->rhs.empty())
+	    // we share the decoded phrases unless we need to re-index non-terminals
+	    if (rule_target->rhs.empty() || (phrase_source.ordered && phrase_target.ordered))
 	      options.push_back(rule_pair_type(rule_source, rule_target));
 	    else {
 	      rule_type rule_sorted_source(*rule_source);
@@ -553,9 +592,14 @@ namespace cicada
 	}
 	
 	rule_pair_set_type(options).swap(options);
+	
+	result.first->second = options_ptr;
+	
+	if (cache_shared)
+	  cache_shared->insert(node, result.first->second);
       }
       
-      return result.first->second;
+      return *result.first->second;
     }
 
   private:    
@@ -565,10 +609,10 @@ namespace cicada
     sequence_type phrase_impl;
     id_set_type   phrase_id_impl;
 
-    const rule_ptr_type& read_phrase(const symbol_type& lhs,
-				     size_type pos,
-				     const cache_phrase_set_type& cache_phrases,
-				     const phrase_db_type& phrase_db) const
+    const cache_phrase_type& read_phrase(const symbol_type& lhs,
+					 size_type pos,
+					 const cache_phrase_set_type& cache_phrases,
+					 const phrase_db_type& phrase_db) const
     {
       typedef utils::hashmurmur3<size_t> hasher_type;
       
@@ -600,15 +644,25 @@ namespace cicada
 	sequence_type& phrase = const_cast<sequence_type&>(phrase_impl);
 	phrase.resize(phrase_id.size());
 	
+	int non_terminal_pos = 1;
+	bool ordered = true;
+	
 	sequence_type::iterator piter = phrase.begin();
 	id_set_type::const_iterator iiter_end = phrase_id.end();
-	for (id_set_type::const_iterator iiter = phrase_id.begin(); iiter != iiter_end; ++ iiter, ++ piter)
+	for (id_set_type::const_iterator iiter = phrase_id.begin(); iiter != iiter_end; ++ iiter, ++ piter) {
 	  *piter = vocab[*iiter];
+	  
+	  if (piter->is_non_terminal()) {
+	    ordered &= (piter->non_terminal_index() == non_terminal_pos);
+	    ++ non_terminal_pos;
+	  }
+	}
 	
 	cache.pos = pos;
 	cache.rule = rule_type::create(rule_type(lhs, phrase.begin(), phrase.end()));
+	cache.ordered = ordered;
       }
-      return cache.rule;
+      return cache;
     }
 
   public:
@@ -693,8 +747,13 @@ namespace cicada
     
     cache_node_set_type   cache_nodes;
     cache_root_type       cache_root;
-
+    
+    cache_shared_ptr_type cache_shared;
+    
   public:
+    size_type cache_hit;
+    size_type cache_miss;
+    
     int max_span;
     int debug;
   };
@@ -1057,6 +1116,15 @@ namespace cicada
     parameter_type::const_iterator piter = param.find("populate");
     if (piter != param.end() && utils::lexical_cast<bool>(piter->second))
       populate();
+    
+    size_type cache_size = 1024 * 64;
+    parameter_type::const_iterator citer = param.find("cache-size");
+    if (citer != param.end())
+      cache_size = utils::lexical_cast<size_type>(citer->second);
+    
+    parameter_type::const_iterator hiter = param.find("cache-shared");
+    if (hiter != param.end() && utils::lexical_cast<bool>(hiter->second))
+      cache_shared.reset(new cache_shared_type(cache_size));
   }
   
   void GrammarStaticImpl::write(const path_type& file) const
@@ -2164,6 +2232,12 @@ namespace cicada
     return (pimpl->is_valid(node) && pimpl->exists(node) ? pimpl->read_rule_set(node) : __empty);
   }
   
+  void GrammarStatic::cache_statistics(size_type& hit, size_type& miss) const
+  {
+    hit  += pimpl->cache_hit;
+    miss += pimpl->cache_miss;
+  }
+  
   void GrammarStatic::quantize()
   {
     pimpl->quantize();
@@ -38,6 +38,8 @@ namespace cicada
     // key,value: key, value pair... valid pairs are:
     //
     //    max-span = 15 : maximum non-terminals span
+    //    cache-shared = true : share the decoded rules among clones
+    //    cache-size = 65536 : # of rule sets in the shared cache
     // 
     //    feature0 = feature-name0
     //    feature1 = feature-name1
@@ -61,6 +63,7 @@ namespace cicada
     id_type next(const id_type& node, const symbol_type& symbol) const;
     bool has_next(const id_type& node) const;
     const rule_pair_set_type& rules(const id_type& node) const;
+    void cache_statistics(size_type& hit, size_type& miss) const;
 
     // grammar_static specific members
     void quantize();
@@ -6,6 +6,7 @@
 #define PHOENIX_THREADSAFE
 
 #include "hypergraph.hpp"
+#include "hypergraph_binary.hpp"
 #include "sort_topologically.hpp"
 #include "unite.hpp"
 
@@ -325,6 +326,10 @@ namespace cicada
     namespace qi = boost::spirit::qi;
     namespace standard = boost::spirit::standard;
     
+    // binary format
+    if (is_binary(iter, end))
+      return read_binary(iter, end, *this);
+    
     clear();
 
     hypergraph_parser_impl::grammar_type& grammar = hypergraph_parser_impl::instance();
@@ -15,15 +15,31 @@
 #include <cicada/attribute_vector.hpp>
 #include <cicada/rule.hpp>
 
+#include <utils/config.hpp>
 #include <utils/small_vector.hpp>
 #include <utils/chunk_vector.hpp>
 #include <utils/piece.hpp>
+#include <utils/arena_allocator.hpp>
 
 #include <boost/shared_ptr.hpp>
 
 namespace cicada
 {
   
+  // When configured with --enable-hypergraph-arena, the nodes, edges, their tails and features are allocated
+  // from the arena installed for the current thread, i.e. the per-sentence arena of the decoder, and
+  // from the heap otherwise. A hypergraph constructed under an arena must not outlive its scope.
+  // Rules are shared with the grammars, and always allocated from the heap.
+  template <typename Tp>
+  struct HyperGraphAllocator
+  {
+#ifdef HAVE_HYPERGRAPH_ARENA
+    typedef utils::arena_allocator<Tp> type;
+#else
+    typedef std::allocator<Tp> type;
+#endif
+  };
+
   class HyperGraph
   {
   public:
@@ -34,7 +50,7 @@ namespace cicada
     typedef cicada::Rule                 rule_type;
     typedef boost::shared_ptr<rule_type> rule_ptr_type;
 
-    typedef cicada::FeatureVector<double, std::allocator<double> > feature_set_type;
+    typedef cicada::FeatureVector<double, HyperGraphAllocator<double>::type > feature_set_type;
     typedef cicada::AttributeVector                                attribute_set_type;
     
   public:
@@ -46,7 +62,7 @@ namespace cicada
   public:
     struct Node
     {
-      typedef std::vector<id_type, std::allocator<id_type> > edge_set_type;
+      typedef std::vector<id_type, HyperGraphAllocator<id_type>::type > edge_set_type;
       
       Node() : id(invalid) {}
       Node(const edge_set_type& __edges, const id_type& __id)
@@ -58,7 +74,7 @@ namespace cicada
     
     struct Edge
     {
-      typedef utils::small_vector<id_type, std::allocator<id_type> > node_set_type;
+      typedef utils::small_vector<id_type, HyperGraphAllocator<id_type>::type > node_set_type;
       typedef cicada::Rule rule_type;
       
       Edge()
@@ -89,8 +105,8 @@ namespace cicada
     typedef Edge edge_type;
     
   public:
-    typedef utils::chunk_vector<node_type, 4096 / sizeof(node_type), std::allocator<node_type> > node_set_type;
-    typedef utils::chunk_vector<edge_type, 4096 / sizeof(edge_type), std::allocator<edge_type> > edge_set_type;
+    typedef utils::chunk_vector<node_type, 4096 / sizeof(node_type), HyperGraphAllocator<node_type>::type > node_set_type;
+    typedef utils::chunk_vector<edge_type, 4096 / sizeof(edge_type), HyperGraphAllocator<edge_type>::type > edge_set_type;
 
   public:
 
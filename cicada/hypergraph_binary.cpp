@@ -0,0 +1,515 @@
+//
+//  Copyright(C) 2013 Taro Watanabe <taro.watanabe@nict.go.jp>
+//
+
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+
+#include "hypergraph_binary.hpp"
+
+#include "codec/lz4.h"
+
+#include "utils/indexed_set.hpp"
+#include "utils/hashmurmur3.hpp"
+
+#include <boost/variant.hpp>
+
+namespace cicada
+{
+  namespace hypergraph_binary_impl
+  {
+    typedef HyperGraph hypergraph_type;
+    typedef hypergraph_type::rule_type          rule_type;
+    typedef hypergraph_type::rule_ptr_type      rule_ptr_type;
+    typedef hypergraph_type::feature_set_type   feature_set_type;
+    typedef hypergraph_type::attribute_set_type attribute_set_type;
+
+    typedef rule_type::symbol_type          symbol_type;
+    typedef feature_set_type::feature_type  feature_type;
+    typedef attribute_set_type::key_type    attribute_type;
+
+    static const uint8_t version  = 1;
+    static const uint8_t flag_lz4 = 1;
+
+    enum {
+      attribute_int = 0,
+      attribute_float,
+      attribute_string
+    };
+
+    struct rule_ptr_hash
+    {
+      size_t operator()(const rule_type* x) const
+      {
+	return (x ? hash_value(*x) : size_t(0));
+      }
+    };
+
+    struct rule_ptr_equal
+    {
+      bool operator()(const rule_type* x, const rule_type* y) const
+      {
+	return (x == y) || (x && y && *x == *y);
+      }
+    };
+
+    typedef utils::indexed_set<symbol_type, boost::hash<symbol_type>, std::equal_to<symbol_type>, std::allocator<symbol_type> >             symbol_map_type;
+    typedef utils::indexed_set<feature_type, boost::hash<feature_type>, std::equal_to<feature_type>, std::allocator<feature_type> >         feature_map_type;
+    typedef utils::indexed_set<attribute_type, boost::hash<attribute_type>, std::equal_to<attribute_type>, std::allocator<attribute_type> > attribute_map_type;
+    typedef utils::indexed_set<const rule_type*, rule_ptr_hash, rule_ptr_equal, std::allocator<const rule_type*> >                          rule_map_type;
+
+    struct Encoder
+    {
+      Encoder(std::string& __buffer) : buffer(__buffer) {}
+
+      void encode(uint64_t x)
+      {
+	while (x >= 0x80) {
+	  buffer.push_back(char((x & 0x7f) | 0x80));
+	  x >>= 7;
+	}
+	buffer.push_back(char(x));
+      }
+
+      void encode(const double& x)
+      {
+	buffer.append(reinterpret_cast<const char*>(&x), sizeof(double));
+      }
+
+      void encode(const std::string& x)
+      {
+	encode(uint64_t(x.size()));
+	buffer.append(x);
+      }
+
+      std::string& buffer;
+    };
+
+    struct Decoder
+    {
+      Decoder(const char* __first, const char* __last) : first(__first), last(__last) {}
+
+      uint64_t decode_int()
+      {
+	uint64_t x = 0;
+	for (int shift = 0; shift < 64; shift += 7) {
+	  if (first == last)
+	    throw std::runtime_error("binary hypergraph: premature end");
+
+	  const uint8_t byte = *first;
+	  ++ first;
+
+	  x |= uint64_t(byte & 0x7f) << shift;
+	  if (! (byte & 0x80))
+	    return x;
+	}
+	throw std::runtime_error("binary hypergraph: invalid varint");
+      }
+
+      uint64_t decode_index(const size_t size)
+      {
+	const uint64_t x = decode_int();
+	if (x >= size)
+	  throw std::runtime_error("binary hypergraph: index out of range");
+	return x;
+      }
+
+      double decode_double()
+      {
+	if (last - first < static_cast<ptrdiff_t>(sizeof(double)))
+	  throw std::runtime_error("binary hypergraph: premature end");
+
+	double x;
+	std::memcpy(&x, first, sizeof(double));
+	first += sizeof(double);
+	return x;
+      }
+
+      utils::piece decode_string()
+      {
+	const uint64_t size = decode_int();
+	if (uint64_t(last - first) < size)
+	  throw std::runtime_error("binary hypergraph: premature end");
+
+	const char* begin = first;
+	first += size;
+	return utils::piece(begin, first);
+      }
+
+      const char* first;
+      const char* last;
+    };
+
+    struct attribute_encoder : public boost::static_visitor<void>
+    {
+      attribute_encoder(Encoder& __encoder) : encoder(__encoder) {}
+
+      void operator()(const attribute_set_type::int_type& x) const
+      {
+	encoder.buffer.push_back(char(attribute_int));
+	// zig-zag
+	encoder.encode(uint64_t((x << 1) ^ (x >> 63)));
+      }
+
+      void operator()(const attribute_set_type::float_type& x) const
+      {
+	encoder.buffer.push_back(char(attribute_float));
+	encoder.encode(x);
+      }
+
+      void operator()(const attribute_set_type::string_type& x) const
+      {
+	encoder.buffer.push_back(char(attribute_string));
+	encoder.encode(x);
+      }
+
+      Encoder& encoder;
+    };
+
+    static const char* base64_table = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+    inline
+    void encode_base64(const std::string& x, std::ostream& os)
+    {
+      std::string encoded;
+      encoded.reserve(((x.size() + 2) / 3) * 4);
+
+      const uint8_t* iter = reinterpret_cast<const uint8_t*>(x.c_str());
+      const uint8_t* last = iter + (x.size() / 3) * 3;
+
+      for (/**/; iter != last; iter += 3) {
+	encoded.push_back(base64_table[iter[0] >> 2]);
+	encoded.push_back(base64_table[((iter[0] & 0x03) << 4) | (iter[1] >> 4)]);
+	encoded.push_back(base64_table[((iter[1] & 0x0f) << 2) | (iter[2] >> 6)]);
+	encoded.push_back(base64_table[iter[2] & 0x3f]);
+      }
+
+      switch (x.size() % 3) {
+      case 1:
+	encoded.push_back(base64_table[iter[0] >> 2]);
+	encoded.push_back(base64_table[(iter[0] & 0x03) << 4]);
+	encoded.append("==");
+	break;
+      case 2:
+	encoded.push_back(base64_table[iter[0] >> 2]);
+	encoded.push_back(base64_table[((iter[0] & 0x03) << 4) | (iter[1] >> 4)]);
+	encoded.push_back(base64_table[(iter[1] & 0x0f) << 2]);
+	encoded.push_back('=');
+	break;
+      }
+
+      os.write(encoded.c_str(), encoded.size());
+    }
+
+    struct base64_decode_table
+    {
+      base64_decode_table()
+      {
+	std::fill(table, table + 256, int8_t(-1));
+	for (int i = 0; i != 64; ++ i)
+	  table[uint8_t(base64_table[i])] = i;
+      }
+
+      int8_t table[256];
+    };
+
+    // decode base64 in [iter, end) until a non-base64 character. iter is advanced to the end of the base64, including padding
+    inline
+    void decode_base64(utils::piece::const_iterator& iter, utils::piece::const_iterator end, std::string& decoded)
+    {
+      static const base64_decode_table __table;
+      const int8_t* table = __table.table;
+
+      decoded.clear();
+      decoded.reserve(((end - iter) * 3) / 4);
+
+      uint32_t bits = 0;
+      int      size = 0;
+      for (/**/; iter != end; ++ iter) {
+	const int8_t value = table[uint8_t(*iter)];
+	if (value < 0) break;
+
+	bits = (bits << 6) | value;
+	size += 6;
+
+	if (size >= 8) {
+	  size -= 8;
+	  decoded.push_back(char((bits >> size) & 0xff));
+	}
+      }
+
+      for (/**/; iter != end && *iter == '='; ++ iter);
+    }
+  };
+
+  std::ostream& write_binary(std::ostream& os, const HyperGraph& graph, const bool compress)
+  {
+    using namespace hypergraph_binary_impl;
+
+    symbol_map_type    symbols;
+    feature_map_type   features;
+    attribute_map_type attributes;
+    rule_map_type      rules;
+
+    // encode nodes first, so that we will collect the tables
+    std::string buffer_nodes;
+    Encoder encoder_nodes(buffer_nodes);
+
+    encoder_nodes.encode(uint64_t(graph.nodes.size()));
+
+    hypergraph_type::node_set_type::const_iterator niter_end = graph.nodes.end();
+    for (hypergraph_type::node_set_type::const_iterator niter = graph.nodes.begin(); niter != niter_end; ++ niter) {
+      encoder_nodes.encode(uint64_t(niter->edges.size()));
+
+      hypergraph_type::node_type::edge_set_type::const_iterator eiter_end = niter->edges.end();
+      for (hypergraph_type::node_type::edge_set_type::const_iterator eiter = niter->edges.begin(); eiter != eiter_end; ++ eiter) {
+	const hypergraph_type::edge_type& edge = graph.edges[*eiter];
+
+	encoder_nodes.encode(uint64_t(edge.tails.size()));
+	hypergraph_type::edge_type::node_set_type::const_iterator titer_end = edge.tails.end();
+	for (hypergraph_type::edge_type::node_set_type::const_iterator titer = edge.tails.begin(); titer != titer_end; ++ titer)
+	  encoder_nodes.encode(uint64_t(*titer));
+
+	encoder_nodes.encode(uint64_t(edge.features.size()));
+	feature_set_type::const_iterator fiter_end = edge.features.end();
+	for (feature_set_type::const_iterator fiter = edge.features.begin(); fiter != fiter_end; ++ fiter) {
+	  feature_map_type::iterator iter = features.insert(fiter->first).first;
+
+	  encoder_nodes.encode(uint64_t(iter - features.begin()));
+	  encoder_nodes.encode(double(fiter->second));
+	}
+
+	encoder_nodes.encode(uint64_t(edge.attributes.size()));
+	attribute_set_type::const_iterator aiter_end = edge.attributes.end();
+	for (attribute_set_type::const_iterator aiter = edge.attributes.begin(); aiter != aiter_end; ++ aiter) {
+	  attribute_map_type::iterator iter = attributes.insert(aiter->first).first;
+
+	  encoder_nodes.encode(uint64_t(iter - attributes.begin()));
+	  boost::apply_visitor(attribute_encoder(encoder_nodes), aiter->second);
+	}
+
+	// rule-id zero is reserved for no rule
+	if (edge.rule) {
+	  rule_map_type::iterator iter = rules.insert(&(*edge.rule)).first;
+
+	  encoder_nodes.encode(uint64_t(iter - rules.begin() + 1));
+	} else
+	  encoder_nodes.encode(uint64_t(0));
+      }
+    }
+
+    encoder_nodes.encode(uint64_t(graph.is_valid() ? graph.goal + 1 : 0));
+
+    // rules, which collects symbols
+    std::string buffer_rules;
+    Encoder encoder_rules(buffer_rules);
+
+    encoder_rules.encode(uint64_t(rules.size()));
+
+    rule_map_type::const_iterator riter_end = rules.end();
+    for (rule_map_type::const_iterator riter = rules.begin(); riter != riter_end; ++ riter) {
+      const rule_type& rule = *(*riter);
+
+      symbol_map_type::iterator iter = symbols.insert(rule.lhs).first;
+
+      encoder_rules.encode(uint64_t(iter - symbols.begin()));
+      encoder_rules.encode(uint64_t(rule.rhs.size()));
+
+      rule_type::symbol_set_type::const_iterator siter_end = rule.rhs.end();
+      for (rule_type::symbol_set_type::const_iterator siter = rule.rhs.begin(); siter != siter_end; ++ siter) {
+	iter = symbols.insert(*siter).first;
+
+	encoder_rules.encode(uint64_t(iter - symbols.begin()));
+      }
+    }
+
+    // tables
+    std::string buffer;
+    Encoder encoder(buffer);
+
+    encoder.encode(uint64_t(symbols.size()));
+    for (symbol_map_type::const_iterator iter = symbols.begin(); iter != symbols.end(); ++ iter)
+      encoder.encode(static_cast<const std::string&>(*iter));
+
+    encoder.encode(uint64_t(features.size()));
+    for (feature_map_type::const_iterator iter = features.begin(); iter != features.end(); ++ iter)
+      encoder.encode(static_cast<const std::string&>(*iter));
+
+    encoder.encode(uint64_t(attributes.size()));
+    for (attribute_map_type::const_iterator iter = attributes.begin(); iter != attributes.end(); ++ iter)
+      encoder.encode(static_cast<const std::string&>(*iter));
+
+    buffer += buffer_rules;
+    buffer += buffer_nodes;
+
+    // header
+    std::string encoded;
+    encoded.push_back(char(version));
+    encoded.push_back(char(compress ? flag_lz4 : 0));
+
+    if (compress) {
+      Encoder encoder_header(encoded);
+      encoder_header.encode(uint64_t(buffer.size()));
+
+      const size_t offset = encoded.size();
+      encoded.resize(offset + LZ4_compressBound(buffer.size()));
+
+      const int size = LZ4_compress(buffer.c_str(), &encoded[offset], buffer.size());
+      if (size <= 0)
+	throw std::runtime_error("binary hypergraph: compression failed");
+
+      encoded.resize(offset + size);
+    } else
+      encoded += buffer;
+
+    os << hypergraph_binary_marker;
+    encode_base64(encoded, os);
+
+    return os;
+  }
+
+  bool read_binary(utils::piece::const_iterator& iter, utils::piece::const_iterator end, HyperGraph& graph)
+  {
+    using namespace hypergraph_binary_impl;
+
+    typedef std::vector<symbol_type, std::allocator<symbol_type> >         symbol_set_type;
+    typedef std::vector<feature_type, std::allocator<feature_type> >       feature_table_type;
+    typedef std::vector<attribute_type, std::allocator<attribute_type> >   attribute_table_type;
+    typedef std::vector<rule_ptr_type, std::allocator<rule_ptr_type> >     rule_ptr_set_type;
+    typedef std::vector<hypergraph_type::id_type, std::allocator<hypergraph_type::id_type> > tail_set_type;
+
+    graph.clear();
+
+    for (/**/; iter != end && (*iter == ' ' || *iter == '\t' || *iter == '\n' || *iter == '\r'); ++ iter);
+
+    if (iter == end || *iter != hypergraph_binary_marker)
+      return false;
+    ++ iter;
+
+    std::string encoded;
+    decode_base64(iter, end, encoded);
+
+    try {
+      if (encoded.size() < 2 || uint8_t(encoded[0]) != version)
+	throw std::runtime_error("binary hypergraph: invalid format");
+
+      std::string decompressed;
+
+      Decoder decoder(encoded.c_str() + 2, encoded.c_str() + encoded.size());
+
+      if (uint8_t(encoded[1]) & flag_lz4) {
+	const uint64_t size = decoder.decode_int();
+	if (size > LZ4_MAX_INPUT_SIZE)
+	  throw std::runtime_error("binary hypergraph: invalid format");
+
+	decompressed.resize(size);
+
+	const int result = LZ4_decompress_safe(decoder.first, &(*decompressed.begin()), decoder.last - decoder.first, size);
+	if (result < 0 || uint64_t(result) != size)
+	  throw std::runtime_error("binary hypergraph: invalid format");
+
+	decoder = Decoder(decompressed.c_str(), decompressed.c_str() + decompressed.size());
+      }
+
+      // tables
+      symbol_set_type symbols(decoder.decode_int());
+      for (symbol_set_type::iterator siter = symbols.begin(); siter != symbols.end(); ++ siter)
+	*siter = decoder.decode_string();
+
+      feature_table_type features(decoder.decode_int());
+      for (feature_table_type::iterator fiter = features.begin(); fiter != features.end(); ++ fiter)
+	*fiter = decoder.decode_string();
+
+      attribute_table_type attributes(decoder.decode_int());
+      for (attribute_table_type::iterator aiter = attributes.begin(); aiter != attributes.end(); ++ aiter)
+	*aiter = decoder.decode_string();
+
+      // rules
+      symbol_set_type rhs;
+
+      rule_ptr_set_type rules(decoder.decode_int() + 1);
+      for (rule_ptr_set_type::iterator riter = rules.begin() + 1; riter != rules.end(); ++ riter) {
+	const symbol_type& lhs = symbols[decoder.decode_index(symbols.size())];
+
+	rhs.resize(decoder.decode_int());
+	for (symbol_set_type::iterator siter = rhs.begin(); siter != rhs.end(); ++ siter)
+	  *siter = symbols[decoder.decode_index(symbols.size())];
+
+	*riter = rule_type::create(rule_type(lhs, rhs.begin(), rhs.end()));
+      }
+
+      // nodes
+      tail_set_type tails;
+
+      const uint64_t num_nodes = decoder.decode_int();
+      for (uint64_t node_id = 0; node_id != num_nodes; ++ node_id) {
+	graph.add_node();
+
+	const uint64_t num_edges = decoder.decode_int();
+	for (uint64_t i = 0; i != num_edges; ++ i) {
+	  tails.resize(decoder.decode_int());
+	  for (tail_set_type::iterator titer = tails.begin(); titer != tails.end(); ++ titer)
+	    *titer = decoder.decode_index(num_nodes);
+
+	  hypergraph_type::edge_type& edge = graph.add_edge(tails.begin(), tails.end());
+
+	  const uint64_t num_features = decoder.decode_int();
+	  if (num_features)
+	    edge.features.rehash(num_features);
+	  for (uint64_t j = 0; j != num_features; ++ j) {
+	    const feature_type& feature = features[decoder.decode_index(features.size())];
+
+	    edge.features.insert(std::make_pair(feature, decoder.decode_double()));
+	  }
+
+	  const uint64_t num_attributes = decoder.decode_int();
+	  for (uint64_t j = 0; j != num_attributes; ++ j) {
+	    const attribute_type& attribute = attributes[decoder.decode_index(attributes.size())];
+
+	    if (decoder.first == decoder.last)
+	      throw std::runtime_error("binary hypergraph: invalid format");
+
+	    const uint8_t type = *decoder.first;
+	    ++ decoder.first;
+
+	    switch (type) {
+	    case attribute_int: {
+	      const uint64_t x = decoder.decode_int();
+	      edge.attributes[attribute] = attribute_set_type::int_type((x >> 1) ^ (- (x & 1)));
+	    } break;
+	    case attribute_float:
+	      edge.attributes[attribute] = attribute_set_type::float_type(decoder.decode_double());
+	      break;
+	    case attribute_string:
+	      edge.attributes[attribute] = static_cast<std::string>(decoder.decode_string());
+	      break;
+	    default:
+	      throw std::runtime_error("binary hypergraph: invalid format");
+	    }
+	  }
+
+	  edge.rule = rules[decoder.decode_index(rules.size())];
+
+	  graph.connect_edge(edge.id, node_id);
+	}
+      }
+
+      // goal is shifted by one, zero for no goal
+      const uint64_t goal = decoder.decode_index(num_nodes + 1);
+      if (goal)
+	graph.goal = goal - 1;
+
+      if (decoder.first != decoder.last)
+	throw std::runtime_error("binary hypergraph: invalid format");
+    }
+    catch (const std::exception&) {
+      graph.clear();
+      return false;
+    }
+
+    for (/**/; iter != end && (*iter == ' ' || *iter == '\t' || *iter == '\n' || *iter == '\r'); ++ iter);
+
+    return true;
+  }
+};
@@ -0,0 +1,50 @@
+// -*- mode: c++ -*-
+//
+//  Copyright(C) 2013 Taro Watanabe <taro.watanabe@nict.go.jp>
+//
+
+#ifndef __CICADA__HYPERGRAPH_BINARY__HPP__
+#define __CICADA__HYPERGRAPH_BINARY__HPP__ 1
+
+//
+// a compact binary hypergraph format, an alternative to the JSON format.
+//
+// A hypergraph is encoded as:
+//   version, flags
+//   symbol table, feature table, attribute table (interned per hypergraph)
+//   rules as indices to the symbol table
+//   nodes, each of which is a list of edges: tails, features, attributes and a rule index
+//   goal
+// where all the integers are varint-coded, and the body is optionally compressed by LZ4.
+// Since the hypergraphs are exchanged as one-line-per-hypergraph, the binary is base64-encoded,
+// prefixed by the marker '@', thus HyperGraph::assign can auto-detect the format.
+//
+
+#include <iostream>
+
+#include <cicada/hypergraph.hpp>
+
+#include <utils/piece.hpp>
+
+namespace cicada
+{
+  // the marker which starts a binary hypergraph
+  static const char hypergraph_binary_marker = '@';
+
+  // write graph in the binary format. When compress is true, the body is compressed by LZ4.
+  std::ostream& write_binary(std::ostream& os, const HyperGraph& graph, const bool compress=false);
+
+  // read graph in the binary format from [iter, end). iter is advanced to the end of the hypergraph, and trailing spaces.
+  bool read_binary(utils::piece::const_iterator& iter, utils::piece::const_iterator end, HyperGraph& graph);
+
+  // is [iter, end) a binary hypergraph? leading spaces are skipped.
+  inline
+  bool is_binary(utils::piece::const_iterator iter, utils::piece::const_iterator end)
+  {
+    for (/**/; iter != end && (*iter == ' ' || *iter == '\t' || *iter == '\n' || *iter == '\r'); ++ iter);
+
+    return iter != end && *iter == hypergraph_binary_marker;
+  }
+};
+
+#endif
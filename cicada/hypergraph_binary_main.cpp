@@ -0,0 +1,97 @@
+//
+//  Copyright(C) 2013 Taro Watanabe <taro.watanabe@nict.go.jp>
+//
+
+// read JSON hypergraphs, one per line, from stdin, and compare the size and the parsing throughput of
+// the JSON and the binary formats (with and without LZ4).
+//
+// hypergraph_binary_main < forests
+
+#include <iostream>
+#include <sstream>
+#include <vector>
+#include <string>
+
+#include "hypergraph.hpp"
+#include "hypergraph_binary.hpp"
+
+#include "utils/resource.hpp"
+#include "utils/getline.hpp"
+
+typedef cicada::HyperGraph hypergraph_type;
+typedef std::vector<std::string, std::allocator<std::string> > line_set_type;
+typedef std::vector<hypergraph_type, std::allocator<hypergraph_type> > hypergraph_set_type;
+
+const size_t num_repeat = 5;
+
+void benchmark(const char* name, const line_set_type& lines, const hypergraph_set_type& graphs)
+{
+  size_t bytes = 0;
+  for (line_set_type::const_iterator liter = lines.begin(); liter != lines.end(); ++ liter)
+    bytes += liter->size();
+
+  size_t num_error = 0;
+  hypergraph_type graph;
+
+  utils::resource start;
+
+  for (size_t repeat = 0; repeat != num_repeat; ++ repeat)
+    for (size_t i = 0; i != lines.size(); ++ i) {
+      utils::piece::const_iterator iter(lines[i].c_str());
+      utils::piece::const_iterator end(lines[i].c_str() + lines[i].size());
+
+      if (! graph.assign(iter, end) || iter != end || graph != graphs[i])
+	++ num_error;
+    }
+
+  utils::resource end;
+
+  const double elapsed = end.thread_time() - start.thread_time();
+
+  std::cout << name << ": bytes: " << bytes
+	    << " hypergraphs/second: " << double(lines.size() * num_repeat) / elapsed
+	    << " MB/second: " << double(bytes * num_repeat) / elapsed / (1024 * 1024)
+	    << " errors: " << num_error
+	    << std::endl;
+}
+
+int main(int argc, char** argv)
+{
+  try {
+    line_set_type       lines_json;
+    line_set_type       lines_binary;
+    line_set_type       lines_lz4;
+    hypergraph_set_type graphs;
+
+    std::string line;
+    while (utils::getline(std::cin, line)) {
+      hypergraph_type graph;
+      graph.assign(line);
+
+      // JSON is not lossless for features, thus compare with the re-parsed hypergraph
+      std::ostringstream os_json;
+      os_json << graph;
+      lines_json.push_back(os_json.str());
+
+      graphs.push_back(hypergraph_type());
+      graphs.back().assign(lines_json.back());
+
+      std::ostringstream os_binary;
+      cicada::write_binary(os_binary, graphs.back(), false);
+      lines_binary.push_back(os_binary.str());
+
+      std::ostringstream os_lz4;
+      cicada::write_binary(os_lz4, graphs.back(), true);
+      lines_lz4.push_back(os_lz4.str());
+    }
+
+    benchmark("json",   lines_json,   graphs);
+    benchmark("binary", lines_binary, graphs);
+    benchmark("lz4",    lines_lz4,    graphs);
+  }
+  catch (std::exception& err) {
+    std::cerr << "error: " << err.what() << std::endl;
+    return 1;
+  }
+  return 0;
+}
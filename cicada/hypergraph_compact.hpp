@@ -0,0 +1,192 @@
+// -*- mode: c++ -*-
+//
+//  Copyright(C) 2013 Taro Watanabe <taro.watanabe@nict.go.jp>
+//
+
+#ifndef __CICADA__HYPERGRAPH_COMPACT__HPP__
+#define __CICADA__HYPERGRAPH_COMPACT__HPP__ 1
+
+#include <vector>
+
+#include <cicada/hypergraph.hpp>
+
+#include <boost/noncopyable.hpp>
+
+//
+// a frozen, read-only view of a hypergraph for the passes which only look at the topology, i.e. inside/outside.
+// node->edges and edge->tails are packed into two contiguous id arrays (CSR-style), and nodes/edges
+// are small PODs which simply hold the ranges into them, thus no pointer chasing into per-node vectors
+// or per-edge tails. Features, attributes and rules are not kept: combine with EdgeScore (edge_score.hpp)
+// which looks-up the edge scores by edge-id.
+//
+// The view provides the same interface as HyperGraph as used by Inside/Outside/InsideOutside
+// (nodes, edges, node.id, node.edges, edge.id, edge.head, edge.tails), and can be passed as their _HyperGraph.
+//
+
+namespace cicada
+{
+
+  class HyperGraphCompact : private boost::noncopyable
+  {
+  public:
+    typedef HyperGraph::id_type id_type;
+
+  public:
+    static const id_type invalid = id_type(-1);
+
+  public:
+    // a range of ids in the packed id array
+    struct IdSet
+    {
+      typedef id_type        value_type;
+      typedef const id_type* const_iterator;
+      typedef const id_type* iterator;
+      typedef size_t         size_type;
+
+      IdSet() : first(0), last(0) {}
+      IdSet(const id_type* __first, const id_type* __last) : first(__first), last(__last) {}
+
+      const_iterator begin() const { return first; }
+      const_iterator end() const { return last; }
+
+      size_type size() const { return last - first; }
+      bool empty() const { return first == last; }
+
+      const id_type& operator[](size_type pos) const { return first[pos]; }
+
+      const id_type* first;
+      const id_type* last;
+    };
+
+    struct Node
+    {
+      typedef IdSet edge_set_type;
+
+      Node() : edges(), id(invalid) {}
+
+      edge_set_type edges;
+      id_type id;
+    };
+
+    struct Edge
+    {
+      typedef IdSet node_set_type;
+
+      Edge() : head(invalid), tails(), id(invalid) {}
+
+      id_type       head;
+      node_set_type tails;
+
+      id_type id;
+    };
+
+    typedef Node node_type;
+    typedef Edge edge_type;
+
+    typedef std::vector<node_type, std::allocator<node_type> > node_set_type;
+    typedef std::vector<edge_type, std::allocator<edge_type> > edge_set_type;
+
+  private:
+    typedef std::vector<id_type, std::allocator<id_type> > id_set_type;
+
+  public:
+    HyperGraphCompact() : goal(invalid) {}
+    HyperGraphCompact(const HyperGraph& graph) : goal(invalid) { assign(graph); }
+
+  public:
+    void assign(const HyperGraph& graph)
+    {
+      clear();
+
+      if (! graph.is_valid()) return;
+
+      // first, compute the size of packed arrays so that ranges are not invalidated
+      size_t size_node_edges = 0;
+      size_t size_edge_tails = 0;
+
+      HyperGraph::node_set_type::const_iterator niter_end = graph.nodes.end();
+      for (HyperGraph::node_set_type::const_iterator niter = graph.nodes.begin(); niter != niter_end; ++ niter)
+	size_node_edges += niter->edges.size();
+
+      HyperGraph::edge_set_type::const_iterator eiter_end = graph.edges.end();
+      for (HyperGraph::edge_set_type::const_iterator eiter = graph.edges.begin(); eiter != eiter_end; ++ eiter)
+	size_edge_tails += eiter->tails.size();
+
+      node_edges.reserve(size_node_edges);
+      edge_tails.reserve(size_edge_tails);
+
+      nodes.resize(graph.nodes.size());
+      edges.resize(graph.edges.size());
+
+      for (HyperGraph::node_set_type::const_iterator niter = graph.nodes.begin(); niter != niter_end; ++ niter) {
+	node_type& node = nodes[niter->id];
+
+	const size_t offset = node_edges.size();
+	node_edges.insert(node_edges.end(), niter->edges.begin(), niter->edges.end());
+
+	if (! niter->edges.empty())
+	  node.edges = IdSet(&node_edges[offset], &node_edges[0] + node_edges.size());
+	node.id = niter->id;
+      }
+
+      for (HyperGraph::edge_set_type::const_iterator eiter = graph.edges.begin(); eiter != eiter_end; ++ eiter) {
+	edge_type& edge = edges[eiter->id];
+
+	const size_t offset = edge_tails.size();
+	edge_tails.insert(edge_tails.end(), eiter->tails.begin(), eiter->tails.end());
+
+	if (! eiter->tails.empty())
+	  edge.tails = IdSet(&edge_tails[offset], &edge_tails[0] + edge_tails.size());
+	edge.head = eiter->head;
+	edge.id   = eiter->id;
+      }
+
+      goal = graph.goal;
+    }
+
+    void clear()
+    {
+      nodes.clear();
+      edges.clear();
+      node_edges.clear();
+      edge_tails.clear();
+      goal = invalid;
+    }
+
+    void swap(HyperGraphCompact& x)
+    {
+      nodes.swap(x.nodes);
+      edges.swap(x.edges);
+      node_edges.swap(x.node_edges);
+      edge_tails.swap(x.edge_tails);
+      std::swap(goal, x.goal);
+    }
+
+    bool is_valid() const
+    {
+      return goal != invalid;
+    }
+
+  public:
+    node_set_type nodes;
+    edge_set_type edges;
+
+    id_type goal;
+
+  private:
+    id_set_type node_edges;
+    id_set_type edge_tails;
+  };
+
+};
+
+namespace std
+{
+  inline
+  void swap(cicada::HyperGraphCompact& x, cicada::HyperGraphCompact& y)
+  {
+    x.swap(y);
+  }
+};
+
+#endif
@@ -0,0 +1,214 @@
+//
+//  Copyright(C) 2013 Taro Watanabe <taro.watanabe@nict.go.jp>
+//
+
+// compare viterbi and k-best, which run over the compact view, against the derivations enumerated
+// directly from the hypergraph
+
+#include <iostream>
+#include <vector>
+#include <set>
+#include <algorithm>
+#include <stdexcept>
+#include <limits>
+
+#include <cstdlib>
+
+#include "hypergraph.hpp"
+#include "hypergraph_compact.hpp"
+#include "viterbi.hpp"
+#include "kbest.hpp"
+
+#include "semiring/tropical.hpp"
+
+typedef cicada::HyperGraph        hypergraph_type;
+typedef cicada::HyperGraphCompact compact_type;
+
+typedef cicada::semiring::Tropical<double> weight_type;
+typedef std::vector<int, std::allocator<int> > yield_type;
+
+typedef std::vector<double, std::allocator<double> > score_set_type;
+
+typedef std::pair<double, yield_type> derivation_type;
+typedef std::vector<derivation_type, std::allocator<derivation_type> > derivation_set_type;
+
+struct traversal_type
+{
+  typedef yield_type value_type;
+
+  template <typename Edge, typename Iterator>
+  void operator()(const Edge& edge, value_type& yield, Iterator first, Iterator last) const
+  {
+    yield.clear();
+    yield.push_back(edge.id);
+    for (/**/; first != last; ++ first)
+      yield.insert(yield.end(), first->begin(), first->end());
+  }
+};
+
+struct function_type
+{
+  typedef weight_type value_type;
+
+  function_type(const score_set_type& __scores) : scores(&__scores) {}
+
+  template <typename Edge>
+  value_type operator()(const Edge& edge) const
+  {
+    return cicada::semiring::traits<value_type>::exp((*scores)[edge.id]);
+  }
+
+  const score_set_type* scores;
+};
+
+struct filter_type
+{
+  template <typename Node, typename Yield>
+  bool operator()(const Node& node, const Yield& yield) const { return false; }
+};
+
+// all the derivations rooted at node, by brute-force
+void enumerate(const hypergraph_type& graph, const score_set_type& scores, int node, derivation_set_type& derivations)
+{
+  derivations.clear();
+
+  hypergraph_type::node_type::edge_set_type::const_iterator eiter_end = graph.nodes[node].edges.end();
+  for (hypergraph_type::node_type::edge_set_type::const_iterator eiter = graph.nodes[node].edges.begin(); eiter != eiter_end; ++ eiter) {
+    const hypergraph_type::edge_type& edge = graph.edges[*eiter];
+
+    derivation_set_type partials(1, derivation_type(scores[edge.id], yield_type(1, edge.id)));
+
+    hypergraph_type::edge_type::node_set_type::const_iterator titer_end = edge.tails.end();
+    for (hypergraph_type::edge_type::node_set_type::const_iterator titer = edge.tails.begin(); titer != titer_end; ++ titer) {
+      derivation_set_type antecedents;
+      enumerate(graph, scores, *titer, antecedents);
+
+      derivation_set_type extended;
+      for (size_t i = 0; i != partials.size(); ++ i)
+	for (size_t j = 0; j != antecedents.size(); ++ j) {
+	  extended.push_back(partials[i]);
+	  extended.back().first += antecedents[j].first;
+	  extended.back().second.insert(extended.back().second.end(), antecedents[j].second.begin(), antecedents[j].second.end());
+	}
+
+      partials.swap(extended);
+    }
+
+    derivations.insert(derivations.end(), partials.begin(), partials.end());
+  }
+}
+
+// random forest: a few leaves, then nodes whose edges take their tails from the nodes preceding them.
+void generate(hypergraph_type& graph, score_set_type& scores, const int num_nodes)
+{
+  graph.clear();
+  scores.clear();
+
+  for (int i = 0; i != num_nodes; ++ i) {
+    const hypergraph_type::id_type head = graph.add_node().id;
+    const int num_edges = 1 + random() % 3;
+
+    for (int e = 0; e != num_edges; ++ e) {
+      std::vector<hypergraph_type::id_type> tails;
+      if (i >= 2) {
+	const int arity = random() % 3;
+	for (int t = 0; t != arity; ++ t)
+	  tails.push_back(random() % i);
+      }
+
+      hypergraph_type::edge_type& edge = graph.add_edge(tails.begin(), tails.end());
+      graph.connect_edge(edge.id, head);
+
+      // integral scores so that the sums are exact
+      scores.push_back(double(int(random() % 11) - 5));
+    }
+  }
+
+  graph.goal = num_nodes - 1;
+}
+
+int main(int argc, char** argv)
+{
+  try {
+    srandom(1234);
+
+    for (int iter = 0; iter != 200; ++ iter) {
+      hypergraph_type graph;
+      score_set_type  scores;
+
+      generate(graph, scores, 2 + random() % 7);
+
+      // the compact view mirrors the topology
+      const compact_type compact(graph);
+
+      if (compact.goal != graph.goal || compact.nodes.size() != graph.nodes.size() || compact.edges.size() != graph.edges.size())
+	throw std::runtime_error("compact view size differ");
+
+      for (size_t id = 0; id != graph.nodes.size(); ++ id)
+	if (! std::equal(graph.nodes[id].edges.begin(), graph.nodes[id].edges.end(), compact.nodes[id].edges.begin())
+	    || graph.nodes[id].edges.size() != compact.nodes[id].edges.size())
+	  throw std::runtime_error("compact node differ");
+
+      for (size_t id = 0; id != graph.edges.size(); ++ id)
+	if (! std::equal(graph.edges[id].tails.begin(), graph.edges[id].tails.end(), compact.edges[id].tails.begin())
+	    || graph.edges[id].tails.size() != compact.edges[id].tails.size()
+	    || graph.edges[id].head != compact.edges[id].head)
+	  throw std::runtime_error("compact edge differ");
+
+      derivation_set_type derivations;
+      enumerate(graph, scores, graph.goal, derivations);
+
+      if (derivations.size() > 100000) continue;
+
+      std::set<yield_type> yields_reference;
+      std::vector<double>  scores_reference;
+      double               score_max = - std::numeric_limits<double>::infinity();
+
+      for (size_t i = 0; i != derivations.size(); ++ i) {
+	yields_reference.insert(derivations[i].second);
+	scores_reference.push_back(derivations[i].first);
+	score_max = std::max(score_max, derivations[i].first);
+      }
+      std::sort(scores_reference.rbegin(), scores_reference.rend());
+
+      // viterbi
+      yield_type  viterbi_yield;
+      weight_type viterbi_weight;
+      cicada::viterbi(graph, viterbi_yield, viterbi_weight, traversal_type(), function_type(scores));
+
+      if (cicada::semiring::log(viterbi_weight) != score_max)
+	throw std::runtime_error("viterbi score differ");
+
+      bool found = false;
+      for (size_t i = 0; i != derivations.size(); ++ i)
+	found |= (derivations[i].second == viterbi_yield && derivations[i].first == score_max);
+      if (! found)
+	throw std::runtime_error("viterbi derivation differ");
+
+      // k-best: enumerate all
+      cicada::KBest<traversal_type, function_type, filter_type> kbest(graph, derivations.size() + 1, traversal_type(), function_type(scores), filter_type());
+
+      std::set<yield_type> yields_kbest;
+      std::vector<double>  scores_kbest;
+
+      yield_type  yield;
+      weight_type weight;
+      for (size_t k = 0; kbest(k, yield, weight); ++ k) {
+	if (! yields_kbest.insert(yield).second)
+	  throw std::runtime_error("k-best duplicates");
+	scores_kbest.push_back(cicada::semiring::log(weight));
+      }
+
+      if (scores_kbest != scores_reference)
+	throw std::runtime_error("k-best scores differ");
+      if (yields_kbest != yields_reference)
+	throw std::runtime_error("k-best derivations differ");
+      if (scores_kbest.front() != cicada::semiring::log(viterbi_weight))
+	throw std::runtime_error("1-best and viterbi differ");
+    }
+  }
+  catch (std::exception& err) {
+    std::cerr << "error: " << err.what() << std::endl;
+    return -1;
+  }
+}
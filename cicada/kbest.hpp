@@ -8,9 +8,12 @@
 
 #include <vector>
 #include <algorithm>
+#include <numeric>
 
 #include <cicada/hypergraph.hpp>
+#include <cicada/hypergraph_compact.hpp>
 #include <cicada/semiring/traits.hpp>
+#include <cicada/edge_score.hpp>
 
 #include <utils/bithack.hpp>
 #include <utils/small_vector.hpp>
@@ -42,6 +45,9 @@ namespace cicada
   // traversal function operator()(const HyperGraph::Edge&, const yield*, Iterator first, Iterator last);
   //                    where Iterator's value (*first etc.) is const yield&
   // semiring function
+  //
+  // The lazy enumeration walks the compact view of the graph (node->edges and edge->tails),
+  // and the original edges are passed only to the traversal.
   
   
   template <typename Traversal,
@@ -52,11 +58,12 @@ namespace cicada
     typedef size_t    size_type;
     typedef ptrdiff_t difference_type;
 
-    typedef HyperGraph hypergraph_type;
+    typedef HyperGraph        hypergraph_type;
+    typedef HyperGraphCompact compact_type;
     
     typedef hypergraph_type::id_type id_type;
-    typedef hypergraph_type::node_type node_type;
-    typedef hypergraph_type::edge_type edge_type;
+    typedef compact_type::node_type node_type;
+    typedef compact_type::edge_type edge_type;
     
     typedef Traversal traversal_type;
     typedef Function  function_type;
@@ -77,11 +84,15 @@ namespace cicada
 	function(__function),
 	filter(__filter),
 	graph(__graph),
+	compact(__graph),
 	states(__graph.nodes.size()) ,
 	k_prime(__k_prime)
     {
       if (graph.goal == hypergraph_type::invalid)
 	throw std::runtime_error("invalid hypergraph...");
+      
+      // edges are re-visited for each derivation, thus score them once
+      edge_score(graph, function, scores);
     }
 
   public:
@@ -243,6 +254,7 @@ namespace cicada
     
     typedef State state_type;
     typedef std::vector<state_type, std::allocator<state_type> > state_set_type;
+    typedef std::vector<weight_type, std::allocator<weight_type> > score_set_type;
 
 
   public:
@@ -331,7 +343,7 @@ namespace cicada
 	    yields.push_back(&(antecedent->yield));
 	  }
 	  
-	  traversal(*(derivation->edge), const_cast<yield_type&>(derivation->yield), yield_iterator(yields.begin()), yield_iterator(yields.end()));
+	  traversal(graph.edges[derivation->edge->id], const_cast<yield_type&>(derivation->yield), yield_iterator(yields.begin()), yield_iterator(yields.end()));
 	  
 	  // perform filtering here...!
 	  // if we have duplicates of "yield", do not insert into D
@@ -384,7 +396,7 @@ namespace cicada
       
       derivation_type& derivation = derivations.back();
       
-      derivation.score = function(edge);
+      derivation.score = scores[edge.id];
       
       index_set_type::const_iterator iiter = j.begin();
       edge_type::node_set_type::const_iterator niter_end = edge.tails.end();
@@ -405,13 +417,13 @@ namespace cicada
       
       if (! state.D.empty() || ! state.cand.empty()) return state;
       
-      const node_type& node = graph.nodes[v];
+      const node_type& node = compact.nodes[v];
       
       state.cand.reserve(node.edges.size());
       
       node_type::edge_set_type::const_iterator eiter_end = node.edges.end();
       for (node_type::edge_set_type::const_iterator eiter = node.edges.begin(); eiter != eiter_end; ++ eiter) {
-	const edge_type& edge = graph.edges[*eiter];
+	const edge_type& edge = compact.edges[*eiter];
 	
 	const index_set_type j(edge.tails.size(), 0);
 	const derivation_type* derivation = make_derivation(edge, j);
@@ -431,9 +443,11 @@ namespace cicada
     const filter_type    filter;
     
     const hypergraph_type& graph;
+    const compact_type     compact;
     
     derivation_set_type derivations;
     state_set_type      states;
+    score_set_type      scores;
     
     const size_type k_prime;
   };
@@ -134,4 +134,30 @@ namespace cicada
     return iter->second;
   }
   
+  NGram::~NGram()
+  {
+    // the last user of the score cache reports its statistics
+    if (debug && score_cache && score_cache.unique())
+      std::cerr << "ngram: " << path()
+		<< " score cache hits: " << score_cache->hits()
+		<< " misses: " << score_cache->misses()
+		<< " inserts: " << score_cache->inserts()
+		<< std::endl;
+  }
+  
+  void NGram::cache_allocate(const size_type bytes)
+  {
+    impl::lock_type lock(impl::__ngram_mutex);
+    
+    if (score_cache || ! bytes) return;
+    
+    score_cache.reset(new score_cache_type(index.order(), bytes));
+    
+    if (debug)
+      std::cerr << "ngram: " << path()
+		<< " score cache entries: " << score_cache->size()
+		<< " bytes: " << score_cache->size_bytes()
+		<< std::endl;
+  }
+  
 };
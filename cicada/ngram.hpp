@@ -13,8 +13,10 @@
 #include <cicada/ngram_index.hpp>
 #include <cicada/ngram_state.hpp>
 #include <cicada/ngram_state_chart.hpp>
+#include <cicada/ngram_score_cache.hpp>
 
 #include <boost/array.hpp>
+#include <boost/shared_ptr.hpp>
 
 #include <utils/packed_vector.hpp>
 #include <utils/succinct_vector.hpp>
@@ -118,9 +120,13 @@ namespace cicada
     };
     typedef Result result_type;
 
+    typedef NGramScoreCache<result_type>     score_cache_type;
+    typedef boost::shared_ptr<score_cache_type> score_cache_ptr_type;
+
   public:
     NGram(const int _debug=0) : debug(_debug) { clear(); }
     NGram(const path_type& path, const int _debug=0) : debug(_debug) { open(path); }
+    ~NGram();
     
   public:
     static const logprob_type logprob_min() { return boost::numeric::bounds<logprob_type>::lowest(); }
@@ -130,10 +136,22 @@ namespace cicada
     
     template <typename Word_>
     result_type ngram_score(const void* buffer_in, const Word_& word, void* buffer_out) const
+    {
+      return ngram_score(buffer_in, index.vocab()[word], buffer_out);
+    }
+    
+    result_type ngram_score(const void* buffer_in, const word_type::id_type& word, void* buffer_out) const
     {
       NGramState ngram_state(index.order());
       
-      result_type result = lookup(buffer_in, word, buffer_out);
+      result_type result;
+      
+      if (! score_cache || ! score_cache->find(buffer_in, word, result, buffer_out)) {
+	result = lookup(buffer_in, word, buffer_out);
+	
+	if (score_cache)
+	  score_cache->insert(buffer_in, word, result, buffer_out);
+      }
       
       const size_type context_length = ngram_state.size(buffer_in);
       
@@ -147,6 +165,58 @@ namespace cicada
       return result;
     }
     
+    // ngram_score for a sequence of words, each scored by the output state of the previous word:
+    // results[i] = ngram_score(buffer_in(i), *(first + i), buffer_out(i)), where buffer_out(i) is buffer_out + i * buffer_size()
+    // and buffer_in(i) is buffer_out(i - 1), or buffer_in for the first word.
+    // The score cache is checked up to the first miss, and the rest are looked up by lookup_sequence.
+    template <typename Iterator>
+    void ngram_score(const void* buffer_in, Iterator first, Iterator last, void* buffer_out, result_type* results) const
+    {
+      NGramState ngram_state(index.order());
+      
+      const size_type buffer_size = ngram_state.buffer_size();
+      const size_type batch_size = 16;
+      
+      word_type::id_type words[batch_size];
+      
+      const char* states_in  = static_cast<const char*>(buffer_in);
+      char*       states_out = static_cast<char*>(buffer_out);
+      
+      while (first != last) {
+	size_type size = 0;
+	for (/**/; first != last && size != batch_size; ++ first, ++ size)
+	  words[size] = *first;
+	
+	size_type pos = 0;
+	if (score_cache)
+	  for (/**/; pos != size; ++ pos)
+	    if (! score_cache->find(pos ? states_out + buffer_size * (pos - 1) : states_in, words[pos], results[pos], states_out + buffer_size * pos))
+	      break;
+	
+	if (pos != size) {
+	  lookup_sequence(pos ? states_out + buffer_size * (pos - 1) : states_in, words + pos, size - pos, states_out + buffer_size * pos, results + pos);
+	  
+	  if (score_cache)
+	    for (size_type i = pos; i != size; ++ i)
+	      score_cache->insert(i ? states_out + buffer_size * (i - 1) : states_in, words[i], results[i], states_out + buffer_size * i);
+	}
+	
+	for (size_type i = 0; i != size; ++ i) {
+	  const void* state_in = (i ? states_out + buffer_size * (i - 1) : states_in);
+	  
+	  const logprob_type* biter     = ngram_state.backoff(state_in) + results[i].length + (results[i].length == 0) - 1;
+	  const logprob_type* biter_end = ngram_state.backoff(state_in) + ngram_state.size(state_in);
+	  
+	  for (/**/; biter < biter_end; ++ biter)
+	    results[i].prob += *biter;
+	}
+	
+	states_in   = states_out + buffer_size * (size - 1);
+	states_out += buffer_size * size;
+	results    += size;
+      }
+    }
+    
     result_type ngram_partial_score(const void* buffer_in, const state_type& state, const int order, void* buffer_out) const
     {
       NGramState ngram_state(index.order());
@@ -299,6 +369,104 @@ namespace cicada
       return result;
     }
 
+    // lookup for a sequence of at most 16 words: words[i] is looked up in the context of the output state of words[i - 1].
+    // The context word j of words[i] is known once the state of words[i - 1] is longer than j, thus, the matches of all the
+    // words are extended one context word at a time, and the cache entries of the trie are prefetched for all the words
+    // before any of them is searched.
+    void lookup_sequence(const void* buffer_in,
+			 const word_type::id_type* words,
+			 const size_type size,
+			 void* buffer_out,
+			 result_type* results) const
+    {
+      NGramState ngram_state(index.order());
+      
+      const size_type buffer_size = ngram_state.buffer_size();
+      const size_type batch_size = 16;
+      
+      if (size > batch_size)
+	throw std::runtime_error("too many words for a sequence lookup");
+      
+      state_type         states[batch_size];
+      int                orders[batch_size];
+      word_type::id_type contexts[batch_size];
+      size_type          actives[batch_size];
+      size_type          queries[batch_size];
+      
+      char* states_out = static_cast<char*>(buffer_out);
+      
+      // unigrams
+      size_type size_active = 0;
+      for (size_type i = 0; i != size; ++ i) {
+	void* output = states_out + buffer_size * i;
+	
+	results[i] = result_type();
+	states[i]  = index.next(state_type(), words[i]);
+	
+	if (states[i].is_root_node()) {
+	  results[i].state    = states[i];
+	  results[i].prob     = smooth;
+	  results[i].bound    = smooth;
+	  results[i].length   = 0;
+	  results[i].complete = true;
+	  
+	  ngram_state.size(output) = 0;
+	  continue;
+	}
+	
+	orders[i] = 1;
+	
+	ngram_state.context(output)[0] = words[i];
+	ngram_state.backoff(output)[0] = backoffs[0](states[i].node(), orders[i]);
+	ngram_state.size(output) = 1;
+	
+	actives[size_active ++] = i;
+      }
+      
+      // longer matches
+      for (size_type j = 0; size_active; ++ j) {
+	size_type size_query = 0;
+	for (size_type a = 0; a != size_active; ++ a) {
+	  const size_type i = actives[a];
+	  const void* state_in = (i ? states_out + buffer_size * (i - 1) : buffer_in);
+	  
+	  if (j < ngram_state.size(state_in)) {
+	    contexts[i] = ngram_state.context(state_in)[j];
+	    
+	    index.prefetch(states[i], contexts[i]);
+	    
+	    queries[size_query ++] = i;
+	  } else
+	    lookup_complete(states[i], orders[i], results[i]);
+	}
+	
+	size_active = 0;
+	for (size_type q = 0; q != size_query; ++ q) {
+	  const size_type i = queries[q];
+	  const state_type state_next = index.next(states[i], contexts[i]);
+	  
+	  if (state_next.is_root_node()) {
+	    results[i].complete = true;
+	    lookup_complete(states[i], orders[i], results[i]);
+	    continue;
+	  }
+	  
+	  ++ orders[i];
+	  
+	  if (orders[i] < index.order()) {
+	    void* output = states_out + buffer_size * i;
+	    
+	    ngram_state.context(output)[ngram_state.size(output)] = contexts[i];
+	    ngram_state.backoff(output)[ngram_state.size(output)] = backoffs[state_next.shard()](state_next.node(), orders[i]);
+	    ++ ngram_state.size(output);
+	  }
+	  
+	  states[i] = state_next;
+	  actives[size_active ++] = i;
+	}
+      }
+    }
+    
     // lookup ngram from partial state
     
     result_type lookup_partial(const void* buffer_in,
@@ -430,6 +598,16 @@ namespace cicada
 
   private:
     
+    void lookup_complete(const state_type& state, int order, result_type& result) const
+    {
+      const size_type shard_index = utils::bithack::branch(state.is_root_shard(), size_type(0), state.shard());
+      
+      if (! result.complete)
+	result.complete = (order == index.order() || ! index[shard_index].has_child(state.node()));
+      
+      lookup_result(state, order, result);
+    }
+    
     void lookup_result(const state_type& state, int order, result_type& result) const
     {
       if (state.is_root()) {
@@ -671,6 +849,7 @@ namespace cicada
       logprobs.clear();
       backoffs.clear();
       logbounds.clear();
+      score_cache.reset();
       smooth = utils::mathop::log(1e-7);
     }
     
@@ -680,6 +859,10 @@ namespace cicada
   public:
     static NGram& create(const path_type& path);
     
+    // allocate the score cache shared by all the users of this ngram. Only the first allocation is effective.
+    void cache_allocate(const size_type bytes);
+    const score_cache_type* cache() const { return score_cache.get(); }
+    
   public:
     shard_index_type    index;
     shard_data_set_type logprobs;
@@ -688,6 +871,9 @@ namespace cicada
     
     logprob_type   smooth;
     int debug;
+    
+  private:
+    score_cache_ptr_type score_cache;
   };
   
 };
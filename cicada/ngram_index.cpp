@@ -10,6 +10,9 @@
 
 #include "utils/lexical_cast.hpp"
 
+#include <boost/iostreams/filtering_stream.hpp>
+#include <boost/iostreams/device/file.hpp>
+
 namespace cicada
 {
 
@@ -23,6 +26,9 @@ namespace cicada
       
     ids.open(rep.path("index"));
     positions.open(rep.path("position"));
+    
+    if (boost::filesystem::exists(rep.path("index-search")))
+      ids_search.open(rep.path("index-search"));
       
     repository_type::const_iterator oiter = rep.find("order");
     if (oiter == rep.end())
@@ -42,10 +48,36 @@ namespace cicada
     }
 
     off_set_type(offsets).swap(offsets);
-
+    
+    if (! ids_search.empty() && ids_search.size() != ids.size())
+      throw std::runtime_error("invalid search index? " + rep.path("index-search").string());
+    
     clear_cache();
   }
   
+  void NGramIndex::Shard::write_search(const path_type& path) const
+  {
+    const size_type buffer_size = 1024 * 64;
+    
+    boost::iostreams::filtering_ostream os;
+    os.push(boost::iostreams::file_sink(path.string(), std::ios_base::out | std::ios_base::trunc), 1024 * 1024);
+    
+    std::vector<id_type, std::allocator<id_type> > buffer;
+    buffer.reserve(buffer_size);
+    
+    for (size_type pos = 0; pos != ids.size(); ++ pos) {
+      buffer.push_back(ids[pos]);
+      
+      if (buffer.size() == buffer_size) {
+	os.write((char*) &(*buffer.begin()), sizeof(id_type) * buffer.size());
+	buffer.clear();
+      }
+    }
+    
+    if (! buffer.empty())
+      os.write((char*) &(*buffer.begin()), sizeof(id_type) * buffer.size());
+  }
+  
   void NGramIndex::open(const path_type& path)
   {
     typedef utils::repository repository_type;
@@ -25,6 +25,8 @@
 #include <utils/array_power2.hpp>
 #include <utils/packed_vector.hpp>
 #include <utils/succinct_vector.hpp>
+#include <utils/map_file.hpp>
+#include <utils/search.hpp>
 #include <utils/hashmurmur.hpp>
 #include <utils/hashmurmur3.hpp>
 #include <utils/bithack.hpp>
@@ -110,6 +112,10 @@ namespace cicada
       typedef utils::packed_vector_mapped<id_type, std::allocator<id_type> >   id_set_type;
       typedef utils::succinct_vector_mapped<std::allocator<int32_t> >          position_set_type;
       typedef std::vector<size_type, std::allocator<size_type> >               off_set_type;
+      
+      // an alternative, search-friendly layout of ids: fixed-width, uncompressed ids, so that children are
+      // accessed without select and searched by interpolation search. Built by write_search() as "index-search"
+      typedef utils::map_file<id_type, std::allocator<id_type> >               id_search_set_type;
 
     public:
       struct cache_type
@@ -155,10 +161,11 @@ namespace cicada
       Shard() {}
       Shard(const path_type& path) { open(path); }
       
-      Shard(const Shard& x) : ids(x.ids), positions(x.positions), offsets(x.offsets) { clear_cache(); }
+      Shard(const Shard& x) : ids(x.ids), ids_search(x.ids_search), positions(x.positions), offsets(x.offsets) { clear_cache(); }
       Shard& operator=(const Shard& x)
       {
 	ids = x.ids;
+	ids_search = x.ids_search;
 	positions = x.positions;
 	offsets = x.offsets;
 	
@@ -172,6 +179,7 @@ namespace cicada
       void clear()
       {
 	ids.clear();
+	ids_search.clear();
 	positions.clear();
 	offsets.clear();
 	
@@ -184,10 +192,12 @@ namespace cicada
       }
 
       void open(const path_type& path);
+      void write_search(const path_type& path) const;
       
       void populate()
       {
 	ids.populate();
+	ids_search.populate();
 	positions.populate();
       }
 
@@ -262,11 +272,7 @@ namespace cicada
 	
 	if (pos_first == pos_last) return size_type(-1);
 	
-	const std::pair<size_type, id_type> child = lower_bound(pos_first, pos_last, id);
-	
-	return utils::bithack::branch(child.first != pos_last && !(id < child.second),
-				      child.first,
-				      size_type(-1));
+	return search(pos_first, pos_last, id);
       }
             
       size_type find(size_type pos, const id_type& id) const
@@ -301,6 +307,38 @@ namespace cicada
         }
       }
       
+      // prefetch the cache entry of find(pos, id), so that find does not stall on it
+      void prefetch(size_type pos, const id_type& id) const
+      {
+#if defined(__GNUC__)
+	if (id != id_type(-1) && pos != size_type(-1))
+	  __builtin_prefetch(&caches[hasher_type::operator()(id, pos) & (caches.size() - 1)], 1, 1);
+#endif
+      }
+      
+      // find the position of id in the children [first, last), or size_type(-1) if not found
+      size_type search(size_type first, size_type last, const id_type& id) const
+      {
+	const size_type offset = offsets[1];
+	
+	if (! ids_search.empty() && last > offset) {
+	  const id_type* begin = ids_search.begin() + (first - offset);
+	  const id_type* end   = ids_search.begin() + (last - offset);
+	  
+	  const id_type* iter = (last - first <= 8
+				 ? utils::linear_search(begin, end, id)
+				 : utils::interpolation_search(begin, end, id));
+	  
+	  return utils::bithack::branch(iter != end, first + (iter - begin), size_type(-1));
+	} else {
+	  const std::pair<size_type, id_type> child = lower_bound(first, last, id);
+	  
+	  return utils::bithack::branch(child.first != last && !(id < child.second),
+					child.first,
+					size_type(-1));
+	}
+      }
+      
       std::pair<size_type, id_type> lower_bound(size_type first, size_type last, const id_type& id) const
       {
 	const size_type offset = offsets[1];
@@ -367,6 +405,7 @@ namespace cicada
       
     public:
       id_set_type        ids;
+      id_search_set_type ids_search;
       position_set_type  positions;
       off_set_type       offsets;
       
@@ -428,6 +467,14 @@ namespace cicada
       }
     }
 
+    // prefetch for next(state, word): the transitions from the root are computed without memory access
+    void prefetch(const state_type& state, const id_type& word) const
+    {
+      if (state.is_root() || state.is_root_node()) return;
+      
+      __shards[! state.is_root_shard() ? state.shard() : shard_index(state.node(), word)].prefetch(state.node(), word);
+    }
+
     int order(const state_type& state) const
     {
       if (state.is_root())
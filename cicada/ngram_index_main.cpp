@@ -0,0 +1,146 @@
+//
+//  Copyright(C) 2013 Taro Watanabe <taro.watanabe@nict.go.jp>
+//
+
+// build the search-friendly "index-search" layout for every shard of an ngram language model,
+// and compare the child look-up throughput and the index size of the packed and the search layout.
+//
+// ngram_index_main ngram-file [build]
+
+#include <iostream>
+#include <vector>
+#include <algorithm>
+
+#include "ngram_index.hpp"
+
+#include "utils/resource.hpp"
+#include "utils/random_seed.hpp"
+
+#include <boost/random.hpp>
+
+typedef cicada::NGramIndex ngram_index_type;
+typedef ngram_index_type::size_type size_type;
+typedef ngram_index_type::id_type   id_type;
+
+struct query_type
+{
+  size_type shard;
+  size_type parent;
+  id_type   id;
+  size_type node;
+};
+typedef std::vector<query_type, std::allocator<query_type> > query_set_type;
+
+const size_type num_repeat = 10;
+
+double benchmark(const ngram_index_type& index, const query_set_type& queries, size_t& num_error)
+{
+  num_error = 0;
+
+  utils::resource start;
+
+  for (size_type repeat = 0; repeat != num_repeat; ++ repeat) {
+    query_set_type::const_iterator qiter_end = queries.end();
+    for (query_set_type::const_iterator qiter = queries.begin(); qiter != qiter_end; ++ qiter)
+      num_error += (index[qiter->shard].__find(qiter->parent, qiter->id) != qiter->node);
+  }
+
+  utils::resource end;
+
+  return double(queries.size() * num_repeat) / (end.thread_time() - start.thread_time());
+}
+
+size_type index_size(const ngram_index_type& index)
+{
+  size_type size = 0;
+  for (size_type shard = 0; shard != index.size(); ++ shard)
+    size += index[shard].size() - index[shard].offsets[1];
+  return size;
+}
+
+int main(int argc, char** argv)
+{
+  if (argc < 2) {
+    std::cout << argv[0] << " ngram-file [build]" << std::endl;
+    return 1;
+  }
+
+  try {
+    const boost::filesystem::path path = boost::filesystem::path(argv[1]) / "index";
+    const bool build = (argc > 2 && std::string(argv[2]) == "build");
+
+    ngram_index_type index(path);
+
+    if (build)
+      for (size_type shard = 0; shard != index.size(); ++ shard)
+	index[shard].write_search(index[shard].path() / "index-search");
+
+    // sample the existing ngrams, bigram and higher, as queries
+    boost::mt19937 generator;
+    generator.seed(utils::random_seed());
+
+    query_set_type queries;
+    for (size_type shard = 0; shard != index.size(); ++ shard) {
+      const size_type offset = index[shard].offsets[1];
+
+      for (size_type node = offset; node != index[shard].size(); ++ node) {
+	query_type query;
+	query.shard  = shard;
+	query.parent = index[shard].parent(node);
+	query.id     = index[shard][node];
+	query.node   = node;
+
+	queries.push_back(query);
+      }
+    }
+
+    boost::random_number_generator<boost::mt19937> gen(generator);
+    std::random_shuffle(queries.begin(), queries.end(), gen);
+
+    const size_type num_ngram = index_size(index);
+
+    // packed layout
+    ngram_index_type index_packed(index);
+    for (size_type shard = 0; shard != index_packed.size(); ++ shard)
+      index_packed[shard].ids_search.clear();
+
+    size_type bytes_packed = 0;
+    for (size_type shard = 0; shard != index_packed.size(); ++ shard)
+      bytes_packed += index_packed[shard].ids.size_compressed() + index_packed[shard].positions.size_compressed();
+
+    size_t errors_packed = 0;
+    const double lookups_packed = benchmark(index_packed, queries, errors_packed);
+
+    std::cout << "packed: lookups/second: " << lookups_packed
+	      << " bytes/ngram: " << double(bytes_packed) / num_ngram
+	      << " errors: " << errors_packed
+	      << std::endl;
+
+    // search layout, if available
+    ngram_index_type index_search(path);
+
+    size_type bytes_search = 0;
+    for (size_type shard = 0; shard != index_search.size(); ++ shard) {
+      if (index_search[shard].ids_search.empty()) {
+	std::cout << "no search layout: run with \"build\"" << std::endl;
+	return errors_packed != 0;
+      }
+
+      bytes_search += index_search[shard].ids_search.size_bytes() + index_search[shard].positions.size_compressed();
+    }
+
+    size_t errors_search = 0;
+    const double lookups_search = benchmark(index_search, queries, errors_search);
+
+    std::cout << "search: lookups/second: " << lookups_search
+	      << " bytes/ngram: " << double(bytes_search) / num_ngram
+	      << " errors: " << errors_search
+	      << std::endl;
+
+    return (errors_packed != 0 || errors_search != 0);
+  }
+  catch (const std::exception& err) {
+    std::cerr << "error: " << err.what() << std::endl;
+    return 1;
+  }
+}
@@ -27,7 +27,7 @@ namespace cicada
     return boost::lexical_cast<Value>(iter->second);
   }
   
-  void NGramNN::open(const path_type& path, const bool normalize)
+  void NGramNN::open(const path_type& path, const bool normalize, const bool precompute)
   {
     typedef utils::repository repository_type;
 
@@ -42,7 +42,8 @@ namespace cicada
     dimension_hidden_    = repository_value<size_type>(rep, "hidden");
     order_               = repository_value<int>(rep, "order");
 
-    normalize_ = normalize;
+    normalize_  = normalize;
+    precompute_ = precompute;
     
     embedding_input_.open(rep.path("input.bin"), dimension_embedding_, embedding_size_);
     embedding_output_.open(rep.path("output.bin"), dimension_embedding_ + 1, embedding_size_);
@@ -64,6 +65,15 @@ namespace cicada
     
     for (size_type i = 0; i != cache_.size(); ++ i)
       cache_[i] = cache_type(order_);
+    
+    // pre-compute the projection of every word at every context position
+    if (precompute_) {
+      projection_.reset(new tensor_type(dimension_hidden_, embedding_size_ * (order_ - 1)));
+      
+      for (int i = 0; i != order_ - 1; ++ i)
+	projection_->block(0, embedding_size_ * i, dimension_hidden_, embedding_size_).noalias()
+	  = Wc_().block(0, dimension_embedding_ * i, dimension_hidden_, dimension_embedding_) * embedding_input_();
+    }
   }
   
   typedef utils::unordered_map<std::string, NGramNN, boost::hash<utils::piece>, std::equal_to<std::string>,
@@ -85,7 +95,7 @@ namespace cicada
   static utils::thread_specific_ptr<ngram_nn_map_type> __ngram_nns;
 #endif
   
-  NGramNN& NGramNN::create(const path_type& path)
+  NGramNN& NGramNN::create(const path_type& path, const bool normalize, const bool precompute)
   {
 #ifdef HAVE_TLS
     if (! __ngram_nns_tls) {
@@ -100,7 +110,9 @@ namespace cicada
     ngram_nn_map_type& ngram_nns_map = *__ngram_nns;
 #endif
     
-    const std::string parameter = path.string();
+    const std::string parameter = (path.string()
+				   + (normalize ? ":normalize" : "")
+				   + (precompute ? ":precompute" : ""));
     
     ngram_nn_map_type::iterator iter = ngram_nns_map.find(parameter);
     if (iter == ngram_nns_map.end()) {
@@ -108,7 +120,7 @@ namespace cicada
       
       ngram_nn_map_type::iterator iter_global = impl::__ngram_nn_map.find(parameter);
       if (iter_global == impl::__ngram_nn_map.end())
-	iter_global = impl::__ngram_nn_map.insert(std::make_pair(parameter, NGramNN(parameter))).first;
+	iter_global = impl::__ngram_nn_map.insert(std::make_pair(parameter, NGramNN(path, normalize, precompute))).first;
       
       iter = ngram_nns_map.insert(*iter_global).first;
     }
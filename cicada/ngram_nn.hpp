@@ -14,6 +14,7 @@
 #include <vector>
 
 #include <boost/filesystem.hpp>
+#include <boost/shared_ptr.hpp>
 
 #include <cicada/symbol.hpp>
 #include <cicada/vocab.hpp>
@@ -113,14 +114,16 @@ namespace cicada
     typedef cicada::NGramCache<id_type, logprob_type>                       cache_type;
     typedef utils::array_power2<cache_type, 16, std::allocator<cache_type> > cache_set_type;
     
+    typedef boost::shared_ptr<tensor_type> tensor_ptr_type;
+    
   public:
-    NGramNN(const bool normalize=false)
-      : normalize_(normalize) { clear(); }
-    NGramNN(const path_type& path, const bool normalize=false)
-      : normalize_(normalize) { open(path, normalize); }
+    NGramNN(const bool normalize=false, const bool precompute=false)
+      : normalize_(normalize), precompute_(precompute) { clear(); }
+    NGramNN(const path_type& path, const bool normalize=false, const bool precompute=false)
+      : normalize_(normalize), precompute_(precompute) { open(path, normalize, precompute); }
     
   public:
-   static NGramNN& create(const path_type& path);
+   static NGramNN& create(const path_type& path, const bool normalize=false, const bool precompute=false);
 
   public:
     const vocab_type& vocab() const { return vocab_; }
@@ -129,10 +132,13 @@ namespace cicada
     size_type dimension_hidden() const { return dimension_hidden_; }
     const int& order() const { return order_; }
     
+    bool normalize() const { return normalize_; }
+    bool precompute() const { return precompute_; }
+    
     path_type path() const { return path_; }
     bool empty() const { return ! path_.empty(); }
     
-    void open(const path_type& path, const bool normalize=false);
+    void open(const path_type& path, const bool normalize=false, const bool precompute=false);
     void close() { clear(); }
 
     void populate()
@@ -176,6 +182,8 @@ namespace cicada
 
       buffer_.clear();
       cache_.clear();
+      
+      projection_.reset();
     }
 
   public:
@@ -191,7 +199,170 @@ namespace cicada
       return logprob_dispatch(first, last, value_type());
     }
     
+    // batched scoring: the sum of the logprobs of the words in [iter, last), each conditioned on the preceding words
+    // in [first, iter) and [iter, last) truncated by order. The ngrams which are not cached are scored together
+    // by matrix-matrix products.
+    template <typename Iterator>
+    logprob_type operator()(Iterator first, Iterator iter, Iterator last) const
+    {
+      return operator()(first, iter, last, order_);
+    }
+    
+    template <typename Iterator>
+    logprob_type operator()(Iterator first, Iterator iter, Iterator last, const int order) const
+    {
+      typedef typename std::iterator_traits<Iterator>::value_type value_type;
+      
+      if (iter == last) return 0;
+      
+      return logprob_batch_dispatch(first, iter, last, utils::bithack::min(order, order_), value_type());
+    }
+    
   private:
+    template <typename Iterator, typename __Word>
+    logprob_type logprob_batch_dispatch(Iterator first, Iterator iter, Iterator last, const int order, __Word) const
+    {
+      typedef std::vector<id_type, std::allocator<id_type> > buffer_type;
+      
+      buffer_type buffer(last - first);
+      
+      buffer_type::iterator biter = buffer.begin();
+      for (Iterator witer = first; witer != last; ++ witer, ++ biter)
+	*biter = vocab_[*witer];
+      
+      return logprob_batch_dispatch(buffer.begin(), buffer.begin() + (iter - first), buffer.end(), order, id_type());
+    }
+    
+    template <typename Iterator>
+    logprob_type logprob_batch_dispatch(Iterator first, Iterator iter, Iterator last, const int order, id_type) const
+    {
+      typedef std::pair<Iterator, Iterator> query_type;
+      typedef std::vector<query_type, std::allocator<query_type> > query_set_type;
+      typedef std::vector<logprob_type, std::allocator<logprob_type> > logprob_set_type;
+      
+      query_set_type queries;
+      double logprob = 0.0;
+      
+      for (/**/; iter != last; ++ iter) {
+	const Iterator qfirst = std::max(first, iter + 1 - order);
+	const Iterator qlast  = iter + 1;
+	
+	const size_type hash      = hasher_type::operator()(qfirst, qlast, 0);
+	const size_type pos       = (hash >> 4) & (cache_type::cache_size - 1);
+	const size_type pos_cache = hash & (locks_.size() - 1);
+	
+	spinlock_type::lock_type lock(const_cast<spinlock_type&>(locks_[pos_cache]).mutex_);
+	
+	const cache_type& cache = cache_[pos_cache];
+	
+	if (cache.equal_to(pos, qfirst, qlast))
+	  logprob += cache[pos];
+	else
+	  queries.push_back(query_type(qfirst, qlast));
+      }
+      
+      if (queries.empty()) return logprob;
+      
+      logprob_set_type logprobs(queries.size());
+      
+      logprob_matrix(queries.begin(), queries.end(), logprobs.begin());
+      
+      for (size_type i = 0; i != queries.size(); ++ i) {
+	const size_type hash      = hasher_type::operator()(queries[i].first, queries[i].second, 0);
+	const size_type pos       = (hash >> 4) & (cache_type::cache_size - 1);
+	const size_type pos_cache = hash & (locks_.size() - 1);
+	
+	spinlock_type::lock_type lock(const_cast<spinlock_type&>(locks_[pos_cache]).mutex_);
+	
+	cache_type& cache = const_cast<cache_type&>(cache_[pos_cache]);
+	
+	cache.assign(pos, queries[i].first, queries[i].second);
+	cache[pos] = logprobs[i];
+	
+	logprob += logprobs[i];
+      }
+      
+      return logprob;
+    }
+    
+    // score the queries, a range of word-ids, in a batch: each query is a column of the input matrix
+    template <typename QueryIterator, typename LogprobIterator>
+    void logprob_matrix(QueryIterator first, QueryIterator last, LogprobIterator result) const
+    {
+      typedef typename std::iterator_traits<QueryIterator>::value_type::first_type word_iterator;
+      
+      const size_type batch_size = std::distance(first, last);
+      
+      tensor_type layer(dimension_hidden_, batch_size);
+      
+      if (projection_) {
+	// the first layer is a sum of the pre-computed projections of words
+	size_type batch = 0;
+	for (QueryIterator qiter = first; qiter != last; ++ qiter, ++ batch) {
+	  const size_type fill_size = order_ - (qiter->second - qiter->first);
+	  
+	  layer.col(batch) = bc_();
+	  
+	  size_type i = 0;
+	  for (/**/; i < fill_size; ++ i)
+	    layer.col(batch) += projection_->col(embedding_size_ * i + id_eps_);
+	  for (word_iterator iter = qiter->first; iter != qiter->second - 1; ++ iter, ++ i)
+	    layer.col(batch) += projection_->col(embedding_size_ * i + *iter);
+	}
+      } else {
+	tensor_type input(dimension_embedding_ * (order_ - 1), batch_size);
+	
+	size_type batch = 0;
+	for (QueryIterator qiter = first; qiter != last; ++ qiter, ++ batch) {
+	  const size_type fill_size = order_ - (qiter->second - qiter->first);
+	  
+	  size_type i = 0;
+	  for (/**/; i < fill_size; ++ i)
+	    input.block(dimension_embedding_ * i, batch, dimension_embedding_, 1) = embedding_input_().col(id_eps_);
+	  for (word_iterator iter = qiter->first; iter != qiter->second - 1; ++ iter, ++ i)
+	    input.block(dimension_embedding_ * i, batch, dimension_embedding_, 1) = embedding_input_().col(*iter);
+	}
+	
+	layer.noalias() = Wc_() * input;
+	layer.colwise() += bc_().col(0);
+      }
+      
+      tensor_type hidden(dimension_embedding_, batch_size);
+      
+      hidden.noalias() = Wh_() * layer.array().unaryExpr(hinge()).matrix();
+      hidden.colwise() += bh_().col(0);
+      hidden = hidden.array().unaryExpr(hinge());
+      
+      if (normalize_) {
+	// partition functions of all the queries by one product with the output embedding
+	tensor_type logits(embedding_size_, batch_size);
+	
+	logits.noalias() = embedding_output_().topRows(dimension_embedding_).transpose() * hidden;
+	logits.colwise() += embedding_output_().row(dimension_embedding_).transpose();
+	
+	size_type batch = 0;
+	for (QueryIterator qiter = first; qiter != last; ++ qiter, ++ batch, ++ result) {
+	  double logsum = - std::numeric_limits<double>::infinity();
+	  
+	  for (id_type id = 0; id != embedding_size_; ++ id)
+	    if (id != id_bos_ && id != id_eps_)
+	      logsum = utils::mathop::logsum(logsum, double(logits(id, batch)));
+	  
+	  const id_type word = *(qiter->second - 1);
+	  
+	  *result = (word != id_bos_ && word != id_eps_ ? double(logits(word, batch)) : 0.0) - logsum;
+	}
+      } else {
+	size_type batch = 0;
+	for (QueryIterator qiter = first; qiter != last; ++ qiter, ++ batch, ++ result) {
+	  const id_type word = *(qiter->second - 1);
+	  
+	  *result = (embedding_output_().col(word).block(0, 0, dimension_embedding_, 1).transpose() * hidden.col(batch)
+		     + embedding_output_().col(word).block(dimension_embedding_, 0, 1, 1))(0, 0);
+	}
+      }
+    }
+    
     template <typename Iterator, typename __Word>
     logprob_type logprob_dispatch(Iterator first, Iterator last, __Word) const
     {
@@ -310,6 +481,7 @@ namespace cicada
     int       order_;
 
     bool normalize_;
+    bool precompute_;
     
     // path to the directory...
     path_type path_;
@@ -317,6 +489,9 @@ namespace cicada
     buffer_type       buffer_;
     cache_set_type    cache_;
     spinlock_set_type locks_;
+    
+    // pre-computed first layer projections, Wc * embedding, for each word and each context position. shared by copies
+    tensor_ptr_type projection_;
   };
 };
 
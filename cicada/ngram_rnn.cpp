@@ -27,7 +27,7 @@ namespace cicada
     return boost::lexical_cast<Value>(iter->second);
   }
   
-  void NGramRNN::open(const path_type& path, const bool normalize)
+  void NGramRNN::open(const path_type& path, const bool normalize, const bool precompute)
   {
     typedef utils::repository repository_type;
 
@@ -41,7 +41,8 @@ namespace cicada
     dimension_      = repository_value<size_type>(rep, "embedding");
     order_          = repository_value<int>(rep, "order");
 
-    normalize_ = normalize;
+    normalize_  = normalize;
+    precompute_ = precompute;
     
     embedding_input_.open(rep.path("input.bin"), dimension_, embedding_size_);
     embedding_output_.open(rep.path("output.bin"), dimension_ + 1, embedding_size_);
@@ -83,6 +84,15 @@ namespace cicada
 		   + bc_().block(0, i, dimension_, 1)).array().unaryExpr(hinge());
       }
     }
+    
+    // pre-compute the projection of every word at every context position
+    if (precompute_) {
+      projection_.reset(new tensor_type(dimension_, embedding_size_ * (order_ - 1)));
+      
+      for (int i = 0; i != order_ - 1; ++ i)
+	projection_->block(0, embedding_size_ * i, dimension_, embedding_size_).noalias()
+	  = Wc_().block(0, i * 2 * dimension_ + offset_embedding, dimension_, dimension_) * embedding_input_();
+    }
   }
   
   typedef utils::unordered_map<std::string, NGramRNN, boost::hash<utils::piece>, std::equal_to<std::string>,
@@ -104,7 +114,7 @@ namespace cicada
   static utils::thread_specific_ptr<ngram_rnn_map_type> __ngram_rnns;
 #endif
   
-  NGramRNN& NGramRNN::create(const path_type& path)
+  NGramRNN& NGramRNN::create(const path_type& path, const bool normalize, const bool precompute)
   {
 #ifdef HAVE_TLS
     if (! __ngram_rnns_tls) {
@@ -119,7 +129,9 @@ namespace cicada
     ngram_rnn_map_type& ngram_rnns_map = *__ngram_rnns;
 #endif
     
-    const std::string parameter = path.string();
+    const std::string parameter = (path.string()
+				   + (normalize ? ":normalize" : "")
+				   + (precompute ? ":precompute" : ""));
     
     ngram_rnn_map_type::iterator iter = ngram_rnns_map.find(parameter);
     if (iter == ngram_rnns_map.end()) {
@@ -127,7 +139,7 @@ namespace cicada
       
       ngram_rnn_map_type::iterator iter_global = impl::__ngram_rnn_map.find(parameter);
       if (iter_global == impl::__ngram_rnn_map.end())
-	iter_global = impl::__ngram_rnn_map.insert(std::make_pair(parameter, NGramRNN(parameter))).first;
+	iter_global = impl::__ngram_rnn_map.insert(std::make_pair(parameter, NGramRNN(path, normalize, precompute))).first;
       
       iter = ngram_rnns_map.insert(*iter_global).first;
     }
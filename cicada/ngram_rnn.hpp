@@ -14,6 +14,7 @@
 #include <vector>
 
 #include <boost/filesystem.hpp>
+#include <boost/shared_ptr.hpp>
 
 #include <cicada/symbol.hpp>
 #include <cicada/vocab.hpp>
@@ -113,14 +114,16 @@ namespace cicada
     typedef cicada::NGramCache<id_type, logprob_type>                       cache_type;
     typedef utils::array_power2<cache_type, 16, std::allocator<cache_type> > cache_set_type;
     
+    typedef boost::shared_ptr<tensor_type> tensor_ptr_type;
+    
   public:
-    NGramRNN(const bool normalize=false)
-      : normalize_(normalize) { clear(); }
-    NGramRNN(const path_type& path, const bool normalize=false)
-      : normalize_(normalize) { open(path, normalize); }
+    NGramRNN(const bool normalize=false, const bool precompute=false)
+      : normalize_(normalize), precompute_(precompute) { clear(); }
+    NGramRNN(const path_type& path, const bool normalize=false, const bool precompute=false)
+      : normalize_(normalize), precompute_(precompute) { open(path, normalize, precompute); }
     
   public:
-   static NGramRNN& create(const path_type& path);
+   static NGramRNN& create(const path_type& path, const bool normalize=false, const bool precompute=false);
 
   public:
     const vocab_type& vocab() const { return vocab_; }
@@ -128,10 +131,13 @@ namespace cicada
     size_type dimension() const { return dimension_; }
     const int& order() const { return order_; }
     
+    bool normalize() const { return normalize_; }
+    bool precompute() const { return precompute_; }
+    
     path_type path() const { return path_; }
     bool empty() const { return ! path_.empty(); }
     
-    void open(const path_type& path, const bool normalize=false);
+    void open(const path_type& path, const bool normalize=false, const bool precompute=false);
     void close() { clear(); }
 
     void populate()
@@ -173,6 +179,8 @@ namespace cicada
       buffer_.clear();
       init_.clear();
       cache_.clear();
+      
+      projection_.reset();
     }
 
   public:
@@ -188,7 +196,177 @@ namespace cicada
       return logprob_dispatch(first, last, value_type());
     }
     
+    // batched scoring: the sum of the logprobs of the words in [iter, last), each conditioned on the preceding words
+    // in [first, iter) and [iter, last) truncated by order. The ngrams which are not cached are scored together
+    // by matrix-matrix products.
+    template <typename Iterator>
+    logprob_type operator()(Iterator first, Iterator iter, Iterator last) const
+    {
+      return operator()(first, iter, last, order_);
+    }
+    
+    template <typename Iterator>
+    logprob_type operator()(Iterator first, Iterator iter, Iterator last, const int order) const
+    {
+      typedef typename std::iterator_traits<Iterator>::value_type value_type;
+      
+      if (iter == last) return 0;
+      
+      return logprob_batch_dispatch(first, iter, last, utils::bithack::min(order, order_), value_type());
+    }
+    
   private:
+    template <typename Iterator, typename __Word>
+    logprob_type logprob_batch_dispatch(Iterator first, Iterator iter, Iterator last, const int order, __Word) const
+    {
+      typedef std::vector<id_type, std::allocator<id_type> > buffer_type;
+      
+      buffer_type buffer(last - first);
+      
+      buffer_type::iterator biter = buffer.begin();
+      for (Iterator witer = first; witer != last; ++ witer, ++ biter)
+	*biter = vocab_[*witer];
+      
+      return logprob_batch_dispatch(buffer.begin(), buffer.begin() + (iter - first), buffer.end(), order, id_type());
+    }
+    
+    template <typename Iterator>
+    logprob_type logprob_batch_dispatch(Iterator first, Iterator iter, Iterator last, const int order, id_type) const
+    {
+      typedef std::pair<Iterator, Iterator> query_type;
+      typedef std::vector<query_type, std::allocator<query_type> > query_set_type;
+      typedef std::vector<logprob_type, std::allocator<logprob_type> > logprob_set_type;
+      
+      query_set_type queries;
+      double logprob = 0.0;
+      
+      for (/**/; iter != last; ++ iter) {
+	const Iterator qfirst = std::max(first, iter + 1 - order);
+	const Iterator qlast  = iter + 1;
+	
+	const size_type hash      = hasher_type::operator()(qfirst, qlast, 0);
+	const size_type pos       = (hash >> 4) & (cache_type::cache_size - 1);
+	const size_type pos_cache = hash & (locks_.size() - 1);
+	
+	spinlock_type::lock_type lock(const_cast<spinlock_type&>(locks_[pos_cache]).mutex_);
+	
+	const cache_type& cache = cache_[pos_cache];
+	
+	if (cache.equal_to(pos, qfirst, qlast))
+	  logprob += cache[pos];
+	else
+	  queries.push_back(query_type(qfirst, qlast));
+      }
+      
+      if (queries.empty()) return logprob;
+      
+      logprob_set_type logprobs(queries.size());
+      
+      logprob_matrix(queries.begin(), queries.end(), logprobs.begin());
+      
+      for (size_type i = 0; i != queries.size(); ++ i) {
+	const size_type hash      = hasher_type::operator()(queries[i].first, queries[i].second, 0);
+	const size_type pos       = (hash >> 4) & (cache_type::cache_size - 1);
+	const size_type pos_cache = hash & (locks_.size() - 1);
+	
+	spinlock_type::lock_type lock(const_cast<spinlock_type&>(locks_[pos_cache]).mutex_);
+	
+	cache_type& cache = const_cast<cache_type&>(cache_[pos_cache]);
+	
+	cache.assign(pos, queries[i].first, queries[i].second);
+	cache[pos] = logprobs[i];
+	
+	logprob += logprobs[i];
+      }
+      
+      return logprob;
+    }
+    
+    // score the queries, a range of word-ids, in a batch: each query is a column of the context matrix, and
+    // the recurrence is performed for all the queries at each context position. Queries shorter than order start
+    // from the initial context for the position.
+    template <typename QueryIterator, typename LogprobIterator>
+    void logprob_matrix(QueryIterator first, QueryIterator last, LogprobIterator result) const
+    {
+      typedef typename std::iterator_traits<QueryIterator>::value_type::first_type word_iterator;
+      
+      const size_type offset_embedding = 0;
+      const size_type offset_context   = dimension_;
+      
+      const size_type batch_size = std::distance(first, last);
+      
+      std::vector<size_type, std::allocator<size_type> > fills(batch_size);
+      
+      tensor_type context(dimension_, batch_size);
+      tensor_type input(dimension_, batch_size);
+      tensor_type context_next(dimension_, batch_size);
+      
+      size_type fill_min = order_;
+      size_type batch = 0;
+      for (QueryIterator qiter = first; qiter != last; ++ qiter, ++ batch) {
+	fills[batch] = order_ - (qiter->second - qiter->first);
+	fill_min = utils::bithack::min(fill_min, fills[batch]);
+	
+	context.col(batch) = matrix_type(const_cast<parameter_type*>(&(*init_.begin(fills[batch]))), dimension_, 1);
+      }
+      
+      for (size_type i = fill_min; i < size_type(order_ - 1); ++ i) {
+	const size_type shift = i * 2 * dimension_;
+	
+	batch = 0;
+	for (QueryIterator qiter = first; qiter != last; ++ qiter, ++ batch) {
+	  const id_type word = (fills[batch] <= i ? *(qiter->first + (i - fills[batch])) : id_eps_);
+	  
+	  if (projection_)
+	    input.col(batch) = projection_->col(embedding_size_ * i + word);
+	  else
+	    input.col(batch) = embedding_input_().col(word);
+	}
+	
+	if (projection_)
+	  context_next = input;
+	else
+	  context_next.noalias() = Wc_().block(0, shift + offset_embedding, dimension_, dimension_) * input;
+	
+	context_next.noalias() += Wc_().block(0, shift + offset_context, dimension_, dimension_) * context;
+	context_next.colwise() += bc_().col(i);
+	
+	batch = 0;
+	for (QueryIterator qiter = first; qiter != last; ++ qiter, ++ batch)
+	  if (fills[batch] <= i)
+	    context.col(batch) = context_next.col(batch).array().unaryExpr(hinge());
+      }
+      
+      if (normalize_) {
+	// partition functions of all the queries by one product with the output embedding
+	tensor_type logits(embedding_size_, batch_size);
+	
+	logits.noalias() = embedding_output_().topRows(dimension_).transpose() * context;
+	logits.colwise() += embedding_output_().row(dimension_).transpose();
+	
+	batch = 0;
+	for (QueryIterator qiter = first; qiter != last; ++ qiter, ++ batch, ++ result) {
+	  double logsum = - std::numeric_limits<double>::infinity();
+	  
+	  for (id_type id = 0; id != embedding_size_; ++ id)
+	    if (id != id_bos_ && id != id_eps_)
+	      logsum = utils::mathop::logsum(logsum, double(logits(id, batch)));
+	  
+	  const id_type word = *(qiter->second - 1);
+	  
+	  *result = (word != id_bos_ && word != id_eps_ ? double(logits(word, batch)) : 0.0) - logsum;
+	}
+      } else {
+	batch = 0;
+	for (QueryIterator qiter = first; qiter != last; ++ qiter, ++ batch, ++ result) {
+	  const id_type word = *(qiter->second - 1);
+	  
+	  *result = (embedding_output_().col(word).block(0, 0, dimension_, 1).transpose() * context.col(batch)
+		     + embedding_output_().col(word).block(dimension_, 0, 1, 1))(0, 0);
+	}
+      }
+    }
+    
     template <typename Iterator, typename __Word>
     logprob_type logprob_dispatch(Iterator first, Iterator last, __Word) const
     {
@@ -342,6 +520,7 @@ namespace cicada
     int       order_;
 
     bool normalize_;
+    bool precompute_;
     
     // path to the directory...
     path_type path_;
@@ -350,6 +529,9 @@ namespace cicada
     buffer_type       init_;
     cache_set_type    cache_;
     spinlock_set_type locks_;
+    
+    // pre-computed projections of the input embedding, Wc * embedding, for each word and each context position. shared by copies
+    tensor_ptr_type projection_;
   };
 };
 
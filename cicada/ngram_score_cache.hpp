@@ -0,0 +1,276 @@
+// -*- mode: c++ -*-
+//
+//  Copyright(C) 2013 Taro Watanabe <taro.watanabe@nict.go.jp>
+//
+
+#ifndef __CICADA__NGRAM_SCORE_CACHE__HPP__
+#define __CICADA__NGRAM_SCORE_CACHE__HPP__ 1
+
+//
+// a process-wide, concurrent cache for ngram scores shared by all the threads (and all the cloned ngram features).
+//
+// The cache is a set-associative table of fixed-size entries, sized once at construction.
+// Each entry is guarded by a version counter (seqlock): a writer acquires an entry by CAS-ing its even version
+// to odd, and releases by incrementing again. A reader simply validates that the version is even and unchanged
+// after reading the entry. Writers never wait: when an entry is being written by others, insertion is skipped.
+// Full barriers order the version loads/stores against the entry contents: after the first version load and
+// before the re-check in find, and after the acquisition and before the final version store in insert.
+//
+// key:   context ids of the ngram state + word
+// value: result of lookup + the output ngram state (context and backoff)
+//
+// The hits, misses and inserts are counted in stripes padded to a cache line, and each thread takes its own stripe,
+// thus, threads do not share the counters unless there are more threads than stripes.
+//
+
+#include <stdint.h>
+
+#include <vector>
+#include <algorithm>
+
+#include <cicada/symbol.hpp>
+#include <cicada/ngram_state.hpp>
+
+#include <utils/hashmurmur3.hpp>
+#include <utils/atomicop.hpp>
+#include <utils/bithack.hpp>
+#include <utils/config.hpp>
+#include <utils/thread_specific_ptr.hpp>
+
+namespace cicada
+{
+  template <typename Result>
+  class NGramScoreCache : public utils::hashmurmur3<uint64_t>
+  {
+  public:
+    typedef size_t    size_type;
+    typedef ptrdiff_t difference_type;
+
+    typedef Symbol             word_type;
+    typedef word_type::id_type id_type;
+    typedef Result             result_type;
+    typedef NGramState         ngram_state_type;
+
+    typedef uint64_t key_type;
+    typedef uint64_t count_type;
+
+    typedef utils::hashmurmur3<key_type> hasher_type;
+
+    static const size_type associativity = 4;
+    static const size_type stripes       = 64;
+
+  private:
+    typedef std::vector<uint64_t, std::allocator<uint64_t> > storage_type;
+
+    struct entry_type
+    {
+      volatile uint32_t version;
+      uint32_t          size;   // context size, or empty
+      id_type           word;
+      id_type           context[1];
+    };
+
+    struct counter_type
+    {
+      counter_type() : hits(0), misses(0), inserts(0) {}
+
+      volatile count_type hits;
+      volatile count_type misses;
+      volatile count_type inserts;
+      char padding[64 - sizeof(count_type) * 3];
+    };
+    typedef std::vector<counter_type, std::allocator<counter_type> > counter_set_type;
+
+    static const uint32_t empty_size = uint32_t(-1);
+
+  public:
+    NGramScoreCache(const int order, const size_type bytes)
+      : ngram_state(order), counters(stripes)
+    {
+      offset_result = (utils::bithack::max(sizeof(entry_type) + sizeof(id_type) * (order - 1), sizeof(entry_type)) + 7) & (~size_type(7));
+      offset_state  = (offset_result + sizeof(result_type) + 7) & (~size_type(7));
+      stride        = ((offset_state + ngram_state.buffer_size() + 7) & (~size_type(7))) >> 3;
+
+      // number of buckets, power of two
+      const size_type buckets_max = utils::bithack::max(bytes / (stride * 8 * associativity), size_type(1));
+
+      buckets = 1;
+      while (buckets * 2 <= buckets_max)
+	buckets *= 2;
+
+      storage.resize(buckets * associativity * stride);
+
+      for (size_type pos = 0; pos != buckets * associativity; ++ pos) {
+	entry_type& entry = this->entry(pos);
+
+	entry.version = 0;
+	entry.size    = empty_size;
+      }
+    }
+
+  public:
+    // find the cached score for context in buffer_in and word. If found, buffer_out is filled with the output state.
+    bool find(const void* buffer_in, const id_type& word, result_type& result, void* buffer_out) const
+    {
+      const id_type*  context = ngram_state.context(buffer_in);
+      const size_type size    = ngram_state.size(buffer_in);
+
+      const key_type  key    = hash(context, size, word);
+      const size_type bucket = key & (buckets - 1);
+
+      for (size_type i = 0; i != associativity; ++ i) {
+	const entry_type& entry = this->entry(bucket * associativity + i);
+
+	const uint32_t version = entry.version;
+
+	// acquire: the entry is read after the version
+	utils::atomicop::memory_barrier();
+
+	if ((version & 1) || entry.size != size || entry.word != word || ! std::equal(context, context + size, entry.context))
+	  continue;
+
+	result = *reinterpret_cast<const result_type*>(reinterpret_cast<const char*>(&entry) + offset_result);
+
+	const void* buffer_cached = reinterpret_cast<const char*>(&entry) + offset_state;
+	const size_type size_out = ngram_state.size(buffer_cached);
+
+	if (size_out >= ngram_state.order_) continue;
+
+	ngram_state.size(buffer_out) = size_out;
+	std::copy(ngram_state.context(buffer_cached), ngram_state.context(buffer_cached) + size_out, ngram_state.context(buffer_out));
+	std::copy(ngram_state.backoff(buffer_cached), ngram_state.backoff(buffer_cached) + size_out, ngram_state.backoff(buffer_out));
+
+	// the copies above complete before the re-check
+	utils::atomicop::memory_barrier();
+
+	// validate: the entry was not modified while copying
+	if (entry.version != version) break;
+
+	count(&counter_type::hits);
+	return true;
+      }
+
+      count(&counter_type::misses);
+      return false;
+    }
+
+    void insert(const void* buffer_in, const id_type& word, const result_type& result, const void* buffer_out)
+    {
+      const id_type*  context = ngram_state.context(buffer_in);
+      const size_type size    = ngram_state.size(buffer_in);
+
+      const key_type  key    = hash(context, size, word);
+      const size_type bucket = key & (buckets - 1);
+
+      // prefer an empty entry, otherwise, use the upper bits of the hash value to select a victim
+      size_type victim = (key >> 32) & (associativity - 1);
+      for (size_type i = 0; i != associativity; ++ i)
+	if (entry(bucket * associativity + i).size == empty_size) {
+	  victim = i;
+	  break;
+	}
+
+      entry_type& entry = this->entry(bucket * associativity + victim);
+
+      const uint32_t version = entry.version;
+      if ((version & 1) || ! utils::atomicop::compare_and_swap(entry.version, version, version + 1))
+	return;
+
+      // the entry is modified only after the version is made odd
+      utils::atomicop::memory_barrier();
+
+      entry.size = size;
+      entry.word = word;
+      std::copy(context, context + size, entry.context);
+
+      *reinterpret_cast<result_type*>(reinterpret_cast<char*>(&entry) + offset_result) = result;
+
+      void* buffer_cached = reinterpret_cast<char*>(&entry) + offset_state;
+      const size_type size_out = ngram_state.size(buffer_out);
+
+      ngram_state.size(buffer_cached) = size_out;
+      std::copy(ngram_state.context(buffer_out), ngram_state.context(buffer_out) + size_out, ngram_state.context(buffer_cached));
+      std::copy(ngram_state.backoff(buffer_out), ngram_state.backoff(buffer_out) + size_out, ngram_state.backoff(buffer_cached));
+
+      // release: the entry is published before the version
+      utils::atomicop::memory_barrier();
+
+      entry.version = version + 2;
+
+      count(&counter_type::inserts);
+    }
+
+  public:
+    // statistics
+    size_type size() const { return buckets * associativity; }
+    size_type size_bytes() const { return storage.size() * sizeof(uint64_t); }
+
+    count_type hits() const { return accumulate(&counter_type::hits); }
+    count_type misses() const { return accumulate(&counter_type::misses); }
+    count_type inserts() const { return accumulate(&counter_type::inserts); }
+
+  private:
+    key_type hash(const id_type* context, const size_type size, const id_type& word) const
+    {
+      return hasher_type::operator()(context, context + size, hasher_type::operator()(word, key_type(size)));
+    }
+
+    // the counters of the stripe owned by this thread
+    void count(volatile count_type counter_type::* member) const
+    {
+      utils::atomicop::add_and_fetch(const_cast<counter_type&>(counters[stripe()]).*member, count_type(1));
+    }
+
+    count_type accumulate(volatile count_type counter_type::* member) const
+    {
+      count_type sum = 0;
+      for (typename counter_set_type::const_iterator citer = counters.begin(); citer != counters.end(); ++ citer)
+	sum += (*citer).*member;
+      return sum;
+    }
+
+    static size_type stripe()
+    {
+      static size_type stripe_next = 0;
+
+#ifdef HAVE_TLS
+      static __thread size_type stripe_tls = size_type(-1);
+
+      if (stripe_tls == size_type(-1))
+	stripe_tls = (utils::atomicop::fetch_and_add(stripe_next, size_type(1)) & (stripes - 1));
+
+      return stripe_tls;
+#else
+      static utils::thread_specific_ptr<size_type> stripe_tss;
+
+      if (! stripe_tss.get())
+	stripe_tss.reset(new size_type(utils::atomicop::fetch_and_add(stripe_next, size_type(1)) & (stripes - 1)));
+
+      return *stripe_tss;
+#endif
+    }
+
+    entry_type& entry(size_type pos)
+    {
+      return *reinterpret_cast<entry_type*>(&storage[pos * stride]);
+    }
+
+    const entry_type& entry(size_type pos) const
+    {
+      return *reinterpret_cast<const entry_type*>(&storage[pos * stride]);
+    }
+
+  private:
+    ngram_state_type ngram_state;
+
+    size_type offset_result;
+    size_type offset_state;
+    size_type stride;     // in uint64_t
+    size_type buckets;
+
+    storage_type     storage;
+    counter_set_type counters;
+  };
+};
+
+#endif
@@ -36,6 +36,7 @@
 #define __EXPGRAM__NGRAM_SCORER__HPP__ 1
 
 #include <vector>
+#include <iterator>
 
 #include <cicada/symbol.hpp>
 #include <cicada/vocab.hpp>
@@ -61,6 +62,7 @@ namespace cicada
     typedef NGramStateChart ngram_state_type;
 
     typedef std::vector<char, std::allocator<char> > buffer_type;
+    typedef std::vector<ngram_type::result_type, std::allocator<ngram_type::result_type> > result_set_type;
 
     struct score_type
     {
@@ -191,6 +193,53 @@ namespace cicada
       }
     }
 
+    // terminal() for each word in [first, last): the words are scored at once by the sequence version of ngram_score
+    template <typename Iterator>
+    void terminals(Iterator first, Iterator last)
+    {
+      const size_type size = std::distance(first, last);
+      
+      if (size <= 1) {
+	if (size)
+	  terminal(*first);
+	return;
+      }
+      
+      const size_type buffer_size = ngram_state_.suffix_.buffer_size();
+      
+      if (buffer_terminals_.size() < buffer_size * (size + 1))
+	buffer_terminals_.resize(buffer_size * (size + 1));
+      results_terminals_.resize(size);
+      
+      // states[0] is the current suffix, and states[i + 1] is the output state of the i-th word
+      char* states = &(*buffer_terminals_.begin());
+      
+      ngram_state_.suffix_.copy(ngram_state_.suffix(state_), states);
+      
+      ngram_->ngram_score(states, first, last, states + buffer_size, &(*results_terminals_.begin()));
+      
+      for (size_type i = 0; i != size; ++ i) {
+	const ngram_type::result_type& result = results_terminals_[i];
+	
+	if (complete_ || result.complete) {
+	  score_.prob_ += result.prob;
+	  
+	  complete_ = true;
+	} else {
+	  score_.bound_ += result.bound;
+	  
+	  ngram_state_.state(state_)[ngram_state_.size_prefix(state_)] = result.state;
+	  ++ ngram_state_.size_prefix(state_);
+	  
+	  // if not incremental, this is a complete state!
+	  if (ngram_state_.suffix_.size(states + buffer_size * (i + 1)) != ngram_state_.suffix_.size(states + buffer_size * i) + 1)
+	    complete_ = true;
+	}
+      }
+      
+      ngram_state_.suffix_.copy(states + buffer_size * size, ngram_state_.suffix(state_));
+    }
+
     // special handling for left-most non-terminal
     void initial_non_terminal(const void* antecedent)
     {
@@ -346,6 +395,9 @@ namespace cicada
     
     buffer_type buffer1_;
     buffer_type buffer2_;
+    
+    buffer_type      buffer_terminals_;
+    result_set_type  results_terminals_;
   };
 };
 
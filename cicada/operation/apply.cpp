@@ -27,7 +27,7 @@ namespace cicada
     Apply::Apply(const std::string& parameter,
 		 const model_type& __model,
 		 const int __debug)
-      : model(__model), weights(0), weights_assigned(0), size(200), diversity(0.0),
+      : model(__model), weights(0), weights_assigned(0), size(200), diversity(0.0), threads(1),
 	weights_one(false), weights_fixed(false), weights_extra(),
 	rejection(false), exact(false), prune(false), grow(false), grow_coarse(false), incremental(false), forced(false), sparse(false), dense(false), state_less(false), state_full(false), prune_bin(false), debug(__debug)
     {
@@ -42,6 +42,8 @@ namespace cicada
 	  size = utils::lexical_cast<int>(piter->second);
 	else if (utils::ipiece(piter->first) == "diversity")
 	  diversity = utils::lexical_cast<double>(piter->second);
+	else if (utils::ipiece(piter->first) == "threads")
+	  threads = utils::lexical_cast<int>(piter->second);
 	else if (utils::ipiece(piter->first) == "rejection")
 	  rejection = utils::lexical_cast<bool>(piter->second);
 	else if (utils::ipiece(piter->first) == "exact")
@@ -120,6 +122,13 @@ namespace cicada
 	if (! prune)
 	  throw std::runtime_error("rejection or diversified can be only combined with cube-pruning");
       
+      if (threads <= 0)
+	throw std::runtime_error("invalid # of threads: " + utils::lexical_cast<std::string>(threads));
+      
+      if (threads > 1)
+	if (! prune || rejection || diversity != 0.0)
+	  throw std::runtime_error("parallel application is supported only by cube-pruning");
+      
       // construct sparse or dense
       if (sparse) {
 	model_type model_sparse;
@@ -228,6 +237,26 @@ namespace cicada
       if (forced)
 	__model.apply_feature(true);
       
+      // a model for each thread: the first one shares the feature functions with __model,
+      // and the rest are clones, since feature functions are not thread-safe
+      model_set_type& __models = const_cast<model_set_type&>(model_threads);
+      
+      if (threads > 1) {
+	if (__models.empty()) {
+	  __models.reserve(threads);
+	  __models.push_back(__model);
+	  for (int i = 1; i != threads; ++ i)
+	    __models.push_back(__model.clone());
+	}
+	
+	for (int i = 1; i != threads; ++ i) {
+	  __models[i].assign(data.id, data.hypergraph, data.lattice, data.spans, data.targets, data.ngram_counts);
+	  
+	  if (forced)
+	    __models[i].apply_feature(true);
+	}
+      }
+      
       const weight_set_type* weights_apply = (weights_assigned ? weights_assigned : &(weights->weights));
       
       if (debug)
@@ -275,6 +304,13 @@ namespace cicada
 	  else
 	    cicada::apply_cube_prune_rejection(__model, hypergraph, applied, weight_function<weight_type>(*weights_apply), const_cast<sampler_type&>(sampler), size, prune_bin);
 	  
+	} else if (threads > 1) {
+	  if (weights_one)
+	    cicada::apply_cube_prune(__models, hypergraph, applied, weight_function_one<weight_type>(), size, prune_bin);
+	  else if (! weights_extra.empty())
+	    cicada::apply_cube_prune(__models, hypergraph, applied, weight_function_extra<weight_type>(*weights_apply, weights_extra.begin(), weights_extra.end()), size, prune_bin);
+	  else
+	    cicada::apply_cube_prune(__models, hypergraph, applied, weight_function<weight_type>(*weights_apply), size, prune_bin);
 	} else {
 	  if (weights_one)
 	    cicada::apply_cube_prune(__model, hypergraph, applied, weight_function_one<weight_type>(), size, prune_bin);
@@ -288,6 +324,9 @@ namespace cicada
       utils::resource end;
     
       __model.apply_feature(false);
+      
+      for (size_t i = 1; i < __models.size(); ++ i)
+	__models[i].apply_feature(false);
     
       if (debug)
 	std::cerr << name << ": " << data.id
@@ -19,6 +19,7 @@ namespace cicada
     {
     private:
       typedef utils::sampler<boost::mt19937> sampler_type;
+      typedef std::vector<model_type, std::allocator<model_type> > model_set_type;
 
     public:
       Apply(const std::string& parameter,
@@ -30,12 +31,14 @@ namespace cicada
       void assign(const weight_set_type& __weights);
 
       model_type model_local;
+      model_set_type model_threads;
 
       const model_type& model;
       const weights_path_type* weights;
       const weight_set_type*   weights_assigned;
       int size;
       double diversity;
+      int threads;
       bool weights_one;
       bool weights_fixed;
 
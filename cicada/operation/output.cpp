@@ -23,6 +23,7 @@
 #include <cicada/kbest.hpp>
 #include <cicada/kbest_diverse.hpp>
 #include <cicada/graphviz.hpp>
+#include <cicada/hypergraph_binary.hpp>
 #include <cicada/treebank.hpp>
 #include <cicada/inside_outside.hpp>
 #include <cicada/span_node.hpp>
@@ -410,6 +411,8 @@ namespace cicada
 	statistics(false),
 	lattice_mode(false),
 	forest_mode(false),
+	binary_mode(false),
+	lz4_mode(false),
         span_mode(false),
         alignment_mode(false),
         dependency_mode(false),
@@ -448,6 +451,10 @@ namespace cicada
 	  lattice_mode = utils::lexical_cast<bool>(piter->second);
 	else if (utils::ipiece(piter->first) == "forest")
 	  forest_mode = utils::lexical_cast<bool>(piter->second);
+	else if (utils::ipiece(piter->first) == "binary")
+	  binary_mode = utils::lexical_cast<bool>(piter->second);
+	else if (utils::ipiece(piter->first) == "lz4")
+	  lz4_mode = utils::lexical_cast<bool>(piter->second);
 	else if (utils::ipiece(piter->first) == "span")
 	  span_mode = utils::lexical_cast<bool>(piter->second);
 	else if (utils::ipiece(piter->first) == "alignment")
@@ -551,6 +558,10 @@ namespace cicada
       
       if (int(lattice_mode) + forest_mode + span_mode + alignment_mode + dependency_mode + bitext_mode == 0)
 	forest_mode = true;
+      
+      // LZ4 compression is applied to the binary format
+      if (lz4_mode)
+	binary_mode = true;
     }
 
     void Output::assign(const weight_set_type& __weights)
@@ -699,13 +710,20 @@ namespace cicada
 	  os << id << " ||| ";
 	
 	if (lattice_mode && forest_mode) {
-	  os << data.lattice << " ||| " << hypergraph;
+	  os << data.lattice << " ||| ";
+	  if (binary_mode)
+	    cicada::write_binary(os, hypergraph, lz4_mode);
+	  else
+	    os << hypergraph;
 	  need_separator = true;
 	} else if (lattice_mode) {
 	  os << data.lattice;
 	  need_separator = true;
 	} else {
-	  os << hypergraph;
+	  if (binary_mode)
+	    cicada::write_binary(os, hypergraph, lz4_mode);
+	  else
+	    os << hypergraph;
 	  need_separator = true;
 	}
 	
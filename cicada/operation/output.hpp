@@ -68,6 +68,8 @@ namespace cicada
       bool statistics;
       bool lattice_mode;
       bool forest_mode;
+      bool binary_mode;
+      bool lz4_mode;
       bool span_mode;
       bool alignment_mode;
       bool dependency_mode;
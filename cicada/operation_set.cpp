@@ -63,6 +63,7 @@ namespace cicada
 apply: feature application\n\
 \tsize=<cube size>\n\
 \tdiversity=<diversity> diversity for cube pruning (zero for none, positive for more diverse)\n\
+\tthreads=<# of threads> parallel cube pruning within a sentence\n\
 \trejection=[true|false] perform rejection sampling\n\
 \texact=[true|false]  no pruning feature application\n\
 \tprune=[true|false]         cube-pruning for feature application\n\
@@ -173,6 +174,8 @@ output: kbest or hypergraph output\n\
 \tstatistics=[true|false] dump various statistics (size etc.)\n\
 \tlattice=[true|false] dump lattice\n\
 \tforest=[true|false] dump forest\n\
+\tbinary=[true|false] dump forest in the compact binary format\n\
+\tlz4=[true|false] compress the binary forest by LZ4\n\
 \tspan=[true|false] dump spans\n\
 \talignment=[true|false] dump alignment\n\
 \tdependency=[true|false] dump dependency\n\
@@ -344,6 +347,9 @@ viterbi: compute viterbi tree\n\
 
     debug = __debug;
     
+    grammar_cache      = grammar;
+    tree_grammar_cache = tree_grammar;
+    
     // default to sentence input...
     if (! input_lattice && ! input_forest && ! input_sentence)
       input_sentence = true;
@@ -690,11 +696,38 @@ viterbi: compute viterbi tree\n\
     if (iter != end)
       throw std::runtime_error("invalid input format: " + utils::lexical_cast<std::string>(data.id) + ' ' + line);
     
+    // the rule cache counters before processing
+    size_type grammar_hit_prev = 0;
+    size_type grammar_miss_prev = 0;
+    size_type tree_grammar_hit_prev = 0;
+    size_type tree_grammar_miss_prev = 0;
+    
+    grammar_cache.cache_statistics(grammar_hit_prev, grammar_miss_prev);
+    tree_grammar_cache.cache_statistics(tree_grammar_hit_prev, tree_grammar_miss_prev);
+    
     // processing...
     operation_ptr_set_type::const_iterator oiter_end = operations.end();
     for (operation_ptr_set_type::const_iterator oiter = operations.begin(); oiter != oiter_end; ++ oiter)
       (*oiter)->operator()(data);
     
+    size_type grammar_hit = 0;
+    size_type grammar_miss = 0;
+    size_type tree_grammar_hit = 0;
+    size_type tree_grammar_miss = 0;
+    
+    grammar_cache.cache_statistics(grammar_hit, grammar_miss);
+    tree_grammar_cache.cache_statistics(tree_grammar_hit, tree_grammar_miss);
+    
+    if (grammar_hit + grammar_miss != grammar_hit_prev + grammar_miss_prev) {
+      data.statistics["grammar-cache-hit"].count  += grammar_hit - grammar_hit_prev;
+      data.statistics["grammar-cache-miss"].count += grammar_miss - grammar_miss_prev;
+    }
+    
+    if (tree_grammar_hit + tree_grammar_miss != tree_grammar_hit_prev + tree_grammar_miss_prev) {
+      data.statistics["tree-grammar-cache-hit"].count  += tree_grammar_hit - tree_grammar_hit_prev;
+      data.statistics["tree-grammar-cache-miss"].count += tree_grammar_miss - tree_grammar_miss_prev;
+    }
+    
     statistics += data.statistics;
   }
 };
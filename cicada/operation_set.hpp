@@ -155,6 +155,10 @@ namespace cicada
     
     operation_ptr_set_type operations;
     statistics_type        statistics;
+    
+    // grammars queried by the operations, kept for the cache statistics
+    grammar_type      grammar_cache;
+    tree_grammar_type tree_grammar_cache;
 
     int debug;
   };
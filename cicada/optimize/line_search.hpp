@@ -9,6 +9,7 @@
 #include <vector>
 #include <deque>
 #include <algorithm>
+#include <functional>
 
 #include <cicada/hypergraph.hpp>
 #include <cicada/weight_vector.hpp>
@@ -249,30 +250,134 @@ namespace cicada
       typedef Result value_type;
 
     private:
-      struct Item
+      // a document flattened into the breakpoints of all the sentences sorted by x. When the scores expose sufficient
+      // statistics, each breakpoint keeps the difference of the statistics from the previous segment of the same sentence
+      // in a contiguous array, and the sweep is an accumulation of doubles. Otherwise, we resort to score arithmetic.
+      struct Sweep
       {
-	int seg;
+	typedef std::vector<double, std::allocator<double> > stat_set_type;
 	
-	segment_set_type::const_iterator first;
-	segment_set_type::const_iterator last;
-
-	Item() : seg(), first(), last() {}
-	Item(const int& __seg,
-	     segment_set_type::const_iterator __first,
-	     segment_set_type::const_iterator __last)
-	  : seg(__seg), first(__first), last(__last) {}
-      };
-      typedef Item item_type;
-      
-      struct item_heap_compare_type
-      {
-	bool operator()(const item_type& x, const item_type& y) const
+	struct Point
+	{
+	  double x;
+	  int seg;
+	  int pos;
+	  
+	  Point(const double& __x, const int& __seg, const int& __pos) : x(__x), seg(__seg), pos(__pos) {}
+	  
+	  friend
+	  bool operator<(const Point& x, const Point& y) { return x.x < y.x; }
+	};
+	typedef std::vector<Point, std::allocator<Point> > point_set_type;
+	
+	Sweep(const segment_document_type& __segments)
+	  : segments(__segments), width(0), curr(0)
 	{
-	  return x.first->x > y.first->x;
+	  for (size_t seg = 0; seg != segments.size(); ++ seg)
+	    if (! segments[seg].empty()) {
+	      if (! stat) {
+		stat  = segments[seg].front().score->zero();
+		width = stat->statistics_size();
+	      }
+	      
+	      for (size_t pos = 1; pos != segments[seg].size(); ++ pos)
+		points.push_back(Point(segments[seg][pos].x, seg, pos));
+	    }
+	  
+	  // stable, so that the breakpoints of a sentence are visited in order
+	  std::stable_sort(points.begin(), points.end());
+	  
+	  // every score should share the same width, otherwise, we will fallback to score arithmetic
+	  for (size_t seg = 0; seg != segments.size() && width; ++ seg) {
+	    segment_set_type::const_iterator siter_end = segments[seg].end();
+	    for (segment_set_type::const_iterator siter = segments[seg].begin(); siter != siter_end && width; ++ siter)
+	      if (siter->score->statistics_size() != width)
+		width = 0;
+	  }
+	  
+	  if (width) {
+	    stat_set_type buffer(width);
+	    
+	    stats.resize(width, 0.0);
+	    deltas.resize(points.size() * width);
+	    
+	    for (size_t seg = 0; seg != segments.size(); ++ seg)
+	      if (! segments[seg].empty()) {
+		segments[seg].front().score->statistics(&(*buffer.begin()));
+		
+		std::transform(stats.begin(), stats.end(), buffer.begin(), stats.begin(), std::plus<double>());
+	      }
+	    
+	    for (size_t i = 0; i != points.size(); ++ i) {
+	      const segment_set_type& sentence = segments[points[i].seg];
+	      
+	      stat_set_type::iterator diter = deltas.begin() + i * width;
+	      
+	      sentence[points[i].pos].score->statistics(&(*diter));
+	      sentence[points[i].pos - 1].score->statistics(&(*buffer.begin()));
+	      
+	      std::transform(diter, diter + width, buffer.begin(), diter, std::minus<double>());
+	    }
+	  } else {
+	    scores.resize(segments.size());
+	    
+	    for (size_t seg = 0; seg != segments.size(); ++ seg)
+	      if (! segments[seg].empty()) {
+		scores[seg] = segments[seg].front().score;
+		*stat += *segments[seg].front().score;
+	      }
+	  }
 	}
+	
+	bool empty() const { return curr == points.size(); }
+	const double& front() const { return points[curr].x; }
+	
+	// apply all the breakpoints at front()
+	void advance()
+	{
+	  const double x = points[curr].x;
+	  
+	  if (width) {
+	    double* __stats = &(*stats.begin());
+	    
+	    for (/**/; curr != points.size() && points[curr].x == x; ++ curr) {
+	      const double* delta = &(*deltas.begin()) + curr * width;
+	      
+	      for (size_t i = 0; i != width; ++ i)
+		__stats[i] += delta[i];
+	    }
+	  } else {
+	    for (/**/; curr != points.size() && points[curr].x == x; ++ curr) {
+	      const score_ptr_type& score = segments[points[curr].seg][points[curr].pos].score;
+	      
+	      *stat -= *scores[points[curr].seg];
+	      *stat += *score;
+	      scores[points[curr].seg] = score;
+	    }
+	  }
+	}
+	
+	double loss()
+	{
+	  if (width)
+	    stat->assign_statistics(&(*stats.begin()));
+	  
+	  return stat->loss();
+	}
+	
+	const segment_document_type& segments;
+	
+	score_ptr_type stat;
+	score_set_type scores;
+	
+	size_t width;
+	size_t curr;
+	
+	point_set_type points;
+	stat_set_type  stats;
+	stat_set_type  deltas;
       };
-      
-      typedef std::vector<item_type, std::allocator<item_type> > heap_type;
+      typedef Sweep sweep_type;
 
       
     public:
@@ -298,39 +403,20 @@ namespace cicada
 	
 	const std::pair<double, double> range(value_min, value_max);
 
-	heap_type heap;
-	
 	if (debug >= 4)
 	  std::cerr << "minimum: " << range.first
 		    << " maximum: " << range.second
 		    << " segments: " << segments.size()
 		    << std::endl;
 	
-	score_ptr_type stat;
-	score_set_type scores(segments.size());
-	
-	for (size_t seg = 0; seg != segments.size(); ++ seg)
-	  if (! segments[seg].empty()) {
-	    
-	    if (! stat)
-	      stat = segments[seg].front().score->zero();
-	    
-	    scores[seg] = segments[seg].front().score;
-	    *stat += *segments[seg].front().score;
-	    
-	    if (segments[seg].size() > 1)
-	      heap.push_back(item_type(seg, segments[seg].begin() + 1, segments[seg].end()));
-	  }
-
-	if (heap.empty()) return;
+	sweep_type sweep(segments);
 	
-	// priority queue...
-	std::make_heap(heap.begin(), heap.end(), item_heap_compare_type());
+	if (sweep.empty()) return;
 	
-	const double score = stat->loss();
+	const double score = sweep.loss();
 	
-	double lower = lower_bound(heap.front().first->x, range.first);
-	double upper = heap.front().first->x;
+	double lower = lower_bound(sweep.front(), range.first);
+	double upper = sweep.front();
 	
 	double objective = score;
 	
@@ -347,30 +433,17 @@ namespace cicada
 		    << " objective: " << objective
 		    << std::endl;
 	
-	while (! heap.empty()) {
-	  // next at heap...
+	while (! sweep.empty()) {
+	  // next breakpoint...
 	  
-	  const double segment_curr = heap.front().first->x;
+	  const double segment_curr = sweep.front();
 	  
-	  while (! heap.empty() && heap.front().first->x == segment_curr) { 
-	    std::pop_heap(heap.begin(), heap.end(), item_heap_compare_type());
-	    
-	    *stat -= *scores[heap.back().seg];
-	    *stat += *heap.back().first->score;
-	    scores[heap.back().seg] = heap.back().first->score;
-	    
-	    // pop and push heap...
-	    ++ heap.back().first;
-	    if (heap.back().first != heap.back().last)
-	      std::push_heap(heap.begin(), heap.end(), item_heap_compare_type());
-	    else
-	      heap.pop_back();
-	  }
+	  sweep.advance();
 	  
-	  const double segment_next = (heap.empty() ? upper_bound(segment_curr, range.second) : heap.front().first->x);
+	  const double segment_next = (sweep.empty() ? upper_bound(segment_curr, range.second) : sweep.front());
 	  
 	  // we perform merging of ranges if error counts are equal...
-	  const double score = stat->loss();
+	  const double score = sweep.loss();
 	  if (score != score_prev) {
 	    segment_prev = segment_curr;
 	    score_prev = score;
@@ -405,40 +478,21 @@ namespace cicada
 	// we assume a set of line_ptr and score_ptr pair...
 	const std::pair<double, double> range(value_min, value_max);
 
-	heap_type heap;
-	
 	if (debug >= 4)
 	  std::cerr << "minimum: " << range.first
 		    << " maximum: " << range.second
 		    << " segments: " << segments.size()
 		    << std::endl;
 	
-	score_ptr_type stat;
-	score_set_type scores(segments.size());
+	sweep_type sweep(segments);
 	
-	for (size_t seg = 0; seg != segments.size(); ++ seg)
-	  if (! segments[seg].empty()) {
-	    
-	    if (! stat)
-	      stat = segments[seg].front().score->zero();
-	    
-	    scores[seg] = segments[seg].front().score;
-	    *stat += *segments[seg].front().score;
-	    
-	    if (segments[seg].size() > 1)
-	      heap.push_back(item_type(seg, segments[seg].begin() + 1, segments[seg].end()));
-	  }
-
-	if (heap.empty())
+	if (sweep.empty())
 	  return value_type();
 	
-	// priority queue...
-	std::make_heap(heap.begin(), heap.end(), item_heap_compare_type());
+	const double score = sweep.loss();
 	
-	const double score = stat->loss();
-	
-	double optimum_lower = lower_bound(heap.front().first->x, range.first);
-	double optimum_upper = heap.front().first->x;
+	double optimum_lower = lower_bound(sweep.front(), range.first);
+	double optimum_upper = sweep.front();
 	
 	double optimum_objective = score;
 	double optimum_score = score;
@@ -454,31 +508,17 @@ namespace cicada
 		    << std::endl;
 
 	
-	while (! heap.empty()) {
-	  // next at heap...
+	while (! sweep.empty()) {
+	  // next breakpoint...
 	  
-	  const double segment_curr = heap.front().first->x;
+	  const double segment_curr = sweep.front();
 	  
-	  while (! heap.empty() && heap.front().first->x == segment_curr) { 
-	    
-	    std::pop_heap(heap.begin(), heap.end(), item_heap_compare_type());
-	    
-	    *stat -= *scores[heap.back().seg];
-	    *stat += *heap.back().first->score;
-	    scores[heap.back().seg] = heap.back().first->score;
-	    
-	    // pop and push heap...
-	    ++ heap.back().first;
-	    if (heap.back().first != heap.back().last)
-	      std::push_heap(heap.begin(), heap.end(), item_heap_compare_type());
-	    else
-	      heap.pop_back();
-	  }
+	  sweep.advance();
 	
-	  const double segment_next = (heap.empty() ? upper_bound(segment_curr, range.second) : heap.front().first->x);
+	  const double segment_next = (sweep.empty() ? upper_bound(segment_curr, range.second) : sweep.front());
 	  
 	  // we perform merging of ranges if error counts are equal...
-	  const double score = stat->loss();
+	  const double score = sweep.loss();
 	  if (score != score_prev) {
 	    segment_prev = segment_curr;
 	    score_prev = score;
@@ -532,40 +572,21 @@ namespace cicada
 	
 	const std::pair<double, double> range(value_min, value_max);
 
-	heap_type heap;
-	
 	if (debug >= 4)
 	  std::cerr << "minimum: " << range.first
 		    << " maximum: " << range.second
 		    << " segments: " << segments.size()
 		    << std::endl;
 	
-	score_ptr_type stat;
-	score_set_type scores(segments.size());
+	sweep_type sweep(segments);
 	
-	for (size_t seg = 0; seg != segments.size(); ++ seg)
-	  if (! segments[seg].empty()) {
-	    
-	    if (! stat)
-	      stat = segments[seg].front().score->zero();
-	    
-	    scores[seg] = segments[seg].front().score;
-	    *stat += *segments[seg].front().score;
-	    
-	    if (segments[seg].size() > 1)
-	      heap.push_back(item_type(seg, segments[seg].begin() + 1, segments[seg].end()));
-	  }
-
-	if (heap.empty())
+	if (sweep.empty())
 	  return value_type();
 	
-	// priority queue...
-	std::make_heap(heap.begin(), heap.end(), item_heap_compare_type());
+	const double score = sweep.loss();
 	
-	const double score = stat->loss();
-	
-	double optimum_lower = lower_bound(heap.front().first->x, range.first);
-	double optimum_upper = heap.front().first->x;
+	double optimum_lower = lower_bound(sweep.front(), range.first);
+	double optimum_upper = sweep.front();
 	
 	double optimum_objective = score + regularizer((optimum_lower + optimum_upper) * 0.5);
 	double optimum_score = score;
@@ -580,31 +601,17 @@ namespace cicada
 		    << " objective: " << optimum_objective
 		    << std::endl;
 	
-	while (! heap.empty()) {
-	  // next at heap...
+	while (! sweep.empty()) {
+	  // next breakpoint...
 	  
-	  const double segment_curr = heap.front().first->x;
+	  const double segment_curr = sweep.front();
 	  
-	  while (! heap.empty() && heap.front().first->x == segment_curr) { 
-	    
-	    std::pop_heap(heap.begin(), heap.end(), item_heap_compare_type());
-	    
-	    *stat -= *scores[heap.back().seg];
-	    *stat += *heap.back().first->score;
-	    scores[heap.back().seg] = heap.back().first->score;
-	    
-	    // pop and push heap...
-	    ++ heap.back().first;
-	    if (heap.back().first != heap.back().last)
-	      std::push_heap(heap.begin(), heap.end(), item_heap_compare_type());
-	    else
-	      heap.pop_back();
-	  }
+	  sweep.advance();
 	
-	  const double segment_next = (heap.empty() ? upper_bound(segment_curr, range.second) : heap.front().first->x);
+	  const double segment_next = (sweep.empty() ? upper_bound(segment_curr, range.second) : sweep.front());
 	  
 	  // we perform merging of ranges if error counts are equal...
-	  const double score = stat->loss();
+	  const double score = sweep.loss();
 	  if (score != score_prev) {
 	    segment_prev = segment_curr;
 	    score_prev = score;
@@ -658,40 +665,21 @@ namespace cicada
 	
 	const std::pair<double, double> range = valid_range(origin, direction);
 
-	heap_type heap;
-	
 	if (debug >= 4)
 	  std::cerr << "minimum: " << range.first
 		    << " maximum: " << range.second
 		    << " segments: " << segments.size()
 		    << std::endl;
 	
-	score_ptr_type stat;
-	score_set_type scores(segments.size());
+	sweep_type sweep(segments);
 	
-	for (size_t seg = 0; seg != segments.size(); ++ seg)
-	  if (! segments[seg].empty()) {
-	    
-	    if (! stat)
-	      stat = segments[seg].front().score->zero();
-	    
-	    scores[seg] = segments[seg].front().score;
-	    *stat += *segments[seg].front().score;
-	    
-	    if (segments[seg].size() > 1)
-	      heap.push_back(item_type(seg, segments[seg].begin() + 1, segments[seg].end()));
-	  }
-
-	if (heap.empty())
+	if (sweep.empty())
 	  return value_type();
 	
-	// priority queue...
-	std::make_heap(heap.begin(), heap.end(), item_heap_compare_type());
+	const double score = sweep.loss();
 	
-	const double score = stat->loss();
-	
-	double optimum_lower = lower_bound(heap.front().first->x, range.first);
-	double optimum_upper = heap.front().first->x;
+	double optimum_lower = lower_bound(sweep.front(), range.first);
+	double optimum_upper = sweep.front();
 	
 	double optimum_objective = score + regularizer(origin, direction, optimum_lower, optimum_upper);
 	double optimum_score = score;
@@ -707,31 +695,17 @@ namespace cicada
 		    << std::endl;
 
 	
-	while (! heap.empty()) {
-	  // next at heap...
+	while (! sweep.empty()) {
+	  // next breakpoint...
 	  
-	  const double segment_curr = heap.front().first->x;
+	  const double segment_curr = sweep.front();
 	  
-	  while (! heap.empty() && heap.front().first->x == segment_curr) { 
-	    
-	    std::pop_heap(heap.begin(), heap.end(), item_heap_compare_type());
-	    
-	    *stat -= *scores[heap.back().seg];
-	    *stat += *heap.back().first->score;
-	    scores[heap.back().seg] = heap.back().first->score;
-	    
-	    // pop and push heap...
-	    ++ heap.back().first;
-	    if (heap.back().first != heap.back().last)
-	      std::push_heap(heap.begin(), heap.end(), item_heap_compare_type());
-	    else
-	      heap.pop_back();
-	  }
+	  sweep.advance();
 	
-	  const double segment_next = (heap.empty() ? upper_bound(segment_curr, range.second) : heap.front().first->x);
+	  const double segment_next = (sweep.empty() ? upper_bound(segment_curr, range.second) : sweep.front());
 	  
 	  // we perform merging of ranges if error counts are equal...
-	  const double score = stat->loss();
+	  const double score = sweep.loss();
 	  if (score != score_prev) {
 	    segment_prev = segment_curr;
 	    score_prev = score;
@@ -9,6 +9,8 @@
 #include <cicada/semiring.hpp>
 #include <cicada/hypergraph.hpp>
 #include <cicada/inside_outside.hpp>
+#include <cicada/hypergraph_compact.hpp>
+#include <cicada/edge_score.hpp>
 
 namespace cicada
 {
@@ -30,6 +32,8 @@ namespace cicada
     
     typedef std::vector<weight_type, std::allocator<weight_type> > weight_set_type;
     
+    typedef EdgeScore<function_type> edge_score_type;
+    
     Posterior(Function __function) : function(__function), feat_posterior("posterior") {}
     Posterior(Function __function, const feature_type& __feat_posterior) : function(__function), feat_posterior(__feat_posterior) {}
     
@@ -49,8 +53,14 @@ namespace cicada
       outside.reserve(graph.nodes.size());
       outside.resize(graph.nodes.size());
       
-      cicada::inside(graph, inside, function);
-      cicada::outside(graph, inside, outside, function);
+      // inside/outside over the compact view with the edge scores computed only once
+      edge_score(graph, function, scores);
+      compact.assign(graph);
+      
+      const edge_score_type score(scores, function);
+      
+      cicada::inside(compact, inside, score);
+      cicada::outside(compact, inside, outside, score);
       
       // reassign features...
       const weight_type weight_total = inside.back();
@@ -64,7 +74,7 @@ namespace cicada
 	for (hypergraph_type::node_type::edge_set_type::const_iterator eiter = niter->edges.begin(); eiter != eiter_end; ++ eiter) {
 	  hypergraph_type::edge_type& edge = graph.edges[*eiter];
 	  
-	  weight_type weight = weight_outside * function(edge) / weight_total;
+	  weight_type weight = weight_outside * scores[edge.id] / weight_total;
 	  hypergraph_type::edge_type::node_set_type::const_iterator titer_end = edge.tails.end();
 	  for (hypergraph_type::edge_type::node_set_type::const_iterator titer = edge.tails.begin(); titer != titer_end; ++ titer)
 	    weight *= inside[*titer];
@@ -85,6 +95,9 @@ namespace cicada
     weight_set_type inside;
     weight_set_type outside;
     
+    typename edge_score_type::score_set_type scores;
+    HyperGraphCompact compact;
+    
     feature_type feat_posterior;
   };
   
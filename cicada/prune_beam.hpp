@@ -10,6 +10,7 @@
 #include <cicada/semiring.hpp>
 #include <cicada/sort_topologically.hpp>
 #include <cicada/inside_outside.hpp>
+#include <cicada/edge_score.hpp>
 
 namespace cicada
 {
@@ -25,6 +26,8 @@ namespace cicada
     typedef Function function_type;
     
     typedef typename function_type::value_type weight_type;
+
+    typedef EdgeScore<function_type> edge_score_type;
     
     typedef std::vector<bool, std::allocator<bool> > removed_type;
 
@@ -62,7 +65,15 @@ namespace cicada
       inside_type    inside(source.nodes.size());
       posterior_type posterior(source.edges.size());
       
-      inside_outside(source, inside, posterior, function, function);
+      // score edges only once, and share them among inside/outside and posterior computation
+      typename edge_score_type::score_set_type scores(source.edges.size());
+      
+      edge_score(source, function, scores);
+      
+      const edge_score_type score(scores, function);
+      const HyperGraphCompact compact(source);
+      
+      inside_outside(compact, inside, posterior, score, score);
       
       // compute max...
       weight_type posterior_max;
@@ -11,6 +11,7 @@
 #include <cicada/sort_topologically.hpp>
 #include <cicada/viterbi.hpp>
 #include <cicada/inside_outside.hpp>
+#include <cicada/edge_score.hpp>
 
 namespace cicada
 {
@@ -27,6 +28,8 @@ namespace cicada
     typedef Function function_type;
     
     typedef typename function_type::value_type weight_type;
+
+    typedef EdgeScore<function_type> edge_score_type;
     
     typedef std::vector<bool, std::allocator<bool> > removed_type;
 
@@ -91,12 +94,20 @@ namespace cicada
       inside_type    inside(source.nodes.size());
       posterior_type posterior(source.edges.size());
       
-      inside_outside(source, inside, posterior, function, function);
+      // score edges only once, and share them among inside/outside and posterior computation
+      typename edge_score_type::score_set_type scores(source.edges.size());
+      
+      edge_score(source, function, scores);
+      
+      const edge_score_type score(scores, function);
+      const HyperGraphCompact compact(source);
+      
+      inside_outside(compact, inside, posterior, score, score);
       
       weight_type viterbi_weight;
       typename traversal::value_type viterbi_derivation;
       
-      viterbi(source, viterbi_derivation, viterbi_weight, traversal(posterior), function);
+      viterbi(source, viterbi_derivation, viterbi_weight, traversal(posterior), score);
       
       const size_t prune_size = static_cast<size_t>(threshold * viterbi_derivation.first);
       
@@ -16,6 +16,9 @@ namespace cicada
       // Max operation... but we will simply perform addition, then hope for sort happen...
       
       if (! x.is_sorted) const_cast<Envelope&>(x).sort();
+      
+      if (! pool)
+	pool = x.pool;
 
       if (lines.empty()) {
 	lines = x.lines;
@@ -48,12 +51,22 @@ namespace cicada
       }
 #endif
       
+      if (! pool)
+	pool = x.pool;
+      
+      // without pool, both are either the zero or the one
+      if (! pool) {
+	if (x.lines.empty())
+	  lines.clear();
+	return *this;
+      }
+      
       if (! is_sorted)   const_cast<Envelope&>(*this).sort();
       if (! x.is_sorted) const_cast<Envelope&>(x).sort();
       
       // we have an object created by weight function...
       if (lines.size() == 1 && lines.front()->edge) {
-	line_ptr_type line_edge_ptr(lines.front());
+	const line_ptr_type line_edge_ptr(lines.front());
 	const line_type& line_edge = *line_edge_ptr;
 	
 	lines.clear();
@@ -61,18 +74,19 @@ namespace cicada
 	for (line_ptr_set_type::const_iterator liter = x.lines.begin(); liter != liter_end; ++ liter) {
 	  const line_type& line = *(*liter);
 	  
-	  // no update to x...
-	  const double& x = line_edge.x;
+	  // adding a line does not move the breakpoints of x...
+	  const double& x = line.x;
 	  const double y  = line_edge.y + line.y;
 	  const double m  = line_edge.m + line.m;
 	  
-	  lines.push_back(line_ptr_type(new line_type(x, m, y, line_edge_ptr, *liter)));
+	  lines.push_back(pool->allocate(line_type(x, m, y, line_edge_ptr, *liter)));
 	}
 	
       } else {
 	static const double infinity = std::numeric_limits<double>::infinity();
 
 	line_ptr_set_type L;
+	L.reserve(lines.size() + x.lines.size());
 	
 	line_ptr_set_type::const_iterator iter1 = lines.begin();
 	line_ptr_set_type::const_iterator iter1_end = lines.end();
@@ -91,7 +105,7 @@ namespace cicada
 	  const double y = line1.y + line2.y;
 	  const double m = line1.m + line2.m;
 	  
-	  L.push_back(line_ptr_type(new line_type(x_curr, m, y, *iter1, *iter2)));
+	  L.push_back(pool->allocate(line_type(x_curr, m, y, *iter1, *iter2)));
 	  
 	  if (x_next1 < x_next2) {
 	    ++ iter1;
@@ -121,7 +135,7 @@ namespace cicada
     template <typename Line>
     struct compare_slope
     {
-      bool operator()(const boost::shared_ptr<Line>& x, const boost::shared_ptr<Line>& y) const
+      bool operator()(const Line* x, const Line* y) const
       {
 	return x->m < y->m;
       }
@@ -130,32 +144,44 @@ namespace cicada
     void Envelope::sort()
     {
       if (is_sorted) return;
+      
+      // a single line is always the upper envelope, and may be the shared one
+      if (lines.size() <= 1) {
+	is_sorted = true;
+	return;
+      }
 
       std::sort(lines.begin(), lines.end(), compare_slope<line_type>());
       
+      // in-place sweep: the lines on the envelope are compacted to the front, and only their x are updated
       int j = 0;
       int K = lines.size();
       
       for (int i = 0; i < K; ++ i) {
-	line_type line = *lines[i];
-	line.x = - std::numeric_limits<double>::infinity();
+	line_ptr_type line = lines[i];
+	double x = - std::numeric_limits<double>::infinity();
 	
 	if (0 < j) {
-	  if (lines[j - 1]->m == line.m) { // parallel line...
-	    if (line.y <= lines[j - 1]->y) continue;
+	  if (lines[j - 1]->m == line->m) { // parallel line...
+	    if (line->y <= lines[j - 1]->y) continue;
 	    -- j;
 	  }
 	  while (0 < j) {
-	    line.x = (line.y - lines[j - 1]->y) / (lines[j - 1]->m - line.m);
-	    if (lines[j - 1]->x < line.x) break;
+	    x = (line->y - lines[j - 1]->y) / (lines[j - 1]->m - line->m);
+	    if (lines[j - 1]->x < x) break;
 	    -- j;
 	  }
 	  
 	  if (0 == j)
-	    line.x = - std::numeric_limits<double>::infinity();
+	    x = - std::numeric_limits<double>::infinity();
 	}
 	
-	*lines[j++] = line;
+	// the one is shared among envelopes, thus, copy it before updating
+	if (line->x != x && line == one_line())
+	  line = pool->allocate(*line);
+	
+	line->x = x;
+	lines[j++] = line;
       }
       
       lines.resize(j);
@@ -30,7 +30,7 @@
 
 #include <utils/simple_vector.hpp>
 
-#include <boost/shared_ptr.hpp>
+#include <boost/utility.hpp>
 
 namespace cicada
 {
@@ -43,17 +43,19 @@ namespace cicada
       typedef cicada::HyperGraph hypergraph_type;
       
     public:
+      // lines are not reference counted: a line is allocated from a LinePool, and refers to its parent and antecedent
+      // by plain pointers, which are valid until the pool is cleared.
       struct Line
       {
 	typedef Line line_type;
-	typedef boost::shared_ptr<line_type>  line_ptr_type;
+	typedef line_type* line_ptr_type;
 	
 	Line()
-	  : x(0.0), m(0.0), y(0.0), edge(0) {}
+	  : x(0.0), m(0.0), y(0.0), edge(0), parent(0), antecedent(0) {}
 	Line(const double& __m, const double& __y, const hypergraph_type::edge_type& __edge)
-	  : x(- std::numeric_limits<double>::infinity()), m(__m), y(__y), edge(&__edge) {}
+	  : x(- std::numeric_limits<double>::infinity()), m(__m), y(__y), edge(&__edge), parent(0), antecedent(0) {}
 	Line(const double& __x, const double& __m, const double& __y)
-	  : x(__x), m(__m), y(__y), edge(0) {}
+	  : x(__x), m(__m), y(__y), edge(0), parent(0), antecedent(0) {}
 	Line(const double& __x, const double& __m, const double& __y, const line_ptr_type& __parent, const line_ptr_type& __antecedent)
 	  : x(__x), m(__m), y(__y), edge(0), parent(__parent), antecedent(__antecedent) {}
 	
@@ -79,7 +81,7 @@ namespace cicada
 	  while (! curr->edge) {
 	    yields.push_back(curr->antecedent->yield(traversal));
 	    
-	    curr = curr->parent.get();
+	    curr = curr->parent;
 	  }
 	  
 	  yield_type __yield;
@@ -91,14 +93,59 @@ namespace cicada
       };
       
       typedef Line line_type;
-      typedef boost::shared_ptr<line_type>  line_ptr_type;
+      typedef line_type* line_ptr_type;
       typedef std::vector<line_ptr_type, std::allocator<line_ptr_type> > line_ptr_set_type;
 
       typedef line_ptr_set_type::const_iterator const_iterator;
+      
+      // an arena of lines for a forest. Lines are carved out of fixed size chunks, and clear() releases all the lines
+      // at once, i.e. after the envelope of a sentence is computed, while keeping the chunks for the next sentence.
+      struct LinePool : private boost::noncopyable
+      {
+	typedef std::vector<line_type*, std::allocator<line_type*> > chunk_set_type;
+	
+	static const size_t chunk_size = 1024 * 4;
+	
+	LinePool() : chunks(), chunk(0), pos(chunk_size) {}
+	~LinePool()
+	{
+	  for (chunk_set_type::const_iterator citer = chunks.begin(); citer != chunks.end(); ++ citer)
+	    delete [] *citer;
+	}
+	
+	line_ptr_type allocate(const line_type& line)
+	{
+	  if (pos == chunk_size) {
+	    if (chunk == chunks.size())
+	      chunks.push_back(new line_type[chunk_size]);
+	    
+	    ++ chunk;
+	    pos = 0;
+	  }
+	  
+	  line_ptr_type ptr = chunks[chunk - 1] + pos;
+	  ++ pos;
+	  
+	  *ptr = line;
+	  return ptr;
+	}
+	
+	void clear()
+	{
+	  chunk = 0;
+	  pos = chunk_size;
+	}
+	
+	chunk_set_type chunks;
+	size_t chunk;
+	size_t pos;
+      };
+      
+      typedef LinePool line_pool_type;
 
     public:      
-      Envelope() : lines(), is_sorted(true) {}
-      Envelope(const line_ptr_type& line) : lines(1, line), is_sorted(true) {}
+      Envelope() : lines(), pool(0), is_sorted(true) {}
+      Envelope(const line_ptr_type& line, line_pool_type& __pool) : lines(1, line), pool(&__pool), is_sorted(true) {}
       
     public:
       const Envelope& operator+=(const Envelope& x);
@@ -110,8 +157,23 @@ namespace cicada
       
       void sort();
       
+    private:
+      // the identity, which is not allocated from any pool
+      struct one_type {};
+      
+      explicit Envelope(one_type) : lines(1, one_line()), pool(0), is_sorted(true) {}
+      
+      static line_ptr_type one_line()
+      {
+	static line_type __one(- std::numeric_limits<double>::infinity(), 0.0, 0.0);
+	return &__one;
+      }
+      
+      friend struct traits<Envelope>;
+      
     private:
       line_ptr_set_type lines;
+      line_pool_type*   pool;
       bool is_sorted;
     };
 
@@ -123,9 +185,12 @@ namespace cicada
       typedef Envelope envelope_type;
       typedef envelope_type::line_type line_type;
       
+      typedef envelope_type::line_pool_type line_pool_type;
+      
       EnvelopeFunction(const feature_set_type& __origin,
-		       const feature_set_type& __direction)
-	: origin(__origin), direction(__direction) {}
+		       const feature_set_type& __direction,
+		       line_pool_type& __pool)
+	: origin(__origin), direction(__direction), pool(__pool) {}
       
       template <typename Edge>
       Envelope operator()(const Edge& edge) const
@@ -133,18 +198,19 @@ namespace cicada
 	const double m = cicada::dot_product(edge.features, direction);
 	const double y = cicada::dot_product(edge.features, origin);
 	
-	return Envelope(boost::shared_ptr<line_type>(new line_type(m, y, edge)));
+	return Envelope(pool.allocate(line_type(m, y, edge)), pool);
       }
       
       const feature_set_type& origin;
       const feature_set_type& direction;
+      line_pool_type&         pool;
     };
     
     template <>
     struct traits<Envelope>
     {
       static inline Envelope zero() { return Envelope();  }
-      static inline Envelope one()  { return Envelope(boost::shared_ptr<Envelope::line_type>(new Envelope::line_type())); }
+      static inline Envelope one()  { return Envelope(Envelope::one_type()); }
     };
 
   };
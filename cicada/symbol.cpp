@@ -19,6 +19,7 @@
 #include <utils/thread_specific_ptr.hpp>
 #include <utils/simple_vector.hpp>
 #include <utils/array_power2.hpp>
+#include <utils/intern_cache.hpp>
 
 #include "symbol.hpp"
 
@@ -96,6 +97,11 @@ namespace cicada
 
 
 
+  Symbol::id_type Symbol::__allocate(const piece_type& x)
+  {
+    return utils::intern_cache<Symbol, symbol_type, id_type>::intern(x, __index(), __symbols(), __mutex);
+  }
+
   Symbol::symbol_map_type& Symbol::__symbol_maps()
   {
     return symbol_impl::instance().symbol_maps;
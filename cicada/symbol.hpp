@@ -209,22 +209,8 @@ namespace cicada
       return __id;
     }
     
-    static id_type __allocate(const piece_type& x)
-    {
-      ticket_type::scoped_writer_lock lock(__mutex);
-
-      symbol_index_type& index = __index();
-      
-      std::pair<symbol_index_type::iterator, bool> result = index.insert(x);
-      
-      if (result.second) {
-	symbol_set_type& symbols = __symbols();
-	symbols.push_back(x);
-	const_cast<piece_type&>(*result.first) = symbols.back();
-      }
-      
-      return result.first - index.begin();
-    }
+    // lookup is lock-free for the symbols cached by each thread, and we take the writer lock only when inserting
+    static id_type __allocate(const piece_type& x);
     
   private:
     id_type __id;
@@ -8,10 +8,15 @@
 
 #include <iostream>
 
+#include <vector>
+#include <string>
+
 #include <boost/lexical_cast.hpp>
 #include <boost/type_traits.hpp>
+#include <boost/thread.hpp>
 
 #include "utils/random_seed.hpp"
+#include "utils/resource.hpp"
 
 #include "symbol.hpp"
 
@@ -19,6 +24,51 @@
 
 #include "msgpack_main_impl.hpp"
 
+// contention benchmark: threads intern the same strings, most of which are already interned
+typedef std::vector<std::string, std::allocator<std::string> > word_set_type;
+
+struct Intern
+{
+  Intern(const word_set_type& __words) : words(__words), checksum(0) {}
+  
+  void operator()()
+  {
+    for (int iter = 0; iter != 64; ++ iter)
+      for (word_set_type::const_iterator witer = words.begin(); witer != words.end(); ++ witer)
+	checksum += cicada::Symbol(*witer).id();
+  }
+  
+  const word_set_type& words;
+  size_t checksum;
+};
+
+void contention(const word_set_type& words)
+{
+  typedef std::vector<Intern, std::allocator<Intern> > intern_set_type;
+  
+  for (int threads = 1; threads <= 32; threads *= 2) {
+    intern_set_type interns(threads, Intern(words));
+    
+    utils::resource start;
+    
+    boost::thread_group workers;
+    for (int i = 0; i != threads; ++ i)
+      workers.add_thread(new boost::thread(boost::ref(interns[i])));
+    workers.join_all();
+    
+    utils::resource end;
+    
+    bool consistent = true;
+    for (int i = 1; i != threads; ++ i)
+      consistent &= (interns[i].checksum == interns.front().checksum);
+    
+    std::cerr << "threads: " << threads
+	      << " symbols/second: " << (64.0 * words.size() * threads) / (end.user_time() - start.user_time())
+	      << " consistent? " << consistent
+	      << std::endl;
+  }
+}
+
 void process(const cicada::Symbol& x, int index)
 {
   std::cout << x << ' ' << index << std::endl
@@ -87,9 +137,18 @@ int main(int argc, char** argv)
 
   srandom(utils::random_seed());
 
+  word_set_type words;
   for (int i = 0; i != 1024 * 4; ++ i) {
     const std::string rnd = boost::lexical_cast<std::string>(random());
     
     symbol_type symbol(rnd);
+    
+    words.push_back(rnd);
   }
+  
+  // a few new symbols are inserted while interning
+  for (int i = 0; i != 64; ++ i)
+    words.push_back(boost::lexical_cast<std::string>(random()));
+  
+  contention(words);
 }
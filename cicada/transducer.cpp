@@ -2,9 +2,11 @@
 //  Copyright(C) 2010-2012 Taro Watanabe <taro.watanabe@nict.go.jp>
 //
 
+#include <cstdio>
 #include <stdexcept>
 #include <iterator>
 #include <iostream>
+#include <sstream>
 
 #include <cicada/transducer.hpp>
 #include <cicada/grammar_format.hpp>
@@ -21,6 +23,8 @@
 
 #include "utils/lexical_cast.hpp"
 #include "utils/compress_stream.hpp"
+#include "utils/hashmurmur3.hpp"
+#include "utils/tempfile.hpp"
 #include "utils/spinlock.hpp"
 #include "utils/unordered_map.hpp"
 #include "utils/thread_specific_ptr.hpp"
@@ -34,6 +38,9 @@ file-name: indexed grammar or plain text grammar\n\
 \tmax-span=[int] maximum span (<=0 for no-constraint)\n\
 \tkey-value=[true|false] store key-value format of features/attributes\n\
 \tpopulate=[true|false] \"populate\" by pre-fetching\n\
+\tcache=[directory] compile a plain text grammar into an indexed grammar under directory, and reuse it\n\
+\tcache-shared=[true|false] share the rule cache of an indexed grammar among threads\n\
+\tcache-size=[int] # of rule sets in the shared cache (default: 65536)\n\
 \tfeature-prefix=[prefix for feature name] add prefix to the default feature name: rule-table\n\
 \tattribute-prefix=[prefix for attribute name] add prefix to the default attribute name: rule-table\n\
 \tfeature0=[feature-name]\n\
@@ -81,6 +88,82 @@ format: ICU's number/date format rules\n\
     static transducer_map_type __transducer_map;
   };
   
+  // compile cache for plain text grammars: the text grammar is compiled into a GrammarStatic image under the cache directory,
+  // keyed by the file name, the file size, the last modification time and the parameters affecting the rules.
+  // Later runs simply memory-map the image.
+  static Transducer::transducer_ptr_type grammar_cache(const Parameter& param, const boost::filesystem::path& cache)
+  {
+    typedef cicada::Parameter parameter_type;
+    typedef boost::filesystem::path path_type;
+    
+    const path_type path = param.name();
+    
+#if BOOST_FILESYSTEM_VERSION == 2
+    const path_type path_absolute = boost::filesystem::complete(path);
+#else
+    const path_type path_absolute = boost::filesystem::absolute(path);
+#endif
+    
+    // parameters for the text grammar and for the compiled grammar
+    parameter_type param_text;
+    parameter_type param_static;
+    
+    param_text.name() = param.name();
+    
+    std::ostringstream os_key;
+    os_key << path_absolute.string()
+	   << ' ' << boost::filesystem::file_size(path)
+	   << ' ' << boost::filesystem::last_write_time(path);
+    
+    for (parameter_type::const_iterator piter = param.begin(); piter != param.end(); ++ piter) {
+      if (utils::ipiece(piter->first) == "cache") continue;
+      
+      param_text.push_back(*piter);
+      
+      if (utils::ipiece(piter->first) == "max-span"
+	  || utils::ipiece(piter->first) == "populate"
+	  || utils::ipiece(piter->first) == "cache-shared"
+	  || utils::ipiece(piter->first) == "cache-size"
+	  || utils::ipiece(piter->first) == "debug")
+	param_static.push_back(*piter);
+      else
+	os_key << ' ' << piter->first << '=' << piter->second;
+    }
+    
+    const std::string key = os_key.str();
+    
+    std::ostringstream os_name;
+    os_name << "grammar." << std::hex << utils::hashmurmur3<size_t>()(key.begin(), key.end(), 0);
+    
+    const path_type path_cache = cache / os_name.str();
+    
+    if (! boost::filesystem::exists(path_cache)) {
+      if (! boost::filesystem::exists(cache))
+	boost::filesystem::create_directories(cache);
+      
+      // compile into a temporary directory, then, rename, so that concurrent runs will not see a partial image
+      const path_type path_tmp = utils::tempfile::directory_name(cache / "grammar.XXXXXX");
+      
+      utils::tempfile::insert(path_tmp);
+      
+      GrammarMutable(utils::lexical_cast<std::string>(param_text)).write(path_tmp);
+      
+      if (::rename(path_tmp.string().c_str(), path_cache.string().c_str()) != 0) {
+	// someone else compiled the same grammar
+	if (! boost::filesystem::exists(path_cache))
+	  throw std::runtime_error("grammar cache failure: " + path_cache.string());
+	
+	boost::filesystem::remove_all(path_tmp);
+      }
+      
+      utils::tempfile::erase(path_tmp);
+    }
+    
+    param_static.name() = path_cache.string();
+    
+    return Transducer::transducer_ptr_type(new GrammarStatic(utils::lexical_cast<std::string>(param_static)));
+  }
+  
 #ifdef HAVE_TLS
   static __thread transducer_map_type* __transducers_tls = 0;
   static utils::thread_specific_ptr<transducer_map_type> __transducers;
@@ -287,9 +370,13 @@ format: ICU's number/date format rules\n\
 	  if (path != "-" && ! boost::filesystem::exists(path))
 	    throw std::runtime_error("invalid parameter: " + parameter);
 	  
+	  parameter_type::const_iterator citer = param.find("cache");
+	  
 	  transducer_ptr_type ptr;
 	  if (path != "-" && boost::filesystem::is_directory(path))
 	    ptr.reset(new GrammarStatic(parameter));
+	  else if (path != "-" && citer != param.end())
+	    ptr = grammar_cache(param, citer->second);
 	  else
 	    ptr.reset(new GrammarShared(parameter));
 	  
@@ -225,7 +225,9 @@ namespace cicada
       } else if (utils::ipiece(piter->first) == "attribute-prefix") {
 	attribute_prefix = piter->second;
 	continue;
-      } else if (utils::ipiece(piter->first) == "populate")
+      } else if (utils::ipiece(piter->first) == "populate"
+		 || utils::ipiece(piter->first) == "cache-shared"
+		 || utils::ipiece(piter->first) == "cache-size")
 	continue;
 
       {
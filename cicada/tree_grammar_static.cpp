@@ -41,6 +41,7 @@
 #include "utils/unordered_map.hpp"
 #include "utils/hashmurmur.hpp"
 #include "utils/hashmurmur3.hpp"
+#include "utils/striped_cache.hpp"
 #include "utils/getline.hpp"
 
 #include <boost/lexical_cast.hpp>
@@ -279,9 +280,15 @@ namespace cicada
     typedef std::vector<score_set_type, std::allocator<score_set_type> > score_db_type;
     
     // caching...
-    typedef utils::arc_list<size_type, rule_pair_set_type, 4,
+    typedef boost::shared_ptr<const rule_pair_set_type> rule_pair_set_ptr_type;
+    
+    typedef utils::arc_list<size_type, rule_pair_set_ptr_type, 4,
 			    std::equal_to<size_type>,
-			    std::allocator<std::pair<size_type, rule_pair_set_type> > > cache_rule_pair_set_type;
+			    std::allocator<std::pair<size_type, rule_pair_set_ptr_type> > > cache_rule_pair_set_type;
+    
+    // the rule sets shared among clones
+    typedef utils::striped_cache<size_type, rule_pair_set_type> cache_shared_type;
+    typedef boost::shared_ptr<cache_shared_type>               cache_shared_ptr_type;
     
     struct cache_rule_type
     {
@@ -306,7 +313,7 @@ namespace cicada
     
     typedef std::vector<size_type, std::allocator<size_type> > cache_root_type;
 
-    TreeGrammarStaticImpl(const std::string& parameter) : cky(false), max_span(0), debug(0) { read(parameter); }
+    TreeGrammarStaticImpl(const std::string& parameter) : cky(false), cache_hit(0), cache_miss(0), max_span(0), debug(0) { read(parameter); }
     TreeGrammarStaticImpl(const TreeGrammarStaticImpl& x)
       : edge_db(x.edge_db), 
 	rule_db(x.rule_db),
@@ -322,6 +329,9 @@ namespace cicada
 	feature_names(x.feature_names),
 	attribute_names(x.attribute_names),
 	cky(x.cky),
+	cache_shared(x.cache_shared),
+	cache_hit(0),
+	cache_miss(0),
 	max_span(x.max_span),
 	debug(x.debug) {}
 
@@ -343,6 +353,7 @@ namespace cicada
       feature_names = x.feature_names;
       attribute_names = x.attribute_names;
       cky = x.cky;
+      cache_shared = x.cache_shared;
       max_span = x.max_span;
       debug = x.debug;
       
@@ -375,6 +386,10 @@ namespace cicada
       cache_nodes.clear();
 
       cache_root.clear();
+      
+      cache_shared.reset();
+      cache_hit  = 0;
+      cache_miss = 0;
 
       max_span = 0;
     }
@@ -502,11 +517,25 @@ namespace cicada
       cache_rule_pair_set_type& cache = const_cast<cache_rule_pair_set_type&>(cache_rule[cache_pos]);
       
       std::pair<cache_rule_pair_set_type::iterator, bool> result = cache.find(node);
-      if (! result.second) {
+      if (result.second) {
+	++ const_cast<size_type&>(cache_hit);
+	return *result.first->second;
+      }
+      
+      result.first->second.reset();
+      if (cache_shared)
+	result.first->second = cache_shared->find(node);
+      
+      if (result.first->second)
+	++ const_cast<size_type&>(cache_hit);
+      else {
 	typedef utils::piece  code_set_type;
-
-	rule_pair_set_type& options = result.first->second;
-	options.clear();
+	
+	++ const_cast<size_type&>(cache_miss);
+	
+	boost::shared_ptr<rule_pair_set_type> options_ptr(new rule_pair_set_type());
+	
+	rule_pair_set_type& options = *options_ptr;
 	
 	rule_pair_db_type::cursor cursor_end = rule_db.cend(node);
 	for (rule_pair_db_type::cursor cursor = rule_db.cbegin(node); cursor != cursor_end; ++ cursor) {
@@ -589,9 +618,14 @@ namespace cicada
 	}
 	
 	rule_pair_set_type(options).swap(options);
+	
+	result.first->second = options_ptr;
+	
+	if (cache_shared)
+	  cache_shared->insert(node, result.first->second);
       }
       
-      return result.first->second;
+      return *result.first->second;
     }
 
   private:
@@ -686,8 +720,13 @@ namespace cicada
     cache_node_set_type      cache_nodes;
 
     cache_root_type cache_root;
+    
+    cache_shared_ptr_type cache_shared;
 
   public:
+    size_type cache_hit;
+    size_type cache_miss;
+    
     int max_span;
     int debug;
   };
@@ -1051,6 +1090,15 @@ namespace cicada
     parameter_type::const_iterator piter = param.find("populate");
     if (piter != param.end() && utils::lexical_cast<bool>(piter->second))
       populate();
+    
+    size_type cache_size = 1024 * 64;
+    parameter_type::const_iterator citer = param.find("cache-size");
+    if (citer != param.end())
+      cache_size = utils::lexical_cast<size_type>(citer->second);
+    
+    parameter_type::const_iterator hiter = param.find("cache-shared");
+    if (hiter != param.end() && utils::lexical_cast<bool>(hiter->second))
+      cache_shared.reset(new cache_shared_type(cache_size));
   }
 
   
@@ -2288,6 +2336,12 @@ namespace cicada
 
   
   
+  void TreeGrammarStatic::cache_statistics(size_type& hit, size_type& miss) const
+  {
+    hit  += pimpl->cache_hit;
+    miss += pimpl->cache_miss;
+  }
+  
   void TreeGrammarStatic::quantize()
   {
     pimpl->quantize();
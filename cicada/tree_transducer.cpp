@@ -30,6 +30,8 @@ file-name: indexed tree grammar or plain text tree grammar\n\
 \tcky|cyk=[true|false] indexing for CKY|CYK parsing/composition\n\
 \tkey-value=[true|false] store key-value format of features/attributes\n\
 \tpopulate=[true|false] \"populate\" by pre-fetching\n\
+\tcache-shared=[true|false] share the rule cache of an indexed grammar among threads\n\
+\tcache-size=[int] # of rule sets in the shared cache (default: 65536)\n\
 \tfeature-prefix=[prefix for feature name] add prefix to the default feature name: tree-rule-table\n\
 \tattribute-prefix=[prefix for attribute name] add prefix to the default attribute name: tree-rule-table\n\
 \tfeature0=[feature-name]\n\
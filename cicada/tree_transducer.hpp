@@ -113,6 +113,9 @@ namespace cicada
     virtual void assign(const lattice_type& lattice) {}
     virtual void assign(const hypergraph_type& hypergraph) {}
     
+    // accumulate the # of hits/misses of the rule cache
+    virtual void cache_statistics(size_type& hit, size_type& miss) const {}
+    
   public:
     static const char* lists();
     static transducer_ptr_type create(const utils::piece& parameter);
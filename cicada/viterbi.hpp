@@ -9,17 +9,26 @@
 #include <vector>
 
 #include <cicada/hypergraph.hpp>
+#include <cicada/hypergraph_compact.hpp>
+#include <cicada/edge_score.hpp>
 
 #include <cicada/semiring/traits.hpp>
 
 namespace cicada
 {
   // I tried semiring based implementation, but ended-up with specific function...
+  //
+  // The max-product runs over the compact view of the graph with the edge scores computed once,
+  // and keeps the best incoming edge of each node. Then, the traversal is performed only for the
+  // nodes along the best derivation, with the original edges so that rules etc. are accessible.
 
   template <typename Traversal, typename Function>
   struct Viterbi
   {
-    typedef HyperGraph hypergraph_type;
+    typedef HyperGraph        hypergraph_type;
+    typedef HyperGraphCompact compact_type;
+
+    typedef hypergraph_type::id_type id_type;
 
     typedef Traversal traversal_type;
     typedef Function  function_type;
@@ -30,6 +39,8 @@ namespace cicada
 
     typedef std::vector<weight_type, std::allocator<weight_type> > weight_set_type;
     typedef std::vector<yield_type, std::allocator<yield_type> >   derivation_set_type;
+    typedef std::vector<id_type, std::allocator<id_type> >         edge_set_type;
+    typedef std::vector<bool, std::allocator<bool> >               reachable_set_type;
     
     typedef Viterbi<Traversal, Function> self_type;
 
@@ -39,11 +50,15 @@ namespace cicada
       : traversal(__traversal),
 	function(__function),
 	graph(__graph),
+	compact(__graph),
 	weights(__graph.nodes.size()),
-	derivations(__graph.nodes.size())
+	derivations(__graph.nodes.size()),
+	bests(__graph.nodes.size(), id_type(hypergraph_type::invalid))
     {
       if (graph.goal == hypergraph_type::invalid)
 	throw std::runtime_error("invalid hypergraph...");
+      
+      edge_score(graph, function, scores);
     }
     
     friend struct Iterator;
@@ -150,34 +165,62 @@ namespace cicada
     {
       // k is simply a dummy...
       
-      yield_set_type yields;
-      
-      hypergraph_type::node_set_type::const_iterator niter_end = graph.nodes.end();
-      for (hypergraph_type::node_set_type::const_iterator niter = graph.nodes.begin(); niter != niter_end; ++ niter) {
-	const hypergraph_type::node_type& node = *niter;
-      
-	hypergraph_type::node_type::edge_set_type::const_iterator eiter_end = node.edges.end();
-	for (hypergraph_type::node_type::edge_set_type::const_iterator eiter = node.edges.begin(); eiter != eiter_end; ++ eiter) {
-	  const hypergraph_type::edge_type& edge = graph.edges[*eiter];
-	
-	  weight_type score = function(edge);
-	  yields.clear();
+      // max-product over the compact view
+      compact_type::node_set_type::const_iterator niter_end = compact.nodes.end();
+      for (compact_type::node_set_type::const_iterator niter = compact.nodes.begin(); niter != niter_end; ++ niter) {
+	const compact_type::node_type& node = *niter;
 	
+	compact_type::node_type::edge_set_type::const_iterator eiter_end = node.edges.end();
+	for (compact_type::node_type::edge_set_type::const_iterator eiter = node.edges.begin(); eiter != eiter_end; ++ eiter) {
+	  const compact_type::edge_type& edge = compact.edges[*eiter];
+	  
+	  weight_type score = scores[edge.id];
+	  
 	  // *=
-	  hypergraph_type::edge_type::node_set_type::const_iterator niter_end = edge.tails.end();
-	  for (hypergraph_type::edge_type::node_set_type::const_iterator niter = edge.tails.begin(); niter != niter_end; ++ niter) {
-	    score *= weights[*niter];
-	    yields.push_back(&derivations[*niter]);
-	  }
+	  compact_type::edge_type::node_set_type::const_iterator titer_end = edge.tails.end();
+	  for (compact_type::edge_type::node_set_type::const_iterator titer = edge.tails.begin(); titer != titer_end; ++ titer)
+	    score *= weights[*titer];
 	  
 	  // +=
 	  if (score > weights[node.id]) {
 	    weights[node.id] = score;
-	    traversal(edge, derivations[node.id], yield_iterator(yields.begin()), yield_iterator(yields.end()));
+	    bests[node.id] = edge.id;
 	  }
 	}
       }
       
+      // collect the nodes along the best derivation. tails always precede their head.
+      reachable_set_type reachable(compact.nodes.size(), false);
+      reachable.back() = true;
+      
+      for (id_type id = compact.nodes.size(); id != 0; -- id) {
+	const id_type node_id = id - 1;
+	
+	if (! reachable[node_id] || bests[node_id] == id_type(hypergraph_type::invalid)) continue;
+	
+	const compact_type::edge_type& edge = compact.edges[bests[node_id]];
+	
+	compact_type::edge_type::node_set_type::const_iterator titer_end = edge.tails.end();
+	for (compact_type::edge_type::node_set_type::const_iterator titer = edge.tails.begin(); titer != titer_end; ++ titer)
+	  reachable[*titer] = true;
+      }
+      
+      // traversal in topological order
+      yield_set_type yields;
+      
+      for (id_type node_id = 0; node_id != compact.nodes.size(); ++ node_id) {
+	if (! reachable[node_id] || bests[node_id] == id_type(hypergraph_type::invalid)) continue;
+	
+	const hypergraph_type::edge_type& edge = graph.edges[bests[node_id]];
+	
+	yields.clear();
+	hypergraph_type::edge_type::node_set_type::const_iterator titer_end = edge.tails.end();
+	for (hypergraph_type::edge_type::node_set_type::const_iterator titer = edge.tails.begin(); titer != titer_end; ++ titer)
+	  yields.push_back(&derivations[*titer]);
+	
+	traversal(edge, derivations[node_id], yield_iterator(yields.begin()), yield_iterator(yields.end()));
+      }
+      
       yield = derivations.back();
       weight = weights.back();
 
@@ -189,9 +232,12 @@ namespace cicada
     const function_type  function;
     
     const hypergraph_type& graph;
+    const compact_type     compact;
     
+    weight_set_type     scores;
     weight_set_type     weights;
     derivation_set_type derivations;
+    edge_set_type       bests;
   };
 
   template <typename Traversal, typename Function>
@@ -27,6 +27,8 @@
 #include "utils/bithack.hpp"
 #include "utils/random_seed.hpp"
 #include "utils/getline.hpp"
+#include "utils/resource.hpp"
+#include "utils/arena_allocator.hpp"
 
 #include <boost/program_options.hpp>
 #include <boost/thread.hpp>
@@ -69,6 +71,8 @@ bool tokenizer_list = false;
 bool matcher_list = false;
 
 int threads = 1;
+int compress_threads = 0;
+int schedule_window = 0;
 
 int debug = 0;
 
@@ -135,6 +139,9 @@ int main(int argc, char ** argv)
     
     threads = utils::bithack::max(1, threads);
 
+    if (compress_threads > 0)
+      utils::compress_stream_threads(compress_threads);
+
     // random number seed
     ::srandom(utils::random_seed());
     
@@ -228,6 +235,38 @@ struct MapReduceFile
   
   typedef utils::lockfree_list_queue<std::string, std::allocator<std::string> > queue_is_type;
   typedef utils::lockfree_list_queue<id_buffer_type, std::allocator<id_buffer_type> > queue_os_type;
+  
+  typedef std::vector<double, std::allocator<double> > latency_set_type;
+
+  // # of outputs dumped so far by the reducer, which bounds the read-ahead of the scheduler
+  struct reduced_type
+  {
+    typedef boost::mutex              mutex_type;
+    typedef boost::condition_variable condition_type;
+    typedef boost::mutex::scoped_lock lock_type;
+    
+    reduced_type() : id(0) {}
+    
+    void assign(const id_type& __id)
+    {
+      {
+	lock_type lock(mutex);
+	id = __id;
+      }
+      cond.notify_all();
+    }
+    
+    void wait(const id_type& __id)
+    {
+      lock_type lock(mutex);
+      while (__id > id)
+	cond.wait(lock);
+    }
+    
+    mutex_type     mutex;
+    condition_type cond;
+    id_type        id;
+  };
 };
 
 namespace std
@@ -254,6 +293,9 @@ struct TaskFile : public MapReduceFile
   
   void operator()()
   {
+    // temporaries of the algorithms are allocated from the arena, reset for each sentence
+    utils::arena arena;
+    
     // cloning should be performed in thread... otherwise, strangething may happen
     const model_type        model(_model.clone());
     const grammar_type      grammar(_grammar.clone());
@@ -288,11 +330,22 @@ struct TaskFile : public MapReduceFile
 	
 	utils::compress_istream is(file, 1024 * 1024);
 	
-	if (utils::getline(is, line) && ! line.empty())
+	utils::resource start;
+	
+	if (utils::getline(is, line) && ! line.empty()) {
+	  utils::arena::scoped_type scoped(arena);
+	  
 	  operations(line);
-	else
+	  
+	  // the hypergraph may be allocated from the arena
+	  const_cast<operation_set_type::data_type&>(operations.get_data()).clear();
+	} else
 	  throw std::runtime_error("invalid file? " + file);
 	
+	utils::resource end;
+	
+	latencies.push_back(end.user_time() - start.user_time());
+	
 	id_buffer.id     = operations.get_data().id;
 	id_buffer.buffer = operations.get_output_data().buffer;
 	
@@ -308,7 +361,20 @@ struct TaskFile : public MapReduceFile
 	queue_is.pop_swap(line);
 	if (line.empty()) break;
 	
-	operations(line);
+	utils::resource start;
+	
+	{
+	  utils::arena::scoped_type scoped(arena);
+	  
+	  operations(line);
+	  
+	  // the hypergraph may be allocated from the arena
+	  const_cast<operation_set_type::data_type&>(operations.get_data()).clear();
+	}
+	
+	utils::resource end;
+	
+	latencies.push_back(end.user_time() - start.user_time());
 	
 	id_buffer.id     = operations.get_data().id;
 	id_buffer.buffer = operations.get_output_data().buffer;
@@ -330,12 +396,13 @@ struct TaskFile : public MapReduceFile
   const tree_grammar_type& _tree_grammar;  
   
   operation_set_type::statistics_type stats;
+  latency_set_type                    latencies;
 };
 
 struct ReduceFile : public MapReduceFile
 {
-  ReduceFile(queue_os_type& __queue, const path_type& __path)
-    : queue(__queue), path(__path) {}
+  ReduceFile(queue_os_type& __queue, const path_type& __path, reduced_type& __reduced)
+    : queue(__queue), path(__path), reduced(__reduced) {}
   
   void operator()()
   {
@@ -378,6 +445,9 @@ struct ReduceFile : public MapReduceFile
       
       if (dump && flush_output)
 	os << std::flush;
+      
+      if (dump)
+	reduced.assign(id);
     }
     
     for (buffer_map_type::iterator iter = maps.find(id); iter != maps.end() && iter->first == id; /**/) {
@@ -405,6 +475,8 @@ struct ReduceFile : public MapReduceFile
   
   queue_os_type& queue;
   path_type      path;
+  
+  reduced_type& reduced;
 };
 
 struct TaskDirectory
@@ -486,6 +558,39 @@ struct TaskDirectory
 };
 
 
+struct ScheduleLength
+{
+  typedef std::pair<size_t, std::string> length_line_type;
+  typedef std::vector<length_line_type, std::allocator<length_line_type> > window_type;
+  
+  bool operator()(const length_line_type& x, const length_line_type& y) const
+  {
+    return x.first > y.first;
+  }
+};
+
+// dispatch the lines in the window, the longest first, so that the long sentences will not be the stragglers.
+// We wait until the lines in the previous window are reduced, thus, the reorder buffer in the reducer
+// keeps at most two windows.
+void schedule_dispatch(MapReduceFile::queue_is_type& queue,
+		       ScheduleLength::window_type& window,
+		       const MapReduceFile::id_type id_first,
+		       MapReduceFile::reduced_type& reduced)
+{
+  if (window.empty()) return;
+  
+  if (id_first > window.size())
+    reduced.wait(id_first - window.size());
+  
+  std::stable_sort(window.begin(), window.end(), ScheduleLength());
+  
+  ScheduleLength::window_type::iterator witer_end = window.end();
+  for (ScheduleLength::window_type::iterator witer = window.begin(); witer != witer_end; ++ witer)
+    queue.push_swap(witer->second);
+  
+  window.clear();
+}
+
 void cicada_file(const operation_set_type& operations,
 		 const model_type& model,
 		 const grammar_type& grammar,
@@ -496,11 +601,16 @@ void cicada_file(const operation_set_type& operations,
   typedef TaskFile      task_type;
   typedef ReduceFile    reducer_type;
   
+  typedef ScheduleLength::length_line_type length_line_type;
+  typedef ScheduleLength::window_type      window_type;
+  
   map_reduce_type::queue_is_type queue_is(threads);
   map_reduce_type::queue_os_type queue_os;
   
+  map_reduce_type::reduced_type reduced;
+  
   boost::thread_group reducer;
-  reducer.add_thread(new boost::thread(reducer_type(queue_os, operations.get_output_data().file)));
+  reducer.add_thread(new boost::thread(reducer_type(queue_os, operations.get_output_data().file, reduced)));
   
   boost::thread_group mapper;
   std::vector<task_type, std::allocator<task_type> > tasks(threads, task_type(queue_is, queue_os, model, grammar, tree_grammar));
@@ -524,17 +634,28 @@ void cicada_file(const operation_set_type& operations,
     operation_set_type::operation_type::id_type id = 0;
     std::string line;
     
+    window_type window;
+    
     while (utils::getline(is, line)) {
       if (input_id_mode) {
 	if (line.empty())
 	  throw std::runtime_error("invalid empty input!");
+      } else
+	line = utils::lexical_cast<std::string>(id) + " ||| " + line;
+      
+      if (schedule_window > 0) {
+	window.push_back(length_line_type(line.size(), std::string()));
+	window.back().second.swap(line);
 	
-	queue_is.push_swap(line);
+	if (window.size() == static_cast<size_t>(schedule_window))
+	  schedule_dispatch(queue_is, window, id + 1 - window.size(), reduced);
       } else
-	queue_is.push(utils::lexical_cast<std::string>(id) + " ||| " + line);
+	queue_is.push_swap(line);
       
       ++ id;
     }
+    
+    schedule_dispatch(queue_is, window, id - window.size(), reduced);
   }
   
   for (int i = 0; i != threads; ++ i)
@@ -545,8 +666,23 @@ void cicada_file(const operation_set_type& operations,
   queue_os.push(map_reduce_type::id_buffer_type());
   reducer.join_all();
 
-  for (int i = 0; i != threads; ++ i)
+  map_reduce_type::latency_set_type latencies;
+  
+  for (int i = 0; i != threads; ++ i) {
     stats += tasks[i].stats;
+    latencies.insert(latencies.end(), tasks[i].latencies.begin(), tasks[i].latencies.end());
+  }
+  
+  if (debug && ! latencies.empty()) {
+    std::sort(latencies.begin(), latencies.end());
+    
+    std::cerr << "latency:"
+	      << " 50%: " << latencies[latencies.size() * 50 / 100]
+	      << " 90%: " << latencies[latencies.size() * 90 / 100]
+	      << " 99%: " << latencies[latencies.size() * 99 / 100]
+	      << " max: " << latencies.back()
+	      << std::endl;
+  }
 }
 
 
@@ -664,6 +800,8 @@ void options(int argc, char** argv)
   opts_command.add_options()
     ("config",  po::value<path_type>(),                    "configuration file")
     ("threads", po::value<int>(&threads),                  "# of threads")
+    ("compress-threads", po::value<int>(&compress_threads), "# of threads for compressed streams")
+    ("schedule-window", po::value<int>(&schedule_window),  "read-ahead window to dispatch the longest sentences first (0 for the input order)")
     ("debug",   po::value<int>(&debug)->implicit_value(1), "debug level")
     ("help", "help message");
 
@@ -155,6 +155,7 @@ double score_union = 0.0;
 double score_intersection = 0.0;
 
 int threads = 1;
+int compress_threads = 0;
 int debug = 0;
 
 void process_posterior(std::istream& is_src_trg, std::istream& is_trg_src, std::istream* is_src, std::istream* is_trg, std::ostream& os);
@@ -171,6 +172,9 @@ int main(int argc, char ** argv)
 
     threads = utils::bithack::max(threads, 1);
 
+    if (compress_threads > 0)
+      utils::compress_stream_threads(compress_threads);
+
     score_null         = utils::mathop::log(prob_null);
     score_union        = utils::mathop::log(prob_union);
     score_intersection = utils::mathop::log(prob_intersection);
@@ -1983,6 +1987,7 @@ void options(int argc, char** argv)
     ("prob-intersection", po::value<double>(&prob_intersection)->default_value(prob_intersection), "intersection probability")
     
     ("threads", po::value<int>(&threads), "# of threads")
+    ("compress-threads", po::value<int>(&compress_threads), "# of threads for compressed streams")
     
     ("debug", po::value<int>(&debug)->implicit_value(1), "debug level")
     ("help", "help message");
@@ -9,6 +9,7 @@
 #include <set>
 
 #include "cicada_alignment_impl.hpp"
+#include "cicada_alignment_hmm_kernel.hpp"
 
 #include "utils/vector2.hpp"
 #include "utils/vector3.hpp"
@@ -58,6 +59,8 @@ struct LearnHMM : public LearnBase
     sentence_type target_class;
 
     point_map_type points;
+    
+    ttable_type::gather_type gather;
 
     void shrink()
     {
@@ -93,6 +96,8 @@ struct LearnHMM : public LearnBase
       sentence_type(target_class).swap(target_class);
       
       point_map_type(points).swap(points);
+      
+      gather.shrink();
     }
     
     void prepare(const sentence_type& __source,
@@ -158,6 +163,8 @@ struct LearnHMM : public LearnBase
 	  points[aiter->target].insert(aiter->source);
       }
       
+      gather.assign(ttable, __source, __target);
+      
       emission.clear();
       transition.clear();
       
@@ -174,18 +181,18 @@ struct LearnHMM : public LearnBase
 	if (! points[trg - 1].empty()) {
 	  point_set_type::const_iterator piter_end = points[trg - 1].end();
 	  for (point_set_type::const_iterator piter = points[trg - 1].begin(); piter != piter_end; ++ piter)
-	    emission(trg, *piter + 1) = ttable(source[*piter + 1], target[trg]);
+	    emission(trg, *piter + 1) = gather(*piter + 1, trg - 1);
 	} else {
 	  // translation into non-NULL word
 	  prob_type* eiter = &(*emission.begin(trg)) + 1;
 	  for (size_type src = 1; src <= source_size; ++ src, ++ eiter)
-	    (*eiter) = ttable(source[src], target[trg]);
+	    (*eiter) = gather(src, trg - 1);
 	
 	  // NULL
 	  prob_type* eiter_first = &(*emission.begin(trg)) + source_size + 2;
 	  prob_type* eiter_last  = eiter_first + source_size + 2 - 1; // -1 to exclude EOS
 	  
-	  std::fill(eiter_first, eiter_last, ttable(vocab_type::EPSILON, target[trg]));
+	  std::fill(eiter_first, eiter_last, gather(0, trg - 1));
 	}
       }
 
@@ -270,6 +277,8 @@ struct LearnHMM : public LearnBase
       for (sentence_type::const_iterator titer = __target.begin(); titer != __target.end(); ++ titer, ++ ctiter)
 	*ctiter = classes_target[*titer];
       
+      gather.assign(ttable, __source, __target);
+      
       emission.clear();
       transition.clear();
       
@@ -287,12 +296,12 @@ struct LearnHMM : public LearnBase
 	// translation into non-NULL word
 	prob_type* eiter = &(*emission.begin(trg)) + 1;
 	for (size_type src = 1; src <= source_size; ++ src, ++ eiter)
-	  (*eiter) = ttable(source[src], target[trg]);
+	  (*eiter) = gather(src, trg - 1);
 	
 	prob_type* eiter_first = &(*emission.begin(trg)) + source_size + 2;
 	prob_type* eiter_last  = eiter_first + source_size + 2 - 1; // -1 to exclude EOS
 	
-	std::fill(eiter_first, eiter_last, ttable(vocab_type::EPSILON, target[trg]));
+	std::fill(eiter_first, eiter_last, gather(0, trg - 1));
       }
 
       
@@ -348,6 +357,9 @@ struct LearnHMM : public LearnBase
       backward.resize(target_size + 2, (source_size + 2) * 2, 0.0);
       scale.resize(target_size + 2, 1.0);
       
+      const HMMKernel& kernel = HMMKernel::instance();
+      const int loop_size = (source_size + 2) * 2;
+      
       forward(0, 0) = 1.0;
       for (size_type trg = 1; trg != target_size + 2; ++ trg) {
 	// +1 to exclude BOS
@@ -359,28 +371,8 @@ struct LearnHMM : public LearnBase
 	  const prob_type* titer = &(*transition.begin(trg, next));
 	  
 	  const double factor = *eiter;
-	  if (factor > 0.0) {
-	    double accum[4] = {0.0, 0.0, 0.0, 0.0};
-	    const int loop_size = (source_size + 2) * 2;
-	    for (int prev = 0; prev < loop_size - 3; prev += 4) {
-	      accum[0] += piter[prev + 0] * titer[prev + 0] * factor;
-	      accum[1] += piter[prev + 1] * titer[prev + 1] * factor;
-	      accum[2] += piter[prev + 2] * titer[prev + 2] * factor;
-	      accum[3] += piter[prev + 3] * titer[prev + 3] * factor;
-	    }
-	    
-	    switch (loop_size & 0x03) {
-	    case 3: accum[4 - 3] += piter[loop_size - 3] * titer[loop_size - 3] * factor;
-	    case 2: accum[4 - 2] += piter[loop_size - 2] * titer[loop_size - 2] * factor;
-	    case 1: accum[4 - 1] += piter[loop_size - 1] * titer[loop_size - 1] * factor;
-	    }
-	    *niter += accum[0] + accum[1] + accum[2] + accum[3];
-	    
-#if 0
-	    for (int prev = 0; prev < (source_size + 2) * 2; ++ prev, ++ piter, ++ titer)
-	      *niter += (*piter) * (*titer) * factor;
-#endif
-	  }
+	  if (factor > 0.0)
+	    *niter += kernel.dot(piter, titer, loop_size) * factor;
 	}
 	
 	prob_type*       niter_none = &(*forward.begin(trg)) + (source_size + 2);
@@ -397,10 +389,10 @@ struct LearnHMM : public LearnBase
 	  *niter_none += (*piter_none2) * (*eiter_none) * transition(trg, next_none, prev_none2);
 	}
 	
-	scale[trg] = std::accumulate(forward.begin(trg), forward.end(trg), 0.0);
+	scale[trg] = kernel.sum(&(*forward.begin(trg)), loop_size);
 	scale[trg] = (scale[trg] == 0.0 ? 1.0 : 1.0 / scale[trg]);
 	if (scale[trg] != 1.0)
-	  std::transform(forward.begin(trg), forward.end(trg), forward.begin(trg), std::bind2nd(std::multiplies<double>(), scale[trg]));
+	  kernel.scale(scale[trg], &(*forward.begin(trg)), loop_size);
       }
       
       backward(target_size + 2 - 1, source_size + 2 - 1) = 1.0;
@@ -417,25 +409,8 @@ struct LearnHMM : public LearnBase
 	  const prob_type* titer = &(*transition.begin(trg + 1, next));
 	  
 	  const double factor = (*eiter) * (*niter) * factor_scale;
-	  if (factor > 0.0) {
-	    const int loop_size = (source_size + 2) * 2;
-	    for (int prev = 0; prev < loop_size - 3; prev += 4) {
-	      piter[prev + 0] += titer[prev + 0] * factor;
-	      piter[prev + 1] += titer[prev + 1] * factor;
-	      piter[prev + 2] += titer[prev + 2] * factor;
-	      piter[prev + 3] += titer[prev + 3] * factor;
-	    }
-	    switch (loop_size & 0x03) {
-	    case 3: piter[loop_size - 3] += titer[loop_size - 3] * factor;
-	    case 2: piter[loop_size - 2] += titer[loop_size - 2] * factor;
-	    case 1: piter[loop_size - 1] += titer[loop_size - 1] * factor;
-	    }
-	    
-#if 0
-	    for (int prev = 0; prev < (source_size + 2) * 2; ++ prev, ++ piter, ++ titer)
-	      *piter += (*titer) * factor;
-#endif
-	  }
+	  if (factor > 0.0)
+	    kernel.axpy(factor, titer, piter, loop_size);
 	}
 	
 	const prob_type* niter_none = &(*backward.begin(trg + 1)) + (source_size + 2);
@@ -466,6 +441,8 @@ struct LearnHMM : public LearnBase
       
       const prob_type sum = forward(target_size + 2 - 1, source_size + 2 - 1);
       
+      const HMMKernel& kernel = HMMKernel::instance();
+      
       for (int trg = 1; trg <= target_size; ++ trg) {
 	const double factor = 1.0 / (scale[trg] * sum);
 	
@@ -474,51 +451,12 @@ struct LearnHMM : public LearnBase
 	const prob_type* biter = &(*backward.begin(trg)) + 1;
 	prob_type* piter = &(*posterior.begin(trg)) + 1;
 	
-#if 1
-	for (int src = 0; src < source_size - 3; src += 4) {
-	  piter[src + 0] += fiter[src + 0] * biter[src + 0] * factor;
-	  piter[src + 1] += fiter[src + 1] * biter[src + 1] * factor;
-	  piter[src + 2] += fiter[src + 2] * biter[src + 2] * factor;
-	  piter[src + 3] += fiter[src + 3] * biter[src + 3] * factor;
-	}
-	switch (source_size & 0x03) {
-	case 3: piter[source_size - 3] += fiter[source_size - 3] * biter[source_size - 3] * factor;
-	case 2: piter[source_size - 2] += fiter[source_size - 2] * biter[source_size - 2] * factor;
-	case 1: piter[source_size - 1] += fiter[source_size - 1] * biter[source_size - 1] * factor;
-	}
-#endif	
-#if 0
-	for (int src = 1; src <= source_size; ++ src, ++ fiter, ++ biter, ++ piter)
-	  (*piter) += (*fiter) * (*biter) * factor;
-#endif
+	kernel.mul_add(factor, fiter, biter, piter, source_size);
 	
 	fiter = &(*forward.begin(trg))  + source_size + 2;
 	biter = &(*backward.begin(trg)) + source_size + 2;
 	
-#if 1
-	double count_none[4] = {0.0, 0.0, 0.0, 0.0};
-	const int loop_size = source_size + 2;
-	for (int src = 0; src < loop_size - 3; src += 4) {
-	  count_none[0] += fiter[src + 0] * biter[src + 0] * factor;
-	  count_none[1] += fiter[src + 1] * biter[src + 1] * factor;
-	  count_none[2] += fiter[src + 2] * biter[src + 2] * factor;
-	  count_none[3] += fiter[src + 3] * biter[src + 3] * factor;
-	}
-	switch (loop_size & 0x03) {
-	case 3: count_none[4 - 3] += fiter[loop_size - 3] * biter[loop_size - 3] * factor;
-	case 2: count_none[4 - 2] += fiter[loop_size - 2] * biter[loop_size - 2] * factor;
-	case 1: count_none[4 - 1] += fiter[loop_size - 1] * biter[loop_size - 1] * factor;
-	}
-	
-	posterior(trg, 0) = count_none[0] + count_none[1] + count_none[2] + count_none[3];
-#endif
-#if 0
-	double count_none = 0.0;
-	for (int src = 0; src < source_size + 2; ++ src, ++ fiter, ++ biter)
-	  count_none += (*fiter) * (*biter) * factor;
-	
-      	posterior(trg, 0) = count_none;
-#endif
+	posterior(trg, 0) = kernel.dot(fiter, biter, source_size + 2) * factor;
       }
     }
 
@@ -544,7 +482,7 @@ struct LearnHMM : public LearnBase
       
       const prob_type sum = forward(target_size + 2 - 1, source_size + 2 - 1);
       
-      {
+      if (counts.dense.empty()) {
 	// allocate enough buffer size...
 	
 	for (int src = 1; src <= source_size; ++ src) {
@@ -565,36 +503,13 @@ struct LearnHMM : public LearnBase
 	const prob_type* biter = &(*backward.begin(trg)) + 1;
 	
 	for (int src = 1; src <= source_size; ++ src, ++ fiter, ++ biter)
-	  counts[source[src]][target[trg]] += (*fiter) * (*biter) * factor;
+	  counts.count(gather, src, trg - 1) += (*fiter) * (*biter) * factor;
 	
 	// null alignment...
 	fiter = &(*forward.begin(trg)) + source_size + 2;
 	biter = &(*backward.begin(trg)) + source_size + 2;
 	
-#if 1
-	double count_none[4] = {0.0, 0.0, 0.0, 0.0};
-	const int loop_size = source_size + 2;
-	for (int src = 0; src < loop_size - 3; src += 4) {
-	  count_none[0] += fiter[src + 0] * biter[src + 0] * factor;
-	  count_none[1] += fiter[src + 1] * biter[src + 1] * factor;
-	  count_none[2] += fiter[src + 2] * biter[src + 2] * factor;
-	  count_none[3] += fiter[src + 3] * biter[src + 3] * factor;
-	}
-	switch (loop_size & 0x03) {
-	case 3: count_none[4 - 3] += fiter[loop_size - 3] * biter[loop_size - 3] * factor;
-	case 2: count_none[4 - 2] += fiter[loop_size - 2] * biter[loop_size - 2] * factor;
-	case 1: count_none[4 - 1] += fiter[loop_size - 1] * biter[loop_size - 1] * factor;
-	}
-	
-	counts[vocab_type::EPSILON][target[trg]] += count_none[0] + count_none[1] + count_none[2] + count_none[3];
-#endif
-#if 0
-	double count_none = 0.0;
-	for (int src = 0; src < source_size + 2; ++ src, ++ fiter, ++ biter)
-	  count_none += (*fiter) * (*biter) * factor;
-	
-	counts[vocab_type::EPSILON][target[trg]] += count_none;
-#endif
+	counts.count(gather, 0, trg - 1) += HMMKernel::instance().dot(fiter, biter, source_size + 2) * factor;
       }
     }
     
@@ -1022,14 +937,11 @@ struct LearnHMMSymmetric : public LearnBase
 	if (src && trg)
 	  count = utils::mathop::sqrt(count);
 	
-	const word_type word_source = (! src ? vocab_type::EPSILON : source[src - 1]);
-	const word_type word_target = (! trg ? vocab_type::EPSILON : target[trg - 1]);
-	
 	if (trg)
-	  ttable_counts_source_target[word_source][word_target] += count;
+	  ttable_counts_source_target.count(hmm_source_target.gather, src, trg - 1) += count;
 	
 	if (src)
-	  ttable_counts_target_source[word_target][word_source] += count;
+	  ttable_counts_target_source.count(hmm_target_source.gather, trg, src - 1) += count;
       }
     
     hmm_source_target.accumulate(source, target, atable_counts_source_target);
@@ -1061,14 +973,11 @@ struct LearnHMMSymmetric : public LearnBase
 	if (src && trg)
 	  count = utils::mathop::sqrt(count);
 	
-	const word_type word_source = (! src ? vocab_type::EPSILON : source[src - 1]);
-	const word_type word_target = (! trg ? vocab_type::EPSILON : target[trg - 1]);
-	
 	if (trg)
-	  ttable_counts_source_target[word_source][word_target] += count;
+	  ttable_counts_source_target.count(hmm_source_target.gather, src, trg - 1) += count;
 	
 	if (src)
-	  ttable_counts_target_source[word_target][word_source] += count;
+	  ttable_counts_target_source.count(hmm_target_source.gather, trg, src - 1) += count;
       }
     
     hmm_source_target.accumulate(source, target, atable_counts_source_target);
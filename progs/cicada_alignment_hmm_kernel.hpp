@@ -0,0 +1,242 @@
+//
+//  Copyright(C) 2013 Taro Watanabe <taro.watanabe@nict.go.jp>
+//
+
+#ifndef __CICADA_ALIGNMENT_HMM_KERNEL__HPP__
+#define __CICADA_ALIGNMENT_HMM_KERNEL__HPP__ 1
+
+//
+// vector kernels for the HMM forward-backward: the forward pass is a dot-product of the previous lattice row and
+// a transition row, the backward pass is an axpy, and the posteriors are element-wise products.
+// The AVX2 kernels are compiled by the target attribute, and selected at runtime by the CPU support,
+// thus we do not require -mavx2 for the whole program.
+//
+
+#include <utils/config.hpp>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__)) && defined(HAVE_IMMINTRIN_H) \
+  && (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9))
+#define CICADA_ALIGNMENT_HMM_KERNEL_AVX2 1
+#include <immintrin.h>
+#endif
+
+struct HMMKernel
+{
+  typedef double value_type;
+
+  // sum_i x[i] * y[i]
+  typedef value_type (*dot_type)(const value_type* x, const value_type* y, const int size);
+  // y[i] += a * x[i]
+  typedef void (*axpy_type)(const value_type a, const value_type* x, value_type* y, const int size);
+  // z[i] += a * x[i] * y[i]
+  typedef void (*mul_add_type)(const value_type a, const value_type* x, const value_type* y, value_type* z, const int size);
+  // sum_i x[i]
+  typedef value_type (*sum_type)(const value_type* x, const int size);
+  // x[i] *= a
+  typedef void (*scale_type)(const value_type a, value_type* x, const int size);
+
+  HMMKernel() { assign(simd_supported()); }
+  HMMKernel(const bool simd) { assign(simd); }
+
+  void assign(const bool simd)
+  {
+#ifdef CICADA_ALIGNMENT_HMM_KERNEL_AVX2
+    if (simd && simd_supported()) {
+      dot     = dot_avx2;
+      axpy    = axpy_avx2;
+      mul_add = mul_add_avx2;
+      sum     = sum_avx2;
+      scale   = scale_avx2;
+      return;
+    }
+#endif
+    dot     = dot_generic;
+    axpy    = axpy_generic;
+    mul_add = mul_add_generic;
+    sum     = sum_generic;
+    scale   = scale_generic;
+  }
+
+  bool is_simd() const { return dot != dot_generic; }
+
+  static bool simd_supported()
+  {
+#ifdef CICADA_ALIGNMENT_HMM_KERNEL_AVX2
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+#else
+    return false;
+#endif
+  }
+
+  // the kernel shared by all the HMM computation. Use select() before spawning threads.
+  static HMMKernel& instance()
+  {
+    static HMMKernel __kernel;
+    return __kernel;
+  }
+
+  static void select(const bool simd) { instance().assign(simd); }
+
+  static value_type dot_generic(const value_type* x, const value_type* y, const int size)
+  {
+    value_type accum[4] = {0.0, 0.0, 0.0, 0.0};
+    for (int i = 0; i < size - 3; i += 4) {
+      accum[0] += x[i + 0] * y[i + 0];
+      accum[1] += x[i + 1] * y[i + 1];
+      accum[2] += x[i + 2] * y[i + 2];
+      accum[3] += x[i + 3] * y[i + 3];
+    }
+    switch (size & 0x03) {
+    case 3: accum[4 - 3] += x[size - 3] * y[size - 3];
+    case 2: accum[4 - 2] += x[size - 2] * y[size - 2];
+    case 1: accum[4 - 1] += x[size - 1] * y[size - 1];
+    }
+    return accum[0] + accum[1] + accum[2] + accum[3];
+  }
+
+  static void axpy_generic(const value_type a, const value_type* x, value_type* y, const int size)
+  {
+    for (int i = 0; i < size - 3; i += 4) {
+      y[i + 0] += a * x[i + 0];
+      y[i + 1] += a * x[i + 1];
+      y[i + 2] += a * x[i + 2];
+      y[i + 3] += a * x[i + 3];
+    }
+    switch (size & 0x03) {
+    case 3: y[size - 3] += a * x[size - 3];
+    case 2: y[size - 2] += a * x[size - 2];
+    case 1: y[size - 1] += a * x[size - 1];
+    }
+  }
+
+  static void mul_add_generic(const value_type a, const value_type* x, const value_type* y, value_type* z, const int size)
+  {
+    for (int i = 0; i < size - 3; i += 4) {
+      z[i + 0] += x[i + 0] * y[i + 0] * a;
+      z[i + 1] += x[i + 1] * y[i + 1] * a;
+      z[i + 2] += x[i + 2] * y[i + 2] * a;
+      z[i + 3] += x[i + 3] * y[i + 3] * a;
+    }
+    switch (size & 0x03) {
+    case 3: z[size - 3] += x[size - 3] * y[size - 3] * a;
+    case 2: z[size - 2] += x[size - 2] * y[size - 2] * a;
+    case 1: z[size - 1] += x[size - 1] * y[size - 1] * a;
+    }
+  }
+
+  static value_type sum_generic(const value_type* x, const int size)
+  {
+    value_type accum = 0.0;
+    for (int i = 0; i != size; ++ i)
+      accum += x[i];
+    return accum;
+  }
+
+  static void scale_generic(const value_type a, value_type* x, const int size)
+  {
+    for (int i = 0; i != size; ++ i)
+      x[i] *= a;
+  }
+
+#ifdef CICADA_ALIGNMENT_HMM_KERNEL_AVX2
+  // the lattice rows start at arbitrary offsets, thus we use unaligned loads/stores.
+
+  __attribute__((target("avx2,fma")))
+  static value_type horizontal_add(const __m256d& x)
+  {
+    const __m128d sum2 = _mm_add_pd(_mm256_castpd256_pd128(x), _mm256_extractf128_pd(x, 1));
+    return _mm_cvtsd_f64(_mm_add_sd(sum2, _mm_unpackhi_pd(sum2, sum2)));
+  }
+
+  __attribute__((target("avx2,fma")))
+  static value_type dot_avx2(const value_type* x, const value_type* y, const int size)
+  {
+    __m256d accum0 = _mm256_setzero_pd();
+    __m256d accum1 = _mm256_setzero_pd();
+
+    int i = 0;
+    for (/**/; i < size - 7; i += 8) {
+      accum0 = _mm256_fmadd_pd(_mm256_loadu_pd(x + i),     _mm256_loadu_pd(y + i),     accum0);
+      accum1 = _mm256_fmadd_pd(_mm256_loadu_pd(x + i + 4), _mm256_loadu_pd(y + i + 4), accum1);
+    }
+    if (i < size - 3) {
+      accum0 = _mm256_fmadd_pd(_mm256_loadu_pd(x + i), _mm256_loadu_pd(y + i), accum0);
+      i += 4;
+    }
+
+    value_type accum = horizontal_add(_mm256_add_pd(accum0, accum1));
+    for (/**/; i < size; ++ i)
+      accum += x[i] * y[i];
+    return accum;
+  }
+
+  __attribute__((target("avx2,fma")))
+  static void axpy_avx2(const value_type a, const value_type* x, value_type* y, const int size)
+  {
+    const __m256d factor = _mm256_set1_pd(a);
+
+    int i = 0;
+    for (/**/; i < size - 3; i += 4)
+      _mm256_storeu_pd(y + i, _mm256_fmadd_pd(factor, _mm256_loadu_pd(x + i), _mm256_loadu_pd(y + i)));
+    for (/**/; i < size; ++ i)
+      y[i] += a * x[i];
+  }
+
+  __attribute__((target("avx2,fma")))
+  static void mul_add_avx2(const value_type a, const value_type* x, const value_type* y, value_type* z, const int size)
+  {
+    const __m256d factor = _mm256_set1_pd(a);
+
+    int i = 0;
+    for (/**/; i < size - 3; i += 4) {
+      const __m256d prod = _mm256_mul_pd(_mm256_loadu_pd(x + i), _mm256_loadu_pd(y + i));
+      _mm256_storeu_pd(z + i, _mm256_fmadd_pd(prod, factor, _mm256_loadu_pd(z + i)));
+    }
+    for (/**/; i < size; ++ i)
+      z[i] += x[i] * y[i] * a;
+  }
+
+  __attribute__((target("avx2,fma")))
+  static value_type sum_avx2(const value_type* x, const int size)
+  {
+    __m256d accum0 = _mm256_setzero_pd();
+    __m256d accum1 = _mm256_setzero_pd();
+
+    int i = 0;
+    for (/**/; i < size - 7; i += 8) {
+      accum0 = _mm256_add_pd(_mm256_loadu_pd(x + i),     accum0);
+      accum1 = _mm256_add_pd(_mm256_loadu_pd(x + i + 4), accum1);
+    }
+    if (i < size - 3) {
+      accum0 = _mm256_add_pd(_mm256_loadu_pd(x + i), accum0);
+      i += 4;
+    }
+
+    value_type accum = horizontal_add(_mm256_add_pd(accum0, accum1));
+    for (/**/; i < size; ++ i)
+      accum += x[i];
+    return accum;
+  }
+
+  __attribute__((target("avx2,fma")))
+  static void scale_avx2(const value_type a, value_type* x, const int size)
+  {
+    const __m256d factor = _mm256_set1_pd(a);
+
+    int i = 0;
+    for (/**/; i < size - 3; i += 4)
+      _mm256_storeu_pd(x + i, _mm256_mul_pd(_mm256_loadu_pd(x + i), factor));
+    for (/**/; i < size; ++ i)
+      x[i] *= a;
+  }
+#endif
+
+  dot_type     dot;
+  axpy_type    axpy;
+  mul_add_type mul_add;
+  sum_type     sum;
+  scale_type   scale;
+};
+
+#endif
@@ -0,0 +1,135 @@
+//
+//  Copyright(C) 2013 Taro Watanabe <taro.watanabe@nict.go.jp>
+//
+
+// micro-benchmark of the HMM forward-backward: compare the scalar and the SIMD kernels
+// on synthetic bitexts of various lengths.
+//
+// cicada_alignment_hmm_kernel_main [# of bitexts] [max length]
+
+#include <cstdlib>
+#include <iostream>
+
+#include "cicada_alignment_impl.hpp"
+
+#include "utils/resource.hpp"
+
+double p0 = 0.01;
+
+#include "cicada_alignment_hmm_impl.hpp"
+
+typedef LearnHMM::HMMData hmm_data_type;
+
+typedef std::pair<int, int> length_type;
+typedef std::vector<length_type, std::allocator<length_type> > length_set_type;
+
+typedef std::vector<hmm_data_type::posterior_type, std::allocator<hmm_data_type::posterior_type> > posterior_set_type;
+
+void prepare(hmm_data_type& hmm, const int source_size, const int target_size)
+{
+  // random emission and transition, which follows the shape of HMMData::prepare()
+  hmm.emission.clear();
+  hmm.transition.clear();
+
+  hmm.emission.resize(target_size + 2, (source_size + 2) * 2, 0.0);
+  hmm.transition.resize(target_size + 2, (source_size + 2) * 2, (source_size + 2) * 2, 0.0);
+
+  hmm.emission(0, 0) = 1.0;
+  hmm.emission(target_size + 2 - 1, source_size + 2 - 1) = 1.0;
+  for (int trg = 1; trg <= target_size; ++ trg) {
+    for (int src = 1; src <= source_size; ++ src)
+      hmm.emission(trg, src) = double(std::rand()) / RAND_MAX;
+
+    const double prob_none = double(std::rand()) / RAND_MAX;
+    for (int src = 0; src != (source_size + 2) - 1; ++ src)
+      hmm.emission(trg, src + source_size + 2) = prob_none;
+  }
+
+  for (int trg = 1; trg != target_size + 2; ++ trg) {
+    for (int next = 1; next != source_size + 2; ++ next)
+      for (int prev = 0; prev != (source_size + 2) - 1; ++ prev) {
+	const double prob = (1.0 - p0) / (1.0 + std::abs(next - prev - 1));
+
+	hmm.transition(trg, next, prev) = prob;
+	hmm.transition(trg, next, prev + source_size + 2) = prob;
+      }
+
+    for (int next = 0; next != (source_size + 2) - 1; ++ next) {
+      hmm.transition(trg, next + source_size + 2, next) = p0;
+      hmm.transition(trg, next + source_size + 2, next + source_size + 2) = p0;
+    }
+  }
+}
+
+double benchmark(const length_set_type& lengths, posterior_set_type& posteriors)
+{
+  hmm_data_type hmm;
+  sentence_type source;
+  sentence_type target;
+
+  posteriors.clear();
+
+  double elapsed = 0.0;
+
+  std::srand(1);
+
+  for (length_set_type::const_iterator liter = lengths.begin(); liter != lengths.end(); ++ liter) {
+    source.resize(liter->first);
+    target.resize(liter->second);
+
+    prepare(hmm, liter->first, liter->second);
+
+    utils::resource start;
+
+    hmm.forward_backward(source, target);
+    hmm.estimate_posterior(source, target);
+
+    utils::resource end;
+
+    elapsed += end.thread_time() - start.thread_time();
+
+    posteriors.push_back(hmm.posterior);
+  }
+
+  return elapsed;
+}
+
+int main(int argc, char** argv)
+{
+  const int num_bitext = (argc > 1 ? std::atoi(argv[1]) : 1000);
+  const int max_length = (argc > 2 ? std::atoi(argv[2]) : 80);
+
+  // synthetic lengths: mostly short with a long tail, as in the real bitexts
+  length_set_type lengths;
+  std::srand(0);
+  for (int i = 0; i != num_bitext; ++ i) {
+    const int source_size = 1 + int(double(max_length) * double(std::rand()) / RAND_MAX * double(std::rand()) / RAND_MAX);
+    const int target_size = utils::bithack::max(1, source_size + (std::rand() % 7) - 3);
+
+    lengths.push_back(std::make_pair(source_size, target_size));
+  }
+
+  posterior_set_type posteriors_scalar;
+  posterior_set_type posteriors_simd;
+
+  HMMKernel::select(false);
+  const double elapsed_scalar = benchmark(lengths, posteriors_scalar);
+
+  if (! HMMKernel::simd_supported())
+    std::cout << "no SIMD support, compare the scalar kernel with itself" << std::endl;
+
+  HMMKernel::select(true);
+  const double elapsed_simd = benchmark(lengths, posteriors_simd);
+
+  double error = 0.0;
+  for (size_t i = 0; i != posteriors_scalar.size(); ++ i)
+    for (size_t j = 0; j != posteriors_scalar[i].size1(); ++ j)
+      for (size_t k = 0; k != posteriors_scalar[i].size2(); ++ k)
+	error = std::max(error, std::fabs(posteriors_scalar[i](j, k) - posteriors_simd[i](j, k)));
+
+  std::cout << "bitexts: " << num_bitext << " max length: " << max_length << std::endl
+	    << "scalar: " << elapsed_scalar << " seconds" << std::endl
+	    << "simd:   " << elapsed_simd << " seconds" << std::endl
+	    << "speedup: " << (elapsed_scalar / elapsed_simd) << std::endl
+	    << "max posterior difference: " << error << std::endl;
+}
@@ -8,8 +8,12 @@
 #define BOOST_SPIRIT_THREADSAFE
 #define PHOENIX_THREADSAFE
 
+#include <memory>
 #include <numeric>
+#include <vector>
+#include <algorithm>
 #include <limits>
+#include <cmath>
 
 #include <boost/spirit/include/qi.hpp>
 #include <boost/spirit/include/karma.hpp>
@@ -39,6 +43,9 @@
 #include <utils/spinlock.hpp>
 #include <utils/vector2.hpp>
 #include <utils/chart.hpp>
+#include <utils/compress_stream.hpp>
+#include <utils/map_file.hpp>
+#include <utils/tempfile.hpp>
 
 typedef cicada::Symbol     word_type;
 typedef cicada::Sentence   sentence_type;
@@ -656,23 +663,98 @@ struct ttable_type
   
   typedef utils::alloc_vector<count_map_type, std::allocator<count_map_type> > count_dict_type;
   
+  // frozen, read-only table in the compressed-sparse-row format: for each source word, sorted target word ids and
+  // their probabilities in float. The smoothing is applied when looked up, since it is usually below the range of float.
+  typedef word_type::id_type id_type;
+  
+  typedef std::vector<size_type, std::allocator<size_type> > offset_set_type;
+  typedef std::vector<id_type, std::allocator<id_type> >     id_set_type;
+  typedef std::vector<float, std::allocator<float> >         prob_set_type;
+  
+  // dense counts parallel to the frozen rows of the table under estimation
+  typedef std::vector<count_type, std::allocator<count_type> > dense_set_type;
+  
+  static const size_type npos = size_type(-1);
+  
+  // positions in the frozen table and probabilities of the pairs of words in a sentence pair, gathered once and
+  // shared by the lookups and the accumulation of counts. The source 0 is NULL, and src + 1 is source[src].
+  struct gather_type
+  {
+    typedef std::vector<word_type, std::allocator<word_type> > word_set_type;
+    typedef std::vector<size_type, std::allocator<size_type> > index_set_type;
+    typedef std::vector<prob_type, std::allocator<prob_type> > value_set_type;
+    
+    void assign(const ttable_type& ttable, const sentence_type& __source, const sentence_type& __target)
+    {
+      source.clear();
+      target.clear();
+      
+      source.push_back(vocab_type::EPSILON);
+      source.insert(source.end(), __source.begin(), __source.end());
+      target.insert(target.end(), __target.begin(), __target.end());
+      
+      indices.resize(source.size() * target.size());
+      probs.resize(source.size() * target.size());
+      
+      index_set_type::iterator iiter = indices.begin();
+      value_set_type::iterator piter = probs.begin();
+      
+      word_set_type::const_iterator siter_end = source.end();
+      for (word_set_type::const_iterator siter = source.begin(); siter != siter_end; ++ siter) {
+	word_set_type::const_iterator titer_end = target.end();
+	for (word_set_type::const_iterator titer = target.begin(); titer != titer_end; ++ titer, ++ iiter, ++ piter) {
+	  *iiter = ttable.find(*siter, *titer);
+	  *piter = ttable(*siter, *titer, *iiter);
+	}
+      }
+    }
+    
+    size_type index(const size_type src, const size_type trg) const { return indices[src * target.size() + trg]; }
+    prob_type operator()(const size_type src, const size_type trg) const { return probs[src * target.size() + trg]; }
+    
+    void shrink()
+    {
+      word_set_type(source).swap(source);
+      word_set_type(target).swap(target);
+      index_set_type(indices).swap(indices);
+      value_set_type(probs).swap(probs);
+    }
+    
+    word_set_type  source;
+    word_set_type  target;
+    index_set_type indices;
+    value_set_type probs;
+  };
+  
   ttable_type(const double __prior=0.1, const double __smooth=1e-20) : ttable(), prior(__prior), smooth(__smooth) {}
   
   count_map_type& operator[](const word_type& word)
   {
+    if (frozen()) thaw();
+    
     return ttable[word.id()];
   }
 
+  // not available while frozen: use row() instead
   const count_map_type& operator[](const word_type& word) const
   {
     return ttable[word.id()];
   }
   
   double operator()(const word_type& source, const word_type& target) const
+  {
+    return operator()(source, target, find(source, target));
+  }
+  
+  // lookup by the position found by find()
+  double operator()(const word_type& source, const word_type& target, const size_type pos) const
   {
     if (source == vocab_type::BOS || source == vocab_type::EOS || target == vocab_type::BOS || target == vocab_type::EOS)
       return source == target;
     
+    if (frozen())
+      return (pos == npos ? smooth : std::max(double(frozen_probs[pos]), smooth));
+    
     if (! ttable.exists(source.id())) return smooth;
     
     const count_map_type& counts = ttable[source.id()];
@@ -681,12 +763,159 @@ struct ttable_type
     return (citer == counts.end() ? smooth : std::max(citer->second, smooth));
   }
   
+  // the position of the pair in the frozen table, or npos
+  size_type find(const word_type& source, const word_type& target) const
+  {
+    if (source.id() + 1 >= frozen_offsets.size()) return npos;
+    
+    // branch-free binary search
+    const id_type* first = &(*frozen_ids.begin()) + frozen_offsets[source.id()];
+    size_type      size  = frozen_offsets[source.id() + 1] - frozen_offsets[source.id()];
+    
+    if (! size) return npos;
+    
+    while (size > 1) {
+      const size_type half = size >> 1;
+      first = (first[half] <= target.id() ? first + half : first);
+      size -= half;
+    }
+    
+    return (*first != target.id() ? npos : size_type(first - &(*frozen_ids.begin())));
+  }
+  
+  // the probabilities of a source word
+  void row(const word_type& source, count_map_type& probs) const
+  {
+    probs.clear();
+    
+    if (frozen()) {
+      if (source.id() + 1 >= frozen_offsets.size()) return;
+      
+      const size_type first = frozen_offsets[source.id()];
+      const size_type last  = frozen_offsets[source.id() + 1];
+      
+      probs.rehash(last - first);
+      for (size_type pos = first; pos != last; ++ pos)
+	probs[word_type(frozen_ids[pos])] = frozen_probs[pos];
+    } else if (ttable.exists(source.id()))
+      probs = ttable[source.id()];
+  }
+  
+  // the count of the pair gathered at (src, trg) of a sentence pair: dense if the pair is in the frozen table, hashed otherwise
+  count_type& count(const gather_type& gather, const size_type src, const size_type trg)
+  {
+    const size_type pos = gather.index(src, trg);
+    
+    if (pos < dense.size())
+      return dense[pos];
+    
+    return ttable[gather.source[src].id()][gather.target[trg]];
+  }
+  
+  // allocate dense counts parallel to the frozen table x. Counts are initialized by negative zeros, which become
+  // non-negative once accumulated, so that the pairs never observed are distinguished from the pairs with zero counts.
+  void assign_dense(const ttable_type& x)
+  {
+    dense.assign(x.frozen_ids.size(), - 0.0);
+  }
+  
+  void clear_dense()
+  {
+    dense_set_type().swap(dense);
+  }
+  
+  // accumulate the dense counts of a source word in the count tables [first, last), parallel to this frozen table
+  template <typename Iterator>
+  void accumulate(const word_type& source, Iterator first, Iterator last, count_map_type& counts) const
+  {
+    if (source.id() + 1 >= frozen_offsets.size()) return;
+    
+    const size_type pos_last = frozen_offsets[source.id() + 1];
+    for (size_type pos = frozen_offsets[source.id()]; pos != pos_last; ++ pos) {
+      count_type count = - 0.0;
+      for (Iterator iter = first; iter != last; ++ iter)
+	if (pos < (*iter)->dense.size())
+	  count += (*iter)->dense[pos];
+      
+      if (! std::signbit(count))
+	counts[word_type(frozen_ids[pos])] += count;
+    }
+  }
+  
+  // freeze the table into the compressed-sparse-row format, so that the lookups during the EM iterations
+  // scan a contiguous sorted row, not a hash table per source word, and the counts are accumulated into dense arrays.
+  // The hash tables are released while frozen, and restored by thaw(), e.g. by any modification.
+  void freeze()
+  {
+    typedef std::pair<id_type, count_type> value_type;
+    typedef std::vector<value_type, std::allocator<value_type> > value_set_type;
+    
+    if (frozen()) return;
+    
+    size_type size_nonzero = 0;
+    for (size_type i = 0; i != ttable.size(); ++ i)
+      if (ttable.exists(i))
+	size_nonzero += ttable[i].size();
+    
+    frozen_offsets.reserve(ttable.size() + 1);
+    frozen_ids.reserve(size_nonzero);
+    frozen_probs.reserve(size_nonzero);
+    
+    value_set_type values;
+    
+    for (size_type i = 0; i != ttable.size(); ++ i) {
+      frozen_offsets.push_back(frozen_ids.size());
+      
+      if (! ttable.exists(i)) continue;
+      
+      values.clear();
+      count_map_type::const_iterator citer_end = ttable[i].end();
+      for (count_map_type::const_iterator citer = ttable[i].begin(); citer != citer_end; ++ citer)
+	values.push_back(value_type(citer->first.id(), citer->second));
+      
+      std::sort(values.begin(), values.end());
+      
+      value_set_type::const_iterator viter_end = values.end();
+      for (value_set_type::const_iterator viter = values.begin(); viter != viter_end; ++ viter) {
+	frozen_ids.push_back(viter->first);
+	frozen_probs.push_back(viter->second);
+      }
+    }
+    
+    frozen_offsets.push_back(frozen_ids.size());
+    
+    count_dict_type().swap(ttable);
+  }
+  
+  void thaw()
+  {
+    if (! frozen()) return;
+    
+    ttable.clear();
+    ttable.reserve(frozen_offsets.size() - 1);
+    ttable.resize(frozen_offsets.size() - 1);
+    
+    for (size_type i = 0; i != frozen_offsets.size() - 1; ++ i)
+      if (frozen_offsets[i] != frozen_offsets[i + 1]) {
+	count_map_type& probs = ttable[i];
+	
+	probs.rehash(frozen_offsets[i + 1] - frozen_offsets[i]);
+	for (size_type pos = frozen_offsets[i]; pos != frozen_offsets[i + 1]; ++ pos)
+	  probs[word_type(frozen_ids[pos])] = frozen_probs[pos];
+      }
+    
+    release();
+  }
+  
+  bool frozen() const { return ! frozen_offsets.empty(); }
   
   void shrink() { ttable.shrink(); }
-  void clear() { ttable.clear(); }
+  void clear() { ttable.clear(); release(); }
   
   void clear(const word_type& word)
   {
+    if (frozen()) thaw();
+    
     if (! ttable.exists(word.id())) return;
     
     ttable.erase(ttable.begin() + word.id());
@@ -695,19 +924,31 @@ struct ttable_type
   void swap(ttable_type& x)
   {
     ttable.swap(x.ttable);
+    frozen_offsets.swap(x.frozen_offsets);
+    frozen_ids.swap(x.frozen_ids);
+    frozen_probs.swap(x.frozen_probs);
+    dense.swap(x.dense);
     std::swap(prior,  x.prior);
     std::swap(smooth, x.smooth);
   }
 
-  size_type size() const { return ttable.size(); }
-  bool empty() const { return ttable.empty(); }
-  bool exists(size_type pos) const { return ttable.exists(pos); }
+  size_type size() const { return (frozen() ? frozen_offsets.size() - 1 : ttable.size()); }
+  bool empty() const { return (frozen() ? frozen_ids.empty() : ttable.empty()); }
+  bool exists(size_type pos) const
+  {
+    if (frozen())
+      return pos + 1 < frozen_offsets.size() && frozen_offsets[pos] != frozen_offsets[pos + 1];
+    else
+      return ttable.exists(pos);
+  }
   
-  void resize(size_type __size) { ttable.resize(__size); }
-  void reserve(size_type __size) { ttable.reserve(__size); }
+  void resize(size_type __size) { if (frozen()) thaw(); ttable.resize(__size); }
+  void reserve(size_type __size) { if (frozen()) thaw(); ttable.reserve(__size); }
 
   void initialize()
   {
+    release();
+    
     for (size_type i = 0; i != ttable.size(); ++ i)
       if (ttable.exists(i))
         ttable[i].clear();
@@ -717,6 +958,8 @@ struct ttable_type
 
   ttable_type& operator+=(const ttable_type& x)
   {
+    if (frozen()) thaw();
+    
     for (size_type i = 0; i != x.ttable.size(); ++ i) 
       if (x.ttable.exists(i))
 	ttable[i] += x.ttable[i];
@@ -726,6 +969,8 @@ struct ttable_type
 
   ttable_type& operator|=(const ttable_type& x)
   {
+    if (frozen()) thaw();
+    
     for (size_type i = 0; i != x.ttable.size(); ++ i) 
       if (x.ttable.exists(i))
 	ttable[i] |= x.ttable[i];
@@ -733,7 +978,22 @@ struct ttable_type
     return *this;
   }
   
+  // drop the frozen table, without restoring the hash tables
+  void release()
+  {
+    offset_set_type().swap(frozen_offsets);
+    id_set_type().swap(frozen_ids);
+    prob_set_type().swap(frozen_probs);
+  }
+  
   count_dict_type ttable;
+  
+  offset_set_type frozen_offsets;
+  id_set_type     frozen_ids;
+  prob_set_type   frozen_probs;
+  
+  dense_set_type  dense;
+  
   double prior;
   double smooth;
 };
@@ -1345,6 +1605,145 @@ struct dtable_type
   cache_type     cache_none_unk;
 };
 
+//
+// pre-tokenized bitext, which is constructed once and memory-mapped, so that the EM iterations
+// need not re-parse the bitext and re-intern the words.
+//
+// words:   word ids of source and target, concatenated for each bitext
+// offsets: offsets into words, two for each bitext, and the sentinel
+// points:  alignment points, if supplied, indexed by alignments
+//
+struct BitextCache
+{
+  typedef size_t    size_type;
+  typedef ptrdiff_t difference_type;
+  
+  typedef uint64_t                   offset_type;
+  typedef alignment_type::point_type point_type;
+
+  typedef utils::map_file<word_type, std::allocator<word_type> >     word_set_type;
+  typedef utils::map_file<offset_type, std::allocator<offset_type> > offset_set_type;
+  typedef utils::map_file<point_type, std::allocator<point_type> >   point_set_type;
+  
+  BitextCache() {}
+  BitextCache(const path_type& source_file, const path_type& target_file, const path_type& alignment_file)
+  {
+    open(source_file, target_file, alignment_file);
+  }
+
+  bool is_open() const { return offsets.is_open(); }
+  bool empty() const { return size() == 0; }
+  size_type size() const { return offsets.empty() ? size_type(0) : size_type(offsets.size() >> 1); }
+
+  size_type source_size(size_type pos) const { return offsets[(pos << 1) + 1] - offsets[pos << 1]; }
+  size_type target_size(size_type pos) const { return offsets[(pos << 1) + 2] - offsets[(pos << 1) + 1]; }
+  
+  void source(size_type pos, sentence_type& sentence) const
+  {
+    sentence.assign(words.begin() + offsets[pos << 1], words.begin() + offsets[(pos << 1) + 1]);
+  }
+  
+  void target(size_type pos, sentence_type& sentence) const
+  {
+    sentence.assign(words.begin() + offsets[(pos << 1) + 1], words.begin() + offsets[(pos << 1) + 2]);
+  }
+
+  void alignment(size_type pos, alignment_type& alignment) const
+  {
+    if (alignments.empty())
+      alignment.clear();
+    else
+      alignment.assign(points.begin() + alignments[pos], points.begin() + alignments[pos + 1]);
+  }
+  
+  void clear()
+  {
+    words.clear();
+    offsets.clear();
+    points.clear();
+    alignments.clear();
+  }
+  
+  void open(const path_type& source_file, const path_type& target_file, const path_type& alignment_file)
+  {
+    clear();
+    
+    const path_type tmp_dir = utils::tempfile::tmp_dir();
+
+    const path_type path_words      = utils::tempfile::file_name(tmp_dir / "cicada.bitext.words.XXXXXX");
+    const path_type path_offsets    = utils::tempfile::file_name(tmp_dir / "cicada.bitext.offsets.XXXXXX");
+    const path_type path_points     = utils::tempfile::file_name(tmp_dir / "cicada.bitext.points.XXXXXX");
+    const path_type path_alignments = utils::tempfile::file_name(tmp_dir / "cicada.bitext.alignments.XXXXXX");
+
+    utils::tempfile::insert(path_words);
+    utils::tempfile::insert(path_offsets);
+    utils::tempfile::insert(path_points);
+    utils::tempfile::insert(path_alignments);
+    
+    {
+      utils::compress_istream is_src(source_file, 1024 * 1024);
+      utils::compress_istream is_trg(target_file, 1024 * 1024);
+      std::auto_ptr<std::istream> is_align(! alignment_file.empty()
+					   ? new utils::compress_istream(alignment_file, 1024 * 1024) : 0);
+      
+      utils::compress_ostream os_words(path_words, 1024 * 1024);
+      utils::compress_ostream os_offsets(path_offsets, 1024 * 1024);
+      utils::compress_ostream os_points(path_points, 1024 * 1024);
+      utils::compress_ostream os_alignments(path_alignments, 1024 * 1024);
+      
+      sentence_type  source;
+      sentence_type  target;
+      alignment_type alignment;
+      
+      offset_type offset_words = 0;
+      offset_type offset_points = 0;
+      
+      for (;;) {
+	is_src >> source;
+	is_trg >> target;
+	if (is_align.get())
+	  *is_align >> alignment;
+	
+	if (! is_src || ! is_trg || (is_align.get() && ! *is_align)) break;
+	
+	if (source.empty() || target.empty()) continue;
+	
+	os_offsets.write((char*) &offset_words, sizeof(offset_type));
+	os_words.write((char*) &(*source.begin()), sizeof(word_type) * source.size());
+	offset_words += source.size();
+	
+	os_offsets.write((char*) &offset_words, sizeof(offset_type));
+	os_words.write((char*) &(*target.begin()), sizeof(word_type) * target.size());
+	offset_words += target.size();
+	
+	if (is_align.get()) {
+	  os_alignments.write((char*) &offset_points, sizeof(offset_type));
+	  if (! alignment.empty())
+	    os_points.write((char*) &(*alignment.begin()), sizeof(point_type) * alignment.size());
+	  offset_points += alignment.size();
+	}
+      }
+      
+      if (is_src || is_trg || (is_align.get() && *is_align))
+	throw std::runtime_error("# of samples do not match");
+      
+      os_offsets.write((char*) &offset_words, sizeof(offset_type));
+      if (is_align.get())
+	os_alignments.write((char*) &offset_points, sizeof(offset_type));
+    }
+    
+    words.open(path_words);
+    offsets.open(path_offsets);
+    points.open(path_points);
+    alignments.open(path_alignments);
+  }
+  
+  word_set_type   words;
+  offset_set_type offsets;
+  point_set_type  points;
+  offset_set_type alignments;
+};
+
 struct LearnBase
 {
   typedef size_t    size_type;
@@ -1467,6 +1866,10 @@ struct LearnBase
     ttable_counts_source_target.resize(word_type::allocated());
     ttable_counts_target_source.resize(word_type::allocated());
     
+    // the pairs in the frozen tables are counted in dense arrays
+    ttable_counts_source_target.assign_dense(ttable_source_target);
+    ttable_counts_target_source.assign_dense(ttable_target_source);
+    
     aligned_source_target.clear();
     aligned_target_source.clear();
     aligned_source_target.reserve(word_type::allocated());
@@ -1718,12 +2121,17 @@ void write_lexicon(const path_type& path, const ttable_type& lexicon, const alig
   const aligned_type::aligned_map_type __empty;
   sorted_type sorted;
   
-  ttable_type::count_dict_type::const_iterator siter_begin = lexicon.ttable.begin();
-  ttable_type::count_dict_type::const_iterator siter_end   = lexicon.ttable.end();
-  for (ttable_type::count_dict_type::const_iterator siter = siter_begin; siter != siter_end; ++ siter) 
-    if (*siter) {
-      const word_type source(word_type::id_type(siter - siter_begin));
-      const ttable_type::count_map_type& dict = *(*siter);
+  // rows of a frozen lexicon are copied
+  ttable_type::count_map_type frozen;
+  
+  for (word_type::id_type source_id = 0; source_id != lexicon.size(); ++ source_id) 
+    if (lexicon.exists(source_id)) {
+      const word_type source(source_id);
+      
+      if (lexicon.frozen())
+	lexicon.row(source, frozen);
+      
+      const ttable_type::count_map_type& dict = (lexicon.frozen() ? frozen : lexicon[source]);
       
       if (dict.empty()) continue;
       
@@ -70,6 +70,7 @@ double l0_beta = 0.01;
 double threshold = 0.0;
 
 int threads = 2;
+int compress_threads = 0;
 
 int debug = 0;
 
@@ -123,6 +124,9 @@ int main(int argc, char ** argv)
       hybrid_mode = true;
 
     threads = utils::bithack::max(threads, 1);
+
+    if (compress_threads > 0)
+      utils::compress_stream_threads(compress_threads);
     
     ttable_type ttable_source_target(prior_lexicon, smooth_lexicon);
     ttable_type ttable_target_source(prior_lexicon, smooth_lexicon);
@@ -192,6 +196,9 @@ int main(int argc, char ** argv)
       }
     }
     
+    ttable_source_target.freeze();
+    ttable_target_source.freeze();
+    
     if (! viterbi_source_target_file.empty() || ! viterbi_target_source_file.empty()) {
       if (itg_mode) {
 	if (debug)
@@ -282,20 +289,10 @@ int main(int argc, char ** argv)
 
 struct LearnMapReduce
 {
-  struct bitext_type
-  {
-    bitext_type() : source(), target(), alignment() {}
-    bitext_type(const sentence_type& __source, const sentence_type& __target)
-      : source(__source), target(__target), alignment() {}
-    bitext_type(const sentence_type& __source, const sentence_type& __target, const alignment_type& __alignment)
-      : source(__source), target(__target), alignment(__alignment) {}
-    
-    sentence_type source;
-    sentence_type target;
-    alignment_type alignment;
-  };
+  typedef BitextCache bitext_set_type;
   
-  typedef std::vector<bitext_type, std::allocator<bitext_type> > bitext_set_type;
+  typedef bitext_set_type::size_type        size_type;
+  typedef std::pair<size_type, size_type> range_type;
   
   struct ttable_counts_type
   {
@@ -314,8 +311,9 @@ struct LearnMapReduce
   };
 
   
-  typedef utils::lockfree_list_queue<bitext_set_type, std::allocator<bitext_set_type> >       queue_bitext_type;
+  typedef utils::lockfree_list_queue<range_type, std::allocator<range_type> >                 queue_bitext_type;
   typedef utils::lockfree_list_queue<ttable_counts_type, std::allocator<ttable_counts_type> > queue_ttable_type;
+  typedef std::vector<const ttable_type*, std::allocator<const ttable_type*> >                ttable_count_set_type;
   typedef std::vector<queue_ttable_type, std::allocator<queue_ttable_type> >                  queue_ttable_set_type;
 };
 
@@ -338,8 +336,12 @@ struct LearnReducer : public Maximizer
   
   typedef map_reduce_type::ttable_counts_type ttable_counts_type;
   typedef map_reduce_type::queue_ttable_type  queue_ttable_type;
+  typedef map_reduce_type::ttable_count_set_type ttable_count_set_type;
   
   LearnReducer(queue_ttable_type& __queue,
+	       const ttable_count_set_type& __ttable_counts,
+	       const size_type __shard,
+	       const size_type __shards,
 	       const ttable_type& __ttable,
 	       const aligned_type& __aligned,
 	       ttable_type& __ttable_new,
@@ -347,6 +349,9 @@ struct LearnReducer : public Maximizer
 	       const Maximizer& __base)
     : Maximizer(__base),
       queue(__queue),
+      ttable_counts(__ttable_counts),
+      shard(__shard),
+      shards(__shards),
       ttable(__ttable),
       aligned(__aligned),
       ttable_new(__ttable_new),
@@ -377,21 +382,36 @@ struct LearnReducer : public Maximizer
 	aligned_reduced.clear(word_id);
       }
 
-    ttable_type::count_map_type ttable_empty;
+    // the counts of the words in this shard: the hashed counts sent by the mappers, and the dense counts of the mappers,
+    // which are complete, since the mappers have terminated
+    const word_type::id_type word_last = utils::bithack::max(ttable_reduced.size(), ttable.size());
     
-    for (word_type::id_type word_id = 0; word_id < ttable_reduced.size(); ++ word_id)
-      if (ttable_reduced.exists(word_id)) { 
-	if (ttable.exists(word_id))
-	  Maximizer::operator()(ttable_reduced[word_id], ttable[word_id], ttable_new[word_id], ttable.prior, ttable.smooth);
-	else
-	  Maximizer::operator()(ttable_reduced[word_id], ttable_empty, ttable_new[word_id], ttable.prior, ttable.smooth);
+    ttable_type::count_map_type counts;
+    ttable_type::count_map_type probs;
+    
+    for (word_type::id_type word_id = shard; word_id < word_last; word_id += shards) {
+      if (ttable_reduced.exists(word_id))
+	counts.swap(ttable_reduced[word_id]);
+      
+      ttable.accumulate(word_id, ttable_counts.begin(), ttable_counts.end(), counts);
+      
+      if (! counts.empty()) {
+	ttable.row(word_id, probs);
 	
-	ttable_reduced.clear(word_id);
+	Maximizer::operator()(counts, probs, ttable_new[word_id], ttable.prior, ttable.smooth);
       }
+      
+      counts.clear();
+      ttable_reduced.clear(word_id);
+    }
   }
   
   queue_ttable_type& queue;
   
+  const ttable_count_set_type& ttable_counts;
+  const size_type              shard;
+  const size_type              shards;
+  
   const ttable_type&  ttable;
   const aligned_type& aligned;
 
@@ -407,16 +427,20 @@ struct LearnMapper : public Learner
   
   typedef map_reduce_type::bitext_set_type    bitext_set_type;
   typedef map_reduce_type::ttable_counts_type ttable_counts_type;
+  typedef map_reduce_type::size_type          size_type;
+  typedef map_reduce_type::range_type         range_type;
   
   typedef map_reduce_type::queue_bitext_type      queue_bitext_type;
   typedef map_reduce_type::queue_ttable_type      queue_ttable_type;
   typedef map_reduce_type::queue_ttable_set_type  queue_ttable_set_type;
   
-  LearnMapper(queue_bitext_type& __queue_bitext,
+  LearnMapper(const bitext_set_type& __bitexts,
+	      queue_bitext_type& __queue_bitext,
 	      queue_ttable_set_type& __queue_ttable_source_target,
 	      queue_ttable_set_type& __queue_ttable_target_source,
 	      const LearnBase& __base)
     : Learner(__base),
+      bitexts(__bitexts),
       queue_bitext(__queue_bitext),
       queue_ttable_source_target(__queue_ttable_source_target),
       queue_ttable_target_source(__queue_ttable_target_source) {}
@@ -425,21 +449,27 @@ struct LearnMapper : public Learner
   {
     Learner::initialize();
 
-    bitext_set_type    bitexts;
+    range_type     range;
+    sentence_type  source;
+    sentence_type  target;
+    alignment_type alignment;
     
     const int iter_mask = (1 << 5) - 1;
     
     for (int iter = 0;; ++ iter) {
-      bitexts.clear();
-      queue_bitext.pop_swap(bitexts);
-      if (bitexts.empty()) break;
+      queue_bitext.pop(range);
+      if (range.first == range.second) break;
       
-      typename bitext_set_type::const_iterator biter_end = bitexts.end();
-      for (typename bitext_set_type::const_iterator biter = bitexts.begin(); biter != biter_end; ++ biter) {
-	if (biter->alignment.empty())
-	  Learner::operator()(biter->source, biter->target);
+      // materialize the pre-tokenized bitexts, no parsing nor interning
+      for (size_type pos = range.first; pos != range.second; ++ pos) {
+	bitexts.source(pos, source);
+	bitexts.target(pos, target);
+	bitexts.alignment(pos, alignment);
+	
+	if (alignment.empty())
+	  Learner::operator()(source, target);
 	else
-	  Learner::operator()(biter->source, biter->target, biter->alignment);
+	  Learner::operator()(source, target, alignment);
       }
 
       if ((iter & iter_mask) == iter_mask) {
@@ -497,6 +527,7 @@ struct LearnMapper : public Learner
     Learner::aligned_target_source.clear();
   }
   
+  const bitext_set_type& bitexts;
   queue_bitext_type& queue_bitext;
   queue_ttable_set_type& queue_ttable_source_target;
   queue_ttable_set_type& queue_ttable_target_source;
@@ -521,6 +552,8 @@ void merge_tables(TableSet& tables, Table& merged)
 	merged[word_type(word_id)].swap(tables[i][word_type(word_id)]);
 }
 
+static BitextCache bitext_cache;
+
 template <typename Learner, typename Maximizer>
 void learn(const Maximizer& maximizer, 
 	   ttable_type& ttable_source_target,
@@ -532,12 +565,14 @@ void learn(const Maximizer& maximizer,
   typedef LearnMapper<Learner> mapper_type;
   typedef LearnReducer<Maximizer> reducer_type;
   
-  typedef map_reduce_type::bitext_type     bitext_type;
   typedef map_reduce_type::bitext_set_type bitext_set_type;
+  typedef map_reduce_type::size_type       size_type;
+  typedef map_reduce_type::range_type      range_type;
   
   typedef map_reduce_type::queue_bitext_type      queue_bitext_type;
   typedef map_reduce_type::queue_ttable_type      queue_ttable_type;
   typedef map_reduce_type::queue_ttable_set_type  queue_ttable_set_type;
+  typedef map_reduce_type::ttable_count_set_type  ttable_count_set_type;
   
   typedef std::vector<mapper_type, std::allocator<mapper_type> > mapper_set_type;
   
@@ -545,7 +580,8 @@ void learn(const Maximizer& maximizer,
   queue_ttable_set_type queue_ttable_source_target(utils::bithack::max(1, threads / 2));
   queue_ttable_set_type queue_ttable_target_source(utils::bithack::max(1, threads / 2));
   
-  mapper_set_type  mappers(threads, mapper_type(queue_bitext,
+  mapper_set_type  mappers(threads, mapper_type(bitext_cache,
+						queue_bitext,
 						queue_ttable_source_target,
 						queue_ttable_target_source,
 						LearnBase(ttable_source_target, ttable_target_source)));
@@ -553,6 +589,21 @@ void learn(const Maximizer& maximizer,
   etable_type etable_source_target(length_source_target);
   etable_type etable_target_source(length_target_source);
 
+  // we will tokenize the bitext only once, and share among all the iterations
+  if (! bitext_cache.is_open()) {
+    utils::resource cache_start;
+    
+    bitext_cache.open(source_file, target_file, alignment_file);
+    
+    utils::resource cache_end;
+    
+    if (debug)
+      std::cerr << "bitext cache: " << bitext_cache.size()
+		<< " cpu time: " << (cache_end.cpu_time() - cache_start.cpu_time())
+		<< " user time: " << (cache_end.user_time() - cache_start.user_time())
+		<< std::endl;
+  }
+
   for (int iter = 0; iter < iteration; ++ iter) {
     if (debug)
       std::cerr << "iteration: " << (iter + 1) << std::endl;
@@ -567,15 +618,31 @@ void learn(const Maximizer& maximizer,
     std::vector<aligned_type, std::allocator<aligned_type> > aligned_source_target_new(threads);
     std::vector<aligned_type, std::allocator<aligned_type> > aligned_target_source_new(threads);
     
+    // freeze the current tables for the lookups by the mappers
+    ttable_source_target.freeze();
+    ttable_target_source.freeze();
+    
     boost::thread_group workers_mapper;
     boost::thread_group workers_reducer_source_target;
     boost::thread_group workers_reducer_target_source;
     
+    // the dense counts of the mappers, summed by the reducers after the mappers terminate
+    ttable_count_set_type ttable_counts_source_target;
+    ttable_count_set_type ttable_counts_target_source;
+    
+    for (size_t i = 0; i != mappers.size(); ++ i) {
+      ttable_counts_source_target.push_back(&mappers[i].ttable_counts_source_target);
+      ttable_counts_target_source.push_back(&mappers[i].ttable_counts_target_source);
+    }
+    
     for (size_t i = 0; i != mappers.size(); ++ i)
       workers_mapper.add_thread(new boost::thread(boost::ref(mappers[i])));
     
     for (size_t i = 0; i != queue_ttable_source_target.size(); ++ i)
       workers_reducer_source_target.add_thread(new boost::thread(reducer_type(queue_ttable_source_target[i],
+									      ttable_counts_source_target,
+									      i,
+									      queue_ttable_source_target.size(),
 									      ttable_source_target,
 									      aligned_source_target,
 									      ttable_source_target_new[i],
@@ -583,75 +650,55 @@ void learn(const Maximizer& maximizer,
 									      maximizer)));
     for (size_t i = 0; i != queue_ttable_target_source.size(); ++ i)
       workers_reducer_target_source.add_thread(new boost::thread(reducer_type(queue_ttable_target_source[i],
+									      ttable_counts_target_source,
+									      i,
+									      queue_ttable_target_source.size(),
 									      ttable_target_source,
 									      aligned_target_source,
 									      ttable_target_source_new[i],
 									      aligned_target_source_new[i],
 									      maximizer)));
     
-    utils::compress_istream is_src(source_file, 1024 * 1024);
-    utils::compress_istream is_trg(target_file, 1024 * 1024);
-    std::auto_ptr<std::istream> is_align(! alignment_file.empty()
-					 ? new utils::compress_istream(alignment_file, 1024 * 1024) : 0);
-    
-    bitext_type     bitext;
-    bitext_set_type bitexts;
-    
     size_t num_bitext = 0;
     size_t length_source = 0;
     size_t length_target = 0;
     double objective_source_target = 0.0;
     double objective_target_source = 0.0;
     
-    for (;;) {
-      is_src >> bitext.source;
-      is_trg >> bitext.target;
-      if (is_align.get())
-	*is_align >> bitext.alignment;
-      
-      if (! is_src || ! is_trg || (is_align.get() && ! *is_align)) break;
-      
-      if (bitext.source.empty() || bitext.target.empty()) continue;
+    for (size_type first = 0; first != bitext_cache.size(); /**/) {
+      const size_type last = utils::bithack::min(first + 64, bitext_cache.size());
       
-      length_source += bitext.source.size();
-      length_target += bitext.target.size();
-      
-      objective_source_target += (utils::mathop::log(etable_source_target(bitext.target.size(), bitext.source.size()))
-				  / bitext.target.size());
-      objective_target_source += (utils::mathop::log(etable_target_source(bitext.source.size(), bitext.target.size()))
-				  / bitext.source.size());
-
-      bitexts.push_back(bitext);
-
-      ++ num_bitext;
-      if (debug) {
-	if (num_bitext % DEBUG_DOT == 0)
-	  std::cerr << '.';
-	if (num_bitext % DEBUG_LINE == 0)
-	  std::cerr << '\n';
+      for (size_type pos = first; pos != last; ++ pos) {
+	const size_type source_size = bitext_cache.source_size(pos);
+	const size_type target_size = bitext_cache.target_size(pos);
+	
+	length_source += source_size;
+	length_target += target_size;
+	
+	objective_source_target += utils::mathop::log(etable_source_target(target_size, source_size)) / target_size;
+	objective_target_source += utils::mathop::log(etable_target_source(source_size, target_size)) / source_size;
+	
+	++ num_bitext;
+	if (debug) {
+	  if (num_bitext % DEBUG_DOT == 0)
+	    std::cerr << '.';
+	  if (num_bitext % DEBUG_LINE == 0)
+	    std::cerr << '\n';
+	}
       }
       
-      if (bitexts.size() == 64) {
-	queue_bitext.push_swap(bitexts);
-	bitexts.clear();
-      }
+      queue_bitext.push(range_type(first, last));
+      
+      first = last;
     }
-
-    if (! bitexts.empty())
-      queue_bitext.push_swap(bitexts);
     
     if (debug && ((num_bitext / DEBUG_DOT) % DEBUG_WRAP))
       std::cerr << std::endl;
     if (debug)
       std::cerr << "# of bitexts: " << num_bitext << std::endl;
-
-    if (is_src || is_trg || (is_align.get() && *is_align))
-      throw std::runtime_error("# of samples do not match");
     
-    for (size_t i = 0; i != mappers.size(); ++ i) {
-      bitexts.clear();
-      queue_bitext.push_swap(bitexts);
-    }
+    for (size_t i = 0; i != mappers.size(); ++ i)
+      queue_bitext.push(range_type(0, 0));
     
     workers_mapper.join_all();
     
@@ -688,6 +735,11 @@ void learn(const Maximizer& maximizer,
     workers_reducer_source_target.join_all();
     workers_reducer_target_source.join_all();
     
+    for (size_t i = 0; i != mappers.size(); ++ i) {
+      mappers[i].ttable_counts_source_target.clear_dense();
+      mappers[i].ttable_counts_target_source.clear_dense();
+    }
+    
     // merge ttable and aligned...
     merge_tables(ttable_source_target_new, ttable_source_target);
     merge_tables(ttable_target_source_new, ttable_target_source);
@@ -1966,6 +2018,7 @@ void options(int argc, char** argv)
     ("threshold", po::value<double>(&threshold)->default_value(threshold), "write with beam-threshold (<= 0.0 implies no beam)")
 
     ("threads", po::value<int>(&threads), "# of threads")
+    ("compress-threads", po::value<int>(&compress_threads), "# of threads for compressed streams")
     
     ("debug", po::value<int>(&debug)->implicit_value(1), "debug level")
     ("help", "help message");
@@ -45,6 +45,8 @@ struct LearnModel1 : public LearnBase
     
     double logsum = 0.0;
     
+    gather.assign(ttable, source, target);
+    
     probs.reserve(source_size + 1);
     probs.resize(source_size + 1);
     
@@ -74,7 +76,7 @@ struct LearnModel1 : public LearnBase
 	for (point_set_type::const_iterator iter = points[trg].begin(); iter != iter_end; ++ iter) {
 	  const int src = *iter;
 	  
-	  probs[src] = ttable(source[src], target[trg]) * prob_align * prob_align_norm;
+	  probs[src] = gather(src + 1, trg) * prob_align * prob_align_norm;
 	  prob_sum += probs[src];
 	  
 	  if (probs[src] > prob_max) {
@@ -87,7 +89,7 @@ struct LearnModel1 : public LearnBase
 	
 	const double factor = 1.0 / prob_sum;
 	for (point_set_type::const_iterator iter = points[trg].begin(); iter != iter_end; ++ iter)
-	  counts[source[*iter]][target[trg]] += probs[*iter] * factor;
+	  counts.count(gather, *iter + 1, trg) += probs[*iter] * factor;
 	
 	aligned[word_max].insert(target[trg]);
 	
@@ -96,7 +98,7 @@ struct LearnModel1 : public LearnBase
 	double prob_sum = 0.0;
       
 	prob_set_type::iterator piter = probs.begin();
-	*piter = ttable(vocab_type::EPSILON, target[trg]) * prob_null;
+	*piter = gather(0, trg) * prob_null;
 	prob_sum += *piter;
 	
 	double prob_max    = *piter;
@@ -105,7 +107,7 @@ struct LearnModel1 : public LearnBase
 	++ piter;
 	
 	for (size_type src = 0; src != source_size; ++ src, ++ piter) {
-	  *piter = ttable(source[src], target[trg]) * prob_align * prob_align_norm;
+	  *piter = gather(src + 1, trg) * prob_align * prob_align_norm;
 	  prob_sum += *piter;
 	  
 	  if (*piter > prob_max) {
@@ -118,11 +120,11 @@ struct LearnModel1 : public LearnBase
 	
 	const double factor = 1.0 / prob_sum;
 	piter = probs.begin();
-	counts[vocab_type::EPSILON][target[trg]] += (*piter) * factor;
+	counts.count(gather, 0, trg) += (*piter) * factor;
 	++ piter;
 	
 	for (size_type src = 0; src != source_size; ++ src, ++ piter)
-	  counts[source[src]][target[trg]] += (*piter) * factor;
+	  counts.count(gather, src + 1, trg) += (*piter) * factor;
 	
 	aligned[word_max].insert(target[trg]);
       }
@@ -146,6 +148,8 @@ struct LearnModel1 : public LearnBase
     
     double logsum = 0.0;
     
+    gather.assign(ttable, source, target);
+    
     probs.reserve(source_size + 1);
     probs.resize(source_size + 1);
     
@@ -155,7 +159,7 @@ struct LearnModel1 : public LearnBase
       
       
       prob_set_type::iterator piter = probs.begin();
-      *piter = ttable(vocab_type::EPSILON, target[trg]) * prob_null;
+      *piter = gather(0, trg) * prob_null;
       prob_sum += *piter;
       
       double prob_max    = *piter;
@@ -164,7 +168,7 @@ struct LearnModel1 : public LearnBase
       ++ piter;
       
       for (size_type src = 0; src != source_size; ++ src, ++ piter) {
-	*piter = ttable(source[src], target[trg]) * prob_align * prob_align_norm;
+	*piter = gather(src + 1, trg) * prob_align * prob_align_norm;
 	prob_sum += *piter;
 	
 	if (*piter > prob_max) {
@@ -177,11 +181,11 @@ struct LearnModel1 : public LearnBase
       
       const double factor = 1.0 / prob_sum;
       piter = probs.begin();
-      counts[vocab_type::EPSILON][target[trg]] += (*piter) * factor;
+      counts.count(gather, 0, trg) += (*piter) * factor;
       ++ piter;
       
       for (size_type src = 0; src != source_size; ++ src, ++ piter)
-	counts[source[src]][target[trg]] += (*piter) * factor;
+	counts.count(gather, src + 1, trg) += (*piter) * factor;
       
       aligned[word_max].insert(target[trg]);
     }
@@ -203,11 +207,13 @@ struct LearnModel1 : public LearnBase
 
   void shrink()
   {
-    
+    gather.shrink();
   }
   
   prob_set_type  probs;
   point_map_type points;
+  
+  ttable_type::gather_type gather;
 };
 
 struct LearnModel1Posterior : public LearnBase
@@ -238,6 +244,8 @@ struct LearnModel1Posterior : public LearnBase
     
     double logsum = 0.0;
     
+    gather.assign(ttable, source, target);
+    
     posterior.clear();
     probs.clear();
     
@@ -284,7 +292,7 @@ struct LearnModel1Posterior : public LearnBase
 	  
 	  double& prob = probs(trg + 1, src + 1);
 	  
-	  prob = ttable(source[src], target[trg]) * prob_align * prob_align_norm;
+	  prob = gather(src + 1, trg) * prob_align * prob_align_norm;
 	  prob_sum += prob;
 	  
 	  if (prob > prob_max) {
@@ -309,7 +317,7 @@ struct LearnModel1Posterior : public LearnBase
       
 	posterior_set_type::iterator piter     = probs.begin(trg + 1);
 	posterior_set_type::iterator piter_end = probs.end(trg + 1);
-	*piter = ttable(vocab_type::EPSILON, target[trg]) * prob_null;
+	*piter = gather(0, trg) * prob_null;
 	prob_sum += *piter;
       
 	double prob_max    = *piter;
@@ -318,7 +326,7 @@ struct LearnModel1Posterior : public LearnBase
 	++ piter;
       
 	for (size_type src = 0; src != source_size; ++ src, ++ piter) {
-	  *piter = ttable(source[src], target[trg]) * prob_align * prob_align_norm;
+	  *piter = gather(src + 1, trg) * prob_align * prob_align_norm;
 	  prob_sum += *piter;
 	
 	  if (*piter > prob_max) {
@@ -374,7 +382,7 @@ struct LearnModel1Posterior : public LearnBase
     // update...
     for (size_type trg = 1; trg <= target_size; ++ trg)
       for (size_type src = 0; src <= source_size; ++ src)
-	counts[src == 0 ? vocab_type::EPSILON : source[src - 1]][target[trg - 1]] += posterior(trg, src);
+	counts.count(gather, src, trg - 1) += posterior(trg, src);
   }
   
   void learn(const sentence_type& source,
@@ -392,6 +400,8 @@ struct LearnModel1Posterior : public LearnBase
     
     double logsum = 0.0;
     
+    gather.assign(ttable, source, target);
+    
     posterior.reserve(target_size + 1, source_size + 1);
     probs.reserve(target_size + 1, source_size + 1);
     
@@ -413,7 +423,7 @@ struct LearnModel1Posterior : public LearnBase
       
       posterior_set_type::iterator piter     = probs.begin(trg + 1);
       posterior_set_type::iterator piter_end = probs.end(trg + 1);
-      *piter = ttable(vocab_type::EPSILON, target[trg]) * prob_null;
+      *piter = gather(0, trg) * prob_null;
       prob_sum += *piter;
       
       double prob_max    = *piter;
@@ -422,7 +432,7 @@ struct LearnModel1Posterior : public LearnBase
       ++ piter;
       
       for (size_type src = 0; src != source_size; ++ src, ++ piter) {
-	*piter = ttable(source[src], target[trg]) * prob_align * prob_align_norm;
+	*piter = gather(src + 1, trg) * prob_align * prob_align_norm;
 	prob_sum += *piter;
 	
 	if (*piter > prob_max) {
@@ -477,7 +487,7 @@ struct LearnModel1Posterior : public LearnBase
     // update...
     for (size_type trg = 1; trg <= target_size; ++ trg)
       for (size_type src = 0; src <= source_size; ++ src)
-	counts[src == 0 ? vocab_type::EPSILON : source[src - 1]][target[trg - 1]] += posterior(trg, src);
+	counts.count(gather, src, trg - 1) += posterior(trg, src);
   }
 
   void operator()(const sentence_type& source, const sentence_type& target)
@@ -494,7 +504,7 @@ struct LearnModel1Posterior : public LearnBase
 
   void shrink()
   {
-    
+    gather.shrink();
   }
 
   posterior_set_type posterior;
@@ -503,6 +513,8 @@ struct LearnModel1Posterior : public LearnBase
   
   prob_set_type      phi;
   prob_set_type      exp_phi;
+  
+  ttable_type::gather_type gather;
 };
 
 struct LearnModel1Symmetric : public LearnBase
@@ -559,6 +571,9 @@ struct LearnModel1Symmetric : public LearnBase
     double logsum_source_target = 0.0;
     double logsum_target_source = 0.0;
     
+    gather_source_target.assign(ttable_source_target, source, target);
+    gather_target_source.assign(ttable_target_source, target, source);
+    
     for (size_type trg = 0; trg != target_size; ++ trg) {
       if (! points_source_target[trg].empty()) {
 	const double prob_align_norm = 1.0 / source_size;
@@ -574,7 +589,7 @@ struct LearnModel1Symmetric : public LearnBase
 	  const int src = *iter;
 	  
 	  double& prob = prob_source_target[src + 1];
-	  prob = ttable_source_target(source[src], target[trg]) * prob_align * prob_align_norm;
+	  prob = gather_source_target(src + 1, trg) * prob_align * prob_align_norm;
 	  prob_sum += prob;
 	  
 	  if (prob > prob_max) {
@@ -600,7 +615,7 @@ struct LearnModel1Symmetric : public LearnBase
       
 	prob_set_type::iterator piter     = prob_source_target.begin();
 	prob_set_type::iterator piter_end = prob_source_target.end();
-	*piter = ttable_source_target(vocab_type::EPSILON, target[trg]) * prob_null;
+	*piter = gather_source_target(0, trg) * prob_null;
 	prob_sum += *piter;
       
 	double prob_max    = *piter;
@@ -609,7 +624,7 @@ struct LearnModel1Symmetric : public LearnBase
 	++ piter;
       
 	for (size_type src = 0; src != source_size; ++ src, ++ piter) {
-	  *piter = ttable_source_target(source[src], target[trg]) * prob_align * prob_align_norm;
+	  *piter = gather_source_target(src + 1, trg) * prob_align * prob_align_norm;
 	  prob_sum += *piter;
 	
 	  if (*piter > prob_max) {
@@ -646,7 +661,7 @@ struct LearnModel1Symmetric : public LearnBase
 	  const int trg = *iter;
 	  
 	  double& prob = prob_target_source[trg + 1];
-	  prob = ttable_target_source(target[trg], source[src]) * prob_align * prob_align_norm;
+	  prob = gather_target_source(trg + 1, src) * prob_align * prob_align_norm;
 	  prob_sum += prob;
 	  
 	  if (prob > prob_max) {
@@ -672,7 +687,7 @@ struct LearnModel1Symmetric : public LearnBase
       
 	prob_set_type::iterator piter     = prob_target_source.begin();
 	prob_set_type::iterator piter_end = prob_target_source.end();
-	*piter = ttable_target_source(vocab_type::EPSILON, source[src]) * prob_null;
+	*piter = gather_target_source(0, src) * prob_null;
 	prob_sum += *piter;
       
 	double prob_max    = *piter;
@@ -681,7 +696,7 @@ struct LearnModel1Symmetric : public LearnBase
 	++ piter;
       
 	for (size_type trg = 0; trg != target_size; ++ trg, ++ piter) {
-	  *piter = ttable_target_source(target[trg], source[src]) * prob_align * prob_align_norm;
+	  *piter = gather_target_source(trg + 1, src) * prob_align * prob_align_norm;
 	  prob_sum += *piter;
 
 	  if (*piter > prob_max) {
@@ -712,14 +727,11 @@ struct LearnModel1Symmetric : public LearnBase
 	if (src != 0 && trg != 0)
 	  count = utils::mathop::sqrt(count);
 	
-	const word_type& source_word = (src == 0 ? vocab_type::EPSILON : source[src - 1]);
-	const word_type& target_word = (trg == 0 ? vocab_type::EPSILON : target[trg - 1]);
-	
 	if (trg != 0)
-	  ttable_counts_source_target[source_word][target_word] += count;
+	  ttable_counts_source_target.count(gather_source_target, src, trg - 1) += count;
 	
 	if (src != 0)
-	  ttable_counts_target_source[target_word][source_word] += count;
+	  ttable_counts_target_source.count(gather_target_source, trg, src - 1) += count;
       }
     
     objective_source_target += logsum_source_target / target_size;
@@ -751,13 +763,16 @@ struct LearnModel1Symmetric : public LearnBase
     double logsum_source_target = 0.0;
     double logsum_target_source = 0.0;
     
+    gather_source_target.assign(ttable_source_target, source, target);
+    gather_target_source.assign(ttable_target_source, target, source);
+    
     for (size_type trg = 0; trg != target_size; ++ trg) {
       const double prob_align_norm = 1.0 / source_size;
       double prob_sum = 0.0;
       
       prob_set_type::iterator piter     = prob_source_target.begin();
       prob_set_type::iterator piter_end = prob_source_target.end();
-      *piter = ttable_source_target(vocab_type::EPSILON, target[trg]) * prob_null;
+      *piter = gather_source_target(0, trg) * prob_null;
       prob_sum += *piter;
       
       double prob_max    = *piter;
@@ -766,7 +781,7 @@ struct LearnModel1Symmetric : public LearnBase
       ++ piter;
       
       for (size_type src = 0; src != source_size; ++ src, ++ piter) {
-	*piter = ttable_source_target(source[src], target[trg]) * prob_align * prob_align_norm;
+	*piter = gather_source_target(src + 1, trg) * prob_align * prob_align_norm;
 	prob_sum += *piter;
 	
 	if (*piter > prob_max) {
@@ -793,7 +808,7 @@ struct LearnModel1Symmetric : public LearnBase
       
       prob_set_type::iterator piter     = prob_target_source.begin();
       prob_set_type::iterator piter_end = prob_target_source.end();
-      *piter = ttable_target_source(vocab_type::EPSILON, source[src]) * prob_null;
+      *piter = gather_target_source(0, src) * prob_null;
       prob_sum += *piter;
       
       double prob_max    = *piter;
@@ -802,7 +817,7 @@ struct LearnModel1Symmetric : public LearnBase
       ++ piter;
       
       for (size_type trg = 0; trg != target_size; ++ trg, ++ piter) {
-	*piter = ttable_target_source(target[trg], source[src]) * prob_align * prob_align_norm;
+	*piter = gather_target_source(trg + 1, src) * prob_align * prob_align_norm;
 	prob_sum += *piter;
 
 	if (*piter > prob_max) {
@@ -832,14 +847,11 @@ struct LearnModel1Symmetric : public LearnBase
 	if (src != 0 && trg != 0)
 	  count = utils::mathop::sqrt(count);
 	
-	const word_type& source_word = (src == 0 ? vocab_type::EPSILON : source[src - 1]);
-	const word_type& target_word = (trg == 0 ? vocab_type::EPSILON : target[trg - 1]);
-	
 	if (trg != 0)
-	  ttable_counts_source_target[source_word][target_word] += count;
+	  ttable_counts_source_target.count(gather_source_target, src, trg - 1) += count;
 	
 	if (src != 0)
-	  ttable_counts_target_source[target_word][source_word] += count;
+	  ttable_counts_target_source.count(gather_target_source, trg, src - 1) += count;
       }
     
     objective_source_target += logsum_source_target / target_size;
@@ -848,7 +860,8 @@ struct LearnModel1Symmetric : public LearnBase
 
   void shrink()
   {
-    
+    gather_source_target.shrink();
+    gather_target_source.shrink();
   }
 
   prob_set_type      prob_source_target;
@@ -858,6 +871,9 @@ struct LearnModel1Symmetric : public LearnBase
 
   point_map_type points_source_target;
   point_map_type points_target_source;
+  
+  ttable_type::gather_type gather_source_target;
+  ttable_type::gather_type gather_target_source;
 };
 
 struct LearnModel1SymmetricPosterior : public LearnBase
@@ -924,6 +940,9 @@ struct LearnModel1SymmetricPosterior : public LearnBase
     double logsum_source_target = 0.0;
     double logsum_target_source = 0.0;
     
+    gather_source_target.assign(ttable_source_target, source, target);
+    gather_target_source.assign(ttable_target_source, target, source);
+    
     for (size_type trg = 0; trg != target_size; ++ trg) {
       if (! points_source_target[trg].empty()) {
 	const double prob_align_norm = 1.0 / source_size;
@@ -937,7 +956,7 @@ struct LearnModel1SymmetricPosterior : public LearnBase
 	  const int src = *iter;
 	  
 	  double& prob = prob_source_target(trg + 1, src + 1);
-	  prob = ttable_source_target(source[src], target[trg]) * prob_align * prob_align_norm;
+	  prob = gather_source_target(src + 1, trg) * prob_align * prob_align_norm;
 	  prob_sum += prob;
 	  
 	  if (prob > prob_max) {
@@ -962,7 +981,7 @@ struct LearnModel1SymmetricPosterior : public LearnBase
       
 	posterior_set_type::iterator piter     = prob_source_target.begin(trg + 1);
 	posterior_set_type::iterator piter_end = prob_source_target.end(trg + 1);
-	*piter = ttable_source_target(vocab_type::EPSILON, target[trg]) * prob_null;
+	*piter = gather_source_target(0, trg) * prob_null;
 	prob_sum += *piter;
       
 	double prob_max    = *piter;
@@ -971,7 +990,7 @@ struct LearnModel1SymmetricPosterior : public LearnBase
 	++ piter;
       
 	for (size_type src = 0; src != source_size; ++ src, ++ piter) {
-	  *piter = ttable_source_target(source[src], target[trg]) * prob_align * prob_align_norm;
+	  *piter = gather_source_target(src + 1, trg) * prob_align * prob_align_norm;
 	  prob_sum += *piter;
 	
 	  if (*piter > prob_max) {
@@ -1007,7 +1026,7 @@ struct LearnModel1SymmetricPosterior : public LearnBase
 	  
 	  double& prob = prob_target_source(src + 1, trg + 1);
 	  
-	  prob = ttable_target_source(target[trg], source[src]) * prob_align * prob_align_norm;
+	  prob = gather_target_source(trg + 1, src) * prob_align * prob_align_norm;
 	  prob_sum += prob;
 	  
 	  if (prob > prob_max) {
@@ -1033,7 +1052,7 @@ struct LearnModel1SymmetricPosterior : public LearnBase
       
 	posterior_set_type::iterator piter     = prob_target_source.begin(src + 1);
 	posterior_set_type::iterator piter_end = prob_target_source.end(src + 1);
-	*piter = ttable_target_source(vocab_type::EPSILON, source[src]) * prob_null;
+	*piter = gather_target_source(0, src) * prob_null;
 	prob_sum += *piter;
       
 	double prob_max    = *piter;
@@ -1042,7 +1061,7 @@ struct LearnModel1SymmetricPosterior : public LearnBase
 	++ piter;
       
 	for (size_type trg = 0; trg != target_size; ++ trg, ++ piter) {
-	  *piter = ttable_target_source(target[trg], source[src]) * prob_align * prob_align_norm;
+	  *piter = gather_target_source(trg + 1, src) * prob_align * prob_align_norm;
 	  prob_sum += *piter;
 	
 	  if (*piter > prob_max) {
@@ -1113,14 +1132,11 @@ struct LearnModel1SymmetricPosterior : public LearnBase
     // since we have already adjusted posterior, we simply accumulate individual counts...
     for (size_type src = 0; src <= source_size; ++ src)
       for (size_type trg = (src == 0); trg <= target_size; ++ trg) {
-	const word_type& source_word = (src == 0 ? vocab_type::EPSILON : source[src - 1]);
-	const word_type& target_word = (trg == 0 ? vocab_type::EPSILON : target[trg - 1]);
-	
 	if (trg != 0)
-	  ttable_counts_source_target[source_word][target_word] += posterior_source_target(trg, src);
+	  ttable_counts_source_target.count(gather_source_target, src, trg - 1) += posterior_source_target(trg, src);
 	
 	if (src != 0)
-	  ttable_counts_target_source[target_word][source_word] += posterior_target_source(src, trg);
+	  ttable_counts_target_source.count(gather_target_source, trg, src - 1) += posterior_target_source(src, trg);
       }
   }
 
@@ -1159,13 +1175,16 @@ struct LearnModel1SymmetricPosterior : public LearnBase
     double logsum_source_target = 0.0;
     double logsum_target_source = 0.0;
     
+    gather_source_target.assign(ttable_source_target, source, target);
+    gather_target_source.assign(ttable_target_source, target, source);
+    
     for (size_type trg = 0; trg != target_size; ++ trg) {
       const double prob_align_norm = 1.0 / source_size;
       double prob_sum = 0.0;
       
       posterior_set_type::iterator piter     = prob_source_target.begin(trg + 1);
       posterior_set_type::iterator piter_end = prob_source_target.end(trg + 1);
-      *piter = ttable_source_target(vocab_type::EPSILON, target[trg]) * prob_null;
+      *piter = gather_source_target(0, trg) * prob_null;
       prob_sum += *piter;
       
       double prob_max    = *piter;
@@ -1174,7 +1193,7 @@ struct LearnModel1SymmetricPosterior : public LearnBase
       ++ piter;
       
       for (size_type src = 0; src != source_size; ++ src, ++ piter) {
-	*piter = ttable_source_target(source[src], target[trg]) * prob_align * prob_align_norm;
+	*piter = gather_source_target(src + 1, trg) * prob_align * prob_align_norm;
 	prob_sum += *piter;
 	
 	if (*piter > prob_max) {
@@ -1201,7 +1220,7 @@ struct LearnModel1SymmetricPosterior : public LearnBase
       
       posterior_set_type::iterator piter     = prob_target_source.begin(src + 1);
       posterior_set_type::iterator piter_end = prob_target_source.end(src + 1);
-      *piter = ttable_target_source(vocab_type::EPSILON, source[src]) * prob_null;
+      *piter = gather_target_source(0, src) * prob_null;
       prob_sum += *piter;
       
       double prob_max    = *piter;
@@ -1210,7 +1229,7 @@ struct LearnModel1SymmetricPosterior : public LearnBase
       ++ piter;
       
       for (size_type trg = 0; trg != target_size; ++ trg, ++ piter) {
-	*piter = ttable_target_source(target[trg], source[src]) * prob_align * prob_align_norm;
+	*piter = gather_target_source(trg + 1, src) * prob_align * prob_align_norm;
 	prob_sum += *piter;
 	
 	if (*piter > prob_max) {
@@ -1280,21 +1299,18 @@ struct LearnModel1SymmetricPosterior : public LearnBase
     // since we have already adjusted posterior, we simply accumulate individual counts...
     for (size_type src = 0; src <= source_size; ++ src)
       for (size_type trg = (src == 0); trg <= target_size; ++ trg) {
-	const word_type& source_word = (src == 0 ? vocab_type::EPSILON : source[src - 1]);
-	const word_type& target_word = (trg == 0 ? vocab_type::EPSILON : target[trg - 1]);
-	
 	if (trg != 0)
-	  ttable_counts_source_target[source_word][target_word] += posterior_source_target(trg, src);
+	  ttable_counts_source_target.count(gather_source_target, src, trg - 1) += posterior_source_target(trg, src);
 	
 	if (src != 0)
-	  ttable_counts_target_source[target_word][source_word] += posterior_target_source(src, trg);
+	  ttable_counts_target_source.count(gather_target_source, trg, src - 1) += posterior_target_source(src, trg);
       }
   }
 
   void shrink()
   {
-    
-  
+    gather_source_target.shrink();
+    gather_target_source.shrink();
   }
   
   posterior_set_type prob_source_target;
@@ -1307,6 +1323,9 @@ struct LearnModel1SymmetricPosterior : public LearnBase
   
   point_map_type points_source_target;
   point_map_type points_target_source;
+  
+  ttable_type::gather_type gather_source_target;
+  ttable_type::gather_type gather_target_source;
 };
 
 struct ViterbiModel1 : public ViterbiBase
@@ -413,10 +413,12 @@ struct LearnModel4 : public LearnBase
       ttable.reserve(target.size() + 1, source.size() + 1);
       ttable.resize(target.size() + 1, source.size() + 1);
       
+      gather.assign(model4.ttable, source, target);
+      
       for (size_type trg = 0; trg != target.size(); ++ trg) {
-	ttable(trg + 1, 0) = model4.ttable(vocab_type::EPSILON, target[trg]);
+	ttable(trg + 1, 0) = gather(0, trg);
 	for (size_type src = 0; src != source.size(); ++ src)
-	  ttable(trg + 1, src + 1) = model4.ttable(source[src], target[trg]);
+	  ttable(trg + 1, src + 1) = gather(src + 1, trg);
       }
       
       //std::cerr << "dtable" << std::endl;
@@ -565,12 +567,8 @@ struct LearnModel4 : public LearnBase
 		    const alignment_type& alignment,
 		    ttable_type& counts)
     {
-      for (size_type trg = 1; trg != aligns.aligns.size(); ++ trg) {
-	const word_type word_source(aligns.aligns[trg] ? source[aligns.aligns[trg] - 1] : vocab_type::EPSILON);
-	const word_type word_target(target[trg - 1]);
-	
-	++ counts[word_source][word_target];
-      }
+      for (size_type trg = 1; trg != aligns.aligns.size(); ++ trg)
+	++ counts.count(gather, aligns.aligns[trg], trg - 1);
     }
 
     void accumulate(const sentence_type& source,
@@ -612,7 +610,7 @@ struct LearnModel4 : public LearnBase
       const int source_size = source.size();
       const int target_size = target.size();
       
-      {
+      if (counts.dense.empty()) {
 	// allocate enough buffer size...
 	
 	for (int src = 1; src <= source_size; ++ src) {
@@ -624,13 +622,11 @@ struct LearnModel4 : public LearnBase
 	mapped.rehash(mapped.size() + target_size);
       }
       
-      sentence_type::const_iterator titer = target.begin();
-      for (int trg = 1; trg <= target_size; ++ trg, ++ titer) {
-	counts[vocab_type::EPSILON][*titer] += posterior(trg, 0);
+      for (int trg = 1; trg <= target_size; ++ trg) {
+	counts.count(gather, 0, trg - 1) += posterior(trg, 0);
 	
-	sentence_type::const_iterator siter = source.begin();
-	for (int src = 1; src <= source_size; ++ src, ++ siter)
-	  counts[*siter][*titer] += posterior(trg, src);
+	for (int src = 1; src <= source_size; ++ src)
+	  counts.count(gather, src, trg - 1) += posterior(trg, src);
       }
     }
     
@@ -1105,6 +1101,8 @@ struct LearnModel4 : public LearnBase
       posterior_type(posterior).swap(posterior);
       posterior_type(posterior_swap).swap(posterior_swap);
       posterior_type(posterior_fertility).swap(posterior_fertility);
+      
+      gather.shrink();
     }
     
     // alignment and model score
@@ -1121,6 +1119,7 @@ struct LearnModel4 : public LearnBase
     sentence_type source_class;
     sentence_type target_class;
     
+    ttable_type::gather_type gather;
     ttable_cache_type        ttable;
     dtable_head_cache_type   dtable_head;
     dtable_others_cache_type dtable_others;
@@ -1541,14 +1540,11 @@ struct LearnModel4Symmetric : public LearnBase
 	if (src && trg)
 	  count = utils::mathop::sqrt(count);
 	
-	const word_type word_source = (! src ? vocab_type::EPSILON : source[src - 1]);
-	const word_type word_target = (! trg ? vocab_type::EPSILON : target[trg - 1]);
-	
 	if (trg)
-	  ttable_counts_source_target[word_source][word_target] += count;
+	  ttable_counts_source_target.count(model4_source_target.gather, src, trg - 1) += count;
 	
 	if (src)
-	  ttable_counts_target_source[word_target][word_source] += count;
+	  ttable_counts_target_source.count(model4_target_source.gather, trg, src - 1) += count;
       }
     
     // accumulate...
@@ -233,6 +233,7 @@ struct EnvelopeTask
   void operator()()
   {
     envelope_set_type envelopes;
+    envelope_type::line_pool_type line_pool;
 
     int seg;
     
@@ -240,10 +241,11 @@ struct EnvelopeTask
       queue.pop(seg);
       if (seg < 0) break;
       
+      line_pool.clear();
       envelopes.clear();
       envelopes.resize(graphs[seg].nodes.size());
 
-      cicada::inside(graphs[seg], envelopes, cicada::semiring::EnvelopeFunction<weight_set_type>(origin, direction));
+      cicada::inside(graphs[seg], envelopes, cicada::semiring::EnvelopeFunction<weight_set_type>(origin, direction, line_pool));
       
       const envelope_type& envelope = envelopes[graphs[seg].goal];
       const_cast<envelope_type&>(envelope).sort();
@@ -54,6 +54,7 @@ bool collapse_target = false;
 
 double max_malloc = 8; // 8 GB
 int threads = 1;
+int compress_threads = 0;
 
 int debug = 0;
 
@@ -75,6 +76,9 @@ int main(int argc, char** argv)
       throw std::runtime_error("no output directory?");
 
     threads = utils::bithack::max(threads, 1);
+
+    if (compress_threads > 0)
+      utils::compress_stream_threads(compress_threads);
     
     prepare_directory(output_file);
 
@@ -190,6 +194,7 @@ void options(int argc, char** argv)
     
     ("max-malloc", po::value<double>(&max_malloc), "maximum malloc in GB")
     ("threads",    po::value<int>(&threads),       "# of threads")
+    ("compress-threads", po::value<int>(&compress_threads), "# of threads for compressed streams")
     ;
   
   po::options_description opts_command("command line options");
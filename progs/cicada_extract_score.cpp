@@ -58,6 +58,7 @@ bool score_ghkm   = false;
 
 double max_malloc = 8; // 8 GB
 int    threads = 1;
+int    compress_threads = 0;
 
 int debug = 0;
 
@@ -106,6 +107,9 @@ int main(int argc, char** argv)
       throw std::runtime_error("specify either one of --score-phrase|scfg|ghkm");
     
     threads = utils::bithack::max(1, threads);
+    
+    if (compress_threads > 0)
+      utils::compress_stream_threads(compress_threads);
 
     path_set_type counts_files;
     
@@ -288,10 +292,21 @@ struct TaskMerge
 	    const path_type& __prefix,
 	    const size_t& __size) : files(__files), prefix(__prefix), size(__size) {}
   
+  struct generator_type
+  {
+    std::ostream& operator()(std::ostream& os, const PhrasePair& rule) const
+    {
+      return os << rule << '\n';
+    }
+  };
+  
   void operator()()
   {
     typedef PhrasePair       rule_pair_type;
     typedef PhrasePairParser rule_pair_parser_type;
+    
+    typedef MergeRuns<rule_pair_type, rule_pair_parser_type, generator_type,
+		      utils::compress_istream, utils::compress_ostream> merge_type;
 
     typedef utils::unordered_set<path_type, boost::hash<path_type>, std::equal_to<path_type>,
 				 std::allocator<path_type> >::type path_temporary_type;
@@ -305,18 +320,19 @@ struct TaskMerge
     for (path_set_type::const_iterator fiter = files.begin(); fiter != fiter_end; ++ fiter)
       size_files.push_back(size_path_type(boost::filesystem::file_size(*fiter), *fiter));
     
-    rule_pair_parser_type parser;
-    
     path_temporary_type temp;
     
     while (size_files.size() > size && size_files.size() >= 2) {
       std::sort(size_files.begin(), size_files.end(), std::greater<size_path_type>());
       
-      const path_type file1 = size_files.back().second;
-      size_files.pop_back();
+      // k-way merge of the smallest files so that we will have size files, but no more than size at once
+      const size_t merge_size = utils::bithack::min(size_files.size() - size + 1, utils::bithack::max(size, size_t(2)));
       
-      const path_type file2 = size_files.back().second;
-      size_files.pop_back();
+      path_set_type merged;
+      for (size_t i = 0; i != merge_size; ++ i) {
+	merged.push_back(size_files.back().second);
+	size_files.pop_back();
+      }
       
       const path_type counts_file_tmp = utils::tempfile::file_name(prefix / "cicada.extract.merged.XXXXXX");
       utils::tempfile::insert(counts_file_tmp);
@@ -324,59 +340,15 @@ struct TaskMerge
       utils::tempfile::insert(counts_file);
       
       temp.insert(counts_file);
-
-      {
-	utils::compress_istream is1(file1, 1024 * 1024);
-	utils::compress_istream is2(file2, 1024 * 1024);
-      
-	utils::compress_ostream os(counts_file, 1024 * 1024);
-	os.exceptions(std::ostream::eofbit | std::ostream::failbit | std::ostream::badbit);
       
-	std::string line1;
-	std::string line2;
-
-	rule_pair_type rule1;
-	rule_pair_type rule2;
+      merge_type()(merged, counts_file);
       
-	bool parsed1 = utils::getline(is1, line1) && parser(line1, rule1);
-	bool parsed2 = utils::getline(is2, line2) && parser(line2, rule2);
-      
-	while (parsed1 && parsed2) {
-	  if (rule1 < rule2) {
-	    os << rule1 << '\n';
-	    parsed1 = utils::getline(is1, line1) && parser(line1, rule1);
-	  } else if (rule2 < rule1) {
-	    os << rule2 << '\n';
-	    parsed2 = utils::getline(is2, line2) && parser(line2, rule2);
-	  } else {
-	    rule1.increment(rule2.counts.begin(), rule2.counts.end());
-	    os << rule1 << '\n';
-	    parsed1 = utils::getline(is1, line1) && parser(line1, rule1);
-	    parsed2 = utils::getline(is2, line2) && parser(line2, rule2);
-	  }
-	}
-      
-	// dump remaining...
-	while (parsed1) {
-	  os << rule1 << '\n';
-	  parsed1 = utils::getline(is1, line1) && parser(line1, rule1);
-	}
-      
-	while (parsed2) {
-	  os << rule2 << '\n';
-	  parsed2 = utils::getline(is2, line2) && parser(line2, rule2);
+      path_set_type::const_iterator miter_end = merged.end();
+      for (path_set_type::const_iterator miter = merged.begin(); miter != miter_end; ++ miter)
+	if (temp.find(*miter) != temp.end()) {
+	  boost::filesystem::remove(*miter);
+	  utils::tempfile::erase(*miter);
 	}
-      }
-      
-      if (temp.find(file1) != temp.end()) {
-	boost::filesystem::remove(file1);
-	utils::tempfile::erase(file1);
-      }
-      
-      if (temp.find(file2) != temp.end()) {
-	boost::filesystem::remove(file2);
-	utils::tempfile::erase(file2);
-      }
       
       size_files.push_back(size_path_type(boost::filesystem::file_size(counts_file), counts_file));
     }
@@ -732,6 +704,7 @@ void options(int argc, char** argv)
     
     ("max-malloc", po::value<double>(&max_malloc), "maximum malloc in GB")
     ("threads", po::value<int>(&threads), "# of threads")
+    ("compress-threads", po::value<int>(&compress_threads), "# of threads for compressed streams")
     
     ;
   
@@ -7,6 +7,7 @@
 
 #include <unistd.h>
 #include <cstring>
+#include <cmath>
 
 #include <memory>
 
@@ -27,6 +28,7 @@
 
 #include <boost/iostreams/filtering_stream.hpp>
 #include <boost/iostreams/filter/zlib.hpp>
+#include <boost/iostreams/device/file.hpp>
 #include <boost/iostreams/device/back_inserter.hpp>
 #include <boost/iostreams/device/array.hpp>
 
@@ -846,6 +848,303 @@ struct PhraseCountGenerator
   }
 };
 
+//
+// binary records for the intermediate files shared among mappers and reducers.
+// Since the records are dumped in sorted order, a phrase is front-coded by the previous one:
+// the length of the shared prefix, the length of the suffix, and the suffix, all the lengths byte-aligned coded.
+// Counts are mostly integers, thus they are byte-aligned coded (shifted by one bit), and fall back to a raw double
+// marked by the lowest bit. The streams are block-compressed by LZ4.
+//
+
+struct BinaryCodec
+{
+  typedef PhrasePair::phrase_type phrase_type;
+  typedef PhrasePair::counts_type counts_type;
+
+  static void write_code(std::ostream& os, const uint64_t value)
+  {
+    char buffer[16];
+    os.write(buffer, utils::byte_aligned_encode(value, buffer));
+  }
+
+  static bool read_code(std::streambuf& is, uint64_t& value)
+  {
+    value = 0;
+    for (int shift = 0; shift < 70; shift += 7) {
+      const int c = is.sbumpc();
+      if (c == std::char_traits<char>::eof())
+	return false;
+
+      value |= uint64_t(c & 0x7f) << shift;
+      if (! (c & 0x80))
+	return true;
+    }
+    throw std::runtime_error("invalid byte-aligned code");
+  }
+
+  static void write_phrase(std::ostream& os, phrase_type& prev, const phrase_type& phrase)
+  {
+    size_t pos = 0;
+    const size_t pos_last = utils::bithack::min(prev.size(), phrase.size());
+    for (/**/; pos != pos_last && prev[pos] == phrase[pos]; ++ pos) {}
+
+    write_code(os, pos);
+    write_code(os, phrase.size() - pos);
+    os.write(phrase.c_str() + pos, phrase.size() - pos);
+
+    prev.replace(prev.begin() + pos, prev.end(), phrase.begin() + pos, phrase.end());
+  }
+
+  static bool read_phrase(std::streambuf& is, phrase_type& prev, phrase_type& phrase)
+  {
+    uint64_t pos = 0;
+    uint64_t diff = 0;
+
+    if (! read_code(is, pos)) return false;
+    if (! read_code(is, diff) || pos > prev.size())
+      throw std::runtime_error("invalid binary phrase");
+
+    prev.resize(pos + diff);
+    if (diff && is.sgetn(&(*(prev.begin() + pos)), diff) != std::streamsize(diff))
+      throw std::runtime_error("truncated binary phrase");
+
+    phrase = prev;
+    return true;
+  }
+
+  static void write_counts(std::ostream& os, const counts_type& counts)
+  {
+    write_code(os, counts.size());
+
+    counts_type::const_iterator citer_end = counts.end();
+    for (counts_type::const_iterator citer = counts.begin(); citer != citer_end; ++ citer) {
+      const double count = *citer;
+
+      if (count >= 0.0 && count < 4503599627370496.0 && count == std::floor(count))
+	write_code(os, uint64_t(count) << 1);
+      else {
+	write_code(os, 1);
+	os.write((const char*) &count, sizeof(double));
+      }
+    }
+  }
+
+  static void read_counts(std::streambuf& is, counts_type& counts)
+  {
+    uint64_t size = 0;
+    if (! read_code(is, size))
+      throw std::runtime_error("truncated binary counts");
+
+    counts.resize(size);
+
+    counts_type::iterator citer_end = counts.end();
+    for (counts_type::iterator citer = counts.begin(); citer != citer_end; ++ citer) {
+      uint64_t code = 0;
+      if (! read_code(is, code))
+	throw std::runtime_error("truncated binary counts");
+
+      if (! (code & 0x01))
+	*citer = double(code >> 1);
+      else if (is.sgetn((char*) &(*citer), sizeof(double)) != std::streamsize(sizeof(double)))
+	throw std::runtime_error("truncated binary counts");
+    }
+  }
+};
+
+struct PhrasePairSimpleBinaryParser
+{
+  typedef PhrasePairSimple phrase_pair_type;
+
+  typedef phrase_pair_type::phrase_type    phrase_type;
+  typedef phrase_pair_type::counts_type    counts_type;
+
+  bool operator()(std::istream& is, phrase_pair_type& phrase_pair)
+  {
+    std::streambuf& buf = *is.rdbuf();
+
+    if (! BinaryCodec::read_phrase(buf, source, phrase_pair.source)) return false;
+    if (! BinaryCodec::read_phrase(buf, target, phrase_pair.target))
+      throw std::runtime_error("truncated binary phrase pair");
+
+    BinaryCodec::read_counts(buf, phrase_pair.counts);
+    return true;
+  }
+
+  phrase_type source;
+  phrase_type target;
+};
+
+struct PhrasePairSimpleBinaryGenerator
+{
+  typedef PhrasePairSimple phrase_pair_type;
+
+  typedef phrase_pair_type::phrase_type    phrase_type;
+  typedef phrase_pair_type::counts_type    counts_type;
+
+  std::ostream& operator()(std::ostream& os, const phrase_pair_type& phrase_pair)
+  {
+    BinaryCodec::write_phrase(os, source, phrase_pair.source);
+    BinaryCodec::write_phrase(os, target, phrase_pair.target);
+    BinaryCodec::write_counts(os, phrase_pair.counts);
+
+    return os;
+  }
+
+  phrase_type source;
+  phrase_type target;
+};
+
+struct PhraseCountBinaryParser
+{
+  typedef PhraseCount phrase_count_type;
+
+  typedef phrase_count_type::phrase_type    phrase_type;
+  typedef phrase_count_type::counts_type    counts_type;
+
+  bool operator()(std::istream& is, phrase_count_type& phrase_count)
+  {
+    std::streambuf& buf = *is.rdbuf();
+
+    if (! BinaryCodec::read_phrase(buf, phrase, phrase_count.phrase)) return false;
+
+    BinaryCodec::read_counts(buf, phrase_count.counts);
+    return true;
+  }
+
+  phrase_type phrase;
+};
+
+struct PhraseCountBinaryGenerator
+{
+  typedef PhraseCount phrase_count_type;
+
+  typedef phrase_count_type::phrase_type    phrase_type;
+  typedef phrase_count_type::counts_type    counts_type;
+
+  std::ostream& operator()(std::ostream& os, const phrase_count_type& phrase_count)
+  {
+    BinaryCodec::write_phrase(os, phrase, phrase_count.phrase);
+    BinaryCodec::write_counts(os, phrase_count.counts);
+
+    return os;
+  }
+
+  phrase_type phrase;
+};
+
+class BinaryOStream : public boost::iostreams::filtering_ostream
+{
+public:
+  typedef boost::filesystem::path path_type;
+
+public:
+  BinaryOStream(const path_type& path, size_t buffer_size = 4096)
+  {
+    push(codec::lz4_compressor());
+    push(boost::iostreams::file_sink(path.string(), std::ios_base::out | std::ios_base::trunc), buffer_size);
+  }
+};
+
+class BinaryIStream : public boost::iostreams::filtering_istream
+{
+public:
+  typedef boost::filesystem::path path_type;
+
+public:
+  BinaryIStream(const path_type& path, size_t buffer_size = 4096)
+  {
+    push(codec::lz4_decompressor());
+    push(boost::iostreams::file_source(path.string()), buffer_size);
+  }
+};
+
+//
+// k-way merge of sorted runs: each run keeps only its current record in the heap, and
+// the records sharing the same key are summed up, thus the memory is bounded by the # of runs.
+//
+template <typename Record, typename Parser, typename Generator, typename IStream, typename OStream>
+struct MergeRuns
+{
+  typedef boost::filesystem::path                            path_type;
+  typedef std::vector<path_type, std::allocator<path_type> > path_set_type;
+
+  typedef Record    record_type;
+  typedef Parser    parser_type;
+  typedef Generator generator_type;
+
+  typedef IStream istream_type;
+  typedef OStream ostream_type;
+
+  struct run_type
+  {
+    run_type(const path_type& path) : is(new istream_type(path, 1024 * 1024)), record(), parser() {}
+
+    bool next() { return parser(*is, record); }
+
+    boost::shared_ptr<istream_type> is;
+    record_type record;
+    parser_type parser;
+  };
+
+  typedef std::vector<run_type, std::allocator<run_type> > run_set_type;
+
+  struct greater_run
+  {
+    bool operator()(const run_type* x, const run_type* y) const
+    {
+      return x->record > y->record;
+    }
+  };
+
+  void operator()(const path_set_type& inputs, const path_type& output) const
+  {
+    typedef std::vector<run_type*, std::allocator<run_type*> > pqueue_base_type;
+    typedef std::priority_queue<run_type*, pqueue_base_type, greater_run> pqueue_type;
+
+    run_set_type runs;
+    runs.reserve(inputs.size());
+
+    pqueue_type pqueue;
+
+    typename path_set_type::const_iterator piter_end = inputs.end();
+    for (typename path_set_type::const_iterator piter = inputs.begin(); piter != piter_end; ++ piter)
+      runs.push_back(run_type(*piter));
+
+    typename run_set_type::iterator riter_end = runs.end();
+    for (typename run_set_type::iterator riter = runs.begin(); riter != riter_end; ++ riter)
+      if (riter->next())
+	pqueue.push(&(*riter));
+
+    ostream_type os(output, 1024 * 1024);
+    os.exceptions(std::ostream::eofbit | std::ostream::failbit | std::ostream::badbit);
+
+    generator_type generator;
+    record_type    curr;
+    bool           found = false;
+
+    while (! pqueue.empty()) {
+      run_type* run = pqueue.top();
+      pqueue.pop();
+
+      if (! found) {
+	curr.swap(run->record);
+	found = true;
+      } else if (curr == run->record)
+	curr.increment(run->record.counts.begin(), run->record.counts.end());
+      else {
+	generator(os, curr);
+	curr.swap(run->record);
+      }
+
+      if (run->next())
+	pqueue.push(run);
+    }
+
+    if (found)
+      generator(os, curr);
+  }
+};
+
 struct PhrasePairExtractor
 {
   typedef uint64_t                            hash_value_type;
@@ -1171,14 +1470,10 @@ struct PhrasePairSourceReducer
   typedef map_reduce_type::queue_ptr_type     queue_ptr_type;
   typedef map_reduce_type::queue_ptr_set_type queue_ptr_set_type;
   
-  typedef PhraseCountParser    phrase_count_parser_type;
-  typedef PhraseCountGenerator phrase_count_generator_type;
+  typedef PhraseCountBinaryGenerator phrase_count_generator_type;
   
   typedef ExtractRoot extract_root_type;
   
-  phrase_count_parser_type    parser;
-  phrase_count_generator_type generator;
-
   queue_ptr_set_type& queues;
   
   path_type      prefix;
@@ -1266,15 +1561,17 @@ struct PhrasePairSourceReducer
     {
       const path_type counts_file_tmp = utils::tempfile::file_name(prefix / "cicada.extract.source.XXXXXX");
       utils::tempfile::insert(counts_file_tmp);
-      const path_type counts_file = counts_file_tmp.string() + ".gz";
+      const path_type counts_file = counts_file_tmp.string() + ".lz4";
       utils::tempfile::insert(counts_file);
       
       path = counts_file;
     }
     
-    utils::compress_ostream os(path, 1024 * 1024);
+    BinaryOStream os(path, 1024 * 1024);
     os.exceptions(std::ostream::eofbit | std::ostream::failbit | std::ostream::badbit);
     
+    phrase_count_generator_type generator;
+    
     simple_type counts;
     std::string root_source;
     size_type observed = 0;
@@ -1292,7 +1589,7 @@ struct PhrasePairSourceReducer
 	if (observed) {
 	  counts.counts.push_back(observed);
 	  
-	  generator(os, phrase_count_type(counts.source, counts.counts)) << '\n';
+	  generator(os, phrase_count_type(counts.source, counts.counts));
 	}
 
 	root_source = extract_root(curr.source);
@@ -1341,7 +1638,7 @@ struct PhrasePairSourceReducer
     if (observed) {
       counts.counts.push_back(observed);
       
-      generator(os, phrase_count_type(counts.source, counts.counts)) << '\n';
+      generator(os, phrase_count_type(counts.source, counts.counts));
     }
     
     progress.final();
@@ -1602,8 +1899,10 @@ struct PhrasePairReverseReducer
   typedef map_reduce_type::queue_ptr_type     queue_ptr_type;
   typedef map_reduce_type::queue_ptr_set_type queue_ptr_set_type;
   
-  typedef PhrasePairSimpleParser    simple_parser_type;
-  typedef PhrasePairSimpleGenerator simple_generator_type;
+  typedef PhrasePairSimpleBinaryParser    simple_parser_type;
+  typedef PhrasePairSimpleBinaryGenerator simple_generator_type;
+  
+  typedef MergeRuns<simple_type, simple_parser_type, simple_generator_type, BinaryIStream, BinaryOStream> merge_type;
 
   typedef utils::unordered_set<simple_type, boost::hash<simple_type>, std::equal_to<simple_type>,
 			       std::allocator<simple_type> >::type simple_unique_type;
@@ -1635,9 +1934,6 @@ struct PhrasePairReverseReducer
 			     string_hash, std::equal_to<std::string>,
 			     std::allocator<std::string> > unique_set_type;
   
-  simple_parser_type    parser;
-  simple_generator_type generator;
-
   queue_type&    queue;
   path_type      prefix;
   path_set_type& paths;
@@ -1675,47 +1971,7 @@ struct PhrasePairReverseReducer
   };
 
 
-  // merge counts from two streams into os..
-  void merge_counts(std::istream& is1, std::istream& is2, std::ostream& os)
-  {
-    std::string line1;
-    std::string line2;
-    simple_type simple1;
-    simple_type simple2;
-    
-    bool parsed1 = utils::getline(is1, line1) && parser(line1, simple1);
-    bool parsed2 = utils::getline(is2, line2) && parser(line2, simple2);
-    
-    while (parsed1 && parsed2) {
-      if (simple1 < simple2) {
-	generator(os, simple1) << '\n';
-	parsed1 = utils::getline(is1, line1) && parser(line1, simple1);
-      } else if (simple2 < simple1) {
-	generator(os, simple2) << '\n';
-	parsed2 = utils::getline(is2, line2) && parser(line2, simple2);
-      } else {
-	simple1.increment(simple2.counts.begin(), simple2.counts.end());
-	generator(os, simple1) << '\n';
-	
-	parsed1 = utils::getline(is1, line1) && parser(line1, simple1);
-	parsed2 = utils::getline(is2, line2) && parser(line2, simple2);	
-      }
-    }
-    
-    // dump remaining...
-    while (parsed1) {
-      generator(os, simple1) << '\n';
-      parsed1 = utils::getline(is1, line1) && parser(line1, simple1);
-    }
-    
-    while (parsed2) {
-      generator(os, simple2) << '\n';
-      parsed2 = utils::getline(is2, line2) && parser(line2, simple2);
-    }
-  }
-  
-  
-  // merge from smallest files...
+  // merge from smallest files by a k-way merge, at most max_files at once...
   void merge_counts(path_set_type& paths)
   {
     typedef std::pair<size_t, path_type> size_path_type;
@@ -1734,32 +1990,27 @@ struct PhrasePairReverseReducer
       // sort according to the file-size...
       std::sort(size_paths.begin(), size_paths.end(), std::greater<size_path_type>());
       
-      const path_type file1 = size_paths.back().second;
-      size_paths.pop_back();
+      // merge the smallest files so that we will have max_files, but no more than max_files at once
+      const size_t merge_size = utils::bithack::min(size_paths.size() - max_files + 1, utils::bithack::max(max_files, size_t(2)));
       
-      const path_type file2 = size_paths.back().second;
-      size_paths.pop_back();
+      path_set_type files;
+      for (size_t i = 0; i != merge_size; ++ i) {
+	files.push_back(size_paths.back().second);
+	size_paths.pop_back();
+      }
       
       const path_type counts_file_tmp = utils::tempfile::file_name(prefix / "cicada.extract.reversed.XXXXXX");
       utils::tempfile::insert(counts_file_tmp);
-      const path_type counts_file = counts_file_tmp.string() + ".gz";
+      const path_type counts_file = counts_file_tmp.string() + ".lz4";
       utils::tempfile::insert(counts_file);
       
-      {
-	utils::compress_istream is1(file1, 1024 * 1024);
-	utils::compress_istream is2(file2, 1024 * 1024);
-	
-	utils::compress_ostream os(counts_file, 1024 * 1024);
-	os.exceptions(std::ostream::eofbit | std::ostream::failbit | std::ostream::badbit);
-	
-	merge_counts(is1, is2, os);
-      }
-      
-      boost::filesystem::remove(file1);
-      boost::filesystem::remove(file2);
+      merge_type()(files, counts_file);
       
-      utils::tempfile::erase(file1);
-      utils::tempfile::erase(file2);
+      path_set_type::const_iterator fiter_end = files.end();
+      for (path_set_type::const_iterator fiter = files.begin(); fiter != fiter_end; ++ fiter) {
+	boost::filesystem::remove(*fiter);
+	utils::tempfile::erase(*fiter);
+      }
       
       size_paths.push_back(size_path_type(boost::filesystem::file_size(counts_file), counts_file));
     }
@@ -1799,18 +2050,20 @@ struct PhrasePairReverseReducer
     // tempfile...
     const path_type counts_file_tmp = utils::tempfile::file_name(prefix / "cicada.extract.reversed.XXXXXX");
     utils::tempfile::insert(counts_file_tmp);
-    const path_type counts_file = counts_file_tmp.string() + ".gz";
+    const path_type counts_file = counts_file_tmp.string() + ".lz4";
     utils::tempfile::insert(counts_file);
     
     paths.push_back(counts_file);
 
     // final dump!
-    utils::compress_ostream os(counts_file, 1024 * 1024);
+    BinaryOStream os(counts_file, 1024 * 1024);
     os.exceptions(std::ostream::eofbit | std::ostream::failbit | std::ostream::badbit);
     
+    simple_generator_type generator;
+    
     sorted_type::const_iterator siter_end = sorted.end();
     for (sorted_type::const_iterator siter = sorted.begin(); siter != siter_end; ++ siter)
-      generator(os, *(*siter)) << '\n';
+      generator(os, *(*siter));
   }
 
   struct EmptyProgress
@@ -2070,8 +2323,16 @@ struct PhrasePairTargetMapper
   
   typedef PhraseSet phrase_set_type;
 
-  typedef PhrasePairSimpleParser    simple_parser_type;
-  typedef PhrasePairSimpleGenerator simple_generator_type;
+  typedef PhrasePairSimpleBinaryParser simple_parser_type;
+  
+  // a binary stream and its parser, which keeps the state of the front-coding
+  struct reader_type
+  {
+    reader_type(const path_type& path) : is(path, 1024 * 1024), parser() {}
+    
+    BinaryIStream      is;
+    simple_parser_type parser;
+  };
   
   typedef ExtractRoot extract_root_type;
   
@@ -2112,18 +2373,12 @@ struct PhrasePairTargetMapper
     }
   };
 
-  simple_parser_type    parser;
-  simple_generator_type generator;
-
-  std::string line;
   simple_type phrase_pair;
 
   template <typename Counts>
-  void read_phrase_pair(std::istream& is, Counts& counts)
+  void read_phrase_pair(reader_type& reader, Counts& counts)
   {    
-    while (counts.size() < 256 && utils::getline(is, line)) {
-      if (! parser(line, phrase_pair)) continue;
-      
+    while (counts.size() < 256 && reader.parser(reader.is, phrase_pair)) {
       if (counts.empty() || counts.back().source != phrase_pair.source)
 	counts.push_back(phrase_pair);
       else if (counts.back().target != phrase_pair.target) {
@@ -2152,18 +2407,17 @@ struct PhrasePairTargetMapper
   template <typename Progress>
   void operator()(const Progress& progress)
   {
-    typedef utils::compress_istream         istream_type;
-    typedef boost::shared_ptr<istream_type> istream_ptr_type;
-    typedef std::vector<istream_ptr_type, std::allocator<istream_ptr_type> > istream_ptr_set_type;
+    typedef boost::shared_ptr<reader_type> reader_ptr_type;
+    typedef std::vector<reader_ptr_type, std::allocator<reader_ptr_type> > reader_ptr_set_type;
     
     typedef std::deque<simple_type, std::allocator<simple_type> > buffer_type;
-    typedef std::pair<buffer_type, istream_type*> buffer_stream_type;
+    typedef std::pair<buffer_type, reader_type*> buffer_stream_type;
     typedef std::vector<buffer_stream_type, std::allocator<buffer_stream_type> > buffer_stream_set_type;
     typedef std::vector<buffer_stream_type*, std::allocator<buffer_stream_type*> > pqueue_base_type;
     typedef std::priority_queue<buffer_stream_type*, pqueue_base_type, greater_buffer<buffer_stream_type> > pqueue_type;
 
     pqueue_type            pqueue;
-    istream_ptr_set_type   istreams(paths.size());
+    reader_ptr_set_type    readers(paths.size());
     buffer_stream_set_type buffer_streams(paths.size());
     
     size_t pos = 0;
@@ -2171,12 +2425,12 @@ struct PhrasePairTargetMapper
       if (! boost::filesystem::exists(*piter))
 	throw std::runtime_error("no file? " + piter->string());
       
-      istreams[pos].reset(new istream_type(*piter, 1024 * 1024));
+      readers[pos].reset(new reader_type(*piter));
       
       buffer_stream_type* buffer_stream = &buffer_streams[pos];
-      buffer_stream->second = &(*istreams[pos]);
+      buffer_stream->second = &(*readers[pos]);
       
-      read_phrase_pair(*istreams[pos], buffer_stream->first);
+      read_phrase_pair(*readers[pos], buffer_stream->first);
       
       if (! buffer_stream->first.empty())
 	pqueue.push(buffer_stream);
@@ -2377,12 +2631,11 @@ struct PhrasePairTargetReducer
 			     string_hash, std::equal_to<std::string>,
 			     std::allocator<std::string> > unique_set_type;
 
-  typedef PhrasePairSimpleParser    simple_parser_type;
-  typedef PhrasePairSimpleGenerator simple_generator_type;
-
-  simple_parser_type    parser;
-  simple_generator_type generator;
+  typedef PhrasePairSimpleBinaryParser    simple_parser_type;
+  typedef PhrasePairSimpleBinaryGenerator simple_generator_type;
   
+  typedef MergeRuns<simple_type, simple_parser_type, simple_generator_type, BinaryIStream, BinaryOStream> merge_type;
+
   queue_type&    queue;
   path_type      prefix;
   path_set_type& paths;
@@ -2419,52 +2672,12 @@ struct PhrasePairTargetReducer
     }
   };
   
-  // merge counts from two streams into os..
-  void merge_counts(std::istream& is1, std::istream& is2, std::ostream& os)
-  {
-    std::string line1;
-    std::string line2;
-    
-    simple_type simple1;
-    simple_type simple2;
-    
-    bool parsed1 = utils::getline(is1, line1) && parser(line1, simple1);
-    bool parsed2 = utils::getline(is2, line2) && parser(line2, simple2);
-    
-    while (parsed1 && parsed2) {
-      if (simple1 < simple2) {
-	generator(os, simple1) << '\n';
-	parsed1 = utils::getline(is1, line1) && parser(line1, simple1);
-      } else if (simple2 < simple1) {
-	generator(os, simple2) << '\n';
-	parsed2 = utils::getline(is2, line2) && parser(line2, simple2);
-      } else {
-	simple1.increment(simple2.counts.begin(), simple2.counts.end());
-	generator(os, simple1) << '\n';
-	
-	parsed1 = utils::getline(is1, line1) && parser(line1, simple1);
-	parsed2 = utils::getline(is2, line2) && parser(line2, simple2);	
-      }
-    }
-    
-    // dump remaining...
-    while (parsed1) {
-      generator(os, simple1) << '\n';
-      parsed1 = utils::getline(is1, line1) && parser(line1, simple1);
-    }
-    
-    while (parsed2) {
-      generator(os, simple2) << '\n';
-      parsed2 = utils::getline(is2, line2) && parser(line2, simple2);
-    }
-  }
-  
-  // merge from smallest files...
+  // merge from smallest files by a k-way merge, at most max_files at once...
   void merge_counts(path_set_type& paths)
   {
     typedef std::pair<size_t, path_type> size_path_type;
     typedef std::vector<size_path_type, std::allocator<size_path_type> > size_path_set_type;
-    
+
     if (paths.size() <= max_files) return;
     
     size_path_set_type size_paths;
@@ -2472,42 +2685,37 @@ struct PhrasePairTargetReducer
     path_set_type::const_iterator piter_end = paths.end();
     for (path_set_type::const_iterator piter = paths.begin(); piter != piter_end; ++ piter)
       size_paths.push_back(size_path_type(boost::filesystem::file_size(*piter), *piter));
-    
+
     while (size_paths.size() > max_files) {
       
       // sort according to the file-size...
       std::sort(size_paths.begin(), size_paths.end(), std::greater<size_path_type>());
       
-      const path_type file1 = size_paths.back().second;
-      size_paths.pop_back();
+      // merge the smallest files so that we will have max_files, but no more than max_files at once
+      const size_t merge_size = utils::bithack::min(size_paths.size() - max_files + 1, utils::bithack::max(max_files, size_t(2)));
       
-      const path_type file2 = size_paths.back().second;
-      size_paths.pop_back();
+      path_set_type files;
+      for (size_t i = 0; i != merge_size; ++ i) {
+	files.push_back(size_paths.back().second);
+	size_paths.pop_back();
+      }
       
       const path_type counts_file_tmp = utils::tempfile::file_name(prefix / "cicada.extract.target.XXXXXX");
       utils::tempfile::insert(counts_file_tmp);
-      const path_type counts_file = counts_file_tmp.string() + ".gz";
+      const path_type counts_file = counts_file_tmp.string() + ".lz4";
       utils::tempfile::insert(counts_file);
       
-      {
-	utils::compress_istream is1(file1, 1024 * 1024);
-	utils::compress_istream is2(file2, 1024 * 1024);
-	
-	utils::compress_ostream os(counts_file, 1024 * 1024);
-	os.exceptions(std::ostream::eofbit | std::ostream::failbit | std::ostream::badbit);
-	
-	merge_counts(is1, is2, os);
-      }
-      
-      boost::filesystem::remove(file1);
-      boost::filesystem::remove(file2);
+      merge_type()(files, counts_file);
       
-      utils::tempfile::erase(file1);
-      utils::tempfile::erase(file2);
+      path_set_type::const_iterator fiter_end = files.end();
+      for (path_set_type::const_iterator fiter = files.begin(); fiter != fiter_end; ++ fiter) {
+	boost::filesystem::remove(*fiter);
+	utils::tempfile::erase(*fiter);
+      }
       
       size_paths.push_back(size_path_type(boost::filesystem::file_size(counts_file), counts_file));
     }
-
+    
     paths.clear();
     
     size_path_set_type::const_iterator siter_end = size_paths.end();
@@ -2543,18 +2751,20 @@ struct PhrasePairTargetReducer
     // tempfile...
     const path_type counts_file_tmp = utils::tempfile::file_name(prefix / "cicada.extract.target.XXXXXX");
     utils::tempfile::insert(counts_file_tmp);
-    const path_type counts_file = counts_file_tmp.string() + ".gz";
+    const path_type counts_file = counts_file_tmp.string() + ".lz4";
     utils::tempfile::insert(counts_file);
     
     paths.push_back(counts_file);
 
     // final dump!
-    utils::compress_ostream os(counts_file, 1024 * 1024);
+    BinaryOStream os(counts_file, 1024 * 1024);
     os.exceptions(std::ostream::eofbit | std::ostream::failbit | std::ostream::badbit);
     
+    simple_generator_type generator;
+    
     sorted_type::const_iterator siter_end = sorted.end();
     for (sorted_type::const_iterator siter = sorted.begin(); siter != siter_end; ++ siter)
-      generator(os, *(*siter)) << '\n';
+      generator(os, *(*siter));
   }
 
   struct EmptyProgress
@@ -2972,8 +3182,21 @@ struct PhrasePairScoreReducer
   typedef map_reduce_type::queue_ptr_type     queue_ptr_type;
   typedef map_reduce_type::queue_ptr_set_type queue_ptr_set_type;  
 
-  typedef PhrasePairSimpleParser    simple_parser_type;
-  typedef PhraseCountParser         phrase_parser_type;
+  typedef PhrasePairSimpleBinaryParser simple_parser_type;
+  typedef PhraseCountBinaryParser      phrase_parser_type;
+  
+  // a binary stream and its parser, which keeps the state of the front-coding
+  template <typename Parser>
+  struct reader_type
+  {
+    reader_type(const path_type& path) : is(path, 1024 * 1024), parser() {}
+    
+    BinaryIStream is;
+    Parser        parser;
+  };
+  
+  typedef reader_type<simple_parser_type> simple_reader_type;
+  typedef reader_type<phrase_parser_type> phrase_reader_type;
   
   const path_type&     path_source;
   const path_set_type& path_targets;
@@ -3082,18 +3305,12 @@ struct PhrasePairScoreReducer
       throw std::runtime_error("generation failed");
   }
   
-  simple_parser_type simple_parser;
-  phrase_parser_type phrase_parser;
-
-  std::string line;
   simple_type phrase_pair;
 
   template <typename Counts>
-  void read_phrase_pair(std::istream& is, Counts& counts)
+  void read_phrase_pair(simple_reader_type& reader, Counts& counts)
   {
-    while (counts.size() < 256 && utils::getline(is, line)) {
-      if (! simple_parser(line, phrase_pair)) continue;
-      
+    while (counts.size() < 256 && reader.parser(reader.is, phrase_pair)) {
       if (counts.empty() || counts.back().source != phrase_pair.source)
 	counts.push_back(phrase_pair);
       else if (counts.back().target != phrase_pair.target) {
@@ -3105,14 +3322,11 @@ struct PhrasePairScoreReducer
   }
   
   template <typename Counts>
-  void read_phrase(std::istream& is, Counts& counts)
+  void read_phrase(phrase_reader_type& reader, Counts& counts)
   {
-    std::string line;
     phrase_count_type phrase;
     
-    while (counts.size() < 256 && utils::getline(is, line)) {
-      if (! phrase_parser(line, phrase)) continue;
-      
+    while (counts.size() < 256 && reader.parser(reader.is, phrase)) {
       if (counts.empty() || counts.back().phrase != phrase.phrase)
 	counts.push_back(phrase);
       else
@@ -3142,12 +3356,11 @@ struct PhrasePairScoreReducer
     typedef std::vector<buffer_queue_type*, std::allocator<buffer_queue_type*> > pqueue_base_type;
     typedef std::priority_queue<buffer_queue_type*, pqueue_base_type, greater_buffer<buffer_queue_type> > pqueue_type;
     
-    typedef utils::compress_istream         istream_type;
-    typedef boost::shared_ptr<istream_type> istream_ptr_type;
-    typedef std::vector<istream_ptr_type, std::allocator<istream_ptr_type> > istream_ptr_set_type;
+    typedef boost::shared_ptr<simple_reader_type> reader_ptr_type;
+    typedef std::vector<reader_ptr_type, std::allocator<reader_ptr_type> > reader_ptr_set_type;
     
     typedef std::deque<simple_type, std::allocator<simple_type> > simple_buffer_type;
-    typedef std::pair<simple_buffer_type, istream_type*> buffer_stream_type;
+    typedef std::pair<simple_buffer_type, simple_reader_type*> buffer_stream_type;
     typedef std::vector<buffer_stream_type, std::allocator<buffer_stream_type> > buffer_stream_set_type;
     
     typedef std::vector<buffer_stream_type*, std::allocator<buffer_stream_type*> > simple_pqueue_base_type;
@@ -3161,7 +3374,7 @@ struct PhrasePairScoreReducer
     std::vector<buffer_queue_type, std::allocator<buffer_queue_type> > buffer_queues(queues.size());
     
     simple_pqueue_type     queue_target;
-    istream_ptr_set_type   istreams(path_targets.size());
+    reader_ptr_set_type    readers(path_targets.size());
     buffer_stream_set_type buffer_streams(path_targets.size());
     
     {
@@ -3185,22 +3398,22 @@ struct PhrasePairScoreReducer
 	if (! boost::filesystem::exists(*piter))
 	  throw std::runtime_error("no file? " + piter->string());
 	
-	istreams[pos].reset(new istream_type(*piter, 1024 * 1024));
+	readers[pos].reset(new simple_reader_type(*piter));
 	
 	buffer_stream_type* buffer_stream = &buffer_streams[pos];
-	buffer_stream->second = &(*istreams[pos]);
+	buffer_stream->second = &(*readers[pos]);
 	
-	read_phrase_pair(*istreams[pos], buffer_stream->first);
+	read_phrase_pair(*readers[pos], buffer_stream->first);
 	
 	if (! buffer_stream->first.empty())
 	  queue_target.push(buffer_stream);
       }
     }
 
-    utils::compress_istream is_source(path_source, 1024 * 1024);
+    phrase_reader_type reader_source(path_source);
     phrase_buffer_type buffer_source;
     
-    read_phrase(is_source, buffer_source);
+    read_phrase(reader_source, buffer_source);
     
     phrase_pair_set_type counts;
     phrase_count_type    source;
@@ -3233,7 +3446,7 @@ struct PhrasePairScoreReducer
 	buffer_source.pop_front();
 	
 	if (buffer_source.empty())
-	  read_phrase(is_source, buffer_source);
+	  read_phrase(reader_source, buffer_source);
 	
 	// next target...
 	if (queue_target.empty())
@@ -2,6 +2,185 @@
 
 #include "cicada_extract_score_impl.hpp"
 
+#include <map>
+#include <stdexcept>
+
+typedef PhrasePairSimple simple_type;
+typedef PhraseCount      phrase_count_type;
+
+typedef std::vector<simple_type, std::allocator<simple_type> > simple_set_type;
+
+typedef boost::filesystem::path                            path_type;
+typedef std::vector<path_type, std::allocator<path_type> > path_set_type;
+
+struct PhrasePairSimpleLineGenerator
+{
+  std::ostream& operator()(std::ostream& os, const simple_type& phrase_pair)
+  {
+    return generator(os, phrase_pair) << '\n';
+  }
+  
+  PhrasePairSimpleGenerator generator;
+};
+
+typedef MergeRuns<simple_type, PhrasePairSimpleBinaryParser, PhrasePairSimpleBinaryGenerator,
+		  BinaryIStream, BinaryOStream> merge_binary_type;
+typedef MergeRuns<simple_type, PhrasePairSimpleParser, PhrasePairSimpleLineGenerator,
+		  utils::compress_istream, utils::compress_ostream> merge_text_type;
+
+bool equal(const simple_set_type& x, const simple_set_type& y)
+{
+  if (x.size() != y.size()) return false;
+  
+  for (size_t i = 0; i != x.size(); ++ i)
+    if (x[i] != y[i] || ! (x[i].counts == y[i].counts))
+      return false;
+  
+  return true;
+}
+
+template <typename Parser, typename IStream>
+void read_records(const path_type& path, simple_set_type& records)
+{
+  IStream is(path);
+  Parser  parser;
+  
+  records.clear();
+  
+  simple_type record;
+  while (parser(is, record))
+    records.push_back(record);
+}
+
+template <typename Generator, typename OStream>
+void write_records(const path_type& path, const simple_set_type& records)
+{
+  OStream   os(path);
+  Generator generator;
+  
+  for (simple_set_type::const_iterator riter = records.begin(); riter != records.end(); ++ riter)
+    generator(os, *riter);
+}
+
+// sorted phrases sharing their prefixes, which are front-coded, and integral and non-integral counts,
+// including the largest integer coded as an integer and the smallest one coded as a raw double
+void test_binary_codec()
+{
+  const char* sources[] = {"", "a", "a b", "a b", "a b c", "a c", "bb c", "bb cc"};
+  const char* targets[] = {"x", "", "x", "x y", "x", "x", "", "y"};
+  const double counts[] = {0.0, 1.0, 3.0, 1099511627776.0, 4503599627370495.0, 4503599627370496.0,
+			   0.5, -1.0, 1e-300, 123.25};
+  
+  const size_t size       = sizeof(sources) / sizeof(const char*);
+  const size_t size_count = sizeof(counts) / sizeof(double);
+  
+  simple_set_type records;
+  for (size_t i = 0; i != size; ++ i)
+    records.push_back(simple_type(sources[i], targets[i],
+				  simple_type::counts_type(counts + (i % size_count), counts + utils::bithack::min(i + 3, size_count))));
+  
+  std::ostringstream os;
+  PhrasePairSimpleBinaryGenerator generator;
+  PhraseCountBinaryGenerator      generator_count;
+  for (size_t i = 0; i != size; ++ i)
+    generator(os, records[i]);
+  for (size_t i = 0; i != size; ++ i)
+    generator_count(os, phrase_count_type(records[i].source, records[i].counts));
+  
+  std::istringstream is(os.str());
+  PhrasePairSimpleBinaryParser parser;
+  PhraseCountBinaryParser      parser_count;
+  
+  simple_set_type decoded(size);
+  for (size_t i = 0; i != size; ++ i)
+    if (! parser(is, decoded[i]))
+      throw std::runtime_error("binary phrase pair: truncated");
+  
+  if (! equal(records, decoded))
+    throw std::runtime_error("binary phrase pair: different");
+  
+  for (size_t i = 0; i != size; ++ i) {
+    phrase_count_type phrase_count;
+    if (! parser_count(is, phrase_count))
+      throw std::runtime_error("binary phrase count: truncated");
+    if (phrase_count.phrase != records[i].source || ! (phrase_count.counts == records[i].counts))
+      throw std::runtime_error("binary phrase count: different");
+  }
+  
+  phrase_count_type phrase_count;
+  if (parser_count(is, phrase_count))
+    throw std::runtime_error("binary phrase count: no eof");
+  
+  std::cout << "binary codec: " << os.str().size() << " bytes" << std::endl;
+}
+
+// k-way merge of sorted runs with duplicated keys, within and across runs, by the binary and the text records
+void test_merge_runs()
+{
+  typedef std::pair<std::string, std::string> key_type;
+  typedef std::map<key_type, simple_type, std::less<key_type>, std::allocator<std::pair<const key_type, simple_type> > > merged_type;
+  
+  const char* sources[] = {"a", "a b", "a b c", "b", "b c"};
+  const char* targets[] = {"x", "x y", "y"};
+  const double counts[] = {1.0, 2.0, 0.5, 0.25, 3.0};
+  
+  const path_type tmp_dir = utils::tempfile::directory_name(utils::tempfile::tmp_dir() / "cicada.extract.score.XXXXXX");
+  utils::tempfile::insert(tmp_dir);
+  
+  path_set_type runs_binary;
+  path_set_type runs_text;
+  merged_type   merged;
+  
+  for (int run = 0; run != 4; ++ run) {
+    simple_set_type records;
+    
+    for (int i = 0; i != 20 * (run + 1); ++ i) {
+      simple_type record(sources[std::rand() % 5], targets[std::rand() % 3], simple_type::counts_type(2));
+      record.counts[0] = counts[std::rand() % 5];
+      record.counts[1] = counts[std::rand() % 5];
+      
+      records.push_back(record);
+      
+      const key_type key(record.source, record.target);
+      if (merged.find(key) == merged.end())
+	merged[key] = record;
+      else
+	merged[key].increment(record.counts.begin(), record.counts.end());
+    }
+    
+    std::sort(records.begin(), records.end());
+    
+    runs_binary.push_back(tmp_dir / ("run-" + utils::lexical_cast<std::string>(run) + ".bin"));
+    runs_text.push_back(tmp_dir / ("run-" + utils::lexical_cast<std::string>(run) + ".txt"));
+    
+    write_records<PhrasePairSimpleBinaryGenerator, BinaryOStream>(runs_binary.back(), records);
+    write_records<PhrasePairSimpleLineGenerator, utils::compress_ostream>(runs_text.back(), records);
+  }
+  
+  merge_binary_type()(runs_binary, tmp_dir / "merged.bin");
+  merge_text_type()(runs_text, tmp_dir / "merged.txt");
+  
+  simple_set_type records_binary;
+  simple_set_type records_text;
+  simple_set_type records_merged;
+  
+  read_records<PhrasePairSimpleBinaryParser, BinaryIStream>(tmp_dir / "merged.bin", records_binary);
+  read_records<PhrasePairSimpleParser, utils::compress_istream>(tmp_dir / "merged.txt", records_text);
+  
+  for (merged_type::const_iterator miter = merged.begin(); miter != merged.end(); ++ miter)
+    records_merged.push_back(miter->second);
+  
+  boost::filesystem::remove_all(tmp_dir);
+  utils::tempfile::erase(tmp_dir);
+  
+  if (! equal(records_binary, records_text))
+    throw std::runtime_error("merge runs: binary and text differ");
+  if (! equal(records_binary, records_merged))
+    throw std::runtime_error("merge runs: different merged records");
+  
+  std::cout << "merge runs: " << records_binary.size() << " records" << std::endl;
+}
+
 void dump(std::ostream& os, const RootCountParser::root_count_type& root_count)
 {
   os << "label: " << root_count.label << std::endl;
@@ -41,4 +220,13 @@ int main(int argc, char** argv)
     std::cout << "parsing failed" << std::endl;
   
   PhrasePairGenerator()(std::cout, phrase_pair) << std::endl;
+  
+  try {
+    test_binary_codec();
+    test_merge_runs();
+  }
+  catch (std::exception& err) {
+    std::cerr << "error: " << err.what() << std::endl;
+    return -1;
+  }
 }
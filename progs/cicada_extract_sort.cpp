@@ -3,6 +3,9 @@
 //
 
 #include <stdexcept>
+#include <limits>
+
+#include <sys/resource.h>
 
 #include "cicada_extract_score_impl.hpp"
 #include "cicada_output_impl.hpp"
@@ -10,6 +13,8 @@
 #include <boost/program_options.hpp>
 #include <boost/bind.hpp>
 #include <boost/filesystem.hpp>
+#include <boost/random.hpp>
+#include <boost/shared_ptr.hpp>
 
 #include <utils/resource.hpp>
 #include <utils/lockfree_list_queue.hpp>
@@ -17,6 +22,7 @@
 #include <utils/tempfile.hpp>
 #include <utils/malloc_stats.hpp>
 #include "utils/getline.hpp"
+#include "utils/random_seed.hpp"
 
 typedef PhrasePair       rule_pair_type;
 typedef PhrasePairParser rule_pair_parser_type;
@@ -29,6 +35,8 @@ path_type output_file;
 
 double max_malloc = 8;
 int threads = 1;
+int compress_threads = 0;
+bool partition_mode = false;
 
 int debug = 0;
 
@@ -59,6 +67,11 @@ struct Task
   };
 
   void dump(const rule_pair_set_type& rule_pairs)
+  {
+    dump(rule_pairs, output, paths);
+  }
+  
+  static void dump(const rule_pair_set_type& rule_pairs, const path_type& output, path_set_type& paths)
   {
     typedef std::vector<const rule_pair_type*, std::allocator<const rule_pair_type*> > sorted_type;
     
@@ -120,8 +133,335 @@ struct Task
   }
 };
 
+// partitioned sort: each task counts and dumps sorted runs as in Task, while keeping a reservoir sample
+// of the source phrases over all the lines it receives. When the input is exhausted, the key space is split
+// by the samples from all the tasks, and each task splits its runs, and the counts still in memory,
+// into the partitions. Runs are sorted by the source phrases, thus a run is split in a single sequential pass.
+typedef std::vector<std::string, std::allocator<std::string> > splitter_set_type;
+typedef std::vector<path_set_type, std::allocator<path_set_type> > path_map_type;
+
+typedef std::pair<std::string, double> sample_type;
+typedef std::vector<sample_type, std::allocator<sample_type> > sample_set_type;
+
+struct TaskPartition
+{
+  typedef Task::queue_type         queue_type;
+  typedef Task::rule_pair_set_type rule_pair_set_type;
+  
+  typedef std::vector<std::string, std::allocator<std::string> > source_set_type;
+  
+  typedef boost::mt19937 generator_type;
+  
+  // write sorted counts into the partitions, opening one partition file at a time
+  struct writer_type
+  {
+    writer_type(const splitter_set_type& __splitters, path_map_type& __paths)
+      : splitters(__splitters), paths(__paths), shard(0) {}
+    
+    std::ostream& operator()(const std::string& source)
+    {
+      const size_t shard_next = std::upper_bound(splitters.begin(), splitters.end(), source) - splitters.begin();
+      
+      if (! os || shard_next != shard) {
+	os.reset();
+	
+	shard = shard_next;
+	
+	const path_type path_tmp = utils::tempfile::file_name(utils::tempfile::tmp_dir() / "counts-XXXXXX");
+	utils::tempfile::insert(path_tmp);
+	const path_type path = path_tmp.string() + ".gz";
+	utils::tempfile::insert(path);
+	
+	os.reset(new utils::compress_ostream(path, 1024 * 1024));
+	os->precision(20);
+	
+	paths[shard].push_back(path);
+      }
+      
+      return *os;
+    }
+    
+    const splitter_set_type& splitters;
+    path_map_type&           paths;
+    size_t                   shard;
+    
+    boost::shared_ptr<utils::compress_ostream> os;
+  };
+  
+  TaskPartition(queue_type& __queue,
+		const size_t __sample_size,
+		const size_t __malloc_threshold,
+		const unsigned int seed)
+    : queue(__queue), sample_size(__sample_size), malloc_threshold(__malloc_threshold), observed(0), generator(seed) {}
+  
+  queue_type&        queue;
+  const size_t       sample_size;
+  const size_t       malloc_threshold;
+  
+  path_set_type      runs;
+  rule_pair_set_type rule_pairs;
+  
+  source_set_type    samples;
+  size_t             observed;
+  generator_type     generator;
+  
+  path_map_type      paths;
+  
+  void sample(const std::string& source)
+  {
+    ++ observed;
+    
+    if (samples.size() < sample_size)
+      samples.push_back(source);
+    else {
+      boost::random_number_generator<generator_type> gen(generator);
+      
+      const size_t pos = gen(observed);
+      if (pos < sample_size)
+	samples[pos] = source;
+    }
+  }
+  
+  void operator()()
+  {
+    rule_pair_parser_type parser;
+    rule_pair_type        rule_pair;
+    
+    std::string line;
+    
+    const size_t iter_mask = (1 << 10) - 1;
+    
+    for (size_t iter = 0; /**/; ++ iter) {
+      queue.pop_swap(line);
+      if (line.empty()) break;
+      
+      if (! parser(line, rule_pair)) continue;
+      
+      sample(rule_pair.source);
+      
+      std::pair<rule_pair_set_type::iterator, bool> result = rule_pairs.insert(rule_pair);
+      if (! result.second)
+	const_cast<rule_pair_type&>(*result.first).increment(rule_pair.counts.begin(), rule_pair.counts.end());
+      
+      if ((iter & iter_mask) == iter_mask && utils::malloc_stats::used() > malloc_threshold) {
+	Task::dump(rule_pairs, utils::tempfile::tmp_dir(), runs);
+	rule_pairs.clear();
+      }
+    }
+    
+    // the last counts are kept in memory, and directly split into the partitions
+  }
+  
+  void split(const splitter_set_type& splitters)
+  {
+    typedef std::vector<const rule_pair_type*, std::allocator<const rule_pair_type*> > sorted_type;
+    
+    paths = path_map_type(splitters.size() + 1);
+    
+    if (! rule_pairs.empty()) {
+      sorted_type sorted(rule_pairs.size());
+      {
+	sorted_type::iterator siter = sorted.begin();
+	rule_pair_set_type::const_iterator citer_end = rule_pairs.end();
+	for (rule_pair_set_type::const_iterator citer = rule_pairs.begin(); citer != citer_end; ++ citer, ++ siter)
+	  *siter = &(*citer);
+      }
+      
+      std::sort(sorted.begin(), sorted.end(), Task::less_ptr<rule_pair_type>());
+      
+      writer_type writer(splitters, paths);
+      
+      sorted_type::const_iterator siter_end = sorted.end();
+      for (sorted_type::const_iterator siter = sorted.begin(); siter != siter_end; ++ siter)
+	writer((*siter)->source) << *(*siter) << '\n';
+      
+      rule_pair_set_type().swap(rule_pairs);
+    }
+    
+    rule_pair_parser_type parser;
+    rule_pair_type        rule_pair;
+    
+    std::string line;
+    
+    path_set_type::const_iterator riter_end = runs.end();
+    for (path_set_type::const_iterator riter = runs.begin(); riter != riter_end; ++ riter) {
+      {
+	writer_type writer(splitters, paths);
+	
+	utils::compress_istream is(*riter, 1024 * 1024);
+	
+	while (utils::getline(is, line))
+	  if (parser(line, rule_pair))
+	    writer(rule_pair.source) << line << '\n';
+      }
+      
+      boost::filesystem::remove(*riter);
+      utils::tempfile::erase(*riter);
+    }
+    
+    runs.clear();
+  }
+};
+// merge all the runs of a partition into a single sorted file.
+struct TaskMergePartition
+{
+  struct generator_type
+  {
+    std::ostream& operator()(std::ostream& os, const rule_pair_type& rule_pair) const
+    {
+      return generator(os, rule_pair) << '\n';
+    }
+    
+    PhrasePairGenerator generator;
+  };
+  
+  typedef MergeRuns<rule_pair_type, rule_pair_parser_type, generator_type,
+		    utils::compress_istream, utils::compress_ostream> merge_type;
+  
+  TaskMergePartition(path_set_type& __runs,
+		     const path_type& __output,
+		     const size_t __max_files,
+		     path_type& __path)
+    : runs(__runs), output(__output), max_files(__max_files), path(__path) {}
+  
+  path_set_type& runs;
+  path_type      output;
+  size_t         max_files;
+  path_type&     path;
+  
+  path_type merge(const path_set_type& files, const path_type& dir)
+  {
+    const path_type path_tmp = utils::tempfile::file_name(dir / "counts-XXXXXX");
+    utils::tempfile::insert(path_tmp);
+    const path_type path_merged = path_tmp.string() + ".gz";
+    utils::tempfile::insert(path_merged);
+    
+    merge_type()(files, path_merged);
+    
+    path_set_type::const_iterator fiter_end = files.end();
+    for (path_set_type::const_iterator fiter = files.begin(); fiter != fiter_end; ++ fiter) {
+      boost::filesystem::remove(*fiter);
+      utils::tempfile::erase(*fiter);
+    }
+    
+    return path_merged;
+  }
+  
+  void operator()()
+  {
+    if (runs.empty()) return;
+    
+    // we keep at most max_files runs open at once
+    while (runs.size() > max_files) {
+      path_set_type files(runs.end() - max_files, runs.end());
+      runs.erase(runs.end() - max_files, runs.end());
+      
+      runs.insert(runs.begin(), merge(files, utils::tempfile::tmp_dir()));
+    }
+    
+    path = merge(runs, output);
+    
+    runs.clear();
+  }
+};
+
+// split the source phrases into # of partitions by the weighted quantiles of the samples: a sample from a task
+// which observed n lines and kept k samples stands for n / k lines.
+void compute_splitters(sample_set_type& samples, const size_t size, splitter_set_type& splitters)
+{
+  std::sort(samples.begin(), samples.end());
+  
+  double total = 0.0;
+  sample_set_type::const_iterator siter_end = samples.end();
+  for (sample_set_type::const_iterator siter = samples.begin(); siter != siter_end; ++ siter)
+    total += siter->second;
+  
+  splitters.clear();
+  if (samples.empty()) {
+    splitters.resize(size - 1);
+    return;
+  }
+  
+  double accumulated = 0.0;
+  sample_set_type::const_iterator siter = samples.begin();
+  for (size_t i = 1; i != size; ++ i) {
+    const double boundary = (total * i) / size;
+    
+    while (siter + 1 != siter_end && accumulated + siter->second < boundary) {
+      accumulated += siter->second;
+      ++ siter;
+    }
+    
+    splitters.push_back(siter->first);
+  }
+}
 void options(int argc, char** argv);
 
+// # of descriptors, after raising the soft limit up to the hard limit
+int number_descriptors()
+{
+  struct rlimit rlimits;
+  
+  getrlimit(RLIMIT_NOFILE, &rlimits);
+  
+  if (rlimits.rlim_cur != rlimits.rlim_max) {
+    struct rlimit raised = rlimits;
+    raised.rlim_cur = raised.rlim_max;
+    
+    if (setrlimit(RLIMIT_NOFILE, &raised) == 0)
+      rlimits = raised;
+  }
+  
+  return utils::bithack::min(rlimits.rlim_cur, rlim_t(std::numeric_limits<int>::max()));
+}
+
+// feed non-empty lines from the input files, or the directories of count files
+template <typename Feeder>
+void read_counts(const path_set_type& files, Feeder& feeder)
+{
+  std::string line;
+  
+  path_set_type::const_iterator fiter_end = files.end();
+  for (path_set_type::const_iterator fiter = files.begin(); fiter != fiter_end; ++ fiter) {
+    
+    if (boost::filesystem::is_directory(*fiter)) {
+      if (! boost::filesystem::exists(*fiter / "files"))
+	throw std::runtime_error("no files? " +  (*fiter / "files").string());
+      
+      std::string list;
+      utils::compress_istream is_list(*fiter / "files");
+      while (utils::getline(is_list, list)) 
+	if (! list.empty()) {
+	  const path_type path = *fiter / list;
+	  
+	  if (! boost::filesystem::exists(path))
+	    throw std::runtime_error("no count files? " + path.string());
+	  
+	  utils::compress_istream is(path, 1024 * 1024);
+	  
+	  while (utils::getline(is, line)) 
+	    if (! line.empty())
+	      feeder(line);
+	}
+    } else {
+      utils::compress_istream is(*fiter, 1024 * 1024);
+      
+      while (utils::getline(is, line)) 
+	if (! line.empty())
+	  feeder(line);
+    }
+  }
+}
+
+struct FeederQueue
+{
+  FeederQueue(Task::queue_type& __queue) : queue(__queue) {}
+  
+  void operator()(std::string& line) { queue.push_swap(line); }
+  
+  Task::queue_type& queue;
+};
+
 int main(int argc, char** argv)
 {
   try {
@@ -135,8 +475,103 @@ int main(int argc, char** argv)
     
     threads = utils::bithack::max(threads, 1);
     
+    if (compress_threads > 0)
+      utils::compress_stream_threads(compress_threads);
+    
     prepare_directory(output_file);
 
+    if (partition_mode) {
+      typedef TaskMergePartition merge_type;
+      
+      typedef TaskPartition task_type;
+      typedef std::vector<task_type, std::allocator<task_type> > task_set_type;
+      
+      task_type::queue_type queue(16 * 1024 * threads);
+      task_set_type tasks;
+      tasks.reserve(threads);
+      for (int i = 0; i != threads; ++ i)
+	tasks.push_back(task_type(queue, 1024 * 16, max_malloc * 1024 * 1024 * 1024, utils::random_seed()));
+      
+      utils::resource start;
+      
+      boost::thread_group workers;
+      for (int i = 0; i != threads; ++ i)
+	workers.add_thread(new boost::thread(boost::ref(tasks[i])));
+      
+      FeederQueue feeder(queue);
+      
+      read_counts(input_files, feeder);
+      
+      for (int i = 0; i != threads; ++ i)
+	queue.push(std::string());
+      
+      workers.join_all();
+      
+      // splitters from the samples of all the tasks
+      sample_set_type samples;
+      for (int i = 0; i != threads; ++ i) {
+	const double weight = double(tasks[i].observed) / utils::bithack::max(tasks[i].samples.size(), size_t(1));
+	
+	for (size_t pos = 0; pos != tasks[i].samples.size(); ++ pos)
+	  samples.push_back(sample_type(tasks[i].samples[pos], weight));
+	
+	TaskPartition::source_set_type().swap(tasks[i].samples);
+      }
+      
+      splitter_set_type splitters;
+      compute_splitters(samples, threads, splitters);
+      
+      if (debug)
+	std::cerr << "partition samples: " << samples.size() << std::endl;
+      
+      sample_set_type().swap(samples);
+      
+      // each task splits its runs into the partitions. One run and one partition file are open at a time.
+      boost::thread_group partitioners;
+      for (int i = 0; i != threads; ++ i)
+	partitioners.add_thread(new boost::thread(boost::bind(&task_type::split, &tasks[i], boost::cref(splitters))));
+      partitioners.join_all();
+      
+      utils::resource end_sort;
+      
+      // collect runs for each partition, and merge them in parallel
+      path_map_type runs(threads);
+      for (int i = 0; i != threads; ++ i)
+	for (int shard = 0; shard != threads; ++ shard)
+	  runs[shard].insert(runs[shard].end(), tasks[i].paths[shard].begin(), tasks[i].paths[shard].end());
+      
+      // all the mergers run concurrently, and each keeps max_files runs and its output open.
+      // Half of the descriptors are left to the rest of the process. Runs are buffered by 1MB, thus
+      // the fan-in is also bounded, which costs only a few more passes over the partition.
+      const int descriptors = number_descriptors();
+      const size_t max_files = utils::bithack::min(utils::bithack::max((descriptors >> 1) / threads - 1, 2), 128);
+      
+      path_set_type merged(threads);
+      
+      boost::thread_group mergers;
+      for (int shard = 0; shard != threads; ++ shard)
+	mergers.add_thread(new boost::thread(merge_type(runs[shard], output_file, max_files, merged[shard])));
+      mergers.join_all();
+      
+      utils::resource end;
+      
+      if (debug)
+	std::cerr << "sort counts cpu time:  " << end_sort.cpu_time() - start.cpu_time() << std::endl
+		  << "sort counts user time: " << end_sort.user_time() - start.user_time() << std::endl
+		  << "merge counts cpu time:  " << end.cpu_time() - end_sort.cpu_time() << std::endl
+		  << "merge counts user time: " << end.user_time() - end_sort.user_time() << std::endl;
+      
+      // partitions are disjoint and ordered, thus the files are listed in the partition order
+      utils::compress_ostream os(output_file / "files");
+      for (int shard = 0; shard != threads; ++ shard)
+	if (! merged[shard].empty()) {
+	  utils::tempfile::erase(merged[shard]);
+	  os << path_type(merged[shard].filename()).string() << '\n';
+	}
+      
+      return 0;
+    }
+    
     typedef Task task_type;
     typedef std::vector<task_type, std::allocator<task_type> > task_set_type;
     
@@ -149,38 +584,9 @@ int main(int argc, char** argv)
     for (int i = 0; i != threads; ++ i)
       workers.add_thread(new boost::thread(boost::ref(tasks[i])));
     
-    std::string line;
+    FeederQueue feeder(queue);
     
-    path_set_type::const_iterator fiter_end = input_files.end();
-    for (path_set_type::const_iterator fiter = input_files.begin(); fiter != fiter_end; ++ fiter) {
-      
-      if (boost::filesystem::is_directory(*fiter)) {
-	if (! boost::filesystem::exists(*fiter / "files"))
-	  throw std::runtime_error("no files? " +  (*fiter / "files").string());
-	
-	std::string list;
-	utils::compress_istream is_list(*fiter / "files");
-	while (utils::getline(is_list, list)) 
-	  if (! list.empty()) {
-	    const path_type path = *fiter / list;
-	    
-	    if (! boost::filesystem::exists(path))
-	      throw std::runtime_error("no count files? " + path.string());
-	    
-	    utils::compress_istream is(path, 1024 * 1024);
-	    
-	    while (utils::getline(is, line)) 
-	      if (! line.empty())
-		queue.push_swap(line);
-	  }
-      } else {
-	utils::compress_istream is(*fiter, 1024 * 1024);
-	
-	while (utils::getline(is, line)) 
-	  if (! line.empty())
-	    queue.push_swap(line);
-      }
-    }
+    read_counts(input_files, feeder);
 
     for (int i = 0; i != threads; ++ i)
       queue.push(std::string());
@@ -220,6 +626,8 @@ void options(int argc, char** argv)
     ("output",     po::value<path_type>(&output_file),                   "output file")
     ("max-malloc", po::value<double>(&max_malloc),                       "maximum malloc in GB")
     ("threads",    po::value<int>(&threads),                             "# of threads")
+    ("compress-threads", po::value<int>(&compress_threads), "# of threads for compressed streams")
+    ("partition",  po::bool_switch(&partition_mode),                     "partition the key space by sampling, and sort/merge each partition in parallel")
 
     ("debug", po::value<int>(&debug)->implicit_value(1), "debug level")
     ("help", "help message");
@@ -103,6 +103,7 @@ bool scorer_list = false;
 bool unite_forest = false;
 
 int threads = 2;
+int compress_threads = 0;
 
 int debug = 0;
 
@@ -205,6 +206,9 @@ int main(int argc, char ** argv)
     
     threads = utils::bithack::max(1, threads);
 
+    if (compress_threads > 0)
+      utils::compress_stream_threads(compress_threads);
+
     scorer_document_type scorers(scorer_name);
     if (! refset_path.empty())
       read_refset(refset_path, scorers);
@@ -2106,6 +2110,7 @@ void options(int argc, char** argv)
     ("unite",    po::bool_switch(&unite_forest), "unite forest sharing the same id")
 
     ("threads", po::value<int>(&threads), "# of threads")
+    ("compress-threads", po::value<int>(&compress_threads), "# of threads for compressed streams")
     
     ("debug", po::value<int>(&debug)->implicit_value(1), "debug level")
     ("help", "help message");
@@ -126,6 +126,7 @@ bool scorer_list = false;
 bool unite_kbest = false;
 
 int threads = 2;
+int compress_threads = 0;
 
 int debug = 0;
 
@@ -238,6 +239,9 @@ int main(int argc, char ** argv)
     
     threads = utils::bithack::max(1, threads);
 
+    if (compress_threads > 0)
+      utils::compress_stream_threads(compress_threads);
+
     scorer_document_type scorers(scorer_name);
 
     if (! refset_files.empty()) {
@@ -3422,6 +3426,7 @@ void options(int argc, char** argv)
     ("unite",    po::bool_switch(&unite_kbest), "unite kbest sharing the same id")
 
     ("threads", po::value<int>(&threads), "# of threads")
+    ("compress-threads", po::value<int>(&compress_threads), "# of threads for compressed streams")
     
     ("debug", po::value<int>(&debug)->implicit_value(1), "debug level")
     ("help", "help message");
@@ -1253,15 +1253,17 @@ void cicada_learn(Learner& learner,
 	segment_document_type segments;
 
 	envelope_set_type envelopes;
+	envelope_type::line_pool_type line_pool;
 	
 	for (size_t id = 0; id != forests_all.size(); ++ id)
 	  if (forests_all[id].is_valid()) {
 	    segments.push_back(segment_set_type());
 	    
+	    line_pool.clear();
 	    envelopes.clear();
 	    envelopes.resize(forests_all[id].nodes.size());
 	    
-	    cicada::inside(forests_all[id], envelopes, cicada::semiring::EnvelopeFunction<weight_set_type>(origin, direction));
+	    cicada::inside(forests_all[id], envelopes, cicada::semiring::EnvelopeFunction<weight_set_type>(origin, direction, line_pool));
 	    
 	    envelope_type& envelope = envelopes[forests_all[id].goal];
 	    envelope.sort();
@@ -1335,6 +1337,7 @@ void cicada_learn(Learner& learner,
 	
       } else {
 	envelope_set_type envelopes;
+	envelope_type::line_pool_type line_pool;
 	
 	boost::iostreams::filtering_ostream os;
 	os.push(boost::iostreams::zlib_compressor());
@@ -1342,10 +1345,11 @@ void cicada_learn(Learner& learner,
 
 	for (size_t id = 0; id != forests_all.size(); ++ id)
 	  if (forests_all[id].is_valid()) {
+	    line_pool.clear();
 	    envelopes.clear();
 	    envelopes.resize(forests_all[id].nodes.size());
 	    
-	    cicada::inside(forests_all[id], envelopes, cicada::semiring::EnvelopeFunction<weight_set_type>(origin, direction));
+	    cicada::inside(forests_all[id], envelopes, cicada::semiring::EnvelopeFunction<weight_set_type>(origin, direction, line_pool));
 	    
 	    envelope_type& envelope = envelopes[forests_all[id].goal];
 	    envelope.sort();
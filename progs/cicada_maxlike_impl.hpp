@@ -36,6 +36,7 @@ struct LineSearch
 
   segment_document_type segments;
   envelope_set_type     envelopes;
+  envelope_type::line_pool_type line_pool;
   
   line_search_type line_search;
   int debug;
@@ -57,10 +58,11 @@ struct LineSearch
 	if (debug >= 4)
 	  std::cerr << "line-search segment: " << seg << std::endl;
 	
+	line_pool.clear();
 	envelopes.clear();
 	envelopes.resize(graphs[seg].nodes.size());
 	
-	cicada::inside(graphs[seg], envelopes, cicada::semiring::EnvelopeFunction<weight_set_type>(origin, direction));
+	cicada::inside(graphs[seg], envelopes, cicada::semiring::EnvelopeFunction<weight_set_type>(origin, direction, line_pool));
 	
 	const envelope_type& envelope = envelopes[graphs[seg].goal];
 	const_cast<envelope_type&>(envelope).sort();
@@ -729,14 +729,16 @@ void EnvelopeComputer::operator()(segment_document_type& segments, const weight_
     
     // compute local envelopes
     envelope_set_type envelopes;
+    envelope_type::line_pool_type line_pool;
     
     for (int mpi_id = 0; mpi_id < static_cast<int>(graphs.size()); ++ mpi_id) {
       const int id = mpi_id * mpi_size + mpi_rank;
       
+      line_pool.clear();
       envelopes.clear();
       envelopes.resize(graphs[mpi_id].nodes.size());
       
-      cicada::inside(graphs[mpi_id], envelopes, cicada::semiring::EnvelopeFunction<weight_set_type>(origin, direction));
+      cicada::inside(graphs[mpi_id], envelopes, cicada::semiring::EnvelopeFunction<weight_set_type>(origin, direction, line_pool));
       
       const envelope_type& envelope = envelopes[graphs[mpi_id].goal];
       const_cast<envelope_type&>(envelope).sort();
@@ -801,6 +803,7 @@ void EnvelopeComputer::operator()(segment_document_type& segments, const weight_
     bcast_weights(0, direction);
 
     envelope_set_type envelopes;
+    envelope_type::line_pool_type line_pool;
     
     ostream_type os;
     os.push(boost::iostreams::zlib_compressor());
@@ -809,10 +812,11 @@ void EnvelopeComputer::operator()(segment_document_type& segments, const weight_
     for (int mpi_id = 0; mpi_id < static_cast<int>(graphs.size()); ++ mpi_id) {
       const int id = mpi_id * mpi_size + mpi_rank;
 
+      line_pool.clear();
       envelopes.clear();
       envelopes.resize(graphs[mpi_id].nodes.size());
       
-      cicada::inside(graphs[mpi_id], envelopes, cicada::semiring::EnvelopeFunction<weight_set_type>(origin, direction));
+      cicada::inside(graphs[mpi_id], envelopes, cicada::semiring::EnvelopeFunction<weight_set_type>(origin, direction, line_pool));
 
       const envelope_type& envelope = envelopes[graphs[mpi_id].goal];
       const_cast<envelope_type&>(envelope).sort();
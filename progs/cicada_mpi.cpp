@@ -32,6 +32,7 @@
 #include "utils/space_separator.hpp"
 #include "utils/random_seed.hpp"
 #include "utils/getline.hpp"
+#include "utils/arena_allocator.hpp"
 
 #include <boost/program_options.hpp>
 #include <boost/tokenizer.hpp>
@@ -615,6 +616,9 @@ struct TaskFile
 
   void operator()()
   {
+    // temporaries of the algorithms are allocated from the arena, reset for each sentence
+    utils::arena arena;
+    
     if (input_directory_mode) {
       typedef boost::spirit::istream_iterator iter_type;
       
@@ -631,9 +635,14 @@ struct TaskFile
 	
 	utils::compress_istream is(file, 1024 * 1024);
 	
-	if (utils::getline(is, line) && ! line.empty())
+	if (utils::getline(is, line) && ! line.empty()) {
+	  utils::arena::scoped_type scoped(arena);
+	  
 	  operations(line);
-	else
+	  
+	  // the hypergraph may be allocated from the arena
+	  const_cast<operation_set_type::data_type&>(operations.get_data()).clear();
+	} else
 	  throw std::runtime_error("invalid file? " + file);
 	
 	queue_is.ready();
@@ -648,7 +657,14 @@ struct TaskFile
 	queue_is.pop_swap(line);
 	if (line.empty()) break;
 	
-	operations(line);
+	{
+	  utils::arena::scoped_type scoped(arena);
+	  
+	  operations(line);
+	  
+	  // the hypergraph may be allocated from the arena
+	  const_cast<operation_set_type::data_type&>(operations.get_data()).clear();
+	}
 	
 	queue_is.ready();
 	
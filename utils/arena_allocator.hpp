@@ -0,0 +1,229 @@
+// -*- mode: c++ -*-
+//
+//  Copyright(C) 2013 Taro Watanabe <taro.watanabe@nict.go.jp>
+//
+
+#ifndef __UTILS__ARENA_ALLOCATOR__HPP__
+#define __UTILS__ARENA_ALLOCATOR__HPP__ 1
+
+//
+// opt-in arena allocator.
+//
+// An arena carves memory out of large chunks by simply bumping a pointer. Deallocation is a no-op, and
+// all the memory is released at once when the arena is reset or destroyed, thus no per-object bookkeeping.
+//
+// An arena is installed for the current thread by arena::scoped_type for the unit of work such as
+// a sentence, and reset when leaving the scope, keeping its chunks for the next unit.
+// arena_allocator captures the arena installed when it is constructed (thus, when a container is constructed)
+// and falls back to the heap when no arena is installed. Use arena_allocator only for the containers which
+// do not outlive the scope of the arena, i.e. the temporaries of an algorithm.
+//
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#include <new>
+#include <memory>
+#include <vector>
+
+#include <utils/config.hpp>
+#include <utils/thread_specific_ptr.hpp>
+
+#include <boost/noncopyable.hpp>
+
+namespace utils
+{
+  class arena : private boost::noncopyable
+  {
+  public:
+    typedef size_t    size_type;
+    typedef ptrdiff_t difference_type;
+    typedef char      byte_type;
+
+    static const size_type chunk_size = 1024 * 128;
+    static const size_type alignment  = 16;
+
+  private:
+    typedef std::vector<byte_type*, std::allocator<byte_type*> > chunk_set_type;
+
+  public:
+    // install an arena for the current thread while in scope, and reset it when leaving the scope
+    struct scoped_type : private boost::noncopyable
+    {
+      scoped_type(arena& __region) : region(__region), prev(local_arena().current) { local_arena().current = &region; }
+      ~scoped_type()
+      {
+	local_arena().current = prev;
+	region.reset();
+      }
+
+      arena& region;
+      arena* prev;
+    };
+
+  public:
+    arena() : chunk(0), first(0), last(0) {}
+    ~arena()
+    {
+      clear();
+    }
+
+  public:
+    void* allocate(size_type size)
+    {
+      size = (size + alignment - 1) & ~(alignment - 1);
+
+      // large allocation is served by a dedicated chunk
+      if (size > chunk_size / 8) {
+	byte_type* p = chunk_allocate(size);
+	larges.push_back(p);
+	return p;
+      }
+
+      if (first + size > last) {
+	// chunks are kept after reset, and reused
+	if (chunk == chunks.size())
+	  chunks.push_back(chunk_allocate(chunk_size));
+
+	first = chunks[chunk];
+	last  = first + chunk_size;
+	++ chunk;
+      }
+
+      byte_type* p = first;
+      first += size;
+      return p;
+    }
+
+    // release all the allocations, but keep the chunks for reuse
+    void reset()
+    {
+      for (chunk_set_type::const_iterator liter = larges.begin(); liter != larges.end(); ++ liter)
+	::free(*liter);
+      larges.clear();
+
+      chunk = 0;
+      first = 0;
+      last  = 0;
+    }
+
+    void clear()
+    {
+      reset();
+
+      for (chunk_set_type::const_iterator citer = chunks.begin(); citer != chunks.end(); ++ citer)
+	::free(*citer);
+      chunks.clear();
+    }
+
+    // the arena installed for the current thread, or 0
+    static arena* current() { return local_arena().current; }
+
+  private:
+    static byte_type* chunk_allocate(size_type size)
+    {
+      void* p = ::malloc(size);
+      if (! p)
+	throw std::bad_alloc();
+      return static_cast<byte_type*>(p);
+    }
+
+    struct local_type
+    {
+      local_type() : current(0) {}
+
+      arena* current;
+    };
+
+    static local_type& local_arena()
+    {
+#ifdef HAVE_TLS
+      static __thread local_type* local_arena = 0;
+      static utils::thread_specific_ptr<local_type> local_arena_tss;
+
+      if (local_arena == 0) {
+	local_arena_tss.reset(new local_type());
+	local_arena = local_arena_tss.get();
+      }
+      return *local_arena;
+#else
+      static utils::thread_specific_ptr<local_type> local_arena;
+      if (! local_arena.get())
+	local_arena.reset(new local_type());
+      return *local_arena;
+#endif
+    }
+
+  private:
+    size_type  chunk; // next chunk to use
+    byte_type* first;
+    byte_type* last;
+
+    chunk_set_type chunks;
+    chunk_set_type larges;
+  };
+
+  template <typename _Tp>
+  struct arena_allocator
+  {
+  public:
+    typedef size_t     size_type;
+    typedef ptrdiff_t  difference_type;
+    typedef _Tp*       pointer;
+    typedef const _Tp* const_pointer;
+    typedef _Tp&       reference;
+    typedef const _Tp& const_reference;
+    typedef _Tp        value_type;
+
+    template<typename _Tp1>
+    struct rebind
+    { typedef arena_allocator<_Tp1> other; };
+
+  public:
+    arena_allocator() throw() : region(arena::current()) {}
+    arena_allocator(const arena_allocator& x) throw() : region(x.region) {}
+    template <typename _Tp1>
+    arena_allocator(const arena_allocator<_Tp1>& x) throw() : region(x.region) {}
+    ~arena_allocator() throw() {}
+
+  public:
+    pointer address(reference x) const { return &x; }
+    const_pointer address(const_reference x) const { return &x; }
+
+    pointer allocate(size_type n, const void* = 0)
+    {
+      if (n > max_size())
+	throw std::bad_alloc();
+
+      if (region)
+	return static_cast<pointer>(region->allocate(n * sizeof(_Tp)));
+      else
+	return static_cast<pointer>(::operator new(n * sizeof(_Tp)));
+    }
+
+    void deallocate(pointer p, size_type)
+    {
+      if (! region)
+	::operator delete(p);
+    }
+
+    size_type max_size() const throw() { return size_t(-1) / sizeof(_Tp); }
+
+    void construct(pointer p, const _Tp& val) { ::new(p) _Tp(val); }
+    void destroy(pointer p) { p->~_Tp(); }
+
+    arena* region;
+  };
+
+  template<typename _T1, typename _T2>
+  inline
+  bool operator==(const arena_allocator<_T1>& x, const arena_allocator<_T2>& y)
+  { return x.region == y.region; }
+
+  template<typename _T1, typename _T2>
+  inline
+  bool operator!=(const arena_allocator<_T1>& x, const arena_allocator<_T2>& y)
+  { return x.region != y.region; }
+};
+
+#endif
@@ -0,0 +1,88 @@
+//
+//  Copyright(C) 2013 Taro Watanabe <taro.watanabe@nict.go.jp>
+//
+
+#include <vector>
+#include <iostream>
+#include <stdexcept>
+
+#include <utils/arena_allocator.hpp>
+#include <utils/small_vector.hpp>
+#include <utils/chunk_vector.hpp>
+
+#include <boost/thread.hpp>
+
+typedef std::vector<int, utils::arena_allocator<int> > vec_type;
+typedef std::vector<vec_type, utils::arena_allocator<vec_type> > vec_set_type;
+typedef utils::small_vector<int, utils::arena_allocator<int> > small_type;
+typedef utils::chunk_vector<small_type, 4096 / sizeof(small_type), utils::arena_allocator<small_type> > small_set_type;
+
+struct worker
+{
+  void operator()()
+  {
+    utils::arena arena;
+
+    for (int sentence = 0; sentence < 64; ++ sentence) {
+      utils::arena::scoped_type scoped(arena);
+
+      if (utils::arena::current() != &arena)
+	throw std::runtime_error("arena is not installed");
+
+      vec_set_type vecs;
+      small_set_type smalls;
+
+      for (int i = 0; i < 1024; ++ i) {
+	vecs.push_back(vec_type(i % 64 + 1, i));
+	smalls.push_back(small_type(i % 8 + 1, i));
+      }
+
+      // large allocation
+      vecs.push_back(vec_type(1024 * 64, sentence));
+
+      for (int i = 0; i < 1024; ++ i) {
+	if (vecs[i].size() != size_t(i % 64 + 1) || vecs[i].front() != i || vecs[i].back() != i)
+	  throw std::runtime_error("invalid arena allocation");
+	if (smalls[i].size() != size_t(i % 8 + 1) || smalls[i].front() != i || smalls[i].back() != i)
+	  throw std::runtime_error("invalid arena allocation");
+      }
+
+      if (vecs.back().size() != 1024 * 64 || vecs.back().back() != sentence)
+	throw std::runtime_error("invalid arena large allocation");
+    }
+
+    if (utils::arena::current())
+      throw std::runtime_error("arena is not uninstalled");
+  }
+};
+
+int main(int argc, char** argv)
+{
+  // no arena: allocated from the heap, and may live anywhere
+  small_type outside(16, 1);
+
+  {
+    utils::arena arena;
+    utils::arena::scoped_type scoped(arena);
+
+    // swap exchanges the allocators together with the storage
+    small_type inside(32, 2);
+    inside.swap(outside);
+
+    if (outside.size() != 32 || outside.front() != 2 || inside.size() != 16 || inside.front() != 1)
+      throw std::runtime_error("invalid swap");
+
+    outside.swap(inside);
+  }
+
+  if (outside.size() != 16 || outside.front() != 1)
+    throw std::runtime_error("invalid heap allocation");
+
+  std::auto_ptr<boost::thread> thread1(new boost::thread(worker()));
+  std::auto_ptr<boost::thread> thread2(new boost::thread(worker()));
+
+  thread1->join();
+  thread2->join();
+
+  std::cout << "arena allocator: ok" << std::endl;
+}
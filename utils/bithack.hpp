@@ -238,7 +238,7 @@ namespace utils
     
     // bit-count
     // for 8-bit and 16-bit, use table-lookup
-    // for 32-bit and 64-bit, use pos-count via masking/shifting etc...
+    // for 32-bit and 64-bit, use pos-count via masking/shifting etc..., or popcnt when compiled with -mpopcnt
 
     struct __bit_count_mask
     {
@@ -296,11 +296,15 @@ namespace utils
     {
       size_t operator()(uint32_t x) const
       {
+#if defined(__GNUC__) && defined(__POPCNT__)
+	return static_cast<size_t>(__builtin_popcount(x));
+#else
 	// from http://graphics.stanford.edu/~seander/bithacks.html
 	
 	x = x - ((x >> 1) & 0x55555555);                    // reuse input as temporary
 	x = (x & 0x33333333) + ((x >> 2) & 0x33333333);     // temp
 	return static_cast<size_t>((((x + (x >> 4)) & 0xF0F0F0F) * 0x1010101) >> 24);
+#endif
       }
     };
     
@@ -309,6 +313,9 @@ namespace utils
     {
       size_t operator()(uint64_t x) const
       {
+#if defined(__GNUC__) && defined(__POPCNT__)
+	return static_cast<size_t>(__builtin_popcountll(x));
+#else
 	x = x - ((x >> 1) & 0x5555555555555555LLU);
 	x = (x & 0x3333333333333333LLU) + ((x >> 2) & 0x3333333333333333LLU);
 	x = (x + (x >> 4)) & 0x0F0F0F0F0F0F0F0FLLU;
@@ -317,6 +324,7 @@ namespace utils
 	x = x + (x >> 32);
 	
 	return static_cast<size_t>(x & 0xFF);
+#endif
       }
     };
     
@@ -568,6 +568,8 @@ namespace utils
     {
       std::swap(__map, x.__map);
       std::swap(__node_size, x.__node_size);
+      std::swap(impl_type::node_allocator(), x.node_allocator());
+      std::swap(impl_type::map_allocator(), x.map_allocator());
     }
     
   private:
@@ -0,0 +1,753 @@
+//
+//  Copyright(C) 2013 Taro Watanabe <taro.watanabe@nict.go.jp>
+//
+
+#include <deque>
+#include <vector>
+#include <string>
+#include <stdexcept>
+#include <algorithm>
+
+#include <cstdlib>
+
+#include <boost/thread.hpp>
+#include <boost/bind.hpp>
+#include <boost/utility.hpp>
+#include <boost/iostreams/device/back_inserter.hpp>
+
+#include <codec/lz4.hpp>
+#include <codec/lz4.h>
+#include <codec/codec_impl.hpp>
+
+#include "compress_stream.hpp"
+
+namespace utils
+{
+  namespace compress_stream_impl
+  {
+    typedef std::vector<char, std::allocator<char> > buffer_type;
+
+    typedef boost::mutex                mutex_type;
+    typedef boost::condition_variable   condition_type;
+    typedef boost::mutex::scoped_lock   lock_type;
+
+    // 1M for gzip, the block size of bzip2 -9 for bzip2, and the chunk size of codec::lz4_compressor for lz4
+    inline
+    size_t block_size(const impl::compress_format_type format)
+    {
+      switch (format) {
+      case impl::COMPRESS_STREAM_BZIP: return 900 * 1000;
+      case impl::COMPRESS_STREAM_LZ4:  return codec::detail::lz4_param::chunk_size;
+      default:                         return 1024 * 1024;
+      }
+    }
+
+    //
+    // gzip member with the extra subfield "CZ" which keeps the size of the member, as done in BGZF
+    //
+    static const size_t gzip_header_size = 10;
+    static const size_t gzip_extra_size  = 2 + 2 + 2 + 4; // XLEN, SI1 SI2, LEN and the member size
+
+    inline
+    void gzip_insert_size(buffer_type& output)
+    {
+      // boost::iostreams::gzip_compressor writes no optional fields without the file name or the comment
+      if (output.size() < gzip_header_size || output[3] != 0) return;
+
+      char extra[gzip_extra_size] = {8, 0, 'C', 'Z', 4, 0, 0, 0, 0, 0};
+      codec::impl::write_size(output.size() + gzip_extra_size, extra + 6);
+
+      output.insert(output.begin() + gzip_header_size, extra, extra + gzip_extra_size);
+      output[3] |= 0x04; // FEXTRA
+    }
+
+    // returns zero when no size is found
+    inline
+    size_t gzip_member_size(const char* header, const size_t size)
+    {
+      if (size < gzip_header_size + gzip_extra_size) return 0;
+      if (header[0] != '\037' || header[1] != '\213' || header[2] != 8 || ! (header[3] & 0x04)) return 0;
+      if (header[10] != 8 || header[11] != 0 || header[12] != 'C' || header[13] != 'Z' || header[14] != 4 || header[15] != 0) return 0;
+
+      return codec::impl::read_size(header + 16);
+    }
+
+    //
+    // bzip2 stream starts by "BZh[1-9]" followed by the block magic or the end-of-stream magic (for an empty stream)
+    //
+    static const size_t bzip_magic_size = 4 + 6;
+
+    inline
+    bool bzip_stream_start(const char* first)
+    {
+      static const char block_magic[6] = {'\x31', '\x41', '\x59', '\x26', '\x53', '\x59'};
+      static const char eos_magic[6]   = {'\x17', '\x72', '\x45', '\x38', '\x50', '\x90'};
+
+      return (first[0] == 'B' && first[1] == 'Z' && first[2] == 'h' && '1' <= first[3] && first[3] <= '9'
+	      && (std::equal(block_magic, block_magic + 6, first + 4) || std::equal(eos_magic, eos_magic + 6, first + 4)));
+    }
+
+    template <typename Filter>
+    inline
+    void filter_block(const Filter& filter, const buffer_type& input, buffer_type& output)
+    {
+      output.clear();
+
+      boost::iostreams::filtering_ostream os;
+      os.push(filter);
+      os.push(boost::iostreams::back_inserter(output));
+      os.exceptions(std::ios_base::badbit);
+
+      if (! input.empty())
+	os.write(&(*input.begin()), input.size());
+      os.reset();
+    }
+
+    inline
+    void compress_block(const impl::compress_format_type format, const buffer_type& input, buffer_type& output)
+    {
+      switch (format) {
+      case impl::COMPRESS_STREAM_GZIP:
+	filter_block(boost::iostreams::gzip_compressor(), input, output);
+	gzip_insert_size(output);
+	break;
+      case impl::COMPRESS_STREAM_BZIP:
+	filter_block(boost::iostreams::bzip2_compressor(), input, output);
+	break;
+      case impl::COMPRESS_STREAM_LZ4:
+	output.resize(4 + LZ4_compressBound(input.size()));
+	output.resize(4 + LZ4_compress(&(*input.begin()), &output[4], input.size()));
+	codec::impl::write_size(output.size() - 4, &output[0]);
+	break;
+      default:
+	throw std::runtime_error("unsupported compression format");
+      }
+    }
+
+    inline
+    void decompress_block(const impl::compress_format_type format, const buffer_type& input, buffer_type& output)
+    {
+      switch (format) {
+      case impl::COMPRESS_STREAM_GZIP:
+	filter_block(boost::iostreams::gzip_decompressor(), input, output);
+	break;
+      case impl::COMPRESS_STREAM_BZIP:
+	filter_block(boost::iostreams::bzip2_decompressor(), input, output);
+	break;
+      case impl::COMPRESS_STREAM_LZ4: {
+	if (input.size() < 4 || input.size() != 4 + codec::impl::read_size(&input[0]))
+	  throw std::runtime_error("invalid lz4 chunk");
+
+	output.resize(codec::detail::lz4_param::chunk_size);
+	const int size = LZ4_decompress_safe(&input[4], &output[0], input.size() - 4, output.size());
+	if (size < 0)
+	  throw std::runtime_error("lz4 decompression failed");
+	output.resize(size);
+	break;
+      }
+      default:
+	throw std::runtime_error("unsupported compression format");
+      }
+    }
+
+    struct block_type
+    {
+      block_type(const impl::compress_format_type __format, const bool __compress)
+	: input(), output(), format(__format), compress(__compress), done(false), error() {}
+
+      void operator()()
+      {
+	try {
+	  if (compress)
+	    compress_block(format, input, output);
+	  else
+	    decompress_block(format, input, output);
+	}
+	catch (std::exception& err) {
+	  error = err.what();
+	  if (error.empty())
+	    error = "compressed stream error";
+	}
+      }
+
+      buffer_type input;
+      buffer_type output;
+
+      impl::compress_format_type format;
+      bool compress;
+      bool done;
+
+      std::string error;
+    };
+    typedef boost::shared_ptr<block_type> block_ptr_type;
+
+    //
+    // worker threads which run blocks, shared by all the streams of the process. Without threads, blocks are run
+    // when pushed. The blocks in flight, i.e. read ahead or waiting to be written, are bounded for the process:
+    // a stream may always keep one block in flight, and more only while the total is below the capacity.
+    //
+    class block_pool : private boost::noncopyable
+    {
+    public:
+      // the pool starts with $CICADA_COMPRESS_THREADS threads, if set, otherwise one
+      block_pool() : threads(1), capacity(4), reserved(0), terminated(false)
+      {
+	const char* threads_env = getenv("CICADA_COMPRESS_THREADS");
+	if (threads_env && atoi(threads_env) > 1)
+	  resize(atoi(threads_env));
+      }
+
+      ~block_pool()
+      {
+	stop();
+      }
+
+      static block_pool& instance()
+      {
+	static block_pool __pool;
+	return __pool;
+      }
+
+      size_t size() const { return threads; }
+
+      // change the number of threads, when no stream is open
+      void resize(const size_t __threads)
+      {
+	lock_type lock_resize(mutex_resize);
+
+	stop();
+
+	threads  = std::max(__threads, size_t(1));
+	capacity = threads * 4;
+
+	if (threads > 1)
+	  for (size_t i = 0; i != threads; ++ i)
+	    workers.push_back(thread_ptr_type(new boost::thread(boost::bind(&block_pool::run, this))));
+      }
+
+      // reserve a block in flight. The first block of a stream is always granted.
+      bool reserve(const bool first)
+      {
+	lock_type lock(mutex);
+
+	if (! first && reserved >= capacity) return false;
+
+	++ reserved;
+	return true;
+      }
+
+      void release(const size_t size = 1)
+      {
+	lock_type lock(mutex);
+
+	reserved -= std::min(size, reserved);
+      }
+
+      void push(const block_ptr_type& block)
+      {
+	if (! workers.size()) {
+	  (*block)();
+	  block->done = true;
+	  return;
+	}
+
+	{
+	  lock_type lock(mutex);
+	  queue.push_back(block);
+	}
+	cond.notify_one();
+      }
+
+      void wait(const block_ptr_type& block)
+      {
+	{
+	  lock_type lock(mutex);
+	  while (! block->done)
+	    cond_done.wait(lock);
+	}
+
+	if (! block->error.empty())
+	  throw std::runtime_error(block->error);
+      }
+
+    private:
+      void stop()
+      {
+	{
+	  lock_type lock(mutex);
+	  terminated = true;
+	}
+	cond.notify_all();
+
+	for (thread_set_type::const_iterator witer = workers.begin(); witer != workers.end(); ++ witer)
+	  (*witer)->join();
+	workers.clear();
+
+	terminated = false;
+      }
+
+      void run()
+      {
+	for (;;) {
+	  block_ptr_type block;
+	  {
+	    lock_type lock(mutex);
+	    while (queue.empty() && ! terminated)
+	      cond.wait(lock);
+
+	    if (queue.empty()) return;
+
+	    block = queue.front();
+	    queue.pop_front();
+	  }
+
+	  (*block)();
+
+	  {
+	    lock_type lock(mutex);
+	    block->done = true;
+	  }
+	  cond_done.notify_all();
+	}
+      }
+
+    private:
+      typedef boost::shared_ptr<boost::thread> thread_ptr_type;
+      typedef std::vector<thread_ptr_type, std::allocator<thread_ptr_type> > thread_set_type;
+
+      mutex_type     mutex;
+      mutex_type     mutex_resize;
+      condition_type cond;
+      condition_type cond_done;
+
+      std::deque<block_ptr_type> queue;
+      thread_set_type            workers;
+
+      size_t threads;
+      size_t capacity;
+      size_t reserved;
+      bool   terminated;
+    };
+
+    // source which reads the prefix, already consumed from the file, then the file
+    struct prefix_source
+    {
+      typedef char char_type;
+      typedef boost::iostreams::source_tag category;
+
+      struct state_type
+      {
+	state_type(const buffer_type& __prefix, const boost::iostreams::file_source& __file)
+	  : prefix(__prefix), pos(0), file(__file) {}
+
+	buffer_type prefix;
+	size_t      pos;
+
+	boost::iostreams::file_source file;
+      };
+
+      prefix_source(const buffer_type& prefix, const boost::iostreams::file_source& file)
+	: state(new state_type(prefix, file)) {}
+
+      std::streamsize read(char_type* s, std::streamsize n)
+      {
+	if (state->pos == state->prefix.size())
+	  return state->file.read(s, n);
+
+	const size_t copied = std::min(size_t(n), state->prefix.size() - state->pos);
+	std::copy(state->prefix.begin() + state->pos, state->prefix.begin() + state->pos + copied, s);
+	state->pos += copied;
+
+	return copied;
+      }
+
+      boost::shared_ptr<state_type> state;
+    };
+
+    inline
+    std::string path_string(const boost::filesystem::path& path)
+    {
+#if BOOST_FILESYSTEM_VERSION == 2
+      return path.file_string();
+#else
+      return path.string();
+#endif
+    }
+  };
+
+  size_t compress_stream_threads()
+  {
+    return compress_stream_impl::block_pool::instance().size();
+  }
+
+  void compress_stream_threads(const size_t threads)
+  {
+    compress_stream_impl::block_pool::instance().resize(threads);
+  }
+
+  struct compress_block_sink::impl_type
+  {
+    typedef compress_stream_impl::buffer_type    buffer_type;
+    typedef compress_stream_impl::block_type     block_type;
+    typedef compress_stream_impl::block_ptr_type block_ptr_type;
+    typedef compress_stream_impl::block_pool     block_pool_type;
+
+    impl_type(const boost::filesystem::path& path, const impl::compress_format_type __format, const size_t threads)
+      : file(compress_stream_impl::path_string(path), std::ios_base::out | std::ios_base::trunc),
+	format(__format),
+	block_size(compress_stream_impl::block_size(__format)),
+	pool(block_pool_type::instance()),
+	pending_size(std::max(std::min(threads, pool.size()), size_t(1)) * 2),
+	blocks(0),
+	closed(false)
+    {
+      if (! file.is_open())
+	throw std::runtime_error("no file? " + compress_stream_impl::path_string(path));
+
+      if (format == impl::COMPRESS_STREAM_LZ4)
+	file.write(impl::compress_lz4_magic(), 4);
+
+      buffer.reserve(block_size);
+    }
+
+    ~impl_type()
+    {
+      try {
+	close();
+      }
+      catch (...) {}
+
+      pool.release(pending.size());
+    }
+
+    std::streamsize write(const char* s, std::streamsize n)
+    {
+      std::streamsize offset = 0;
+      while (offset < n) {
+	const size_t copied = std::min(size_t(n - offset), block_size - buffer.size());
+
+	buffer.insert(buffer.end(), s + offset, s + offset + copied);
+	offset += copied;
+
+	if (buffer.size() == block_size)
+	  submit();
+      }
+      return n;
+    }
+
+    void close()
+    {
+      if (closed) return;
+      closed = true;
+
+      // we need at least one gzip member or bzip2 stream for an empty output
+      if (! buffer.empty() || (! blocks && format != impl::COMPRESS_STREAM_LZ4))
+	submit();
+
+      while (! pending.empty())
+	dump();
+
+      file.close();
+    }
+
+    void submit()
+    {
+      block_ptr_type block(new block_type(format, true));
+      block->input.swap(buffer);
+      buffer.reserve(block_size);
+
+      // write the pending blocks until we may keep one more block in flight
+      for (;;) {
+	if (pending.empty()) {
+	  pool.reserve(true);
+	  break;
+	}
+
+	if (pending.size() < pending_size && pool.reserve(false))
+	  break;
+
+	dump();
+      }
+
+      pool.push(block);
+      pending.push_back(block);
+      ++ blocks;
+    }
+
+    void dump()
+    {
+      const block_ptr_type block = pending.front();
+      pending.pop_front();
+      pool.release();
+
+      pool.wait(block);
+
+      const buffer_type& output = block->output;
+      if (! output.empty())
+	file.write(&(*output.begin()), output.size());
+    }
+
+    boost::iostreams::file_sink file;
+
+    impl::compress_format_type format;
+    size_t                     block_size;
+
+    buffer_type                buffer;
+
+    block_pool_type&           pool;
+    std::deque<block_ptr_type> pending;
+    size_t                     pending_size;
+    size_t                     blocks;
+
+    bool closed;
+  };
+
+  compress_block_sink::compress_block_sink(const boost::filesystem::path& path, const impl::compress_format_type format, const size_t threads)
+    : pimpl(new impl_type(path, format, threads)) {}
+
+  void compress_block_sink::close() { pimpl->close(); }
+
+  std::streamsize compress_block_sink::write(const char_type* s, std::streamsize n) { return pimpl->write(s, n); }
+
+  struct compress_block_source::impl_type
+  {
+    typedef compress_stream_impl::buffer_type    buffer_type;
+    typedef compress_stream_impl::block_type     block_type;
+    typedef compress_stream_impl::block_ptr_type block_ptr_type;
+    typedef compress_stream_impl::block_pool     block_pool_type;
+
+    typedef boost::iostreams::filtering_istream stream_type;
+
+    // bzip2 streams longer than this are decompressed sequentially
+    static const size_t max_stream_size = 1024 * 1024 * 16;
+
+    impl_type(const boost::filesystem::path& path, const impl::compress_format_type __format, const size_t threads)
+      : file(compress_stream_impl::path_string(path)),
+	format(__format),
+	input(),
+	input_pos(0),
+	eof(false),
+	pool(block_pool_type::instance()),
+	pending_size(std::max(std::min(threads, pool.size()), size_t(1)) * 2),
+	block(),
+	pos(0)
+    {
+      if (! file.is_open())
+	throw std::runtime_error("no file? " + compress_stream_impl::path_string(path));
+
+      if (format == impl::COMPRESS_STREAM_LZ4) {
+	if (! fill(4) || ! std::equal(input.begin(), input.begin() + 4, impl::compress_lz4_magic()))
+	  throw std::runtime_error("not a lz4 stream: " + compress_stream_impl::path_string(path));
+	input_pos += 4;
+      }
+    }
+
+    ~impl_type()
+    {
+      pool.release(pending.size());
+    }
+
+    std::streamsize read(char* s, std::streamsize n)
+    {
+      std::streamsize offset = 0;
+      while (offset < n) {
+	if (block && pos < block->output.size()) {
+	  const size_t copied = std::min(size_t(n - offset), block->output.size() - pos);
+
+	  std::copy(block->output.begin() + pos, block->output.begin() + pos + copied, s + offset);
+	  pos += copied;
+	  offset += copied;
+	  continue;
+	}
+
+	block.reset();
+
+	if (! stream)
+	  read_ahead();
+
+	if (! pending.empty()) {
+	  block = pending.front();
+	  pos = 0;
+	  pending.pop_front();
+	  pool.release();
+
+	  pool.wait(block);
+	  continue;
+	}
+
+	if (stream) {
+	  stream->read(s + offset, n - offset);
+	  if (stream->gcount() <= 0) break;
+
+	  offset += stream->gcount();
+	  continue;
+	}
+
+	break;
+      }
+
+      return (offset == 0 && n > 0 ? std::streamsize(-1) : offset);
+    }
+
+    void close()
+    {
+      pool.release(pending.size());
+      pending.clear();
+      block.reset();
+      stream.reset();
+
+      file.close();
+    }
+
+    void read_ahead()
+    {
+      while (! stream && pending.size() < pending_size && pool.reserve(pending.empty())) {
+	block_ptr_type next = next_block();
+	if (! next) {
+	  pool.release();
+	  break;
+	}
+
+	pool.push(next);
+	pending.push_back(next);
+      }
+    }
+
+    // read the next compressed block, or switch to the sequential decompression
+    block_ptr_type next_block()
+    {
+      if (! fill(1)) return block_ptr_type();
+
+      size_t size = 0;
+      switch (format) {
+      case impl::COMPRESS_STREAM_LZ4:
+	if (! fill(4))
+	  throw std::runtime_error("truncated lz4 stream");
+	size = 4 + codec::impl::read_size(&input[input_pos]);
+	break;
+      case impl::COMPRESS_STREAM_GZIP:
+	fill(compress_stream_impl::gzip_header_size + compress_stream_impl::gzip_extra_size);
+	size = compress_stream_impl::gzip_member_size(&input[input_pos], input.size() - input_pos);
+	break;
+      case impl::COMPRESS_STREAM_BZIP:
+	size = bzip_stream_size();
+	break;
+      default:
+	throw std::runtime_error("unsupported compression format");
+      }
+
+      if (! size) {
+	sequential();
+	return block_ptr_type();
+      }
+
+      if (! fill(size))
+	throw std::runtime_error("truncated compressed stream");
+
+      block_ptr_type next(new block_type(format, false));
+      next->input.assign(input.begin() + input_pos, input.begin() + input_pos + size);
+      input_pos += size;
+
+      return next;
+    }
+
+    // the size of the bzip2 stream by searching the next stream, or zero when not splittable
+    size_t bzip_stream_size()
+    {
+      const size_t magic_size = compress_stream_impl::bzip_magic_size;
+
+      if (! fill(magic_size) || ! compress_stream_impl::bzip_stream_start(&input[input_pos]))
+	return 0;
+
+      size_t first = 4;
+      for (;;) {
+	const size_t last = input.size() - input_pos;
+
+	while (first + magic_size <= last) {
+	  const char* begin = &input[input_pos] + first;
+	  const char* end   = &input[0] + input.size() - (magic_size - 1);
+	  const char* iter  = std::find(begin, end, 'B');
+
+	  if (iter == end) {
+	    first = last - (magic_size - 1);
+	    break;
+	  }
+
+	  if (compress_stream_impl::bzip_stream_start(iter))
+	    return iter - &input[input_pos];
+
+	  first = (iter - &input[input_pos]) + 1;
+	}
+
+	if (eof) return last;
+	if (last > max_stream_size) return 0;
+
+	fill(last + 1024 * 1024);
+      }
+    }
+
+    void sequential()
+    {
+      stream.reset(new stream_type());
+
+      if (format == impl::COMPRESS_STREAM_GZIP)
+	stream->push(boost::iostreams::gzip_decompressor());
+      else if (format == impl::COMPRESS_STREAM_BZIP)
+	stream->push(boost::iostreams::bzip2_decompressor());
+      else
+	throw std::runtime_error("unsupported compression format");
+
+      stream->push(compress_stream_impl::prefix_source(buffer_type(input.begin() + input_pos, input.end()), file));
+      stream->exceptions(std::ios_base::badbit);
+
+      input.clear();
+      input_pos = 0;
+    }
+
+    // make sure that we have size bytes after input_pos
+    bool fill(const size_t size)
+    {
+      while (input.size() - input_pos < size && ! eof) {
+	if (input_pos && input_pos >= (input.size() >> 1)) {
+	  input.erase(input.begin(), input.begin() + input_pos);
+	  input_pos = 0;
+	}
+
+	const size_t read_size = std::max(size - (input.size() - input_pos), size_t(1024 * 1024));
+	const size_t offset = input.size();
+
+	input.resize(offset + read_size);
+	const std::streamsize read = file.read(&input[offset], read_size);
+	input.resize(offset + (read > 0 ? read : 0));
+
+	eof = (read <= 0);
+      }
+
+      return input.size() - input_pos >= size;
+    }
+
+    boost::iostreams::file_source file;
+
+    impl::compress_format_type format;
+
+    buffer_type input;
+    size_t      input_pos;
+    bool        eof;
+
+    block_pool_type&           pool;
+    std::deque<block_ptr_type> pending;
+    size_t                     pending_size;
+
+    block_ptr_type block;
+    size_t         pos;
+
+    boost::shared_ptr<stream_type> stream;
+  };
+
+  compress_block_source::compress_block_source(const boost::filesystem::path& path, const impl::compress_format_type format, const size_t threads)
+    : pimpl(new impl_type(path, format, threads)) {}
+
+  void compress_block_source::close() { pimpl->close(); }
+
+  std::streamsize compress_block_source::read(char_type* s, std::streamsize n) { return pimpl->read(s, n); }
+};
@@ -7,11 +7,13 @@
 #define __UTILS__COMPRESS_STREAM__HPP__ 1
 
 #include <cstring>
+#include <algorithm>
 #include <iostream>
 #include <fstream>
 
 #include <unistd.h>
 
+#include <boost/iostreams/categories.hpp>
 #include <boost/iostreams/filtering_stream.hpp>
 #include <boost/iostreams/filter/gzip.hpp>
 #include <boost/iostreams/filter/bzip2.hpp>
@@ -20,6 +22,7 @@
 
 #include <boost/version.hpp>
 #include <boost/filesystem.hpp>
+#include <boost/shared_ptr.hpp>
 
 namespace utils
 {
@@ -29,21 +32,27 @@ namespace utils
     typedef enum {
       COMPRESS_STREAM_GZIP,
       COMPRESS_STREAM_BZIP,
+      COMPRESS_STREAM_LZ4,
       COMPRESS_STREAM_UNKNOWN
     } compress_format_type;
     
+    // lz4 stream is a magic followed by the chunks of codec::lz4_compressor
+    inline const char* compress_lz4_magic() { return "\211LZ4"; }
+    
     inline compress_format_type compress_iformat (const std::string& filename)
     {
       char buffer[8];
       
       std::ifstream ifs(filename.c_str());
-      ifs.read((char*) buffer, sizeof(char)*3);
+      ifs.read((char*) buffer, sizeof(char)*4);
       const size_t gcount = ifs.gcount();
       
       if (gcount >= 2 && buffer[0] == '\037' && buffer[1] == '\213')
 	return COMPRESS_STREAM_GZIP;
       else if (gcount >= 3 && buffer[0] == 'B' && buffer[1] == 'Z' && buffer[2] == 'h')
 	return COMPRESS_STREAM_BZIP;
+      else if (gcount >= 4 && std::equal(buffer, buffer + 4, compress_lz4_magic()))
+	return COMPRESS_STREAM_LZ4;
       else
 	return COMPRESS_STREAM_UNKNOWN;
     }
@@ -59,6 +68,8 @@ namespace utils
 	return COMPRESS_STREAM_GZIP;
       else if (filename.size() > 4 && strncmp(&(filename.c_str()[filename.size() - 4]), ".bz2", 4) == 0)
 	return COMPRESS_STREAM_BZIP;
+      else if (filename.size() > 4 && strncmp(&(filename.c_str()[filename.size() - 4]), ".lz4", 4) == 0)
+	return COMPRESS_STREAM_LZ4;
       else
 	return COMPRESS_STREAM_UNKNOWN;
     }
@@ -69,12 +80,67 @@ namespace utils
 #endif
   };
 
+  // the number of threads shared by all the compressed streams of the process, by default, one or
+  // $CICADA_COMPRESS_THREADS. With a single thread, gzip and bzip2 use the boost filters. Set before opening
+  // streams, e.g. by the --compress-threads option of a tool. The blocks read ahead or waiting to be written are bounded
+  // by four blocks per thread for the process, but a stream always keeps at least one block.
+  size_t compress_stream_threads();
+  void compress_stream_threads(const size_t threads);
+  
+  //
+  // block-parallel compression: the input is split into blocks, each of which is compressed independently by threads,
+  // then written in order. A block is a gzip member with its size in the extra field, a bzip2 stream or a lz4 chunk,
+  // thus, the output is readable by gzip, bzip2 and codec::lz4_decompressor (after the magic).
+  //
+  class compress_block_sink
+  {
+  public:
+    typedef char char_type;
+    struct category : public boost::iostreams::sink_tag,
+		      public boost::iostreams::closable_tag {};
+    
+    compress_block_sink(const boost::filesystem::path& path, const impl::compress_format_type format, const size_t threads);
+    
+    void close();
+    std::streamsize write(const char_type* s, std::streamsize n);
+    
+  private:
+    struct impl_type;
+    
+    boost::shared_ptr<impl_type> pimpl;
+  };
+  
+  //
+  // block-parallel decompression: blocks are read ahead and decompressed by threads. Only the files written by
+  // compress_block_sink (or BGZF-like gzip and multi-stream bzip2 files) are split: gzip members without the size,
+  // or bzip2 streams longer than 16MB, e.g. the output of the plain gzip or bzip2, are decompressed sequentially
+  // by the boost filters.
+  //
+  class compress_block_source
+  {
+  public:
+    typedef char char_type;
+    struct category : public boost::iostreams::source_tag,
+		      public boost::iostreams::closable_tag {};
+    
+    compress_block_source(const boost::filesystem::path& path, const impl::compress_format_type format, const size_t threads);
+    
+    void close();
+    std::streamsize read(char_type* s, std::streamsize n);
+    
+  private:
+    struct impl_type;
+    
+    boost::shared_ptr<impl_type> pimpl;
+  };
+
 
   template <typename Stream>
   inline
   Stream& push_compress_ostream(Stream& os,
 				const boost::filesystem::path& path,
-				size_t buffer_size = 4096)
+				size_t buffer_size = 4096,
+				size_t threads = compress_stream_threads())
   {
     if (path == "-")  {
 #if BOOST_VERSION >= 104400
@@ -83,7 +149,14 @@ namespace utils
       os.push(boost::iostreams::file_descriptor_sink(::dup(STDOUT_FILENO), true), buffer_size);
 #endif
     } else {
-      switch (impl::compress_oformat(path)) {
+      const impl::compress_format_type format = impl::compress_oformat(path);
+      
+      if (format == impl::COMPRESS_STREAM_LZ4 || (format != impl::COMPRESS_STREAM_UNKNOWN && threads > 1)) {
+	os.push(compress_block_sink(path, format, threads), buffer_size);
+	return os;
+      }
+      
+      switch (format) {
       case impl::COMPRESS_STREAM_GZIP:
 	os.push(boost::iostreams::gzip_compressor());
 	break;
@@ -105,7 +178,8 @@ namespace utils
   inline
   Stream& push_compress_istream(Stream& is,
 				const boost::filesystem::path& path,
-				size_t buffer_size = 4096)
+				size_t buffer_size = 4096,
+				size_t threads = compress_stream_threads())
   {
     if (path == "-")  {
 #if BOOST_VERSION >= 104400
@@ -115,7 +189,14 @@ namespace utils
 #endif
     } else {
       if (boost::filesystem::is_regular_file(path)) {
-	switch (impl::compress_iformat(path)) {
+	const impl::compress_format_type format = impl::compress_iformat(path);
+	
+	if (format == impl::COMPRESS_STREAM_LZ4 || (format != impl::COMPRESS_STREAM_UNKNOWN && threads > 1)) {
+	  is.push(compress_block_source(path, format, threads), buffer_size);
+	  return is;
+	}
+	
+	switch (format) {
 	case impl::COMPRESS_STREAM_GZIP:
 	  is.push(boost::iostreams::gzip_decompressor());
 	  break;
@@ -143,9 +224,10 @@ namespace utils
     
   public:
     compress_ostream(const path_type& path,
-		     size_t buffer_size = 4096)
+		     size_t buffer_size = 4096,
+		     size_t threads = compress_stream_threads())
     {
-      push_compress_ostream(__stream(), path, buffer_size);
+      push_compress_ostream(__stream(), path, buffer_size, threads);
     }
     
   private:
@@ -162,9 +244,10 @@ namespace utils
     
   public:
     compress_istream(const path_type& path,
-		     size_t buffer_size = 4096)
+		     size_t buffer_size = 4096,
+		     size_t threads = compress_stream_threads())
     {
-      push_compress_istream(__stream(), path, buffer_size);
+      push_compress_istream(__stream(), path, buffer_size, threads);
     }
     
   private:
@@ -2,11 +2,103 @@
 //  Copyright(C) 2010-2011 Taro Watanabe <taro.watanabe@nict.go.jp>
 //
 
+// compress_stream_main input               : decompress input into stdout
+// compress_stream_main input output        : decompress input and compress into output
+// compress_stream_main --benchmark [MB]    : throughput of gzip, bzip2 and lz4 streams by the number of threads
+
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <boost/thread.hpp>
+
 #include "utils/compress_stream.hpp"
+#include "utils/tempfile.hpp"
+#include "utils/resource.hpp"
+
+typedef boost::filesystem::path path_type;
+typedef std::vector<char, std::allocator<char> > buffer_type;
+
+void benchmark(const path_type& path, const size_t threads, const buffer_type& data)
+{
+  // the threads are shared by all the streams, thus, set before opening the streams
+  utils::compress_stream_threads(threads);
+  
+  utils::resource start;
+  {
+    utils::compress_ostream os(path, 1024 * 1024, threads);
+
+    for (size_t offset = 0; offset < data.size(); offset += 4096)
+      os.write(&data[offset], std::min(data.size() - offset, size_t(4096)));
+  }
+  utils::resource middle;
+
+  buffer_type decoded;
+  decoded.reserve(data.size());
+  {
+    utils::compress_istream is(path, 1024 * 1024, threads);
+
+    char buffer[4096];
+    do {
+      is.read(buffer, 4096);
+      if (is.gcount() > 0)
+	decoded.insert(decoded.end(), buffer, buffer + is.gcount());
+    } while (is);
+  }
+  utils::resource end;
+
+  const double mbytes = double(data.size()) / (1024 * 1024);
+
+  std::cout << path.extension().string()
+	    << " threads: " << threads
+	    << " ratio: " << (double(boost::filesystem::file_size(path)) / data.size())
+	    << " write: " << (mbytes / (middle.user_time() - start.user_time())) << " MB/s"
+	    << " read: " << (mbytes / (end.user_time() - middle.user_time())) << " MB/s"
+	    << (decoded == data ? "" : " DIFFERENT!")
+	    << std::endl;
+}
+
+void benchmark(const size_t mbytes)
+{
+  // text-like data: lines of words drawn from a Zipfian-ish vocabulary
+  std::vector<std::string> vocab;
+  for (int i = 0; i != 10000; ++ i) {
+    std::string word;
+    for (int length = 1 + (std::rand() % 10); length; -- length)
+      word += char('a' + (std::rand() % 26));
+    vocab.push_back(word);
+  }
+
+  buffer_type data;
+  data.reserve(mbytes * 1024 * 1024 + 1024);
+  while (data.size() < mbytes * 1024 * 1024) {
+    for (int length = 1 + (std::rand() % 40); length; -- length) {
+      const std::string& word = vocab[(std::rand() % vocab.size()) * (std::rand() % vocab.size()) / vocab.size()];
+      data.insert(data.end(), word.begin(), word.end());
+      data.push_back(length == 1 ? '\n' : ' ');
+    }
+  }
+
+  const path_type tmp_dir = utils::tempfile::directory_name(utils::tempfile::tmp_dir() / "compress-stream-XXXXXX");
+  utils::tempfile::insert(tmp_dir);
+
+  const size_t threads_max = std::max(size_t(boost::thread::hardware_concurrency()), size_t(4));
+  const char* extensions[] = {".gz", ".bz2", ".lz4"};
+
+  for (int i = 0; i != 3; ++ i)
+    for (size_t threads = 1; threads <= threads_max; threads <<= 1)
+      benchmark(tmp_dir / (std::string("data") + extensions[i]), threads, data);
+
+  boost::filesystem::remove_all(tmp_dir);
+  utils::tempfile::erase(tmp_dir);
+}
 
 int main(int argc, char** argv)
 {
-  if (argc == 2) {
+  if (argc >= 2 && std::strcmp(argv[1], "--benchmark") == 0) {
+    benchmark(argc >= 3 ? std::atoi(argv[2]) : 64);
+  } else if (argc == 2) {
     utils::compress_istream is(argv[1]);
     
     char buffer[4096];
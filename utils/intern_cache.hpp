@@ -0,0 +1,134 @@
+// -*- mode: c++ -*-
+//
+//  Copyright(C) 2013 Taro Watanabe <taro.watanabe@nict.go.jp>
+//
+
+#ifndef __UTILS__INTERN_CACHE__HPP__
+#define __UTILS__INTERN_CACHE__HPP__ 1
+
+//
+// interning of strings into ids shared by all the threads, with a per-thread cache in front of the shared index.
+//
+// The cache is two-way associative, keeps a pointer to the interned key and its id, and is looked up without
+// any lock nor atomic operation. Interned keys are never erased, thus, a cached pointer is always valid.
+// On a cache miss, the shared index is searched under the reader lock, which still performs an atomic
+// increment on the ticket, and the writer lock is taken only when inserting a new key.
+//
+// Tag distinguishes the caches of the same Key and Id types, e.g. symbols and features.
+//
+
+#include <algorithm>
+#include <memory>
+
+#include <boost/functional/hash.hpp>
+
+#include <utils/config.hpp>
+#include <utils/thread_specific_ptr.hpp>
+#include <utils/array_power2.hpp>
+
+namespace utils
+{
+  template <typename Tag, typename Key, typename Id, size_t Size=1024 * 16>
+  class intern_cache
+  {
+  public:
+    typedef size_t    size_type;
+    typedef ptrdiff_t difference_type;
+
+    typedef Key key_type;
+    typedef Id  id_type;
+
+  private:
+    struct value_type
+    {
+      const key_type* key;
+      id_type         id;
+
+      value_type() : key(0), id(0) {}
+    };
+
+    typedef utils::array_power2<value_type, Size, std::allocator<value_type> > value_set_type;
+
+  public:
+    intern_cache() { std::fill(values.begin(), values.end(), value_type()); }
+
+  public:
+    // intern x into index, whose keys are stored in keys, and guarded by mutex
+    template <typename Piece, typename Index, typename KeySet, typename Mutex>
+    static id_type intern(const Piece& x, Index& index, KeySet& keys, Mutex& mutex)
+    {
+      intern_cache& cache = instance();
+
+      // the recently used one is kept in the even slot
+      const size_type pos = (boost::hash<Piece>()(x) << 1) & (Size - 1);
+
+      value_type& value = cache.values[pos];
+      value_type& value_prev = cache.values[pos + 1];
+
+      if (value.key && Piece(*value.key) == x)
+	return value.id;
+
+      std::swap(value, value_prev);
+
+      if (value.key && Piece(*value.key) == x)
+	return value.id;
+
+      {
+	typename Mutex::scoped_reader_lock lock(mutex);
+
+	typename Index::const_iterator iter = index.find(x);
+
+	if (iter != index.end()) {
+	  value.id = iter - index.begin();
+	  value.key = &keys[value.id];
+
+	  return value.id;
+	}
+      }
+
+      typename Mutex::scoped_writer_lock lock(mutex);
+
+      std::pair<typename Index::iterator, bool> result = index.insert(x);
+
+      if (result.second) {
+	keys.push_back(x);
+	const_cast<Piece&>(*result.first) = keys.back();
+      }
+
+      value.id = result.first - index.begin();
+      value.key = &keys[value.id];
+
+      return value.id;
+    }
+
+  private:
+    static intern_cache& instance()
+    {
+      // we may be called during the static initialization, thus, the thread specific storage is function local
+#ifdef HAVE_TLS
+      static __thread intern_cache* cache_tls = 0;
+
+      if (! cache_tls) {
+	static utils::thread_specific_ptr<intern_cache> cache;
+
+	cache.reset(new intern_cache());
+	cache_tls = cache.get();
+      }
+
+      return *cache_tls;
+#else
+      static utils::thread_specific_ptr<intern_cache> cache;
+
+      if (! cache.get())
+	cache.reset(new intern_cache());
+
+      return *cache;
+#endif
+    }
+
+  private:
+    value_set_type values;
+  };
+};
+
+#endif
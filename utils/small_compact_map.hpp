@@ -0,0 +1,470 @@
+// -*- mode: c++ -*-
+//
+//  Copyright(C) 2013 Taro Watanabe <taro.watanabe@nict.go.jp>
+//
+
+#ifndef __UTILS__SMALL_COMPACT_MAP__HPP__
+#define __UTILS__SMALL_COMPACT_MAP__HPP__ 1
+
+#include <stdint.h>
+
+#include <memory>
+#include <utility>
+#include <iterator>
+
+#include <boost/type_traits.hpp>
+#include <boost/functional/hash/hash.hpp>
+
+#include <utils/memory.hpp>
+#include <utils/compact_map.hpp>
+
+//
+// compact_map with small inline storage:
+//
+// up to small_threshold elements are kept in the inline array without any heap allocation, and
+// looked up by linear scan. When we have more elements, we spill into the compact_map.
+// Erased elements in the inline storage are marked by the deleted key and zero data, so that iterators
+// and references are not invalidated by erase, as in compact_map.
+//
+
+namespace utils
+{
+  template <typename Key, typename Data, typename Empty, typename Deleted,
+	    typename Hash, typename Pred, typename Alloc>
+  class small_compact_map;
+
+  template <typename Table, typename Pointer, typename Reference, typename Tp, typename MapIterator>
+  struct __small_compact_map_iterator
+  {
+    template <typename K, typename D, typename E, typename _D, typename H, typename P, typename A>
+    friend class small_compact_map;
+
+    template <typename T, typename P, typename R, typename V, typename M>
+    friend struct __small_compact_map_iterator;
+
+    typedef std::forward_iterator_tag iterator_category;
+
+    typedef size_t    size_type;
+    typedef ptrdiff_t difference_type;
+    typedef Tp        value_type;
+    typedef Reference reference;
+    typedef Pointer   pointer;
+
+    typedef __small_compact_map_iterator<Table, Pointer, Reference, Tp, MapIterator> iterator;
+
+    __small_compact_map_iterator() : table(0), pos(0), iter() {}
+
+    template <typename T, typename P, typename R, typename V, typename M>
+    __small_compact_map_iterator(const __small_compact_map_iterator<T,P,R,V,M>& x)
+      : table(x.table), pos(x.pos), iter(x.iter) {}
+
+    __small_compact_map_iterator(const Table& __table, Pointer __pos, bool forward)
+      : table(&__table), pos(__pos), iter()
+    {
+      if (forward)
+	advance();
+    }
+
+    __small_compact_map_iterator(MapIterator __iter)
+      : table(0), pos(0), iter(__iter) {}
+
+  public:
+    reference operator*() const { return (pos ? *pos : *iter); }
+    pointer operator->() const { return &(operator*()); }
+
+    iterator& operator++()
+    {
+      if (pos) {
+	++ pos;
+	advance();
+      } else
+	++ iter;
+      return *this;
+    }
+
+    iterator operator++(int)
+    {
+      iterator tmp(*this);
+      ++ *this;
+      return tmp;
+    }
+
+    template <typename T, typename P, typename R, typename V, typename M>
+    bool operator==(const __small_compact_map_iterator<T,P,R,V,M>& x) const
+    {
+      return pos == x.pos && iter == x.iter;
+    }
+
+    template <typename T, typename P, typename R, typename V, typename M>
+    bool operator!=(const __small_compact_map_iterator<T,P,R,V,M>& x) const
+    {
+      return pos != x.pos || iter != x.iter;
+    }
+
+  private:
+    void advance()
+    {
+      for (/**/; pos != table->small_end() && table->is_deleted(pos->first); ++ pos);
+    }
+
+  private:
+    const Table* table;
+    Pointer      pos;
+    MapIterator  iter;
+  };
+
+  template <typename Key,
+	    typename Data,
+	    typename Empty,
+	    typename Deleted,
+	    typename Hash=boost::hash<Key>,
+	    typename Pred=std::equal_to<Key>,
+	    typename Alloc=std::allocator<std::pair<const Key, Data> > >
+  class small_compact_map : public Pred
+  {
+    template <typename T, typename P, typename R, typename V, typename M>
+    friend struct __small_compact_map_iterator;
+
+  public:
+    typedef Key                                    key_type;
+    typedef Data                                   mapped_type;
+    typedef std::pair<const key_type, mapped_type> value_type;
+
+    typedef utils::compact_map<Key, Data, Empty, Deleted, Hash, Pred, Alloc> map_type;
+
+    typedef size_t    size_type;
+    typedef ptrdiff_t difference_type;
+
+    typedef       value_type* pointer;
+    typedef const value_type* const_pointer;
+    typedef       value_type& reference;
+    typedef const value_type& const_reference;
+
+    typedef __small_compact_map_iterator<small_compact_map, pointer, reference, value_type,
+					 typename map_type::iterator> iterator;
+    typedef __small_compact_map_iterator<small_compact_map, const_pointer, const_reference, value_type,
+					 typename map_type::const_iterator> const_iterator;
+
+    static const size_type small_bytes = 64;
+    static const size_type small_threshold = (sizeof(value_type) >= small_bytes ? size_type(1) : small_bytes / sizeof(value_type));
+
+  private:
+    typedef small_compact_map<Key, Data, Empty, Deleted, Hash, Pred, Alloc> self_type;
+
+    typedef typename Alloc::template rebind<map_type>::other map_alloc_type;
+
+    typedef typename boost::aligned_storage<sizeof(value_type) * small_threshold,
+					    boost::alignment_of<value_type>::value>::type storage_type;
+
+  public:
+    small_compact_map(const size_type hint=0)
+      : __map(0), __used(0), __size(0) { rehash(hint); }
+    small_compact_map(const small_compact_map& x)
+      : Pred(x), __map(0), __used(0), __size(0) { assign(x); }
+    ~small_compact_map()
+    {
+      destroy_small();
+      deallocate_map();
+    }
+
+    small_compact_map& operator=(const small_compact_map& x)
+    {
+      assign(x);
+      return *this;
+    }
+
+  public:
+    void assign(const small_compact_map& x)
+    {
+      if (this == &x) return;
+
+      destroy_small();
+
+      if (x.__map) {
+	if (__map)
+	  *__map = *x.__map;
+	else
+	  __map = allocate_map(*x.__map);
+      } else {
+	deallocate_map();
+
+	const_pointer siter_end = x.small_end();
+	for (const_pointer siter = x.small_begin(); siter != siter_end; ++ siter)
+	  if (! is_deleted(siter->first)) {
+	    utils::construct_object(small_begin() + __used, *siter);
+	    ++ __used;
+	  }
+	__size = __used;
+      }
+    }
+
+    void swap(small_compact_map& x)
+    {
+      if (! __used && ! x.__used) {
+	std::swap(__map,  x.__map);
+	std::swap(__size, x.__size);
+      } else if (! __used)
+	swap_small(x);
+      else if (! x.__used)
+	x.swap_small(*this);
+      else {
+	self_type tmp(x);
+	x.assign(*this);
+	assign(tmp);
+      }
+    }
+
+  public:
+    inline mapped_type& operator[](const key_type& x)
+    {
+      if (__map)
+	return (*__map)[x];
+
+      return insert_small(value_type(x, mapped_type())).first->second;
+    }
+
+    const_iterator begin() const { return (__map ? const_iterator(__map->begin()) : const_iterator(*this, small_begin(), true)); }
+    iterator begin() { return (__map ? iterator(__map->begin()) : iterator(*this, small_begin(), true)); }
+    const_iterator end() const { return (__map ? const_iterator(__map->end()) : const_iterator(*this, small_end(), false)); }
+    iterator end() { return (__map ? iterator(__map->end()) : iterator(*this, small_end(), false)); }
+
+    bool empty() const { return size() == 0; }
+    size_type size() const { return (__map ? __map->size() : size_type(__size)); }
+    size_type occupied_count() const { return (__map ? __map->occupied_count() : size_type(__used)); }
+
+    // do we spill into the compact_map?
+    bool spilled() const { return __map; }
+
+    // raw inline storage, valid only when not spilled. Erased elements have zero data.
+    const_pointer small_begin() const { return reinterpret_cast<const_pointer>(&__storage); }
+    const_pointer small_end() const { return small_begin() + __used; }
+
+    void clear()
+    {
+      if (__map)
+	__map->clear();
+      else
+	destroy_small();
+    }
+
+    // rehash: spill into the compact_map if we need more than the inline storage
+    void rehash(size_type hint)
+    {
+      if (__map)
+	__map->rehash(hint);
+      else if (hint > small_threshold)
+	spill(hint);
+    }
+
+    // reserve: a hint used only after spilled, since the estimate may be loose
+    void reserve(size_type hint)
+    {
+      if (__map)
+	__map->rehash(hint);
+    }
+
+    const_iterator find(const key_type& x) const
+    {
+      if (__map)
+	return const_iterator(__map->find(x));
+
+      const_pointer siter_end = small_end();
+      for (const_pointer siter = small_begin(); siter != siter_end; ++ siter)
+	if (pred()(siter->first, x))
+	  return const_iterator(*this, siter, false);
+
+      return end();
+    }
+
+    iterator find(const key_type& x)
+    {
+      if (__map)
+	return iterator(__map->find(x));
+
+      pointer siter_end = small_end();
+      for (pointer siter = small_begin(); siter != siter_end; ++ siter)
+	if (pred()(siter->first, x))
+	  return iterator(*this, siter, false);
+
+      return end();
+    }
+
+    std::pair<iterator, bool> insert(const value_type& x)
+    {
+      if (__map) {
+	std::pair<typename map_type::iterator, bool> result = __map->insert(x);
+
+	return std::make_pair(iterator(result.first), result.second);
+      } else
+	return insert_small(x);
+    }
+
+    iterator insert(iterator, const value_type& x) { return insert(x).first; }
+
+    template <typename Iterator>
+    void insert(Iterator first, Iterator last)
+    {
+      for (/**/; first != last; ++ first)
+	insert(*first);
+    }
+
+    size_type erase(const key_type& key)
+    {
+      if (__map)
+	return __map->erase(key);
+
+      iterator iter = find(key);
+      if (iter == end()) return 0;
+
+      erase_small(iter.pos);
+      return 1;
+    }
+
+    void erase(iterator iter)
+    {
+      if (__map)
+	__map->erase(iter.iter);
+      else if (iter.pos != small_end() && ! is_deleted(iter.pos->first))
+	erase_small(iter.pos);
+    }
+
+    void erase(const_iterator iter)
+    {
+      if (__map)
+	__map->erase(iter.iter);
+      else if (iter.pos != small_end() && ! is_deleted(iter.pos->first))
+	erase_small(const_cast<pointer>(iter.pos));
+    }
+
+  private:
+    const Pred& pred() const { return static_cast<const Pred&>(*this); }
+
+    pointer small_begin() { return reinterpret_cast<pointer>(&__storage); }
+    pointer small_end() { return small_begin() + __used; }
+
+    bool is_deleted(const key_type& x) const
+    {
+      return pred()(x, Deleted()());
+    }
+
+    std::pair<iterator, bool> insert_small(const value_type& x)
+    {
+      pointer pos_insert = 0;
+
+      pointer siter_end = small_end();
+      for (pointer siter = small_begin(); siter != siter_end; ++ siter) {
+	if (pred()(siter->first, x.first))
+	  return std::make_pair(iterator(*this, siter, false), false);
+	else if (! pos_insert && is_deleted(siter->first))
+	  pos_insert = siter;
+      }
+
+      if (pos_insert) {
+	utils::destroy_object(pos_insert);
+	utils::construct_object(pos_insert, x);
+      } else if (__used < small_threshold) {
+	pos_insert = small_end();
+	utils::construct_object(pos_insert, x);
+	++ __used;
+      } else {
+	spill(small_threshold << 1);
+
+	std::pair<typename map_type::iterator, bool> result = __map->insert(x);
+
+	return std::make_pair(iterator(result.first), result.second);
+      }
+
+      ++ __size;
+      return std::make_pair(iterator(*this, pos_insert, false), true);
+    }
+
+    void erase_small(pointer pos)
+    {
+      utils::destroy_object(pos);
+      utils::construct_object(pos, value_type(Deleted()(), mapped_type()));
+      -- __size;
+    }
+
+    // we have no inline elements, i.e. spilled or empty, but x has: move the inline elements of x,
+    // and pass our map pointer to x, without copying the spilled table.
+    void swap_small(small_compact_map& x)
+    {
+      map_type* map = __map;
+      
+      __map = 0;
+      
+      const_pointer siter_end = x.small_end();
+      for (const_pointer siter = x.small_begin(); siter != siter_end; ++ siter) {
+	utils::construct_object(small_begin() + __used, *siter);
+	++ __used;
+      }
+      __size = x.__size;
+      
+      x.destroy_small();
+      x.__map = map;
+    }
+
+    void destroy_small()
+    {
+      utils::destroy_range(small_begin(), small_end());
+      __used = 0;
+      __size = 0;
+    }
+
+    void spill(size_type hint)
+    {
+      map_type* map = allocate_map(map_type(0));
+
+      map->rehash(hint);
+
+      const_pointer siter_end = small_end();
+      for (const_pointer siter = small_begin(); siter != siter_end; ++ siter)
+	if (! is_deleted(siter->first))
+	  map->insert(*siter);
+
+      destroy_small();
+
+      __map = map;
+    }
+
+    map_type* allocate_map(const map_type& x)
+    {
+      map_alloc_type alloc;
+
+      map_type* map = alloc.allocate(1);
+      utils::construct_object(map, x);
+      return map;
+    }
+
+    void deallocate_map()
+    {
+      if (! __map) return;
+
+      map_alloc_type alloc;
+
+      utils::destroy_object(__map);
+      alloc.deallocate(__map, 1);
+      __map = 0;
+    }
+
+  private:
+    storage_type __storage;
+    map_type*    __map;
+    uint32_t     __used;
+    uint32_t     __size;
+  };
+};
+
+namespace std
+{
+  template <typename Key, typename Data, typename Empty, typename Deleted, typename Hash, typename Pred, typename Alloc>
+  inline
+  void swap(utils::small_compact_map<Key,Data,Empty,Deleted,Hash,Pred,Alloc>& x,
+	    utils::small_compact_map<Key,Data,Empty,Deleted,Hash,Pred,Alloc>& y)
+  {
+    x.swap(y);
+  }
+
+};
+
+#endif
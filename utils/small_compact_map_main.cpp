@@ -0,0 +1,131 @@
+#include <iostream>
+#include <string>
+#include <map>
+#include <stdexcept>
+
+#include <utils/small_compact_map.hpp>
+
+struct empty_key
+{
+  const std::string& operator()() const
+  {
+    static std::string __key("");
+    
+    return __key;
+  }
+};
+
+struct deleted_key
+{
+  const std::string& operator()() const
+  {
+    static std::string __key("This is not allowed!");
+    
+    return __key;
+  }
+};
+
+typedef std::map<std::string, int>          map_map_type;
+typedef utils::small_compact_map<std::string, int, empty_key, deleted_key> vec_map_type;
+
+void check(const map_map_type& map_map, const vec_map_type& vec_map)
+{
+  if (map_map.size() != vec_map.size())
+    std::cerr << "size differ?"
+	      << " map size: " << map_map.size()
+	      << " vec size: " << vec_map.size() << std::endl;
+  
+  for (map_map_type::const_iterator miter = map_map.begin(); miter != map_map.end(); ++ miter) {
+    vec_map_type::const_iterator viter = vec_map.find(miter->first);
+    
+    if (viter == vec_map.end() || viter->second != miter->second)
+      std::cerr << "differ?"
+		<< "\tmap: " << miter->first << ": " << miter->second << std::endl;
+  }
+  
+  // inverse...
+  for (vec_map_type::const_iterator viter = vec_map.begin(); viter != vec_map.end(); ++ viter) {
+    map_map_type::const_iterator miter = map_map.find(viter->first);
+    
+    if (miter == map_map.end())
+      std::cerr << "differ?"
+		<< "\tvec: " << viter->first << ": " << viter->second << std::endl;
+  }
+}
+
+int main(int argc, char** argv)
+{
+  std::cerr << "size: " << sizeof(vec_map_type)
+	    << " threshold: " << vec_map_type::small_threshold << std::endl;
+
+  map_map_type map_map;
+  vec_map_type vec_map;
+
+  std::string token;
+  while (std::cin >> token) {
+    ++ map_map[token];
+    
+    const bool spilled = vec_map.spilled();
+    
+    ++ vec_map[token];
+    
+    if (spilled != vec_map.spilled())
+      std::cerr << "spilled at size: " << vec_map.size() << std::endl;
+  }
+  
+  check(map_map, vec_map);
+  
+  vec_map_type vec_map2 = vec_map;
+  check(map_map, vec_map2);
+  
+  for (map_map_type::const_iterator miter = map_map.begin(); miter != map_map.end(); ++ miter) {
+    vec_map_type::iterator viter = vec_map.find(miter->first);
+    if (viter == vec_map.end())
+      throw std::runtime_error("not found?");
+    
+    vec_map.erase(viter);
+    
+    if (vec_map.find(miter->first) != vec_map.end())
+      throw std::runtime_error("found?");
+  }
+  
+  std::cerr << "erased vec map" << std::endl
+	    << "map size: " << map_map.size() << std::endl
+	    << "vec size: " << vec_map.size() << std::endl;
+
+  vec_map.insert(map_map.begin(), map_map.end());
+  check(map_map, vec_map);
+  
+  for (vec_map_type::iterator viter = vec_map.begin(); viter != vec_map.end(); /**/)
+    vec_map.erase(viter ++);
+  
+  std::cerr << "incrementally erased vec map" << std::endl
+	    << "map size: " << map_map.size() << std::endl
+	    << "vec size: " << vec_map.size() << std::endl;
+  
+  // small maps, which never spill
+  {
+    map_map_type map_small;
+    vec_map_type vec_small;
+    
+    map_map_type::const_iterator miter = map_map.begin();
+    for (size_t i = 0; i != vec_map_type::small_threshold && miter != map_map.end(); ++ i, ++ miter) {
+      map_small.insert(*miter);
+      vec_small.insert(*miter);
+    }
+    
+    if (vec_small.spilled())
+      throw std::runtime_error("spilled?");
+    
+    check(map_small, vec_small);
+    
+    vec_small.swap(vec_map2);
+    check(map_small, vec_map2);
+    check(map_map, vec_small);
+    
+    // and back, from the spilled side
+    vec_small.swap(vec_map2);
+    check(map_small, vec_small);
+    check(map_map, vec_map2);
+  }
+}
@@ -48,6 +48,7 @@ namespace utils {
     {
       std::swap(__base, x.__base);
       std::swap(__size, x.__size);
+      std::swap(allocator(), x.allocator());
     }
     
     inline const_iterator begin() const { return (__size > small_threshold ? __base : reinterpret_cast<const_iterator>(&__base)); }
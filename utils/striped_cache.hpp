@@ -0,0 +1,125 @@
+// -*- mode: c++ -*-
+//
+//  Copyright(C) 2013 Taro Watanabe <taro.watanabe@nict.go.jp>
+//
+
+#ifndef __UTILS__STRIPED_CACHE__HPP__
+#define __UTILS__STRIPED_CACHE__HPP__ 1
+
+//
+// a direct-mapped cache shared among threads. Each bucket keeps a key and a shared pointer to an immutable value,
+// and buckets are guarded by a fixed number of striped spinlocks, thus, the critical section is a pointer copy.
+// An evicted value is kept alive by readers which still hold its pointer.
+//
+
+#include <vector>
+#include <memory>
+#include <functional>
+
+#include <boost/functional/hash.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/utility.hpp>
+
+#include <utils/spinlock.hpp>
+#include <utils/bithack.hpp>
+
+namespace utils
+{
+  template <typename Key, typename Value, typename Hash=boost::hash<Key>, typename Equal=std::equal_to<Key> >
+  class striped_cache : private boost::noncopyable
+  {
+  public:
+    typedef size_t    size_type;
+    typedef ptrdiff_t difference_type;
+
+    typedef Key   key_type;
+    typedef Value value_type;
+
+    typedef boost::shared_ptr<const value_type> value_ptr_type;
+
+  private:
+    typedef utils::spinlock lock_type;
+
+    // each lock is padded to a cache line, so that threads taking neighbouring stripes do not share a line
+    static const size_type cache_line_size = 64;
+
+    struct padded_lock_type
+    {
+      lock_type lock;
+      char      padding[cache_line_size - sizeof(lock_type) % cache_line_size];
+    };
+
+    struct bucket_type
+    {
+      key_type       key;
+      value_ptr_type value;
+
+      bucket_type() : key(), value() {}
+    };
+
+    typedef std::vector<bucket_type, std::allocator<bucket_type> > bucket_set_type;
+
+    static const size_type lock_size = 256;
+
+  public:
+    striped_cache(size_type __size = 1024 * 64) : buckets(bucket_size(__size)) {}
+
+  private:
+    static size_type bucket_size(size_type __size)
+    {
+      __size = (__size < size_type(lock_size) ? size_type(lock_size) : __size);
+      return (utils::bithack::is_power2(__size) ? __size : size_type(utils::bithack::next_largest_power2(__size)));
+    }
+
+  public:
+    size_type size() const { return buckets.size(); }
+
+    // returns empty pointer when not found
+    value_ptr_type find(const key_type& key) const
+    {
+      const size_type pos = hash_type()(key) & (buckets.size() - 1);
+
+      lock_type::scoped_lock lock(const_cast<lock_type&>(locks[pos & (lock_size - 1)].lock));
+
+      const bucket_type& bucket = buckets[pos];
+
+      return (bucket.value && equal_type()(bucket.key, key) ? bucket.value : value_ptr_type());
+    }
+
+    // replaces the bucket, if already occupied
+    void insert(const key_type& key, const value_ptr_type& value)
+    {
+      const size_type pos = hash_type()(key) & (buckets.size() - 1);
+
+      value_ptr_type evicted;
+      {
+	lock_type::scoped_lock lock(locks[pos & (lock_size - 1)].lock);
+
+	bucket_type& bucket = buckets[pos];
+
+	bucket.key = key;
+	evicted.swap(bucket.value);
+	bucket.value = value;
+      }
+      // the evicted value, if not referenced by others, is released outside of the lock
+    }
+
+    void clear()
+    {
+      for (size_type pos = 0; pos != buckets.size(); ++ pos) {
+	lock_type::scoped_lock lock(locks[pos & (lock_size - 1)].lock);
+
+	buckets[pos] = bucket_type();
+      }
+    }
+
+  private:
+    typedef Hash  hash_type;
+    typedef Equal equal_type;
+
+    bucket_set_type  buckets;
+    padded_lock_type locks[lock_size];
+  };
+};
+
+#endif
@@ -27,6 +27,10 @@
 #include <utils/array_power2.hpp>
 #include <utils/filesystem.hpp>
 
+#if defined(__GNUC__) && defined(__BMI2__)
+#include <immintrin.h>
+#endif
+
 namespace utils
 {
   struct __succinct_vector_base
@@ -40,6 +44,7 @@ namespace utils
     typedef uint32_t rank_high_type;
     typedef uint8_t  rank_low_type;
     typedef uint8_t  byte_type;
+    typedef uint32_t select_sample_type;
     
     static const size_type num_block_rank_high = 8;
     static const size_type num_block_rank_low = 1;
@@ -53,6 +58,11 @@ namespace utils
     static const size_type shift_block_rank_low = 5;
 
     static const block_type mask_block = 0x1f;
+
+    // select samples: the rank-high position of every 4096-th one (or zero), which narrows down the binary search
+    // over the rank-high. We do not keep samples when the rank-high is short enough for a linear search.
+    static const size_type shift_select_sample = 12;
+    static const size_type min_select_sample = 64;
     
     const byte_type* masks_select1() const
     {
@@ -212,7 +222,13 @@ namespace utils
       static inline
       size_type result(size_type first, size_type last, const Data& data, const size_type& value)
       {
-	size_type offset = first;
+	return result(first, last, data, value, first);
+      }
+      
+      // offset is the position where counting starts, which may be before the first
+      static inline
+      size_type result(size_type first, size_type last, const Data& data, const size_type& value, const size_type offset)
+      {
 	size_type length = last - first;
 	if (length <= 64) {
 	  for (/**/; first != last && (first - offset + 1) * ReverseScale - data[first] < value; ++ first) {}
@@ -272,12 +288,69 @@ namespace utils
       }
     };
     
+    // position of the x-th one within a block
+    size_type select_block(const block_type block_value, const size_type x) const
+    {
+#if defined(__GNUC__) && defined(__BMI2__)
+      return __builtin_ctz(_pdep_u32(block_type(1) << (x - 1), block_value));
+#else
+      const rank_block_type rank_block(block_value);
+      const size_type pos_byte = __lower_bound_linear<rank_block_type, 0>::result(0, rank_block.size() - 1, rank_block, x);
+      const size_type num_bits_remain = x - (pos_byte == 0 ? size_type(0) : rank_block[pos_byte - 1]);
+      
+      const byte_type byte_value = rank_block(pos_byte);
+      const size_type byte_value_count_lower = bithack::bit_count(byte_value & 0x0f);
+      
+      return (pos_byte << 3) + (byte_value_count_lower < num_bits_remain
+				? 4 + masks_select1()[4 * ((byte_value >> 4) & 0x0f) + (num_bits_remain - byte_value_count_lower - 1)]
+				: masks_select1()[4 * (byte_value & 0x0f) + (num_bits_remain - 1)]);
+#endif
+    }
+    
+    // range of rank-high which contains the x-th bit
+    template <typename RankHigh, typename Samples>
+    std::pair<size_type, size_type> select_range(const RankHigh& rank_high, const Samples& samples, size_type x) const
+    {
+      if (samples.empty() || x == 0)
+	return std::make_pair(size_type(0), size_type(rank_high.size()));
+      
+      const size_type pos = (x - 1) >> shift_select_sample;
+      
+      if (pos >= samples.size())
+	return std::make_pair(size_type(samples.back()), size_type(rank_high.size()));
+      else
+	return std::make_pair(size_type(samples[pos]), size_type(pos + 1 < samples.size() ? samples[pos + 1] + 1 : rank_high.size()));
+    }
+    
   protected:
     
-    template <typename Block, typename RankHigh, typename RankLow>
-    size_type select1(const Block& block, const RankHigh& rank_high, const RankLow& rank_low, size_type x) const
+    template <typename RankHigh, typename Samples>
+    void build_select_sample(const RankHigh& rank_high, Samples& samples1, Samples& samples0) const
     {
-      const size_type pos_high = __lower_bound<RankHigh, 0>::result(0, rank_high.size(), rank_high, x);
+      samples1.clear();
+      samples0.clear();
+      
+      if (rank_high.size() <= min_select_sample) return;
+      
+      size_type next1 = 1;
+      size_type next0 = 1;
+      for (size_type pos = 0; pos != rank_high.size(); ++ pos) {
+	const size_type count1 = rank_high[pos];
+	const size_type count0 = ((pos + 1) << shift_block_rank_high) - count1;
+	
+	for (/**/; next1 <= count1; next1 += (size_type(1) << shift_select_sample))
+	  samples1.push_back(pos);
+	for (/**/; next0 <= count0; next0 += (size_type(1) << shift_select_sample))
+	  samples0.push_back(pos);
+      }
+    }
+    
+    template <typename Block, typename RankHigh, typename RankLow, typename Samples>
+    size_type select1(const Block& block, const RankHigh& rank_high, const RankLow& rank_low, const Samples& samples, size_type x) const
+    {
+      const std::pair<size_type, size_type> range = select_range(rank_high, samples, x);
+      
+      const size_type pos_high = __lower_bound<RankHigh, 0>::result(range.first, range.second, rank_high, x);
       if (pos_high == rank_high.size()) return size_type(-1);
       size_type num_bits_remain = x - (pos_high == 0 ? size_type(0) : rank_high[pos_high - 1]);
       
@@ -289,25 +362,16 @@ namespace utils
       
       // now, pos_low is the position of block...
       const size_type pos_block = pos_high * num_block_rank_high + pos_low_diff;
-      const rank_block_type rank_block(block[pos_block]);
-      const size_type pos_byte = __lower_bound_linear<rank_block_type, 0>::result(0, rank_block.size() - 1, rank_block, num_bits_remain);
-      num_bits_remain -= (pos_byte == 0 ? size_type(0) : rank_block[pos_byte - 1]);
-      
-      size_type pos_bit = (pos_block << shift_block) + (pos_byte << 3);
-      const byte_type byte_value = rank_block(pos_byte);
-      const size_type byte_value_count_lower = bithack::bit_count(byte_value & 0x0f);
-      
-      pos_bit += (byte_value_count_lower < num_bits_remain
-		  ? 4 + masks_select1()[4 * ((byte_value >> 4) & 0x0f) + (num_bits_remain - byte_value_count_lower - 1)]
-		  : masks_select1()[4 * (byte_value & 0x0f) + (num_bits_remain - 1)]);
       
-      return pos_bit;
+      return (pos_block << shift_block) + select_block(block[pos_block], num_bits_remain);
     }
     
-    template <typename Block, typename RankHigh, typename RankLow>
-    size_type select0(const Block& block, const RankHigh& rank_high, const RankLow& rank_low, size_type x) const
+    template <typename Block, typename RankHigh, typename RankLow, typename Samples>
+    size_type select0(const Block& block, const RankHigh& rank_high, const RankLow& rank_low, const Samples& samples, size_type x) const
     {
-      const size_type pos_high = __lower_bound<RankHigh, rank_high_size>::result(0, rank_high.size(), rank_high, x);
+      const std::pair<size_type, size_type> range = select_range(rank_high, samples, x);
+      
+      const size_type pos_high = __lower_bound<RankHigh, rank_high_size>::result(range.first, range.second, rank_high, x, 0);
       if (pos_high == rank_high.size()) return size_type(-1);
       size_type num_bits_remain = x - (pos_high == 0 ? size_type(0) : (pos_high << shift_block_rank_high) - rank_high[pos_high - 1]);
       
@@ -319,19 +383,8 @@ namespace utils
       
       // now, pos_low is the position of block...
       const size_type pos_block = pos_high * num_block_rank_high + pos_low_diff;
-      const rank_block_type rank_block(block[pos_block]);
-      const size_type pos_byte = __lower_bound_linear<rank_block_type, 8>::result(0, rank_block.size() - 1, rank_block, num_bits_remain);
-      num_bits_remain -= (pos_byte == 0 ? size_type(0) : (pos_byte << 3) - rank_block[pos_byte - 1]);
-      
-      size_type pos_bit = (pos_block << shift_block) + (pos_byte << 3);
-      const byte_type byte_value = rank_block(pos_byte);
-      const size_type byte_value_count_lower = 4 - bithack::bit_count(byte_value & 0x0f);
       
-      pos_bit += (byte_value_count_lower < num_bits_remain
-		  ? 4 + masks_select0()[4 * ((byte_value >> 4) & 0x0f) + (num_bits_remain - byte_value_count_lower - 1)]
-		  : masks_select0()[4 * (byte_value & 0x0f) + (num_bits_remain - 1)]);
-      
-      return pos_bit;
+      return (pos_block << shift_block) + select_block(~block[pos_block], num_bits_remain);
     }
     
     template <typename Block, typename RankHigh, typename RankLow>
@@ -381,6 +434,9 @@ namespace utils
     typedef typename _Alloc::template rebind<cache_type>::other cache_allocator_type;
     typedef std::vector<cache_type, cache_allocator_type > cache_set_type;
 
+    typedef typename _Alloc::template rebind<select_sample_type>::other select_sample_allocator_type;
+    typedef std::vector<select_sample_type, select_sample_allocator_type> select_sample_set_type;
+
   public:
     succinct_vector_mapped()
       : __size(0), __blocks(), __rank_high(), __rank_low() {}
@@ -398,7 +454,11 @@ namespace utils
     
     uint64_t size_bytes() const { return __blocks.size_bytes() + __rank_high.size_bytes() + __rank_low.size_bytes(); }
     uint64_t size_compressed() const { return __blocks.size_compressed() + __rank_high.size_compressed() + __rank_low.size_compressed(); }
-    uint64_t size_cache() const { return __cache_select0.size() * sizeof(cache_type) + __cache_select1.size() * sizeof(cache_type); }
+    uint64_t size_cache() const
+    {
+      return (__cache_select0.size() * sizeof(cache_type) + __cache_select1.size() * sizeof(cache_type)
+	      + __select_sample0.size() * sizeof(select_sample_type) + __select_sample1.size() * sizeof(select_sample_type));
+    }
     
     void clear()
     {
@@ -409,6 +469,9 @@ namespace utils
       
       __cache_select0.clear();
       __cache_select1.clear();
+      
+      __select_sample0.clear();
+      __select_sample1.clear();
     }
     void close() { clear(); }
 
@@ -422,6 +485,9 @@ namespace utils
       __cache_select0.swap(x.__cache_select0);
       __cache_select1.swap(x.__cache_select1);
       
+      __select_sample0.swap(x.__select_sample0);
+      __select_sample1.swap(x.__select_sample1);
+      
       std::swap(__select0_mask_pos,    x.__select0_mask_pos);
       std::swap(__select0_mask_select, x.__select0_mask_select);
       std::swap(__select1_mask_pos,    x.__select1_mask_pos);
@@ -451,8 +517,8 @@ namespace utils
 	return __select;
       
       __select = (bit 
-		  ? base_type::select1(__blocks, __rank_high, __rank_low, pos)
-		  : base_type::select0(__blocks, __rank_high, __rank_low, pos));
+		  ? base_type::select1(__blocks, __rank_high, __rank_low, __select_sample1, pos)
+		  : base_type::select0(__blocks, __rank_high, __rank_low, __select_sample0, pos));
       
       cache_new.value = ((uint64_t(pos) << 32) & mask_pos) | (uint64_t(__select) & mask_select);
       
@@ -520,6 +586,9 @@ namespace utils
       __select1_mask_pos = (~uint64_t(__cache_select1.size() - 1)) << 32;
       __select0_mask_select = ~__select0_mask_pos;
       __select1_mask_select = ~__select1_mask_pos;
+      
+      // select samples are not stored, but computed from the rank-high
+      base_type::build_select_sample(__rank_high, __select_sample1, __select_sample0);
     }
     
     void write(const path_type& file) const
@@ -574,6 +643,9 @@ namespace utils
   private:
     cache_set_type __cache_select0;
     cache_set_type __cache_select1;
+    
+    select_sample_set_type __select_sample0;
+    select_sample_set_type __select_sample1;
 
     uint64_t __select0_mask_pos;
     uint64_t __select0_mask_select;
@@ -609,6 +681,9 @@ namespace utils
     typedef std::vector<block_type, block_allocator_type>         bit_block_type;
     typedef std::vector<rank_high_type, rank_high_allocator_type> bit_rank_high_type;
     typedef std::vector<rank_low_type, rank_low_allocator_type>   bit_rank_low_type;
+    
+    typedef typename _Alloc::template rebind<select_sample_type>::other select_sample_allocator_type;
+    typedef std::vector<select_sample_type, select_sample_allocator_type> select_sample_set_type;
 
     typedef __succinct_vector_base base_type;
 
@@ -621,14 +696,19 @@ namespace utils
       : __size(0),
 	__blocks(),
 	__rank_high(),
-	__rank_low() {}
+	__rank_low(),
+	__select_sample1(),
+	__select_sample0() {}
     
     template <typename __Alloc>
     succinct_vector(const succinct_vector_mapped<__Alloc>& x)
       : __size(x.__size),
 	__blocks(x.__blocks.begin(), x.__blocks.end()),
 	__rank_high(x.__rank_high.begin(), x.__rank_high.end()),
-	__rank_low(x.__rank_low.begin(), x.__rank_low.end()) {}
+	__rank_low(x.__rank_low.begin(), x.__rank_low.end())
+    {
+      base_type::build_select_sample(__rank_high, __select_sample1, __select_sample0);
+    }
     
     template <typename __Alloc>
     succinct_vector& operator=(const succinct_vector_mapped<__Alloc>& x)
@@ -637,6 +717,8 @@ namespace utils
       __blocks.assign(x.__blocks.begin(), x.__blocks.end());
       __rank_high.assign(x.__rank_high.begin(), x.__rank_high.end());
       __rank_low.assign(x.__rank_low.begin(), x.__rank_low.end());
+      
+      base_type::build_select_sample(__rank_high, __select_sample1, __select_sample0);
       return *this;
     }
     
@@ -644,6 +726,8 @@ namespace utils
     {
       __rank_high.clear();
       __rank_low.clear();
+      __select_sample1.clear();
+      __select_sample0.clear();
 
       const size_type block_pos = pos >> shift_block;
       const size_type mask_pos  = pos & mask_block;
@@ -670,7 +754,10 @@ namespace utils
 	      + __rank_low.size() * sizeof(rank_low_type));
     }
     uint64_t size_compressed() const { return size_bytes(); }
-    uint64_t size_cache() const { return 0; }
+    uint64_t size_cache() const
+    {
+      return __select_sample1.size() * sizeof(select_sample_type) + __select_sample0.size() * sizeof(select_sample_type);
+    }
     
     void clear()
     {
@@ -678,6 +765,8 @@ namespace utils
       __blocks.clear();
       __rank_high.clear();
       __rank_low.clear();
+      __select_sample1.clear();
+      __select_sample0.clear();
     }
 
     void swap(succinct_vector& x)
@@ -686,6 +775,8 @@ namespace utils
       __blocks.swap(x.__blocks);
       __rank_high.swap(x.__rank_high);
       __rank_low.swap(x.__rank_low);
+      __select_sample1.swap(x.__select_sample1);
+      __select_sample0.swap(x.__select_sample0);
     }
     
     size_type select(size_type pos, bool bit) const
@@ -694,8 +785,8 @@ namespace utils
 	throw std::runtime_error("no ranks...");
       
       return (bit 
-	      ? base_type::select1(__blocks, __rank_high, __rank_low, pos)
-	      : base_type::select0(__blocks, __rank_high, __rank_low, pos));
+	      ? base_type::select1(__blocks, __rank_high, __rank_low, __select_sample1, pos)
+	      : base_type::select0(__blocks, __rank_high, __rank_low, __select_sample0, pos));
     }
     
     size_type rank(size_type pos, bool bit) const
@@ -708,10 +799,13 @@ namespace utils
     }
 
     
-    void build()
+    // when select_sample is false, select binary-searches the whole rank-high
+    void build(const bool select_sample=true)
     {
       __rank_high.clear();
       __rank_low.clear();
+      __select_sample1.clear();
+      __select_sample0.clear();
       
       rank_high_type sum = 0;
       rank_high_type sum_low = 0;
@@ -736,6 +830,9 @@ namespace utils
       
       if ((i & mask_dump) != 0 || sum == 0)
 	__rank_high.push_back(sum);
+      
+      if (select_sample)
+	base_type::build_select_sample(__rank_high, __select_sample1, __select_sample0);
     }
 
     void write(const path_type& path) const
@@ -780,6 +877,9 @@ namespace utils
     bit_block_type     __blocks;
     bit_rank_high_type __rank_high;
     bit_rank_low_type  __rank_low;
+    
+    select_sample_set_type __select_sample1;
+    select_sample_set_type __select_sample0;
   };
   
 };
@@ -2,19 +2,122 @@
 //  Copyright(C) 2010-2011 Taro Watanabe <taro.watanabe@nict.go.jp>
 //
 
+// succinct_vector_main             : randomized test against std::vector<bool>
+// succinct_vector_main bits [ones] : ns/select with and without select samples, e.g. 1000000000 bits, 0.5 ones (default)
+
+#include <cstdlib>
 #include <iostream>
 #include <vector>
 
 #include "utils/succinct_vector.hpp"
+#include "utils/resource.hpp"
+
+typedef utils::succinct_vector<std::allocator<char> > succinct_vector_type;
+typedef std::vector<size_t, std::allocator<size_t> > position_set_type;
+
+double benchmark(const succinct_vector_type& bvector, const position_set_type& positions, const bool bit, position_set_type& selected)
+{
+  selected.clear();
+  selected.reserve(positions.size());
+  
+  utils::resource start;
+  
+  for (position_set_type::const_iterator piter = positions.begin(); piter != positions.end(); ++ piter)
+    selected.push_back(bvector.select(*piter, bit));
+  
+  utils::resource end;
+  
+  return (end.thread_time() - start.thread_time()) * 1e9 / positions.size();
+}
+
+void benchmark(const size_t size, const double ones)
+{
+  std::cout << "popcount: "
+#if defined(__GNUC__) && defined(__POPCNT__)
+	    << "popcnt"
+#else
+	    << "table"
+#endif
+	    << " select in block: "
+#if defined(__GNUC__) && defined(__BMI2__)
+	    << "pdep/tzcnt"
+#else
+	    << "table"
+#endif
+	    << std::endl;
+  
+  // xorshift, since random() is too slow for 1e9 bits
+  uint64_t state = 88172645463325252LLU;
+  const uint64_t threshold = uint64_t(ones * double(uint64_t(-1)));
+  
+  succinct_vector_type bvector;
+  size_t num_ones = 0;
+  for (size_t pos = 0; pos != size; ++ pos) {
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+    
+    if (state <= threshold) {
+      bvector.set(pos);
+      ++ num_ones;
+    }
+  }
+  if (bvector.size() != size)
+    bvector.set(size - 1, false);
+  
+  const size_t num_zeros = size - num_ones;
+  const size_t num_queries = 1024 * 1024;
+  
+  position_set_type positions1;
+  position_set_type positions0;
+  for (size_t i = 0; i != num_queries; ++ i) {
+    if (num_ones)
+      positions1.push_back(1 + (random() % num_ones));
+    if (num_zeros)
+      positions0.push_back(1 + (random() % num_zeros));
+  }
+  
+  position_set_type selected1_full;
+  position_set_type selected0_full;
+  position_set_type selected1_sampled;
+  position_set_type selected0_sampled;
+  
+  bvector.build(false);
+  const double select1_full = benchmark(bvector, positions1, true,  selected1_full);
+  const double select0_full = benchmark(bvector, positions0, false, selected0_full);
+  
+  bvector.build(true);
+  const double select1_sampled = benchmark(bvector, positions1, true,  selected1_sampled);
+  const double select0_sampled = benchmark(bvector, positions0, false, selected0_sampled);
+  
+  std::cout << "bits: " << size << " ones: " << num_ones << " zeros: " << num_zeros << std::endl
+	    << "samples: " << bvector.size_cache() << " bytes" << std::endl
+	    << "select1 full:    " << select1_full << " ns/select" << std::endl
+	    << "select1 sampled: " << select1_sampled << " ns/select" << std::endl
+	    << "select0 full:    " << select0_full << " ns/select" << std::endl
+	    << "select0 sampled: " << select0_sampled << " ns/select" << std::endl;
+  
+  for (size_t i = 0; i != selected1_full.size(); ++ i)
+    if (selected1_full[i] != selected1_sampled[i] || ! bvector.test(selected1_full[i]) || bvector.rank(selected1_full[i], true) != positions1[i])
+      std::cout << "DIFFER for select1: " << positions1[i] << std::endl;
+  for (size_t i = 0; i != selected0_full.size(); ++ i)
+    if (selected0_full[i] != selected0_sampled[i] || bvector.test(selected0_full[i]) || bvector.rank(selected0_full[i], false) != positions0[i])
+      std::cout << "DIFFER for select0: " << positions0[i] << std::endl;
+}
 
 int main(int argc, char** argv)
 {
+  if (argc > 1) {
+    benchmark(std::strtoull(argv[1], 0, 10), argc > 2 ? std::atof(argv[2]) : 0.5);
+    return 0;
+  }
+  
   srandom(time(0) * getpid());
 
   for (int samples = 0; samples < 10; ++ samples) {
     
     std::vector<bool> stdvector(2048 + 7);
-    utils::succinct_vector<std::allocator<char> > bvector;
+    succinct_vector_type bvector;
     for (int i = 0; i < 2048 + 7; ++ i) {
       const int pos = random() % (2048 + 7);
       bvector.set(pos); 
@@ -28,11 +131,11 @@ int main(int argc, char** argv)
     utils::succinct_vector_mapped<std::allocator<char> > bvector_mapped;
     bvector_mapped.open("tmptmp-succinct");
     
-    utils::succinct_vector<std::allocator<char> > bvector_copied(bvector_mapped);
+    succinct_vector_type bvector_copied(bvector_mapped);
 
     uint32_t rank1 = 0;
     uint32_t rank0 = 0;
-    for (int i = 0; i < bvector.size(); ++ i) {
+    for (succinct_vector_type::size_type i = 0; i != bvector.size(); ++ i) {
       std::cout << "i = " << i << " value: " << bvector.test(i) << std::endl;
       
       if (bvector.test(i) != stdvector[i])